@@ -51,6 +51,7 @@
 #if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
   #include <stdint.h>
   extern uint32_t SystemCoreClock;
+  extern uint64_t Time_Get64(void);
 #endif
 #define configENABLE_FPU                         1
 #define configENABLE_MPU                         0
@@ -64,7 +65,7 @@
 #define configTICK_RATE_HZ                       ((TickType_t)1000)
 #define configMAX_PRIORITIES                     ( 15 )
 #define configMINIMAL_STACK_SIZE                 ((uint16_t)128)
-#define configTOTAL_HEAP_SIZE                    ((size_t)10000)
+#define configTOTAL_HEAP_SIZE                    ((size_t)16000)
 #define configMAX_TASK_NAME_LEN                  ( 16 )
 #define configUSE_TRACE_FACILITY                 1
 #define configUSE_16_BIT_TICKS                   0
@@ -74,7 +75,7 @@
 #define configUSE_COUNTING_SEMAPHORES            1
 #define configUSE_PORT_OPTIMISED_TASK_SELECTION  1
 
-#define configGENERATE_RUN_TIME_STATS            0
+#define configGENERATE_RUN_TIME_STATS            1
 
 /* USER CODE BEGIN MESSAGE_BUFFER_LENGTH_TYPE */
 /* Defaults to size_t for backward compatibility, but can be changed
@@ -156,6 +157,12 @@ standard names. */
 
 /* USER CODE BEGIN Defines */   	      
 /* Section where parameter definitions can be added (for instance, to override default ones in FreeRTOS.h) */
+/* Run time stats count Time_Get64 ticks / 64, so the CPU time of each task and
+   of idle can be read in the debugger (ulRunTimeCounter). The 32 bit
+   counter then wraps every 27 minutes at 170 ticks/uS instead of every 25 S.
+   TIM2 is started before the scheduler. */
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()        ((uint32_t)(Time_Get64() >> 6))
 /* USER CODE END Defines */ 
 
 #endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,85 @@
+/******************************************************************************
+* File:                    FreeRTOSConfig.h
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       FreeRTOS settings for the host build, on the
+*                          POSIX port. Kept in step with the firmware's
+*                          FreeRTOS/FreeRTOSConfig.h where the firmware can
+*                          see the difference (priorities, tick rate, the
+*                          syscall interupt priority and the APIs used).
+******************************************************************************/
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <assert.h>
+#include <stdint.h>
+
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+#define configUSE_PREEMPTION                     1
+#define configSUPPORT_STATIC_ALLOCATION          0
+#define configSUPPORT_DYNAMIC_ALLOCATION         1
+#define configUSE_TICK_HOOK                      0
+#define configTICK_RATE_HZ                       ((TickType_t)1000)
+#define configMAX_PRIORITIES                     ( 15 )
+#define configMAX_TASK_NAME_LEN                  ( 16 )
+#define configUSE_TRACE_FACILITY                 1
+#define configUSE_16_BIT_TICKS                   0
+#define configUSE_MUTEXES                        1
+#define configQUEUE_REGISTRY_SIZE                8
+#define configUSE_RECURSIVE_MUTEXES              1
+#define configUSE_COUNTING_SEMAPHORES            1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION  0
+#define configMESSAGE_BUFFER_LENGTH_TYPE         size_t
+#define configUSE_CO_ROUTINES                    0
+#define configMAX_CO_ROUTINE_PRIORITIES          ( 2 )
+
+// The idle hook tells the hardware task when every firmware task has gone idle
+#define configUSE_IDLE_HOOK                      1
+
+// Each task is a pthread with its own stack, the sizes given to xTaskCreate
+// only need to be big enough for the kernel's bookkeeping
+#define configMINIMAL_STACK_SIZE                 ((uint16_t)1024)
+#define configTOTAL_HEAP_SIZE                    ((size_t)(1024 * 1024))
+
+// Run time stats count host CPU microseconds. The simulated TIM2 time
+// stands still while tasks run, so it would charge every task nothing.
+#define configGENERATE_RUN_TIME_STATS            1
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()         HostSim_GetRunTimeCounter()
+uint32_t HostSim_GetRunTimeCounter(void);
+
+#define configUSE_TIMERS                         1
+#define configTIMER_TASK_PRIORITY                ( 4 )
+#define configTIMER_QUEUE_LENGTH                 10
+#define configTIMER_TASK_STACK_DEPTH             1024
+
+#define INCLUDE_vTaskPrioritySet                 1
+#define INCLUDE_uxTaskPriorityGet                1
+#define INCLUDE_vTaskDelete                      0
+#define INCLUDE_vTaskCleanUpResources            0
+#define INCLUDE_vTaskSuspend                     1
+#define INCLUDE_vTaskDelayUntil                  1
+#define INCLUDE_xTaskDelayUntil                  1
+#define INCLUDE_vTaskDelay                       1
+#define INCLUDE_xTaskGetSchedulerState           1
+#define INCLUDE_xTaskGetCurrentTaskHandle        1
+#define INCLUDE_xTimerPendFunctionCall           1
+#define INCLUDE_xQueueGetMutexHolder             1
+#define INCLUDE_uxTaskGetStackHighWaterMark      1
+#define INCLUDE_eTaskGetState                    1
+
+// The firmware sets its interupt priorities from these, the simulated NVIC
+// keeps them but every handler runs with the tick masked
+#define configLIBRARY_LOWEST_INTERRUPT_PRIORITY      15
+#define configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY 5
+
+#define configASSERT( x )                        assert( x )
+
+
+#endif // ifdef FREERTOS_CONFIG_H
@@ -0,0 +1,503 @@
+/******************************************************************************
+* File:                    HostBench.c
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Host benchmarks, see HostBench.h.
+*
+* Each output is switched on and off once per 720* cycle, evenly spread over
+* the cycle like the coils and injectors of an 8 cylinder, and the outputs are
+* shared out over the scheduler channels. Like the fuel injectors, each event
+* queues the next one from the compare interupt. The outputs drive no pins,
+* the events are timed from the core time HostSim models, so an event is late
+* when the TIM8 handler waited on another handler.
+*
+* The fuel benchmark runs the fuel task's work for one engine cycle, the
+* sensor conversions, the steady state fuel and the transient step, over a
+* spread of rpm, MAP and TPS, timed by the PC's clock.
+*
+* The snapshot benchmark times what the ignition task reads before each spark,
+* the current angle, the time and the uS per degree. Before the decoder
+* published snapshots each was a getter that took the status mutex, and for
+* patterns decoded in the ISRs masked interupts too, and worked the answer out
+* from the last 4 primary events. Those getters are kept here, over a copy of
+* the status they read, and timed against TriggerDecoder_GetSnapshot.
+*******************************************************************************
+* Includes
+******************************************************************************/
+#include "HostBench.h"
+#include "HostSim.h"
+
+#include "Scheduler.h"
+#include "Time.h"
+#include "FuelControl.h"
+#include "Calibration.h"
+#include "TriggerDecoder.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+// Coil dwell and injector pulse, the injectors stay open for most of the cycle
+// at 12000 rpm
+#define HOSTBENCH_DWELL             TIME_US_TO_TICKS(3000U)
+#define HOSTBENCH_PULSE             TIME_US_TO_TICKS(6000U)
+
+// Time from starting to the first event
+#define HOSTBENCH_START_DELAY       TIME_US_TO_TICKS(1000U)
+
+
+/******************************************************************************
+* Public Types
+******************************************************************************/
+typedef struct{
+    uint32_t channel;
+    uint32_t onTime;                // Time the output is next switched on
+    uint32_t width;                 // Ticks it stays on
+    uint64_t firstOn;               // Time_Get64 time of its first switch on
+}hostBenchOutput_t;
+
+// What the locked getters read, as the decoder kept it before snapshots
+typedef struct{
+    const triggerPattern_t * pattern;
+    uint32_t trusted;               // Sync confidence above TRIGGER_MIN_SYNC_CONFIDENCE
+    uint32_t lastPrimaryEventNumber;
+    uint32_t pastPrimaryEvents[4];  // Time (uS) of the newest primary event first
+}hostBenchLockedStatus_t;
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+/******************************************************************************
+* Private Function Prototypes (static)
+******************************************************************************/
+static void hostBench_on(void * argument);
+static void hostBench_off(void * argument);
+static void hostBench_queue(hostBenchOutput_t * output, uint32_t time, schedulerCallback_t callback);
+static void hostBench_event(uint32_t due);
+static float hostBench_fuelCycle(fuelTransient_t * state, uint32_t cycle);
+static void hostBench_lockStatus(void);
+static void hostBench_unlockStatus(void);
+static float hostBench_primaryAngleSpan(uint32_t eventsBack);
+static float hostBench_lockedCurrentAngle(void);
+static float hostBench_lockedUsPerDegree(void);
+static double hostBench_nanoseconds(const struct timespec * start, const struct timespec * end);
+
+/******************************************************************************
+* Private Variables (static)
+******************************************************************************/
+static hostBenchOutput_t hostBenchOutputs[HOSTBENCH_OUTPUTS];
+static hostBenchStats_t hostBenchStats;
+
+static uint32_t hostBenchPeriod;
+static uint32_t hostBenchRunning;
+
+static hostBenchLockedStatus_t hostBenchStatus;
+static SemaphoreHandle_t hostBenchStatusMutex;
+
+/******************************************************************************
+* Function Code
+******************************************************************************/
+
+
+/******************************************************************************
+* void HostBench_Start(double rpm)
+* Spreads the outputs over the cycle and queues the first switch on of each.
+* Output x goes on the scheduler channel x % SCHEDULER_CHANNELS.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void HostBench_Start(double rpm){
+    uint32_t offset;
+    uint32_t x;
+
+    memset(&hostBenchStats, 0, sizeof(hostBenchStats));
+
+    // Ticks per 720* cycle
+    hostBenchPeriod = (uint32_t) TIME_US_TO_TICKS(120000000.0 / rpm);
+    hostBenchRunning = 1;
+
+    for(x = 0; x < HOSTBENCH_OUTPUTS; x++){
+        offset = HOSTBENCH_START_DELAY + ((hostBenchPeriod / HOSTBENCH_COILS) * (x % HOSTBENCH_COILS));
+
+        hostBenchOutputs[x].channel = x % SCHEDULER_CHANNELS;
+        hostBenchOutputs[x].width = (x < HOSTBENCH_COILS) ? HOSTBENCH_DWELL : HOSTBENCH_PULSE;
+        hostBenchOutputs[x].onTime = Time_GetTicks() + offset;
+        hostBenchOutputs[x].firstOn = Time_Get64() + offset;
+
+        if(Scheduler_Add(hostBenchOutputs[x].channel, hostBenchOutputs[x].onTime, &hostBench_on, (void *) &hostBenchOutputs[x]) != SCHEDULER_OK){
+            hostBenchStats.full++;
+        }
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void HostBench_Stop(void)
+* Stops the outputs queueing their next event, and counts the switch ons and
+* offs that fell due while running
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void HostBench_Stop(void){
+    uint64_t now;
+    uint32_t x;
+
+    hostBenchRunning = 0;
+    now = Time_Get64();
+
+    hostBenchStats.expected = 0;
+    for(x = 0; x < HOSTBENCH_OUTPUTS; x++){
+        if(now >= hostBenchOutputs[x].firstOn){
+            hostBenchStats.expected += (uint32_t)((now - hostBenchOutputs[x].firstOn) / hostBenchPeriod) + 1U;
+        }
+        if(now >= hostBenchOutputs[x].firstOn + hostBenchOutputs[x].width){
+            hostBenchStats.expected += (uint32_t)((now - hostBenchOutputs[x].firstOn - hostBenchOutputs[x].width) / hostBenchPeriod) + 1U;
+        }
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void HostBench_GetStats(hostBenchStats_t * stats)
+* Copies what the benchmark measured
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void HostBench_GetStats(hostBenchStats_t * stats){
+    *stats = hostBenchStats;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void HostBench_Fuel(hostBenchFuel_t * result)
+* Times HOSTBENCH_FUEL_CYCLES engine cycles of pulse widths. Then runs the
+* transient with the wall fraction at 1 and past it, which would divide by
+* zero or go negative if it were not held below 1, and counts every pulse
+* that is not a number or is negative.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void HostBench_Fuel(hostBenchFuel_t * result){
+    static const float fractions[] = {1.0f, 1.5f};
+    fuelTransient_t state;
+    struct timespec start;
+    struct timespec end;
+    volatile float sink = 0;
+    float savedFraction;
+    uint32_t x;
+    uint32_t y;
+
+    memset(result, 0, sizeof(*result));
+    memset(&state, 0, sizeof(state));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(x = 0; x < HOSTBENCH_FUEL_CYCLES; x++){
+        sink += hostBench_fuelCycle(&state, x);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    result->cycles = HOSTBENCH_FUEL_CYCLES;
+    result->nsPerCycle = hostBench_nanoseconds(&start, &end) / (double) HOSTBENCH_FUEL_CYCLES;
+
+    savedFraction = fuelWallFraction;
+    for(y = 0; y < (sizeof(fractions) / sizeof(fractions[0])); y++){
+        fuelWallFraction = fractions[y];
+        memset(&state, 0, sizeof(state));
+        for(x = 0; x < 1000U; x++){
+            hostBench_fuelCycle(&state, x);
+            if(!isfinite(state.pulse[0]) || (state.pulse[0] < 0)){
+                result->bad++;
+            }
+        }
+    }
+    fuelWallFraction = savedFraction;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void HostBench_Snapshot(const triggerPattern_t * pattern, hostBenchSnapshot_t * result)
+* Lays out the locked status from a snapshot, the last 4 primary events at
+* the speed the decoder has now, then times HOSTBENCH_SNAPSHOT_READS spark
+* reads each way. The mutex is never held by anyone else, so this is the
+* cost with no wait.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void HostBench_Snapshot(const triggerPattern_t * pattern, hostBenchSnapshot_t * result){
+    triggerSnapshot_t snapshot;
+    struct timespec start;
+    struct timespec end;
+    volatile float sink = 0;
+    uint32_t eventTime;
+    uint32_t x;
+
+    memset(result, 0, sizeof(*result));
+    if(hostBenchStatusMutex == 0){
+        hostBenchStatusMutex = xSemaphoreCreateMutex();
+    }
+
+    TriggerDecoder_GetSnapshot(&snapshot);
+    hostBenchStatus.pattern = pattern;
+    hostBenchStatus.trusted = (snapshot.currentAngle >= 0);
+    hostBenchStatus.lastPrimaryEventNumber = pattern->primaryEventCount - 1U;
+    eventTime = TIME_TICKS_TO_US(snapshot.timeStamp);
+    hostBenchStatus.pastPrimaryEvents[0] = eventTime;
+    for(x = 1; x < 4U; x++){
+        hostBenchStatus.pastPrimaryEvents[x] = eventTime - (uint32_t)(snapshot.usPerDegree * hostBench_primaryAngleSpan(x));
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(x = 0; x < HOSTBENCH_SNAPSHOT_READS; x++){
+        sink += hostBench_lockedCurrentAngle();
+        sink += (float) TIME_TICKS_TO_US(Time_GetTicks());
+        sink += hostBench_lockedUsPerDegree();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    result->lockedNs = hostBench_nanoseconds(&start, &end) / (double) HOSTBENCH_SNAPSHOT_READS;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(x = 0; x < HOSTBENCH_SNAPSHOT_READS; x++){
+        TriggerDecoder_GetSnapshot(&snapshot);
+        sink += snapshot.currentAngle + (float) snapshot.timeStamp + snapshot.usPerDegree;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    result->snapshotNs = hostBench_nanoseconds(&start, &end) / (double) HOSTBENCH_SNAPSHOT_READS;
+
+    result->reads = HOSTBENCH_SNAPSHOT_READS;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostBench_lockStatus(void)
+* void hostBench_unlockStatus(void)
+* Lock the status as the decoder did, against its task and, for patterns that
+* decode in the ISR, against the trigger ISRs
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostBench_lockStatus(void){
+    xSemaphoreTake(hostBenchStatusMutex, portMAX_DELAY);
+    if(hostBenchStatus.pattern->decodeInIsr){
+        taskENTER_CRITICAL();
+    }
+}
+
+static void hostBench_unlockStatus(void){
+    if(hostBenchStatus.pattern->decodeInIsr){
+        taskEXIT_CRITICAL();
+    }
+    xSemaphoreGive(hostBenchStatusMutex);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* float hostBench_primaryAngleSpan(uint32_t eventsBack)
+* Returns the crank angle covered between the primary event seen eventsBack
+* events ago and the most recent primary event
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static float hostBench_primaryAngleSpan(uint32_t eventsBack){
+    const triggerPattern_t * pattern = hostBenchStatus.pattern;
+    uint32_t oldest;
+    float newestAngle;
+    float oldestAngle;
+
+    if(hostBenchStatus.lastPrimaryEventNumber >= eventsBack){
+        oldest = hostBenchStatus.lastPrimaryEventNumber - eventsBack;
+    }
+    else{
+        oldest = hostBenchStatus.lastPrimaryEventNumber + pattern->primaryEventCount - eventsBack;
+    }
+
+    newestAngle = pattern->primaryEventAngles[hostBenchStatus.lastPrimaryEventNumber];
+    oldestAngle = pattern->primaryEventAngles[oldest];
+    if(newestAngle > oldestAngle){
+        return newestAngle - oldestAngle;
+    }
+    return (720 - oldestAngle) + newestAngle;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* float hostBench_lockedCurrentAngle(void)
+* float hostBench_lockedUsPerDegree(void)
+* The decoder's angle and speed getters as they were before snapshots
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static float hostBench_lockedCurrentAngle(void){
+    float newestAngle;
+    float degreesPerUS;
+    int32_t newestAngleTime;
+    int32_t deltaTime;
+    int32_t currentTime;
+    float currentAngle;
+
+    hostBench_lockStatus();
+
+    if(hostBenchStatus.trusted){
+        newestAngle = hostBenchStatus.pattern->primaryEventAngles[hostBenchStatus.lastPrimaryEventNumber];
+        newestAngleTime = (int32_t) hostBenchStatus.pastPrimaryEvents[0];
+        deltaTime = newestAngleTime - (int32_t) hostBenchStatus.pastPrimaryEvents[3];
+        degreesPerUS = hostBench_primaryAngleSpan(3) / ((float) deltaTime);
+
+        currentTime = (int32_t) TIME_TICKS_TO_US(Time_GetTicks());
+        currentAngle = (((float)(currentTime - newestAngleTime)) * degreesPerUS) + newestAngle;
+        if(currentAngle >= 720){
+            currentAngle = currentAngle - 720;
+        }
+    }
+    else{
+        currentAngle = -1;
+    }
+
+    hostBench_unlockStatus();
+
+    return currentAngle;
+}
+
+static float hostBench_lockedUsPerDegree(void){
+    int32_t deltaTime;
+    float uSPerDegree;
+
+    hostBench_lockStatus();
+
+    if(hostBenchStatus.trusted){
+        deltaTime = (int32_t) hostBenchStatus.pastPrimaryEvents[0] - (int32_t) hostBenchStatus.pastPrimaryEvents[3];
+        uSPerDegree = ((float) deltaTime) / hostBench_primaryAngleSpan(3);
+    }
+    else{
+        uSPerDegree = -1;
+    }
+
+    hostBench_unlockStatus();
+
+    return uSPerDegree;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* double hostBench_nanoseconds(const struct timespec * start, const struct timespec * end)
+* Returns the nS from start to end
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static double hostBench_nanoseconds(const struct timespec * start, const struct timespec * end){
+    return ((double)(end->tv_sec - start->tv_sec) * 1e9) + (double)(end->tv_nsec - start->tv_nsec);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* float hostBench_fuelCycle(fuelTransient_t * state, uint32_t cycle)
+* One engine cycle of the fuel task's pulse width work, with the rpm, MAP and
+* TPS stepped round on each cycle so no two cycles in a row are the same.
+* Returns the first cylinder's pulse.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static float hostBench_fuelCycle(fuelTransient_t * state, uint32_t cycle){
+    float rpm;
+    float map;
+    float tps;
+
+    rpm = 800.0f + (100.0f * (float)(cycle % 64U));
+    map = (float) Calibration_Convert(SENSOR_MAP, (uint16_t)(cycle * 977U)) * 0.1f;
+    tps = (float) Calibration_Convert(SENSOR_TPS, (uint16_t)(cycle * 1499U)) * 0.1f;
+    (void) Calibration_Convert(SENSOR_BAT, (uint16_t)(cycle * 31U));
+
+    FuelControl_UpdateTransient(state, FuelControl_CalcFuel(rpm, map), tps, map, 120000000.0f / rpm);
+
+    return state->pulse[0];
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostBench_on(void * argument)
+* void hostBench_off(void * argument)
+* Switch an output on and queue its switch off, or off and queue the next
+* switch on a cycle after the last
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostBench_on(void * argument){
+    hostBenchOutput_t * output = (hostBenchOutput_t *) argument;
+
+    hostBench_event(output->onTime);
+    hostBench_queue(output, output->onTime + output->width, &hostBench_off);
+}
+
+static void hostBench_off(void * argument){
+    hostBenchOutput_t * output = (hostBenchOutput_t *) argument;
+
+    hostBench_event(output->onTime + output->width);
+    output->onTime += hostBenchPeriod;
+    hostBench_queue(output, output->onTime, &hostBench_on);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostBench_queue(hostBenchOutput_t * output, uint32_t time, schedulerCallback_t callback)
+* Queues the next event of an output from the compare interupt while running,
+* and notes how deep its channel got
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostBench_queue(hostBenchOutput_t * output, uint32_t time, schedulerCallback_t callback){
+    uint32_t pending;
+
+    if(!hostBenchRunning){
+        return;
+    }
+
+    if(Scheduler_AddFromISR(output->channel, time, callback, (void *) output) != SCHEDULER_OK){
+        hostBenchStats.full++;
+        return;
+    }
+
+    pending = Scheduler_GetPending(output->channel);
+    if(pending > hostBenchStats.deepest){
+        hostBenchStats.deepest = pending;
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostBench_event(uint32_t due)
+* Counts an event and how long after it was due the core got to it
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostBench_event(uint32_t due){
+    double late;
+
+    late = TIME_TICKS_TO_US((double) TIME_DIFF(HostSim_GetCoreTime(), due)) * 1000.0;
+
+    hostBenchStats.events++;
+    hostBenchStats.lateSum += late;
+    if(late > hostBenchStats.worstLate){
+        hostBenchStats.worstLate = late;
+    }
+}
+/*****************************************************************************/
@@ -0,0 +1,113 @@
+/******************************************************************************
+* File:                    HostBench.h
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Benchmarks for the host build. Runs 8 coils and 8
+*                          injectors through the TIM8 scheduler alongside the
+*                          firmware and measures how it kept up, and times
+*                          the fuel task's pulse width work.
+******************************************************************************/
+#ifndef HOSTBENCH_H
+#define HOSTBENCH_H
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <stdint.h>
+
+#include "TriggerPattern.h"
+
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+#define HOSTBENCH_COILS             8U
+#define HOSTBENCH_INJECTORS         8U
+#define HOSTBENCH_OUTPUTS           (HOSTBENCH_COILS + HOSTBENCH_INJECTORS)
+
+// Engine cycles the fuel benchmark times
+#define HOSTBENCH_FUEL_CYCLES       1000000U
+
+// Reads of the engine's angle and speed the snapshot benchmark times each way
+#define HOSTBENCH_SNAPSHOT_READS    1000000U
+
+
+/******************************************************************************
+* Public Types
+******************************************************************************/
+typedef struct{
+    uint32_t events;                // Events run
+    uint32_t expected;              // Events that fell due while running
+    uint32_t full;                  // Events the scheduler had no room for
+    uint32_t deepest;               // Most events waiting on one channel
+    double lateSum;                 // nS, after each event was due
+    double worstLate;               // nS
+}hostBenchStats_t;
+
+typedef struct{
+    uint32_t cycles;
+    double nsPerCycle;              // Wall clock time of one engine cycle's pulse widths
+    uint32_t bad;                   // Pulses that came out negative or not a number
+}hostBenchFuel_t;
+
+typedef struct{
+    uint32_t reads;
+    double lockedNs;                // Angle, time and speed from the mutex locked getters
+    double snapshotNs;              // The same from one TriggerDecoder_GetSnapshot
+}hostBenchSnapshot_t;
+
+
+/******************************************************************************
+* Public Function Prototypes
+******************************************************************************/
+    /******************************************************************************
+    * void HostBench_Start(double rpm)
+    * Queues the first event of every output, for an engine at this rpm. Only
+    * called from the hardware task.
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void HostBench_Start(double rpm);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void HostBench_Stop(void)
+    * Stops queueing events, those waiting still run
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void HostBench_Stop(void);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void HostBench_GetStats(hostBenchStats_t * stats)
+    * Copies what the benchmark measured
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void HostBench_GetStats(hostBenchStats_t * stats);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void HostBench_Fuel(hostBenchFuel_t * result)
+    * Times the per cycle pulse width work of the fuel task, and checks the
+    * pulses stay sane with the wall fraction at and past 1
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void HostBench_Fuel(hostBenchFuel_t * result);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void HostBench_Snapshot(const triggerPattern_t * pattern, hostBenchSnapshot_t * result)
+    * Times what the ignition task reads for each spark, the way the decoder's
+    * getters took it under the status mutex against one snapshot. Only called
+    * from the hardware task once the decoder has sync.
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void HostBench_Snapshot(const triggerPattern_t * pattern, hostBenchSnapshot_t * result);
+    /*****************************************************************************/
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+#endif // ifdef HOSTBENCH_H
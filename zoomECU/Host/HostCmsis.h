@@ -0,0 +1,93 @@
+/******************************************************************************
+* File:                    HostCmsis.h
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Stands in for cmsis_gcc.h in the host build. It is
+*                          force included ahead of every source, so the real
+*                          device headers give the register layouts and
+*                          addresses while the Cortex-M instructions become
+*                          plain C. Barriers only stop the compiler from
+*                          moving memory accesses, which is all they need to
+*                          do with one simulated core.
+******************************************************************************/
+#ifndef HOSTCMSIS_H
+#define HOSTCMSIS_H
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <stdint.h>
+
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+// Stops cmsis_compiler.h pulling in the ARM only cmsis_gcc.h
+#define __CMSIS_GCC_H
+
+#define STM32G474xx
+
+// Enables and disables go through HostNvic.h, see there
+#define CMSIS_NVIC_VIRTUAL
+#define CMSIS_NVIC_VIRTUAL_HEADER_FILE "HostNvic.h"
+
+#define __ASM                       __asm
+#define __INLINE                    inline
+#define __STATIC_INLINE             static inline
+#define __STATIC_FORCEINLINE        __attribute__((always_inline)) static inline
+#define __NO_RETURN                 __attribute__((__noreturn__))
+#define __USED                      __attribute__((used))
+#define __WEAK                      __attribute__((weak))
+#define __PACKED                    __attribute__((packed, aligned(1)))
+#define __PACKED_STRUCT             struct __attribute__((packed, aligned(1)))
+#define __PACKED_UNION              union __attribute__((packed, aligned(1)))
+#define __ALIGNED(x)                __attribute__((aligned(x)))
+#define __RESTRICT                  __restrict
+#define __COMPILER_BARRIER()        __ASM volatile("" ::: "memory")
+
+#define __DMB()                     __COMPILER_BARRIER()
+#define __DSB()                     __COMPILER_BARRIER()
+#define __ISB()                     __COMPILER_BARRIER()
+#define __NOP()                     __COMPILER_BARRIER()
+#define __WFI()                     __COMPILER_BARRIER()
+#define __WFE()                     __COMPILER_BARRIER()
+#define __SEV()                     __COMPILER_BARRIER()
+#define __BKPT(value)               __builtin_trap()
+
+#define __enable_irq()              __COMPILER_BARRIER()
+#define __disable_irq()             __COMPILER_BARRIER()
+
+
+/******************************************************************************
+* Public Function Prototypes
+******************************************************************************/
+    /******************************************************************************
+    * uint8_t __CLZ(uint32_t value)
+    * Counts the leading zero bits, 32 for zero like the CLZ instruction
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    __STATIC_FORCEINLINE uint8_t __CLZ(uint32_t value){
+        return (value == 0U) ? 32U : (uint8_t) __builtin_clz(value);
+    }
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * uint32_t __RBIT(uint32_t value)
+    * Reverses the bit order of a word like the RBIT instruction
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    __STATIC_FORCEINLINE uint32_t __RBIT(uint32_t value){
+        uint32_t result = 0;
+        uint32_t x;
+
+        for(x = 0; x < 32U; x++){
+            result = (result << 1) | (value & 1U);
+            value >>= 1;
+        }
+
+        return result;
+    }
+    /*****************************************************************************/
+
+
+#endif // ifdef HOSTCMSIS_H
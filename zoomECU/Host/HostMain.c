@@ -0,0 +1,1599 @@
+/******************************************************************************
+* File:                    HostMain.c
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Host build entry point. Starts the firmware modules
+*                          the same way Main.c does, then turns a trigger
+*                          wheel through an rpm profile and reports how the
+*                          decoder, ignition, fuel and the scheduler kept up.
+*
+*   zoomEcuHost [options] [pattern] [rpm] [cycles]
+*   zoomEcuHost 60-2 6000 5000
+*   zoomEcuHost -e 8000 -t 4 -w 5 36-1 800 3000
+*   zoomEcuHost -S -w 3 -n 0.1 60-2
+*   zoomEcuHost -B 60-2 12000 2000
+*   zoomEcuHost -M 60-2 3000 100
+*   zoomEcuHost -R -e 7000 -t 4 60-2 200 3000
+*   zoomEcuHost -D card.img 60-2 3000 200
+*   zoomEcuHost -l 50 60-2 3000 100
+*   zoomEcuHost -A stock 50 20
+*   zoomEcuHost -C
+*   zoomEcuHost -F
+*   zoomEcuHost -T
+*   zoomEcuHost -m
+*
+*   -e rpm      ramp to this rpm
+*   -t seconds  time the ramp takes, 10 by default
+*   -w percent  compression ripple, speed swing each stroke
+*   -n percent  chance of a noise pulse before each edge
+*   -d percent  chance of each edge being lost
+*   -s seed     seed for the noise and dropouts
+*   -i seconds  stand still this long before the wheel starts
+*   -L degrees  fail (exit status 1) if a spark or the first injector's close
+*               is further off than this, sync is lost, or sparks are missing
+*               or extra. Without noise or dropouts a run always fails if the
+*               decoder names a tooth wrong, or never names one.
+*   -p mode     angle prediction of the decoder, linear (default) or second
+*   -j nS       time each interupt handler keeps the ECU busy, 1500 by default
+*   -J nS       fail if a coil edge lands more than this after it was due
+*   -l cycle    pull two crank teeth out of this engine cycle, fail if sync
+*               is not lost. Teeth named wrong until then do not fail the run. Built with TRIGGER_TOOTH_LOG, also fail unless
+*               the tooth log froze TRIGGER_TOOTH_LOG_AFTER_LOSS edges after
+*               the edge that lost sync.
+*   -A          sample MAP over a window of each cylinder's intake stroke,
+*               reading a waveform that changes with the sample and the
+*               cycle. Fail unless every window after the first is
+*               published, with the lowest and average of the readings
+*               taken in it, each sample is taken at its angle, and only
+*               samples too far for TIM6 from where they were armed are
+*               missed. On the stock wheel below about 20 rpm some are.
+*   -S          sweep 100 to 15000 rpm and report the spark angle error
+*   -B          also run 8 coils and 8 injectors through the scheduler (not
+*               with -S), fail if it runs out of room or misses an event
+*   -R          also take snapshots from a second host thread while the wheel
+*               turns (not with -S), fail if one does not agree with itself
+*   -M          after the run, time what the ignition task reads for each
+*               spark, from the old mutex locked getters and from one snapshot
+*   -D image    run the datalogger onto this SD card image (not with -S),
+*               fail if a write fails or no frame is logged
+*   -C          print every raw reading (0-65535) and what Calibration_Convert
+*               gives for each sensor at it, one line each, and exit. Checked
+*               by Tools/generateCalibration.py --check.
+*   -F          time the fuel task's pulse width work per engine cycle and
+*               exit, fail if a pulse is negative or not a number
+*   -T          replay a throttle snap through the transient fuel and exit,
+*               fail if lambda strays further than HOSTMAIN_SNAP_LAMBDA
+*   -m          check 3D table lookups inside and off the ends of a table,
+*               the axis checks, and lookups from a second host thread while
+*               a task rewrites the table, and exit. Fail on any wrong lookup,
+*               axis or lookup that mixed two writes.
+*
+* Patterns are stock, 36-1, 60-2 and 24+1. The spark angle error is the true
+* crank angle each coil fired at, less the angle the firmware aims that spark
+* at for the rpm and load at the time. Positive is late. The angle error is
+* the decoder's current angle, taken half way between each pair of edges,
+* less the true crank angle then. The edge jitter is how long after it was due
+* each coil pin moved: for a pin written from an interupt, the handler entry
+* plus any handler still running when it was raised, for an output compare
+* (built with IGNITION_OUTPUT_COMPARE) nothing unless it had to be forced.
+*
+* Built with TRIGGER_TOOTH_LOG defined, a run prints the edges around the
+* first sync loss from the tooth log. Each interupt handler's mean time is
+* printed with every run, so the time the log adds to each edge shows against
+* a build without it.
+*
+* SystemClock_Init is skipped, it waits on clock ready flags that nothing
+* sets here. HostSim has no regular ADC scans, so every sensor reads a raw 0
+* but MAP, which reads the crank angle MAP windows once one completes (a raw
+* 1 without -A).
+*******************************************************************************
+* Includes
+******************************************************************************/
+#include "HostSim.h"
+#include "HostWheel.h"
+#include "HostStimulus.h"
+#include "HostBench.h"
+#include "HostSnap.h"
+#include "HostTable.h"
+#include "HostSdCard.h"
+
+#include "Gpio.h"
+#include "PinoutConfiguration.h"
+#include "Time.h"
+#include "Scheduler.h"
+#include "IgnitionControl.h"
+#include "FuelControl.h"
+#include "TriggerDecoder.h"
+#include "TriggerPattern.h"
+#include "EngineController.h"
+#include "Calibration.h"
+#include "Datalog.h"
+#include "Sensors.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+#define HOSTMAIN_DEFAULT_RPM        3000.0
+#define HOSTMAIN_DEFAULT_CYCLES     2000U
+#define HOSTMAIN_DEFAULT_RAMP       10.0
+
+// Cycles run at each rpm of a sweep
+#define HOSTMAIN_SWEEP_CYCLES       200U
+
+// The wheel starts turning this long after the tasks are up
+#define HOSTMAIN_START_DELAY        TIME_US_TO_TICKS(1000U)
+
+// Time the wheel stands still between the runs of a sweep. The decoder looks
+// for a stall once every stall time (1.5 S), so it can take up to two of them
+// to drop sync on a stopped engine.
+#define HOSTMAIN_STOP_TIME          TIME_US_TO_TICKS(4000000U)
+
+// Crank degrees between sparks
+#define HOSTMAIN_SPARK_SPACING      (720.0 / ENGINE_CYLINDERS)
+
+// Furthest lambda may stray from 1 over a throttle snap with the transient fuel
+#define HOSTMAIN_SNAP_LAMBDA        0.15
+
+// Crank edges remembered with their true angle, for checking the tooth the
+// decoder names for each. Patterns decoded in the task see an edge a little
+// after it came.
+#define HOSTMAIN_EDGE_HISTORY       64U
+
+// Crank edges -l pulls out of its cycle, two whole teeth, so the decoder sees
+// a gap where the wheel has none
+#define HOSTMAIN_LOSS_EDGES         4U
+
+// A tooth is named right if its pattern angle is this close to the true one
+#define HOSTMAIN_TOOTH_TOLERANCE    0.5
+
+// Furthest the speed ratios of a snapshot may multiply out from 1, a few
+// float roundings
+#define HOSTMAIN_SPEED_PRODUCT      1e-5f
+
+// Sparks a run with limits may miss. Each schedule is first set after sync,
+// so the first cycle's sparks can be missed, and the run can end during a
+// dwell.
+#define HOSTMAIN_MISSED_SPARKS      8U
+
+// MAP windows set with -A, degrees after intake TDC. On the stock wheel the
+// last sample of one window and the first of the next are timed from the
+// same tooth.
+#define HOSTMAIN_MAP_START          10.0
+#define HOSTMAIN_MAP_END            170.0
+#define HOSTMAIN_MAP_SAMPLES        5U
+
+// A MAP sample is taken at the right angle if it is this close
+#define HOSTMAIN_MAP_TOLERANCE      0.5
+
+// TIM6 times a sample up to 65535 steps of 4 uS from where it is armed
+#define HOSTMAIN_MAP_REACH_US       262144.0
+
+// Sensors.c scales the 12 bit injected reading up to the raw range
+#define HOSTMAIN_MAP_SHIFT          4U
+
+// The 12 bit MAP waveform: a level for each cylinder, stepped up every
+// window so one window never reads the same as the last, and a shape over the
+// samples whose lowest is not the first
+#define HOSTMAIN_MAP_BASE           1000U
+#define HOSTMAIN_MAP_CYLINDER_STEP  400U
+#define HOSTMAIN_MAP_WINDOW_STEP    32U
+
+// Windows a run may not publish, one a cylinder joined part way after sync
+// and one a cylinder still open when the run ends
+#define HOSTMAIN_MAP_UNFINISHED     (2U * ENGINE_CYLINDERS)
+
+
+/******************************************************************************
+* Public Types
+******************************************************************************/
+// What one run of the wheel did
+typedef struct{
+    uint32_t edges;
+    uint32_t sparks;
+    uint32_t expectedSparks;
+    uint32_t injections;
+    uint32_t injectionEnds;         // Closes of the first injector
+    double injectionEndSquares;
+    double worstInjectionEnd;
+    uint32_t teeth;                 // Teeth the decoder named while in sync
+    uint32_t wrongTeeth;            // Named as a tooth at another angle
+    uint64_t snapshots;             // Taken by the reader thread with -R
+    uint64_t tornSnapshots;         // Taken part way through a publish
+    uint32_t syncLosses;
+    uint64_t lossEdges;             // Trigger handler calls when sync was first lost
+    uint64_t frozenEdges;           // Trigger handler calls when the tooth log froze, 0 if it never did
+    int32_t syncTime;               // Ticks from the wheel starting to sync, -1 if never
+    double errorSum;
+    double errorSquares;
+    double worstError;
+    uint32_t predictions;
+    double predictionSquares;
+    double worstPrediction;
+    uint32_t coilEdges;
+    double edgeSquares;             // nS squared
+    double worstEdge;               // nS
+    double wallSeconds;
+    double simulatedSeconds;
+    uint32_t mapConversions;        // Injected MAP conversions in sync, with -A
+    uint32_t mapWrongAngles;        // Taken further than HOSTMAIN_MAP_TOLERANCE from a sample angle
+    double worstMapAngle;
+    uint32_t mapWindows;            // Windows published
+    uint32_t mapWrongWindows;       // Published with a wrong lowest or average, or the wrong samples missed
+    uint32_t mapUnpublished;        // Windows after the first of a cylinder that were never published
+    uint32_t mapMissed;             // Samples missed in the windows published
+}hostMainResult_t;
+
+// The MAP window of a cylinder being read, with -A
+typedef struct{
+    uint32_t windows;               // Windows seen so far
+    uint32_t startTime;             // TIM2 time of the window's first reading
+    int32_t lastSample;
+    uint32_t taken;                 // Bit for each sample converted
+    uint32_t minimum;
+    uint32_t sum;
+    uint32_t count;
+    uint32_t published;
+    uint32_t result;                // Last published, as Sensors_GetMapCycle gave it
+}hostMainMap_t;
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+/******************************************************************************
+* Private Function Prototypes (static)
+******************************************************************************/
+static void hostMain_task(void * pvParameters);
+static void hostMain_run(const hostStimulusProfile_t * profile, uint32_t cycles, hostMainResult_t * result);
+static void hostMain_sweep(void);
+static void hostMain_output(GPIO_TypeDef * port, uint32_t pin, uint32_t level, uint32_t time, uint32_t due);
+static void hostMain_prediction(uint32_t time, hostMainResult_t * result);
+static void hostMain_tooth(uint32_t primaryEventNumber, uint32_t timeStamp, float usPerDegree);
+static void hostMain_mapWindows(void);
+static double hostMain_mapAngle(uint32_t cylinder, uint32_t sample);
+static double hostMain_mapArmed(uint32_t cylinder, uint32_t sample, double usPerDegree);
+static uint32_t hostMain_analog(ADC_TypeDef * adc, uint32_t channel, uint32_t time);
+static void hostMain_mapPublished(hostMainResult_t * result);
+static uint64_t hostMain_triggerCalls(void);
+static void hostMain_startReader(pthread_t * thread);
+static void hostMain_stopReader(pthread_t thread, hostMainResult_t * result);
+static void * hostMain_reader(void * argument);
+static uint32_t hostMain_torn(const triggerSnapshot_t * snapshot);
+static void hostMain_report(const hostMainResult_t * result);
+static void hostMain_load(double simulatedSeconds, uint64_t irqNanoseconds);
+static void hostMain_check(const hostMainResult_t * result, double rpm);
+static void hostMain_bench(void);
+static void hostMain_snapshotBench(void);
+static int hostMain_calibration(void);
+static int hostMain_fuel(void);
+static int hostMain_snap(void);
+static void hostMain_tables(void);
+#ifdef TRIGGER_TOOTH_LOG
+static void hostMain_toothLog(const hostMainResult_t * result);
+#endif
+static int hostMain_usage(const char * name);
+
+/******************************************************************************
+* Private Variables (static)
+******************************************************************************/
+static const struct{
+    const char * name;
+    const triggerPattern_t * pattern;
+}hostMainPatterns[] = {
+    {"stock", &triggerPatternStock},
+    {"36-1", &triggerPattern36_1},
+    {"60-2", &triggerPattern60_2},
+    {"24+1", &triggerPattern24_1},
+};
+
+static const double hostMainSweepRpm[] = {
+    100, 250, 500, 750, 1000, 1500, 2000, 3000, 4000, 5000,
+    6000, 7000, 8000, 9000, 10000, 11000, 12000, 13000, 14000, 15000,
+};
+
+static const triggerPattern_t * hostMainPattern = &triggerPatternStock;
+static hostStimulusProfile_t hostMainProfile = {
+    HOSTMAIN_DEFAULT_RPM, HOSTMAIN_DEFAULT_RPM, HOSTMAIN_DEFAULT_RAMP, 0, 0, 0, 1
+};
+static uint32_t hostMainCycles = HOSTMAIN_DEFAULT_CYCLES;
+static double hostMainIdleSeconds;
+
+// Largest spark angle error a run may have, 0 when runs are not checked. Set
+// once any run fails.
+static double hostMainLimit;
+static double hostMainEdgeLimit = -1.0;
+static uint32_t hostMainFailed;
+static uint32_t hostMainSweep;
+static uint32_t hostMainBench;
+static uint32_t hostMainReader;
+static uint32_t hostMainSnapshotBench;
+static uint32_t hostMainLossCycle;
+static uint32_t hostMainTables;
+static uint32_t hostMainMapCheck;
+static const char * hostMainCard;
+static triggerPrediction_t hostMainPrediction = TRIGGER_PREDICT_LINEAR;
+
+static hostWheel_t hostMainWheel;
+static hostStimulus_t hostMainStimulus;
+
+// The run the output edges are counted against, 0 while the wheel is stopped
+static hostMainResult_t * hostMainActive;
+
+static hostMainMap_t hostMainMap[ENGINE_CYLINDERS];
+
+// Last crank edges handed to the firmware, see HOSTMAIN_EDGE_HISTORY
+static struct{
+    uint32_t time;
+    double angle;
+}hostMainEdges[HOSTMAIN_EDGE_HISTORY];
+static uint32_t hostMainEdgeHead;
+
+// The reader thread runs while this is set, and counts into the others
+static volatile uint32_t hostMainReading;
+static uint64_t hostMainSnapshots;
+static uint64_t hostMainTornSnapshots;
+
+/******************************************************************************
+* Function Code
+******************************************************************************/
+
+
+/******************************************************************************
+* int main(int argc, char ** argv)
+* Reads the arguments, brings up the simulated hardware and the firmware, and
+* starts the scheduler
+* David Tolsma, 10/17/2026
+******************************************************************************/
+int main(int argc, char ** argv){
+    uint32_t x;
+    uint32_t found = 0;
+    uint32_t endGiven = 0;
+    int option;
+
+    while((option = getopt(argc, argv, "e:t:w:n:d:s:i:L:p:j:J:l:D:SBRMCFTmA")) != -1){
+        switch(option){
+            case 'e':   hostMainProfile.endRpm = atof(optarg); endGiven = 1; break;
+            case 't':   hostMainProfile.rampSeconds = atof(optarg); break;
+            case 'w':   hostMainProfile.ripple = atof(optarg) * 0.01; break;
+            case 'n':   hostMainProfile.noiseRate = atof(optarg) * 0.01; break;
+            case 'd':   hostMainProfile.dropoutRate = atof(optarg) * 0.01; break;
+            case 's':   hostMainProfile.seed = (uint32_t) strtoul(optarg, 0, 10); break;
+            case 'i':   hostMainIdleSeconds = atof(optarg); break;
+            case 'L':   hostMainLimit = atof(optarg); break;
+            case 'p':
+                if(strcmp(optarg, "linear") == 0){
+                    hostMainPrediction = TRIGGER_PREDICT_LINEAR;
+                }
+                else if(strcmp(optarg, "second") == 0){
+                    hostMainPrediction = TRIGGER_PREDICT_SECOND_ORDER;
+                }
+                else{
+                    return hostMain_usage(argv[0]);
+                }
+                break;
+            case 'j':   HostSim_SetIrqTime((uint32_t) strtoul(optarg, 0, 10)); break;
+            case 'J':   hostMainEdgeLimit = atof(optarg); break;
+            case 'l':   hostMainLossCycle = (uint32_t) strtoul(optarg, 0, 10); break;
+            case 'D':   hostMainCard = optarg; break;
+            case 'S':   hostMainSweep = 1; break;
+            case 'B':   hostMainBench = 1; break;
+            case 'R':   hostMainReader = 1; break;
+            case 'M':   hostMainSnapshotBench = 1; break;
+            case 'C':   return hostMain_calibration();
+            case 'F':   return hostMain_fuel();
+            case 'T':   return hostMain_snap();
+            case 'm':   hostMainTables = 1; break;
+            case 'A':   hostMainMapCheck = 1; break;
+            default:    return hostMain_usage(argv[0]);
+        }
+    }
+
+    if(optind < argc){
+        for(x = 0; x < (sizeof(hostMainPatterns) / sizeof(hostMainPatterns[0])); x++){
+            if(strcmp(argv[optind], hostMainPatterns[x].name) == 0){
+                hostMainPattern = hostMainPatterns[x].pattern;
+                found = 1;
+            }
+        }
+        if(found == 0){
+            return hostMain_usage(argv[0]);
+        }
+    }
+    if((optind + 1) < argc){
+        hostMainProfile.startRpm = atof(argv[optind + 1]);
+    }
+    if((optind + 2) < argc){
+        hostMainCycles = (uint32_t) strtoul(argv[optind + 2], 0, 10);
+    }
+    if(endGiven == 0){
+        hostMainProfile.endRpm = hostMainProfile.startRpm;
+    }
+    if((hostMainProfile.startRpm <= 0) || (hostMainProfile.endRpm <= 0)){
+        fprintf(stderr, "rpm must be above 0\n");
+        return EXIT_FAILURE;
+    }
+    if((hostMainProfile.ripple < 0) || (hostMainProfile.ripple >= 1.0)){
+        fprintf(stderr, "ripple must be from 0 up to 100%%\n");
+        return EXIT_FAILURE;
+    }
+
+    HostSim_Init();
+    HostSim_SetOutputCallback(&hostMain_output);
+    if(hostMainMapCheck){
+        HostSim_SetAnalogCallback(&hostMain_analog);
+    }
+
+    Time_Timer2Init();
+
+    Gpio_Init();
+
+    Scheduler_Init();
+
+    Sensors_Init();
+
+    IgnitionControl_Init();
+
+    FuelControl_Init();
+
+    EngineController_Init();
+
+    TriggerDecoder_Init();
+
+    Time_SyncSlaveTimers();
+
+    TriggerDecoder_AddToothCallback(&hostMain_tooth);
+
+    if(hostMainCard != 0){
+        if(HostSdCard_Open(hostMainCard) != 0){
+            fprintf(stderr, "can not open the card image %s\n", hostMainCard);
+            return EXIT_FAILURE;
+        }
+        Datalog_Init();
+    }
+
+    xTaskCreate(hostMain_task,
+                "hostMainTask",
+                1000,
+                ( void * ) 0,
+                HOSTSIM_TASK_PRIORITY,
+                0);
+
+    vTaskStartScheduler();
+
+    return EXIT_FAILURE;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostMain_task(void * pvParameters)
+* Plays the hardware, one run or a sweep, then ends the program
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostMain_task(void * pvParameters){
+    hostMainResult_t result;
+    pthread_t reader;
+    double idle;
+
+    HostSim_Start();
+
+    // The table writer masks interupts, so it runs here rather than before the RTOS
+    if(hostMainTables){
+        hostMain_tables();
+        exit(hostMainFailed ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+
+    // Stood long enough, TIM2 comes round with no spark set
+    for(idle = 0; idle < hostMainIdleSeconds; idle += 1.0){
+        HostSim_AdvanceTo(Time_GetTicks() + TIME_US_TO_TICKS(1000000U));
+    }
+
+    TriggerDecoder_SetPattern(hostMainPattern);
+    TriggerDecoder_SetPredictionMode(hostMainPrediction);
+
+    // Sensors_Init timed the first MAP sample from the pattern set then
+    Sensors_ResetMap();
+    if(hostMainMapCheck){
+        hostMain_mapWindows();
+    }
+    if(HostWheel_Build(hostMainPattern, &hostMainWheel) != 0){
+        printf("warning: the %s wheel does not meet every expected level\n", hostMainPattern->name);
+    }
+
+    if(hostMainSweep){
+        hostMain_sweep();
+    }
+    else{
+        if(hostMainBench){
+            HostBench_Start(hostMainProfile.startRpm);
+        }
+        if(hostMainReader){
+            hostMain_startReader(&reader);
+        }
+        hostMain_run(&hostMainProfile, hostMainCycles, &result);
+        if(hostMainReader){
+            hostMain_stopReader(reader, &result);
+        }
+        if(hostMainBench){
+            HostBench_Stop();
+        }
+        hostMain_report(&result);
+        hostMain_check(&result, hostMainProfile.endRpm);
+    }
+
+    exit(hostMainFailed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostMain_run(const hostStimulusProfile_t * profile, uint32_t cycles, hostMainResult_t * result)
+* Turns the wheel from 0* for a number of cycles and leaves it standing. The
+* triggers are put at their levels for 0* quietly first, a wheel does not
+* make edges while it is stopped.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostMain_run(const hostStimulusProfile_t * profile, uint32_t cycles, hostMainResult_t * result){
+    struct timespec start;
+    struct timespec end;
+    hostStimulusEvent_t event;
+    uint32_t startTime;
+    uint32_t lastTime;
+    uint32_t midTime;
+    uint32_t synced = 0;
+    uint32_t pulled = 0;
+    double syncAngle = 0;
+    double syncedAngle = 0;
+
+    memset(result, 0, sizeof(*result));
+    memset(hostMainMap, 0, sizeof(hostMainMap));
+    result->syncTime = -1;
+
+    MODIFY_REG(CRANK_PORT->IDR, CRANK_PIN, hostMainWheel.primaryStart ? CRANK_PIN : 0);
+    MODIFY_REG(CAM_PORT->IDR, CAM_PIN, hostMainWheel.secondaryStart ? CAM_PIN : 0);
+
+    startTime = Time_GetTicks() + HOSTMAIN_START_DELAY;
+    lastTime = startTime;
+    HostStimulus_Init(&hostMainStimulus, &hostMainWheel, profile, startTime);
+    hostMainActive = result;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while(hostMainStimulus.cycle < cycles){
+        HostStimulus_Next(&hostMainStimulus, &event);
+
+        if(synced){
+            midTime = lastTime + (uint32_t)(TIME_DIFF(event.time, lastTime) / 2);
+            HostSim_AdvanceTo(midTime);
+            hostMain_prediction(midTime, result);
+        }
+        lastTime = event.time;
+
+        HostSim_AdvanceTo(event.time);
+        if(event.primary && (hostMainLossCycle != 0) && (hostMainStimulus.cycle == hostMainLossCycle) &&
+           (pulled < HOSTMAIN_LOSS_EDGES)){
+            pulled++;
+        }
+        else if(event.primary){
+            hostMainEdges[hostMainEdgeHead % HOSTMAIN_EDGE_HISTORY].time = event.time;
+            hostMainEdges[hostMainEdgeHead % HOSTMAIN_EDGE_HISTORY].angle = HostStimulus_AngleAt(&hostMainStimulus, event.time);
+            hostMainEdgeHead++;
+            HostSim_SetInput(CRANK_PORT, CRANK_PIN, event.level);
+        }
+        else{
+            HostSim_SetInput(CAM_PORT, CAM_PIN, event.level);
+        }
+        result->edges++;
+
+        if(TriggerDecoder_GetSyncStatus() > 0){
+            if(synced == 0){
+                synced = 1;
+                syncAngle = hostMainStimulus.angle;
+                if(result->syncTime < 0){
+                    result->syncTime = TIME_DIFF(event.time, startTime);
+                }
+            }
+        }
+        else if(synced){
+            synced = 0;
+            syncedAngle += hostMainStimulus.angle - syncAngle;
+            if(result->syncLosses == 0){
+                result->lossEdges = hostMain_triggerCalls();
+            }
+            result->syncLosses++;
+        }
+
+#ifdef TRIGGER_TOOTH_LOG
+        if((result->frozenEdges == 0) && TriggerDecoder_ToothLogIsFrozen()){
+            result->frozenEdges = hostMain_triggerCalls();
+        }
+#endif
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    hostMainActive = 0;
+
+    if(synced){
+        syncedAngle += hostMainStimulus.angle - syncAngle;
+    }
+    result->expectedSparks = (uint32_t)(syncedAngle / HOSTMAIN_SPARK_SPACING);
+    result->wallSeconds = (double)(end.tv_sec - start.tv_sec) + ((double)(end.tv_nsec - start.tv_nsec) * 1e-9);
+    result->simulatedSeconds = TIME_TICKS_TO_US(hostMainStimulus.time) * 1e-6;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostMain_sweep(void)
+* Runs the wheel at each sweep rpm in turn, stopping the engine in between so
+* every run starts from no sync, and prints the spark angle error of each
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostMain_sweep(void){
+    hostStimulusProfile_t profile;
+    hostMainResult_t result;
+    uint32_t x;
+
+    profile = hostMainProfile;
+
+    printf("spark angle error, pattern %s, %u cycles per rpm, %.1f%% ripple, %.2f%% noise, %.2f%% dropouts, %s prediction\n",
+           hostMainPattern->name, (unsigned) HOSTMAIN_SWEEP_CYCLES, profile.ripple * 100.0,
+           profile.noiseRate * 100.0, profile.dropoutRate * 100.0,
+           (hostMainPrediction == TRIGGER_PREDICT_LINEAR) ? "linear" : "second order");
+    printf("    rpm   sync mS    sparks  expected   mean deg    rms deg  worst deg  sync lost  angle rms  angle worst  edge rms nS  edge worst nS  injection worst\n");
+
+    for(x = 0; x < (sizeof(hostMainSweepRpm) / sizeof(hostMainSweepRpm[0])); x++){
+        profile.startRpm = hostMainSweepRpm[x];
+        profile.endRpm = hostMainSweepRpm[x];
+
+        hostMain_run(&profile, HOSTMAIN_SWEEP_CYCLES, &result);
+
+        printf("  %5.0f  %8.1f  %8u  %8u  %9.3f  %9.3f  %9.3f  %9u  %9.3f  %11.3f  %11.0f  %13.0f  %15.3f\n",
+               hostMainSweepRpm[x],
+               (result.syncTime >= 0) ? (TIME_TICKS_TO_US((double) result.syncTime) * 1e-3) : -1.0,
+               (unsigned) result.sparks, (unsigned) result.expectedSparks,
+               (result.sparks > 0) ? (result.errorSum / result.sparks) : 0.0,
+               (result.sparks > 0) ? sqrt(result.errorSquares / result.sparks) : 0.0,
+               result.worstError,
+               (unsigned) result.syncLosses,
+               (result.predictions > 0) ? sqrt(result.predictionSquares / result.predictions) : 0.0,
+               result.worstPrediction,
+               (result.coilEdges > 0) ? sqrt(result.edgeSquares / result.coilEdges) : 0.0,
+               result.worstEdge, result.worstInjectionEnd);
+        hostMain_check(&result, hostMainSweepRpm[x]);
+
+        HostSim_AdvanceTo(Time_GetTicks() + HOSTMAIN_STOP_TIME);
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostMain_check(const hostMainResult_t * result, double rpm)
+* Holds a run to the limits given with -L and -J, and prints what it failed on.
+* Without noise or dropouts the decoder must name every tooth right.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostMain_check(const hostMainResult_t * result, double rpm){
+    datalogStats_t datalog;
+
+    // On a clean wheel every tooth must be named right, checked or not
+    if((hostMainProfile.noiseRate == 0) && (hostMainProfile.dropoutRate == 0) && (hostMainLossCycle == 0) &&
+       ((result->wrongTeeth > 0) || (result->teeth == 0))){
+        printf("FAIL %.0f rpm: %u of %u teeth named wrong\n", rpm, (unsigned) result->wrongTeeth, (unsigned) result->teeth);
+        hostMainFailed = 1;
+    }
+
+    if(hostMainReader && ((result->tornSnapshots > 0) || (result->snapshots == 0))){
+        printf("FAIL %.0f rpm: %llu of %llu snapshots torn\n", rpm,
+               (unsigned long long) result->tornSnapshots, (unsigned long long) result->snapshots);
+        hostMainFailed = 1;
+    }
+
+    if(hostMainCard != 0){
+        Datalog_GetStats(&datalog);
+        if((datalog.errors > 0) || (datalog.framesLogged == 0)){
+            printf("FAIL %.0f rpm: %u frames logged, %u failed writes\n", rpm,
+                   (unsigned) datalog.framesLogged, (unsigned) datalog.errors);
+            hostMainFailed = 1;
+        }
+    }
+
+    if((hostMainEdgeLimit >= 0) && (result->worstEdge > hostMainEdgeLimit)){
+        printf("FAIL %.0f rpm: coil edge %.0f nS late, limit %.0f nS\n", rpm, result->worstEdge, hostMainEdgeLimit);
+        hostMainFailed = 1;
+    }
+
+    // A cylinder has a window each spark spacing while in sync
+    if(hostMainMapCheck && (((result->mapWindows + HOSTMAIN_MAP_UNFINISHED) < result->expectedSparks) ||
+                            (result->mapWrongWindows > 0) || (result->mapUnpublished > 0) || (result->mapWrongAngles > 0))){
+        printf("FAIL %.0f rpm: %u MAP windows of %u, %u wrong, %u not published, %u samples off their angle\n", rpm,
+               (unsigned) result->mapWindows, (unsigned) result->expectedSparks, (unsigned) result->mapWrongWindows,
+               (unsigned) result->mapUnpublished, (unsigned) result->mapWrongAngles);
+        hostMainFailed = 1;
+    }
+
+    if((hostMainLossCycle != 0) && (result->syncLosses == 0)){
+        printf("FAIL %.0f rpm: sync was not lost with teeth pulled out of cycle %u\n", rpm, (unsigned) hostMainLossCycle);
+        hostMainFailed = 1;
+    }
+
+    if(hostMainLimit <= 0){
+        return;
+    }
+
+    if(fabs(result->worstError) > hostMainLimit){
+        printf("FAIL %.0f rpm: worst spark %.3f deg, limit %.3f deg\n", rpm, result->worstError, hostMainLimit);
+        hostMainFailed = 1;
+    }
+    if(fabs(result->worstInjectionEnd) > hostMainLimit){
+        printf("FAIL %.0f rpm: worst end of injection %.3f deg, limit %.3f deg\n", rpm, result->worstInjectionEnd, hostMainLimit);
+        hostMainFailed = 1;
+    }
+    if(result->syncLosses > 0){
+        printf("FAIL %.0f rpm: sync lost %u times\n", rpm, (unsigned) result->syncLosses);
+        hostMainFailed = 1;
+    }
+    if((result->sparks + HOSTMAIN_MISSED_SPARKS < result->expectedSparks) || (result->sparks > result->expectedSparks + 1U)){
+        printf("FAIL %.0f rpm: %u sparks, %u expected\n", rpm, (unsigned) result->sparks, (unsigned) result->expectedSparks);
+        hostMainFailed = 1;
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostMain_output(GPIO_TypeDef * port, uint32_t pin, uint32_t level, uint32_t time, uint32_t due)
+* Counts sparks and injections as the outputs change, measures the crank
+* angle each spark landed at against the angle the firmware aims it at, and
+* how long after it was due each coil edge came
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostMain_output(GPIO_TypeDef * port, uint32_t pin, uint32_t level, uint32_t time, uint32_t due){
+    static const uint32_t coilPins[4] = {PP_1_PIN, PP_2_PIN, PP_3_PIN, PP_4_PIN};
+    hostMainResult_t * result = hostMainActive;
+    double error;
+    double late;
+    uint32_t x;
+
+    if(result == 0){
+        return;
+    }
+
+    if(((port == LSD_1_PORT) || (port == LSD_5_PORT)) && level){
+        result->injections++;
+    }
+
+    // The first injector must close at the end of injection angle before its TDC
+    if((port == LSD_1_PORT) && (pin & LSD_1_PIN) && !level){
+        error = HostStimulus_AngleAt(&hostMainStimulus, time) - ((double) ENGINE_TDC_ANGLE(0) - (double) fuelEndOfInjection);
+        while(error >= 360.0){
+            error -= 720.0;
+        }
+        while(error < -360.0){
+            error += 720.0;
+        }
+
+        result->injectionEnds++;
+        result->injectionEndSquares += error * error;
+        if(fabs(error) > fabs(result->worstInjectionEnd)){
+            result->worstInjectionEnd = error;
+        }
+    }
+
+    if(port != PP_1_PORT){
+        return;
+    }
+
+    for(x = 0; x < 4U; x++){
+        if((pin & coilPins[x]) == 0){
+            continue;
+        }
+
+        late = TIME_TICKS_TO_US((double) TIME_DIFF(time, due)) * 1000.0;
+        result->coilEdges++;
+        result->edgeSquares += late * late;
+        if(late > result->worstEdge){
+            result->worstEdge = late;
+        }
+
+        if(level){
+            continue;
+        }
+
+        error = HostStimulus_AngleAt(&hostMainStimulus, time) - IgnitionControl_calcNextIgnitionAngle(IGN_SCH_1 << x);
+        if(error >= 360.0){
+            error -= 720.0;
+        }
+        else if(error < -360.0){
+            error += 720.0;
+        }
+
+        result->sparks++;
+        result->errorSum += error;
+        result->errorSquares += error * error;
+        if(fabs(error) > fabs(result->worstError)){
+            result->worstError = error;
+        }
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostMain_prediction(uint32_t time, hostMainResult_t * result)
+* Measures the decoder's current angle against the true crank angle at a time
+* between two edges
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostMain_prediction(uint32_t time, hostMainResult_t * result){
+    triggerSnapshot_t snapshot;
+    double error;
+
+    TriggerDecoder_GetSnapshot(&snapshot);
+    if(snapshot.currentAngle < 0){
+        return;
+    }
+
+    error = snapshot.currentAngle - HostStimulus_AngleAt(&hostMainStimulus, time);
+    if(error >= 360.0){
+        error -= 720.0;
+    }
+    else if(error < -360.0){
+        error += 720.0;
+    }
+
+    result->predictions++;
+    result->predictionSquares += error * error;
+    if(fabs(error) > fabs(result->worstPrediction)){
+        result->worstPrediction = error;
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostMain_tooth(uint32_t primaryEventNumber, uint32_t timeStamp, float usPerDegree)
+* Called by the decoder on every primary event while sync is trusted. Finds
+* the crank edge it was timed from and checks the pattern angle of the tooth
+* the decoder named against the true angle of that edge. Noise edges have no
+* true angle and are not checked.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostMain_tooth(uint32_t primaryEventNumber, uint32_t timeStamp, float usPerDegree){
+    hostMainResult_t * result = hostMainActive;
+    const triggerPattern_t * pattern = hostMainPattern;
+    double error;
+    uint32_t x;
+
+    (void) usPerDegree;
+
+    if(result == 0){
+        return;
+    }
+
+    if(hostMainMapCheck){
+        hostMain_mapPublished(result);
+    }
+
+    for(x = 1; (x <= HOSTMAIN_EDGE_HISTORY) && (x <= hostMainEdgeHead); x++){
+        if(hostMainEdges[(hostMainEdgeHead - x) % HOSTMAIN_EDGE_HISTORY].time != timeStamp){
+            continue;
+        }
+
+        error = fabs(pattern->primaryEventAngles[primaryEventNumber] - hostMainEdges[(hostMainEdgeHead - x) % HOSTMAIN_EDGE_HISTORY].angle);
+        if(error > 360.0){
+            error = 720.0 - error;
+        }
+
+        result->teeth++;
+        if(error > HOSTMAIN_TOOTH_TOLERANCE){
+            result->wrongTeeth++;
+        }
+        return;
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostMain_mapWindows(void)
+* Replaces the default MAP windows with the ones -A checks
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostMain_mapWindows(void){
+    uint32_t x;
+
+    for(x = 0; x < ENGINE_CYLINDERS; x++){
+        Sensors_SetMapWindow(x, (float) hostMain_mapAngle(x, 0), (float) hostMain_mapAngle(x, HOSTMAIN_MAP_SAMPLES - 1U),
+                             HOSTMAIN_MAP_SAMPLES);
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* double hostMain_mapAngle(uint32_t cylinder, uint32_t sample)
+* Returns the engine angle (0-720*) of a sample of a cylinder's MAP window
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static double hostMain_mapAngle(uint32_t cylinder, uint32_t sample){
+    double angle;
+
+    angle = (double) ENGINE_TDC_ANGLE(cylinder) + 360.0 + HOSTMAIN_MAP_START +
+            ((HOSTMAIN_MAP_END - HOSTMAIN_MAP_START) * (double) sample / (double)(HOSTMAIN_MAP_SAMPLES - 1U));
+
+    return fmod(angle, 720.0);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* double hostMain_mapArmed(uint32_t cylinder, uint32_t sample, double usPerDegree)
+* Returns the angle past its tooth a sample is armed at. The first sample on
+* a tooth is armed by the tooth. The next is armed when the one before it is
+* taken, or straight away if that one was missed.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static double hostMain_mapArmed(uint32_t cylinder, uint32_t sample, double usPerDegree){
+    uint32_t tooth;
+    float offset;
+    float other;
+    double before = -1.0;
+    double armed;
+    uint32_t beforeCylinder = 0;
+    uint32_t beforeSample = 0;
+    uint32_t x;
+    uint32_t y;
+
+    tooth = TriggerDecoder_GetReferenceTooth((float) hostMain_mapAngle(cylinder, sample), &offset);
+
+    for(x = 0; x < ENGINE_CYLINDERS; x++){
+        for(y = 0; y < HOSTMAIN_MAP_SAMPLES; y++){
+            if((TriggerDecoder_GetReferenceTooth((float) hostMain_mapAngle(x, y), &other) == tooth) &&
+               (other < offset) && (other > before)){
+                before = other;
+                beforeCylinder = x;
+                beforeSample = y;
+            }
+        }
+    }
+
+    if(before < 0){
+        return 0;
+    }
+
+    armed = hostMain_mapArmed(beforeCylinder, beforeSample, usPerDegree);
+    if(((before - armed) * usPerDegree) < HOSTMAIN_MAP_REACH_US){
+        return before;
+    }
+    return armed;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t hostMain_analog(ADC_TypeDef * adc, uint32_t channel, uint32_t time)
+* Gives the MAP reading of an injected conversion in sync. The sample it was
+* meant to be is the one nearest the true angle, and the reading is worked
+* out from the cylinder, the window and the sample. A sample no later in its
+* window than the last one, or a turn or more after the window started,
+* starts the cylinder's next window. The window before it having been
+* published or not is checked then.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint32_t hostMain_analog(ADC_TypeDef * adc, uint32_t channel, uint32_t time){
+    static const uint32_t shape[HOSTMAIN_MAP_SAMPLES] = {48, 0, 96, 16, 64};
+    hostMainResult_t * result = hostMainActive;
+    hostMainMap_t * map;
+    double angle;
+    double error;
+    double best = 720.0;
+    double turn;
+    uint32_t cylinder = 0;
+    uint32_t sample = 0;
+    uint32_t value;
+    uint32_t x;
+    uint32_t y;
+
+    if((result == 0) || (adc != ADC1) || (channel != MAP_ADC_CHANNEL) || (TriggerDecoder_GetSyncStatus() == 0)){
+        return 0;
+    }
+
+    hostMain_mapPublished(result);
+
+    angle = HostStimulus_AngleAt(&hostMainStimulus, time);
+    for(x = 0; x < ENGINE_CYLINDERS; x++){
+        for(y = 0; y < HOSTMAIN_MAP_SAMPLES; y++){
+            error = angle - hostMain_mapAngle(x, y);
+            if(error >= 360.0){
+                error -= 720.0;
+            }
+            else if(error < -360.0){
+                error += 720.0;
+            }
+            if(fabs(error) < fabs(best)){
+                best = error;
+                cylinder = x;
+                sample = y;
+            }
+        }
+    }
+
+    result->mapConversions++;
+    if(fabs(best) > fabs(result->worstMapAngle)){
+        result->worstMapAngle = best;
+    }
+    if(fabs(best) > HOSTMAIN_MAP_TOLERANCE){
+        result->mapWrongAngles++;
+    }
+
+    map = &hostMainMap[cylinder];
+    turn = TIME_US_TO_TICKS(60000000.0 / HostStimulus_GetRpm(&hostMainStimulus));
+    if((map->windows == 0) || ((int32_t) sample <= map->lastSample) || (TIME_DIFF(time, map->startTime) >= (int32_t) turn)){
+        if((map->windows > 1U) && (map->published == 0)){
+            result->mapUnpublished++;
+        }
+        map->windows++;
+        map->startTime = time;
+        map->taken = 0;
+        map->minimum = 0xFFFFU;
+        map->sum = 0;
+        map->count = 0;
+        map->published = 0;
+    }
+
+    value = HOSTMAIN_MAP_BASE + (cylinder * HOSTMAIN_MAP_CYLINDER_STEP) +
+            ((map->windows % 4U) * HOSTMAIN_MAP_WINDOW_STEP) + shape[sample];
+
+    map->lastSample = (int32_t) sample;
+    map->taken |= 1UL << sample;
+    if((value << HOSTMAIN_MAP_SHIFT) < map->minimum){
+        map->minimum = value << HOSTMAIN_MAP_SHIFT;
+    }
+    map->sum += value << HOSTMAIN_MAP_SHIFT;
+    map->count++;
+
+    return value;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostMain_mapPublished(hostMainResult_t * result)
+* Looks for MAP windows published since the last look, called on every tooth
+* and conversion. Each must give the lowest and average of the readings
+* taken in the window, read as MAP, and be missing just the samples further
+* from where they were armed than TIM6 reaches at the true speed.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostMain_mapPublished(hostMainResult_t * result){
+    hostMainMap_t * map;
+    uint16_t minimum;
+    uint16_t average;
+    uint32_t expected;
+    double usPerDegree;
+    float offset;
+    uint32_t x;
+    uint32_t y;
+
+    usPerDegree = 1000000.0 / (HostStimulus_GetRpm(&hostMainStimulus) * 6.0);
+
+    for(x = 0; x < ENGINE_CYLINDERS; x++){
+        map = &hostMainMap[x];
+        if((Sensors_GetMapCycle(x, &minimum, &average) == 0) ||
+           ((((uint32_t) minimum << 16) | average) == map->result)){
+            continue;
+        }
+        map->result = ((uint32_t) minimum << 16) | average;
+        map->published = 1;
+        result->mapWindows++;
+
+        expected = 0;
+        for(y = 0; y < HOSTMAIN_MAP_SAMPLES; y++){
+            TriggerDecoder_GetReferenceTooth((float) hostMain_mapAngle(x, y), &offset);
+            if((((double) offset - hostMain_mapArmed(x, y, usPerDegree)) * usPerDegree) < HOSTMAIN_MAP_REACH_US){
+                expected |= 1UL << y;
+            }
+        }
+
+        if((map->count == 0) || (minimum != map->minimum) || (average != (map->sum / map->count)) ||
+           (map->taken != expected) || (Sensors_GetRaw(SENSOR_MAP) != average)){
+            result->mapWrongWindows++;
+        }
+        result->mapMissed += HOSTMAIN_MAP_SAMPLES - (uint32_t) __builtin_popcount(map->taken);
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint64_t hostMain_triggerCalls(void)
+* Returns how many times the trigger handlers have run, one for each edge
+* handed to the decoder
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint64_t hostMain_triggerCalls(void){
+    hostSimIrqStats_t crank;
+    hostSimIrqStats_t cam;
+
+    HostSim_GetIrqStats(HOSTSIM_IRQ_EXTI3, &crank);
+    HostSim_GetIrqStats(HOSTSIM_IRQ_EXTI1, &cam);
+
+    return crank.calls + cam.calls;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostMain_startReader(pthread_t * thread)
+* void hostMain_stopReader(pthread_t thread, hostMainResult_t * result)
+* Start and stop the reader thread. It is a plain host thread, not a task, so
+* it runs on its own core at the same time as the decoder rather than taking
+* turns with it. Every signal is blocked in it, they belong to the RTOS port.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostMain_startReader(pthread_t * thread){
+    sigset_t blocked;
+    sigset_t previous;
+
+    hostMainSnapshots = 0;
+    hostMainTornSnapshots = 0;
+    hostMainReading = 1;
+
+    sigfillset(&blocked);
+    pthread_sigmask(SIG_SETMASK, &blocked, &previous);
+    if(pthread_create(thread, 0, &hostMain_reader, 0) != 0){
+        fprintf(stderr, "could not start the reader thread\n");
+        exit(EXIT_FAILURE);
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, 0);
+}
+
+static void hostMain_stopReader(pthread_t thread, hostMainResult_t * result){
+    hostMainReading = 0;
+    pthread_join(thread, 0);
+
+    result->snapshots = hostMainSnapshots;
+    result->tornSnapshots = hostMainTornSnapshots;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void * hostMain_reader(void * argument)
+* Takes snapshots as fast as it can while the decoder publishes, and counts
+* the ones that do not agree with themselves
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void * hostMain_reader(void * argument){
+    triggerSnapshot_t snapshot;
+
+    (void) argument;
+
+    while(hostMainReading){
+        TriggerDecoder_GetSnapshot(&snapshot);
+        hostMainSnapshots++;
+        if(hostMain_torn(&snapshot)){
+            hostMainTornSnapshots++;
+        }
+    }
+    return 0;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t hostMain_torn(const triggerSnapshot_t * snapshot)
+* Returns 1 if a snapshot mixes two publishes of the decoder. Each publish
+* works out rpm, both speed ratios and whether the angle is known from the
+* same figures, so any one of them from another publish shows up: rpm is
+* degree per uS times a constant to the bit, the ratios multiply to 1, and
+* either all of them are set or none.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint32_t hostMain_torn(const triggerSnapshot_t * snapshot){
+    if(snapshot->degreePerUs == -1.0f){
+        // Sync not trusted, nothing was worked out
+        return (snapshot->rpm != 0) || (snapshot->usPerDegree != -1.0f) || (snapshot->currentAngle != -1.0f);
+    }
+
+    return (snapshot->rpm != (snapshot->degreePerUs * ((1000000.0f * 60.0f) / 360.0f))) ||
+           (snapshot->currentAngle < 0) ||
+           (fabsf((snapshot->degreePerUs * snapshot->usPerDegree) - 1.0f) > HOSTMAIN_SPEED_PRODUCT);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostMain_report(const hostMainResult_t * result)
+* Prints what the firmware made of a run, and how long each interupt took
+* on this machine
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostMain_report(const hostMainResult_t * result){
+    static const char * const names[HOSTSIM_IRQ_COUNT] = {"TIM2", "TIM8_CC", "EXTI1", "EXTI3", "ADC1_2"};
+    hostSimIrqStats_t stats;
+    ignitionRetryStats_t retries;
+    datalogStats_t datalog;
+    uint64_t irqNanoseconds = 0;
+    uint32_t x;
+
+    IgnitionControl_GetRetryStats(&retries);
+
+    printf("pattern %s, %.0f to %.0f rpm, %u cycles\n", hostMainPattern->name,
+           hostMainProfile.startRpm, hostMainProfile.endRpm, (unsigned) hostMainCycles);
+    printf("  stimulus   %u edges, %u noise edges, %u dropped\n",
+           (unsigned) result->edges, (unsigned) hostMainStimulus.noiseEdges, (unsigned) hostMainStimulus.droppedEdges);
+    printf("  decoder    sync %d after %.1f mS, lost %u times, %.1f rpm, %u event overflows\n",
+           (int) TriggerDecoder_GetSyncStatus(),
+           (result->syncTime >= 0) ? (TIME_TICKS_TO_US((double) result->syncTime) * 1e-3) : -1.0,
+           (unsigned) result->syncLosses, (double) TriggerDecoder_GetRPM(),
+           (unsigned) TriggerDecoder_GetEventOverflows());
+    printf("  teeth      %u named in sync, %u named wrong\n",
+           (unsigned) result->teeth, (unsigned) result->wrongTeeth);
+    if(hostMainMapCheck){
+        printf("  map        %u windows, %u wrong, %u not published, %u samples missed, %u taken, %.3f deg worst\n",
+               (unsigned) result->mapWindows, (unsigned) result->mapWrongWindows, (unsigned) result->mapUnpublished,
+               (unsigned) result->mapMissed, (unsigned) result->mapConversions, result->worstMapAngle);
+    }
+    if(hostMainReader){
+        printf("  snapshots  %llu taken by a second thread, %llu torn\n",
+               (unsigned long long) result->snapshots, (unsigned long long) result->tornSnapshots);
+    }
+    if(hostMainCard != 0){
+        Datalog_GetStats(&datalog);
+        printf("  datalog    log %u, %u frames, %u dropped, %u errors\n",
+               (unsigned) datalog.session, (unsigned) datalog.framesLogged,
+               (unsigned) datalog.framesDropped, (unsigned) datalog.errors);
+        printf("  card       %u blocks in %u writes, %.0f uS mean, %.0f uS longest\n",
+               (unsigned) datalog.blocksWritten, (unsigned) datalog.writes,
+               (datalog.writes > 0) ? (TIME_TICKS_TO_US((double) datalog.writeTicksTotal) / datalog.writes) : 0.0,
+               TIME_TICKS_TO_US((double) datalog.writeTicksMax));
+    }
+    printf("  outputs    %u sparks of %u, %u injections\n",
+           (unsigned) result->sparks, (unsigned) result->expectedSparks, (unsigned) result->injections);
+    printf("  injection  %.3f deg rms, %.3f deg worst end of injection, %u closes\n",
+           (result->injectionEnds > 0) ? sqrt(result->injectionEndSquares / result->injectionEnds) : 0.0,
+           result->worstInjectionEnd, (unsigned) result->injectionEnds);
+    printf("  retries    %u with no confidence, %u too late to arm\n",
+           (unsigned) retries.noConfidence, (unsigned) retries.late);
+    printf("  spark      %.3f deg mean, %.3f deg rms, %.3f deg worst\n",
+           (result->sparks > 0) ? (result->errorSum / result->sparks) : 0.0,
+           (result->sparks > 0) ? sqrt(result->errorSquares / result->sparks) : 0.0,
+           result->worstError);
+    printf("  angle      %.3f deg rms, %.3f deg worst, %s prediction\n",
+           (result->predictions > 0) ? sqrt(result->predictionSquares / result->predictions) : 0.0,
+           result->worstPrediction, (hostMainPrediction == TRIGGER_PREDICT_LINEAR) ? "linear" : "second order");
+    printf("  coil edge  %.0f nS rms, %.0f nS worst after due, %u edges\n",
+           (result->coilEdges > 0) ? sqrt(result->edgeSquares / result->coilEdges) : 0.0,
+           result->worstEdge, (unsigned) result->coilEdges);
+    printf("  time       %.3f s simulated in %.3f s, %.0f edges/s\n",
+           result->simulatedSeconds, result->wallSeconds,
+           (result->wallSeconds > 0) ? ((double) result->edges / result->wallSeconds) : 0.0);
+
+    for(x = 0; x < HOSTSIM_IRQ_COUNT; x++){
+        HostSim_GetIrqStats((hostSimIrq_t) x, &stats);
+        printf("  %-10s %10llu calls, %7.0f nS mean, %7llu nS worst\n", names[x],
+               (unsigned long long) stats.calls,
+               (stats.calls > 0) ? ((double) stats.nanoseconds / (double) stats.calls) : 0.0,
+               (unsigned long long) stats.worstNanoseconds);
+        irqNanoseconds += stats.nanoseconds;
+    }
+
+    hostMain_load(result->simulatedSeconds, irqNanoseconds);
+
+    if(hostMainBench){
+        hostMain_bench();
+    }
+    if(hostMainSnapshotBench){
+        hostMain_snapshotBench();
+    }
+
+#ifdef TRIGGER_TOOTH_LOG
+    hostMain_toothLog(result);
+#endif
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostMain_load(double simulatedSeconds, uint64_t irqNanoseconds)
+* Prints the CPU time of each firmware task from the run time stats, and how
+* busy the ECU would be if it ran as fast as this machine. Interupts run in
+* the hardware task, so their time is added from the interupt stats. The
+* hardware task and idle are not part of the firmware.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostMain_load(double simulatedSeconds, uint64_t irqNanoseconds){
+    static TaskStatus_t tasks[16];
+    uint32_t count;
+    uint32_t total;
+    double busy;
+    uint32_t x;
+
+    count = (uint32_t) uxTaskGetSystemState(tasks, sizeof(tasks) / sizeof(tasks[0]), &total);
+    busy = (double) irqNanoseconds * 1e-9;
+
+    for(x = 0; x < count; x++){
+        if((tasks[x].uxBasePriority == HOSTSIM_TASK_PRIORITY) || (strcmp(tasks[x].pcTaskName, "IDLE") == 0)){
+            continue;
+        }
+        printf("  task       %-16s %9u uS\n", tasks[x].pcTaskName, (unsigned) tasks[x].ulRunTimeCounter);
+        busy += (double) tasks[x].ulRunTimeCounter * 1e-6;
+    }
+
+    if(simulatedSeconds > 0){
+        printf("  load       %.3f%% busy, %.3f%% idle, at this machine's speed\n",
+               busy * 100.0 / simulatedSeconds, 100.0 - (busy * 100.0 / simulatedSeconds));
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostMain_bench(void)
+* Prints how the scheduler kept up with the benchmark outputs, and fails the
+* run if it ran out of room or an event did not run
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostMain_bench(void){
+    hostBenchStats_t stats;
+
+    HostBench_GetStats(&stats);
+
+    printf("  scheduler  %u coils, %u injectors, %u events of %u, %u without room, %u deepest of %u\n",
+           (unsigned) HOSTBENCH_COILS, (unsigned) HOSTBENCH_INJECTORS, (unsigned) stats.events,
+           (unsigned) stats.expected, (unsigned) stats.full, (unsigned) stats.deepest, (unsigned) SCHEDULER_QUEUE_SIZE);
+    printf("  late       %.0f nS mean, %.0f nS worst\n",
+           (stats.events > 0) ? (stats.lateSum / stats.events) : 0.0, stats.worstLate);
+
+    if((stats.full > 0) || (stats.events < stats.expected)){
+        printf("FAIL scheduler: %u events of %u, %u without room\n",
+               (unsigned) stats.events, (unsigned) stats.expected, (unsigned) stats.full);
+        hostMainFailed = 1;
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostMain_snapshotBench(void)
+* Prints how long the ignition task's reads for a spark take through the old
+* mutex locked getters and through one snapshot, and fails the run if the
+* decoder had no sync to read
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostMain_snapshotBench(void){
+    hostBenchSnapshot_t bench;
+    triggerSnapshot_t snapshot;
+
+    TriggerDecoder_GetSnapshot(&snapshot);
+    if(snapshot.currentAngle < 0){
+        printf("FAIL snapshot bench: no sync at the end of the run\n");
+        hostMainFailed = 1;
+        return;
+    }
+
+    HostBench_Snapshot(hostMainPattern, &bench);
+    printf("  reads      %u per path, %.1f nS locked getters, %.1f nS snapshot, per spark\n",
+           (unsigned) bench.reads, bench.lockedNs, bench.snapshotNs);
+}
+/*****************************************************************************/
+
+
+
+#ifdef TRIGGER_TOOTH_LOG
+/******************************************************************************
+* void hostMain_toothLog(const hostMainResult_t * result)
+* Prints the edges leading up to the first sync loss in the tooth log and a
+* few of those after it. With -l, fails the run unless the log froze
+* TRIGGER_TOOTH_LOG_AFTER_LOSS edges after the one that lost sync, counted by
+* the trigger handlers and in the log.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostMain_toothLog(const hostMainResult_t * result){
+    static const char * const names[4] = {"crank rise", "crank fall", "cam rise", "cam fall"};
+    static triggerToothLogEntry_t entries[TRIGGER_TOOTH_LOG_SIZE];
+    uint32_t frozen = TriggerDecoder_ToothLogIsFrozen();
+    uint32_t count;
+    uint32_t loss;
+    uint32_t x;
+
+    if(!frozen){
+        printf("  tooth log  running, sync was not lost\n");
+        if(hostMainLossCycle != 0){
+            printf("FAIL tooth log: still running after sync was lost\n");
+            hostMainFailed = 1;
+        }
+        return;
+    }
+
+    count = TriggerDecoder_GetToothLog(entries, TRIGGER_TOOTH_LOG_SIZE);
+    if(count <= TRIGGER_TOOTH_LOG_AFTER_LOSS){
+        return;
+    }
+    loss = count - 1U - TRIGGER_TOOTH_LOG_AFTER_LOSS;
+
+    if((hostMainLossCycle != 0) &&
+       (((result->frozenEdges - result->lossEdges) != TRIGGER_TOOTH_LOG_AFTER_LOSS) ||
+        ((entries[loss - 1U].edge & TRIG_LOG_SYNC) == 0) || ((entries[loss].edge & TRIG_LOG_SYNC) != 0))){
+        printf("FAIL tooth log: froze %lld edges after sync was lost, not %u, or the loss is not at edge %u\n",
+               (long long)(result->frozenEdges - result->lossEdges), (unsigned) TRIGGER_TOOTH_LOG_AFTER_LOSS, (unsigned) loss);
+        hostMainFailed = 1;
+    }
+
+    printf("  tooth log  %u edges, sync lost at edge %u\n", (unsigned) count, (unsigned) loss);
+    printf("         uS since last  edge        crank  cam  sync  tooth  confidence\n");
+    for(x = (loss > 16U) ? (loss - 16U) : 1U; (x < count) && (x <= loss + 8U); x++){
+        printf("    %s %10.1f  %-10s  %5u  %3u  %4u  %5u  %10u%s\n",
+               (x == loss) ? ">>" : "  ",
+               TIME_TICKS_TO_US((double) TIME_DIFF(entries[x].timeStamp, entries[x - 1U].timeStamp)),
+               names[entries[x].edge & TRIG_LOG_EVENT_MASK],
+               (unsigned) ((entries[x].edge & TRIG_LOG_PRIMARY_HIGH) != 0),
+               (unsigned) ((entries[x].edge & TRIG_LOG_SECONDARY_HIGH) != 0),
+               (unsigned) ((entries[x].edge & TRIG_LOG_SYNC) != 0),
+               (unsigned) entries[x].primaryEventNumber,
+               (unsigned) entries[x].syncConfidence,
+               (entries[x].edge & TRIG_LOG_OVERFLOW) ? "  edges dropped before" : "");
+    }
+}
+/*****************************************************************************/
+#endif
+
+
+
+/******************************************************************************
+* int hostMain_calibration(void)
+* Prints the conversion of every raw reading for every sensor, the raw reading
+* then one column per sensor in sensor_t order
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static int hostMain_calibration(void){
+    uint32_t raw;
+    uint32_t sensor;
+
+    for(raw = 0; raw <= SENSORS_FULL_SCALE; raw++){
+        printf("%u", raw);
+        for(sensor = 0; sensor < SENSOR_COUNT; sensor++){
+            printf(" %d", Calibration_Convert((sensor_t) sensor, (uint16_t) raw));
+        }
+        printf("\n");
+    }
+    return EXIT_SUCCESS;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* int hostMain_fuel(void)
+* Runs the fuel benchmark and prints the time per engine cycle
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static int hostMain_fuel(void){
+    hostBenchFuel_t result;
+
+    HostBench_Fuel(&result);
+
+    printf("fuel      %u cycles, %.1f nS per cycle for %u cylinders\n",
+           result.cycles, result.nsPerCycle, FUEL_CYLINDERS);
+    printf("wall      %u bad pulses with the wall fraction at 1 and past it\n", result.bad);
+
+    if(result.bad > 0){
+        printf("FAIL\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* int hostMain_snap(void)
+* Runs the throttle snap replay and prints the lambda range with and without
+* the transient fuel. Fails if the transient fuel lets lambda stray further
+* than HOSTMAIN_SNAP_LAMBDA, or does no better than the steady state fuel.
+* The cycle already fuelled when the throttle moved is reported, not held to
+* the limit.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static int hostMain_snap(void){
+    hostSnapResult_t result;
+    double excursion;
+    double baseExcursion;
+
+    HostSnap_Run(&result);
+
+    excursion = fmax(1.0 - result.richest, result.leanest - 1.0);
+    baseExcursion = fmax(1.0 - result.baseRichest, result.baseLeanest - 1.0);
+
+    printf("snap      %u cycles, lambda %.3f to %.3f with the transient fuel\n",
+           result.cycles, result.richest, result.leanest);
+    printf("base      lambda %.3f to %.3f on steady state fuel\n", result.baseRichest, result.baseLeanest);
+    printf("missed    lambda %.3f filling after the throttle moved, fuel worked out before\n", result.missedLeanest);
+
+    if((excursion > HOSTMAIN_SNAP_LAMBDA) || (excursion >= baseExcursion)){
+        printf("FAIL\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostMain_tables(void)
+* Runs the 3D table checks and prints what they found
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostMain_tables(void){
+    hostTableResult_t result;
+
+    HostTable_Run(&result);
+
+    printf("lookups   %u checked, %u wrong, %.2e worst error\n",
+           (unsigned) result.lookups, (unsigned) result.failures, result.worstError);
+    printf("clamping  %u lookups off the axes did not read the edge\n", (unsigned) result.clampFailures);
+    printf("axes      %u accepted or refused wrongly\n", (unsigned) result.axisFailures);
+    printf("writer    %u writes, %llu lookups from the reader, %llu mixed two writes\n",
+           (unsigned) result.writes, (unsigned long long) result.reads, (unsigned long long) result.tornReads);
+
+    if((result.failures > 0) || (result.clampFailures > 0) || (result.axisFailures > 0) || (result.tornReads > 0)){
+        printf("FAIL\n");
+        hostMainFailed = 1;
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* int hostMain_usage(const char * name)
+* Prints how to run the program
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static int hostMain_usage(const char * name){
+    fprintf(stderr, "usage: %s [-e rpm] [-t seconds] [-w ripple%%] [-n noise%%] [-d dropout%%] [-s seed]\n"
+                    "       [-i seconds] [-L degrees] [-p linear|second] [-j nS] [-J nS] [-l cycle] [-D image] [-S] [-B] [-R] [-M] [-C] [-F] [-T] [-m] [-A]\n"
+                    "       [stock|36-1|60-2|24+1] [rpm] [cycles]\n", name);
+    return EXIT_FAILURE;
+}
+/*****************************************************************************/
@@ -0,0 +1,36 @@
+/******************************************************************************
+* File:                    HostNvic.h
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       NVIC calls for the host build, pulled in by
+*                          core_cm4.h through CMSIS_NVIC_VIRTUAL. ISER and
+*                          ICER are write 1 to set and clear on the chip, but
+*                          are plain memory here, so enabling one interupt
+*                          would turn off every other. The simulated NVIC
+*                          keeps its enables in ISER only.
+******************************************************************************/
+#ifndef HOSTNVIC_H
+#define HOSTNVIC_H
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+#define HOSTNVIC_BIT(IRQn)          (1UL << (((uint32_t)(IRQn)) & 0x1FUL))
+#define HOSTNVIC_WORD(IRQn)         (((uint32_t)(IRQn)) >> 5UL)
+
+#define NVIC_EnableIRQ(IRQn)        (NVIC->ISER[HOSTNVIC_WORD(IRQn)] |= HOSTNVIC_BIT(IRQn))
+#define NVIC_DisableIRQ(IRQn)       (NVIC->ISER[HOSTNVIC_WORD(IRQn)] &= ~HOSTNVIC_BIT(IRQn))
+#define NVIC_GetEnableIRQ(IRQn)     ((NVIC->ISER[HOSTNVIC_WORD(IRQn)] & HOSTNVIC_BIT(IRQn)) != 0UL)
+
+#define NVIC_SetPriorityGrouping    __NVIC_SetPriorityGrouping
+#define NVIC_GetPriorityGrouping    __NVIC_GetPriorityGrouping
+#define NVIC_GetPendingIRQ          __NVIC_GetPendingIRQ
+#define NVIC_SetPendingIRQ          __NVIC_SetPendingIRQ
+#define NVIC_ClearPendingIRQ        __NVIC_ClearPendingIRQ
+#define NVIC_GetActive              __NVIC_GetActive
+#define NVIC_SetPriority            __NVIC_SetPriority
+#define NVIC_GetPriority            __NVIC_GetPriority
+#define NVIC_SystemReset            __NVIC_SystemReset
+
+
+#endif // ifdef HOSTNVIC_H
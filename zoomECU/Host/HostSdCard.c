@@ -0,0 +1,155 @@
+/******************************************************************************
+* File:                    HostSdCard.c
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       SD card for the host build, see HostSdCard.h.
+*
+* Every write goes straight to the image file, so when the program ends part
+* way through a log the image is left as a card would be at a power cut.
+*******************************************************************************
+* Includes
+******************************************************************************/
+#include "HostSdCard.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <stdio.h>
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+
+
+/******************************************************************************
+* Public Types
+******************************************************************************/
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+/******************************************************************************
+* Private Function Prototypes (static)
+******************************************************************************/
+
+
+/******************************************************************************
+* Private Variables (static)
+******************************************************************************/
+static FILE * hostSdCardImage;
+static uint32_t hostSdCardImageBlocks;
+
+// Set by SdCard_Init, as on a card
+static uint32_t hostSdCardBlockCount;
+
+/******************************************************************************
+* Function Code
+******************************************************************************/
+
+
+/******************************************************************************
+* int32_t HostSdCard_Open(const char * path)
+* Opens the image for reading and writing and takes its size
+* David Tolsma, 10/17/2026
+******************************************************************************/
+int32_t HostSdCard_Open(const char * path){
+    long size;
+
+    hostSdCardImage = fopen(path, "r+b");
+    if(hostSdCardImage == 0){
+        return -1;
+    }
+
+    fseek(hostSdCardImage, 0, SEEK_END);
+    size = ftell(hostSdCardImage);
+    hostSdCardImageBlocks = (size > 0) ? (uint32_t)(size / SDCARD_BLOCK_SIZE) : 0;
+
+    return (hostSdCardImageBlocks > 0) ? 0 : -1;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* int32_t SdCard_Init(void)
+* uint32_t SdCard_IsPresent(void)
+* uint32_t SdCard_GetBlockCount(void)
+* The card is in the socket and ready once an image is open
+* David Tolsma, 10/17/2026
+******************************************************************************/
+int32_t SdCard_Init(void){
+    hostSdCardBlockCount = 0;
+
+    if(!SdCard_IsPresent()){
+        return SDCARD_NO_CARD;
+    }
+
+    hostSdCardBlockCount = hostSdCardImageBlocks;
+    return SDCARD_OK;
+}
+
+uint32_t SdCard_IsPresent(void){
+    return (hostSdCardImage != 0);
+}
+
+uint32_t SdCard_GetBlockCount(void){
+    return hostSdCardBlockCount;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* int32_t SdCard_ReadBlock(uint32_t block, uint8_t * data)
+* Reads a block of the image
+* David Tolsma, 10/17/2026
+******************************************************************************/
+int32_t SdCard_ReadBlock(uint32_t block, uint8_t * data){
+    if(hostSdCardBlockCount == 0){
+        return SDCARD_NO_CARD;
+    }
+    if(block >= hostSdCardBlockCount){
+        return SDCARD_ERROR;
+    }
+
+    fseek(hostSdCardImage, (long) block * SDCARD_BLOCK_SIZE, SEEK_SET);
+    if(fread(data, SDCARD_BLOCK_SIZE, 1, hostSdCardImage) != 1){
+        return SDCARD_ERROR;
+    }
+    return SDCARD_OK;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* int32_t SdCard_WriteBlocks(uint32_t block, const uint8_t * data, uint32_t count)
+* Writes the blocks to the image one at a time, sleeping HOSTSDCARD_BLOCK_TICKS
+* after each like the driver sleeps while a block is moved and programmed
+* David Tolsma, 10/17/2026
+******************************************************************************/
+int32_t SdCard_WriteBlocks(uint32_t block, const uint8_t * data, uint32_t count){
+    uint32_t x;
+
+    if(hostSdCardBlockCount == 0){
+        return SDCARD_NO_CARD;
+    }
+    if((block >= hostSdCardBlockCount) || (count > (hostSdCardBlockCount - block))){
+        return SDCARD_ERROR;
+    }
+
+    for(x = 0; x < count; x++){
+        fseek(hostSdCardImage, (long)(block + x) * SDCARD_BLOCK_SIZE, SEEK_SET);
+        if((fwrite(&data[x * SDCARD_BLOCK_SIZE], SDCARD_BLOCK_SIZE, 1, hostSdCardImage) != 1) ||
+           (fflush(hostSdCardImage) != 0)){
+            return SDCARD_ERROR;
+        }
+        vTaskDelay(HOSTSDCARD_BLOCK_TICKS);
+    }
+
+    return SDCARD_OK;
+}
+/*****************************************************************************/
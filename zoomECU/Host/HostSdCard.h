@@ -0,0 +1,53 @@
+/******************************************************************************
+* File:                    HostSdCard.h
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       SD card for the host build, in place of SdCard.c.
+*                          The card is an image file, and each block written
+*                          keeps the calling task asleep for as long as a
+*                          card takes to take a block in, so the datalogger's
+*                          write times and dropped frames can be seen.
+******************************************************************************/
+#ifndef HOSTSDCARD_H
+#define HOSTSDCARD_H
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <stdint.h>
+
+#include "SdCard.h"
+
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+// RTOS ticks (1mS) each block written takes, DMA and programming. Cards
+// program a block in 0.25 to 1mS, so this is a slow card.
+#define HOSTSDCARD_BLOCK_TICKS      1U
+
+
+/******************************************************************************
+* Public Types
+******************************************************************************/
+
+
+/******************************************************************************
+* Public Function Prototypes
+******************************************************************************/
+    /******************************************************************************
+    * int32_t HostSdCard_Open(const char * path)
+    * Puts the card image at path in the socket, its size is the card's size.
+    * Returns 0, or -1 if it can not be opened or is under a block.
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    int32_t HostSdCard_Open(const char * path);
+    /*****************************************************************************/
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+#endif // ifdef HOSTSDCARD_H
@@ -0,0 +1,1162 @@
+/******************************************************************************
+* File:                    HostSim.c
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Simulated peripherals for the host build. The
+*                          firmware reads and writes its registers as usual,
+*                          this module moves the counters, raises the flags
+*                          the hardware would and calls the handlers.
+*
+* Time only moves when the hardware task asks it to. After every interupt the
+* hardware task waits for the rest of the tasks to go idle before moving on,
+* so the firmware always sees an instant response from its tasks and a run is
+* repeatable. The RTOS tick is given from the same simulated time once the
+* hardware task calls HostSim_Start, so delays and timeouts line up with TIM2
+* too. The POSIX port's own SIGALRM tick is turned off for that.
+*
+* Two writes to a plain memory BSRR in a row would only leave the last one, so
+* Gpio_SetPin and Gpio_ResetPin are wrapped at link time (--wrap) and applied
+* to ODR as they happen.
+*
+* The handlers run in no simulated time, but on the ECU a pin written from a
+* handler moves a little after the interupt was raised, and later again if the
+* core is still busy with another handler. Each handler is taken to keep the
+* core busy for a set time (HostSim_SetIrqTime), and the output callback is
+* given both the time an edge was due and the time the pin would have moved.
+* Channels 1 and 2 of TIM3 and TIM4 are modelled as output compares, which
+* move their pin on the match itself.
+*
+* TIM6 is modelled as the one shot delay Sensors.c times its MAP samples with,
+* and its update starts an injected conversion on ADC1, read from the analog
+* callback when the sample is taken. The regular scans and their DMA are not
+* modelled, so the rest of the sensors read a raw 0.
+*
+* Sensors_Init waits on the ADCs. Until HostSim_Start, TIM2 moves on a tick
+* each time the firmware reads it (Time_GetTicks is wrapped like the GPIO
+* writes), and a host thread ends each calibration the firmware starts.
+* ADRDY is write 1 to clear, so the firmware's own write to clear it leaves it
+* set in plain memory.
+*******************************************************************************
+* Includes
+******************************************************************************/
+#include "HostSim.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "stm32g4xx.h"
+#include "Time.h"
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+// Register blocks mapped as memory: the APB/AHB peripherals up to the ADCs,
+// and the Cortex-M system space (NVIC, SCB, DWT, DBGMCU)
+#define HOSTSIM_PERIPH_START        0x40000000UL
+#define HOSTSIM_PERIPH_SIZE         0x10100000UL
+#define HOSTSIM_CORE_START          0xE0000000UL
+#define HOSTSIM_CORE_SIZE           0x00100000UL
+
+// Handlers that keep raising themselves are a firmware bug, give up after this
+// many back to back
+#define HOSTSIM_MAX_IRQ_PASSES      1000U
+
+// TIM SR and DIER share the positions of the update and compare 1-4 bits
+#define HOSTSIM_TIM_IRQ_MASK        (TIM_SR_UIF | TIM_SR_CC1IF | TIM_SR_CC2IF | TIM_SR_CC3IF | TIM_SR_CC4IF)
+
+#define HOSTSIM_NO_MATCH            0x100000000ULL
+
+// TIM2 ticks between RTOS ticks
+#define HOSTSIM_TICK_PERIOD         ((uint32_t) TIME_US_TO_TICKS(1000000U / configTICK_RATE_HZ))
+
+// Rounds nS to TIM2 ticks
+#define HOSTSIM_NS_TO_TICKS(ns)     ((uint32_t)((((uint64_t)(ns) * TIME_TICKS_PER_US) + 500U) / 1000U))
+
+// From an interupt being raised to its handler writing a pin: 12 cycles to
+// stack the registers and about as many again of handler preamble at 170 MHz
+#define HOSTSIM_IRQ_ENTRY_NS        150U
+
+// Time each handler keeps the core busy unless HostSim_SetIrqTime says otherwise
+#define HOSTSIM_DEFAULT_IRQ_NS      1500U
+
+// Output compare channels modelled, TIM3 CH1/CH2 and TIM4 CH1/CH2
+#define HOSTSIM_COMPARE_CHANNELS    4U
+
+// OCxM modes, the extended modes (OCxM_3) and PWM are not modelled
+#define HOSTSIM_OC_ACTIVE           1U      // Set active on match
+#define HOSTSIM_OC_INACTIVE         2U      // Set inactive on match
+#define HOSTSIM_OC_TOGGLE           3U      // Toggle on match
+#define HOSTSIM_OC_FORCE_INACTIVE   4U
+#define HOSTSIM_OC_FORCE_ACTIVE     5U
+
+// ADC1/2 injected trigger input of TIM6_TRGO (RM0440, ADC1/2 injected triggers)
+#define HOSTSIM_JEXTSEL_TIM6_TRGO   14U
+
+// From the trigger to JEOS: 92.5 ADC clocks of sampling and 12.5 of conversion
+// at 42.5 Mhz
+#define HOSTSIM_ADC_CONVERSION_NS   2500U
+
+// ADCs whose calibration the start up thread ends, and how often it looks
+#define HOSTSIM_ADC_COUNT           5U
+#define HOSTSIM_BOOT_POLL_US        10U
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+/******************************************************************************
+* Private Function Prototypes (static)
+******************************************************************************/
+static void hostSim_mapRegion(uintptr_t start, size_t size);
+static void hostSim_setCount(uint32_t count);
+static uint64_t hostSim_nextMatch(uint32_t now);
+static void hostSim_softwareEvents(void);
+static uint32_t hostSim_pending(hostSimIrq_t irq);
+static uint32_t hostSim_serviceInterrupts(void);
+static void hostSim_runIrq(hostSimIrq_t irq);
+static uint32_t hostSim_tick(void);
+static void hostSim_writeOutput(GPIO_TypeDef * port, uint32_t pin, uint32_t level);
+static uint32_t hostSim_pinTime(void);
+static uint32_t hostSim_isAlternate(GPIO_TypeDef * port, uint32_t pin, uint32_t alternateFunction);
+static uint32_t hostSim_compareMode(uint32_t x);
+static void hostSim_compareMatch(uint32_t count);
+static void hostSim_compareForce(void);
+static void hostSim_compareOutputs(uint32_t time, uint32_t due);
+static uint32_t hostSim_timer6Ticks(void);
+static void hostSim_timer6Events(void);
+static void hostSim_timer6Count(uint32_t count);
+static void hostSim_injectedTrigger(uint32_t time);
+static void * hostSim_bootThread(void * argument);
+
+// Firmware handlers, weak so a build without one of them still links
+extern void TIM2_IRQHandler(void) __attribute__((weak));
+extern void TIM8_CC_IRQHandler(void) __attribute__((weak));
+extern void EXTI1_IRQHandler(void) __attribute__((weak));
+extern void EXTI3_IRQHandler(void) __attribute__((weak));
+extern void ADC1_2_IRQHandler(void) __attribute__((weak));
+
+void __wrap_Gpio_SetPin(GPIO_TypeDef * GPIOx, uint32_t Pin);
+void __wrap_Gpio_ResetPin(GPIO_TypeDef * GPIOx, uint32_t Pin);
+uint32_t __wrap_Time_GetTicks(void);
+uint32_t __real_Time_GetTicks(void);
+void vApplicationIdleHook(void);
+
+/******************************************************************************
+* Private Variables (static)
+******************************************************************************/
+// Interupts in the order the NVIC takes them at equal priority (lowest IRQn first)
+static const IRQn_Type hostSimIrqNumber[HOSTSIM_IRQ_COUNT] = {TIM2_IRQn, TIM8_CC_IRQn, EXTI1_IRQn, EXTI3_IRQn, ADC1_2_IRQn};
+static const hostSimIrq_t hostSimIrqOrder[HOSTSIM_IRQ_COUNT] = {HOSTSIM_IRQ_EXTI1, HOSTSIM_IRQ_EXTI3, HOSTSIM_IRQ_ADC1_2, HOSTSIM_IRQ_TIM2, HOSTSIM_IRQ_TIM8_CC};
+static void (* const hostSimIrqHandler[HOSTSIM_IRQ_COUNT])(void) = {TIM2_IRQHandler, TIM8_CC_IRQHandler, EXTI1_IRQHandler, EXTI3_IRQHandler, ADC1_2_IRQHandler};
+
+// EXTI lines waiting for their handler. PR1 is write 1 to clear, which plain
+// memory can not do, so the pending lines are kept here and copied into PR1
+// for the handler to read.
+static uint32_t hostSimExtiPending;
+
+// JEOS is write 1 to clear as well, so it is kept here the same way
+static uint32_t hostSimAdcPending;
+
+static hostSimIrqStats_t hostSimIrqStats[HOSTSIM_IRQ_COUNT];
+static hostSimOutputCallback_t hostSimOutputCallback;
+
+static TaskHandle_t hostSimTaskHandle;
+
+// TIM2 time of the next RTOS tick, only counted once started
+static uint32_t hostSimNextTick;
+static uint32_t hostSimTicking;
+static volatile uint32_t hostSimWaiting;
+
+// Ticks each handler keeps the core busy, the TIM2 time the core is free
+// again, and while a handler runs, the time its pin writes land
+static uint32_t hostSimIrqTicks = HOSTSIM_NS_TO_TICKS(HOSTSIM_DEFAULT_IRQ_NS);
+static uint32_t hostSimCoreFree;
+static uint32_t hostSimInIrq;
+static uint32_t hostSimIrqPinTime;
+static uint32_t hostSimIrqDue;
+
+// Output compare channels: timer, compare register, OCxM/CCxE position
+static TIM_TypeDef * const hostSimCompareTimer[HOSTSIM_COMPARE_CHANNELS] = {TIM3, TIM3, TIM4, TIM4};
+static volatile uint32_t * const hostSimCompareRegister[HOSTSIM_COMPARE_CHANNELS] = {&TIM3->CCR1, &TIM3->CCR2, &TIM4->CCR1, &TIM4->CCR2};
+static const uint32_t hostSimCompareChannel[HOSTSIM_COMPARE_CHANNELS] = {0, 1, 0, 1};
+
+// OCxREF of each channel
+static uint32_t hostSimCompareRef[HOSTSIM_COMPARE_CHANNELS];
+
+// Pins each channel can be routed to (RM0440 alternate function table), and
+// the level last reported for each
+static const struct{
+    GPIO_TypeDef * port;
+    uint32_t pin;
+    uint32_t alternateFunction;
+    uint32_t channel;
+}hostSimCompareRoutes[] = {
+    {GPIOA, (0x1UL << 6), 2, 0},        // TIM3_CH1
+    {GPIOB, (0x1UL << 4), 2, 0},
+    {GPIOC, (0x1UL << 6), 2, 0},
+    {GPIOA, (0x1UL << 7), 2, 1},        // TIM3_CH2
+    {GPIOB, (0x1UL << 5), 2, 1},
+    {GPIOC, (0x1UL << 7), 2, 1},
+    {GPIOB, (0x1UL << 6), 2, 2},        // TIM4_CH1
+    {GPIOD, (0x1UL << 12), 2, 2},
+    {GPIOB, (0x1UL << 7), 2, 3},        // TIM4_CH2
+    {GPIOD, (0x1UL << 13), 2, 3},
+};
+static uint32_t hostSimRouteLevel[sizeof(hostSimCompareRoutes) / sizeof(hostSimCompareRoutes[0])];
+
+// TIM6 while it counts: the TIM2 time it was at 0, and the CNT and ARR last
+// seen, so a restart by the firmware shows
+static uint32_t hostSimTimer6Running;
+static uint32_t hostSimTimer6Start;
+static uint32_t hostSimTimer6Seen;
+static uint32_t hostSimTimer6Reload;
+
+// Injected conversion under way on ADC1, the reading it took and when it ends
+static uint32_t hostSimAdcConverting;
+static uint32_t hostSimAdcDue;
+static uint32_t hostSimAdcValue;
+static hostSimAnalogCallback_t hostSimAnalogCallback;
+
+// The start up thread runs until HostSim_Start
+static pthread_t hostSimBoot;
+static volatile uint32_t hostSimBooting;
+
+/******************************************************************************
+* Function Code
+******************************************************************************/
+
+
+/******************************************************************************
+* void HostSim_Init(void)
+* Maps zeroed memory over the register blocks, the reset value of most
+* registers, so the firmware can use its usual register pointers, and starts
+* the thread that calibrates the ADCs. It is a plain host thread with every
+* signal blocked, they belong to the RTOS port.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void HostSim_Init(void){
+    sigset_t blocked;
+    sigset_t previous;
+
+    hostSim_mapRegion(HOSTSIM_PERIPH_START, HOSTSIM_PERIPH_SIZE);
+    hostSim_mapRegion(HOSTSIM_CORE_START, HOSTSIM_CORE_SIZE);
+
+    hostSimBooting = 1;
+    sigfillset(&blocked);
+    pthread_sigmask(SIG_SETMASK, &blocked, &previous);
+    if(pthread_create(&hostSimBoot, 0, &hostSim_bootThread, 0) != 0){
+        fprintf(stderr, "HostSim: can not start the ADC calibration thread\n");
+        exit(EXIT_FAILURE);
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, 0);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void HostSim_Start(void)
+* Takes the RTOS tick over from the POSIX port. Register writes made during
+* init (the TIM2 restart) are acted on first, so the ticks count from the
+* time the firmware sees. Time only moves when asked from here on.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void HostSim_Start(void){
+    struct itimerval stopped = {{0, 0}, {0, 0}};
+
+    setitimer(ITIMER_REAL, &stopped, 0);
+
+    hostSimBooting = 0;
+    pthread_join(hostSimBoot, 0);
+
+    hostSimTaskHandle = xTaskGetCurrentTaskHandle();
+    hostSim_softwareEvents();
+    hostSimNextTick = READ_REG(TIM2->CNT) + HOSTSIM_TICK_PERIOD;
+    hostSimTicking = 1;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void HostSim_AdvanceTo(uint32_t time)
+* Steps the count from one compare match (or overflow) to the next until it
+* reaches the time asked for, running the interupts raised at each step and
+* letting the tasks they wake finish before going on. A task may arm a new
+* compare, or start TIM6, at any step, so its writes are acted on and the next
+* match is looked for again each time.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void HostSim_AdvanceTo(uint32_t time){
+    uint32_t now;
+    uint64_t span;
+    uint64_t step;
+    uint32_t woken;
+
+    while(1){
+        if(hostSim_serviceInterrupts()){
+            HostSim_WaitIdle();
+        }
+
+        now = READ_REG(TIM2->CNT);
+        span = (uint32_t)(time - now);
+        if(span == 0){
+            break;
+        }
+
+        step = hostSim_nextMatch(now);
+        if(step > span){
+            step = span;
+        }
+
+        hostSim_setCount(now + (uint32_t) step);
+
+        woken = hostSim_serviceInterrupts();
+        woken |= hostSim_tick();
+        if(woken){
+            HostSim_WaitIdle();
+        }
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void HostSim_SetInput(GPIO_TypeDef * port, uint32_t pin, uint32_t level)
+* Changes an IDR bit. If its EXTI line is routed to this port (SYSCFG EXTICR)
+* and the edge is enabled, the line is made pending and serviced.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void HostSim_SetInput(GPIO_TypeDef * port, uint32_t pin, uint32_t level){
+    uint32_t line;
+    uint32_t portIndex;
+    uint32_t routedPort;
+    uint32_t edgeEnabled;
+
+    if(((READ_REG(port->IDR) & pin) != 0) == (level != 0)){
+        return;
+    }
+
+    if(level){
+        SET_BIT(port->IDR, pin);
+    }
+    else{
+        CLEAR_BIT(port->IDR, pin);
+    }
+
+    line = (uint32_t) __builtin_ctz(pin);
+    portIndex = (uint32_t)(((uintptr_t) port - GPIOA_BASE) / (GPIOB_BASE - GPIOA_BASE));
+    routedPort = (READ_REG(SYSCFG->EXTICR[line >> 2]) >> ((line & 3U) * 4U)) & 0xFU;
+    edgeEnabled = level ? READ_BIT(EXTI->RTSR1, pin) : READ_BIT(EXTI->FTSR1, pin);
+
+    if((routedPort == portIndex) && edgeEnabled){
+        hostSimExtiPending |= pin;
+    }
+
+    if(hostSim_serviceInterrupts()){
+        HostSim_WaitIdle();
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void HostSim_WaitIdle(void)
+* Sleeps until the idle hook runs, which only happens once every other task
+* is blocked. The hardware task has the highest priority, so the idle task
+* can not run while it is busy and a wake up can not be missed.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void HostSim_WaitIdle(void){
+    hostSimTaskHandle = xTaskGetCurrentTaskHandle();
+    hostSimWaiting = 1;
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void HostSim_SetOutputCallback(hostSimOutputCallback_t callback)
+* Sets the function told about every GPIO output change
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void HostSim_SetOutputCallback(hostSimOutputCallback_t callback){
+    hostSimOutputCallback = callback;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void HostSim_SetAnalogCallback(hostSimAnalogCallback_t callback)
+* Sets the function that gives the reading of each injected conversion
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void HostSim_SetAnalogCallback(hostSimAnalogCallback_t callback){
+    hostSimAnalogCallback = callback;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void HostSim_SetIrqTime(uint32_t nanoseconds)
+* Sets how long each handler keeps the core busy on the ECU
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void HostSim_SetIrqTime(uint32_t nanoseconds){
+    hostSimIrqTicks = HOSTSIM_NS_TO_TICKS(nanoseconds);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void HostSim_GetIrqStats(hostSimIrq_t irq, hostSimIrqStats_t * stats)
+* Copies the counts and handler times of an interupt
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void HostSim_GetIrqStats(hostSimIrq_t irq, hostSimIrqStats_t * stats){
+    *stats = hostSimIrqStats[irq];
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t HostSim_GetCoreTime(void)
+* Returns the TIM2 time the code running now would be at on the ECU, see
+* hostSim_pinTime
+* David Tolsma, 10/17/2026
+******************************************************************************/
+uint32_t HostSim_GetCoreTime(void){
+    return hostSim_pinTime();
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t HostSim_GetRunTimeCounter(void)
+* Returns the CPU time the process has used in uS. Only one task thread runs
+* at a time, so the kernel charges each task the CPU time it used.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+uint32_t HostSim_GetRunTimeCounter(void){
+    struct timespec now;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+
+    return (uint32_t)(((uint64_t) now.tv_sec * 1000000ULL) + ((uint64_t) now.tv_nsec / 1000ULL));
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void vApplicationIdleHook(void)
+* Wakes the hardware task once everything else has gone idle
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void vApplicationIdleHook(void){
+    if(hostSimWaiting){
+        hostSimWaiting = 0;
+        xTaskNotifyGive(hostSimTaskHandle);
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void __wrap_Gpio_SetPin(GPIO_TypeDef * GPIOx, uint32_t Pin)
+* void __wrap_Gpio_ResetPin(GPIO_TypeDef * GPIOx, uint32_t Pin)
+* Stand in for the firmware's Gpio_SetPin and Gpio_ResetPin
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void __wrap_Gpio_SetPin(GPIO_TypeDef * GPIOx, uint32_t Pin){
+    hostSim_writeOutput(GPIOx, Pin, 1);
+}
+
+void __wrap_Gpio_ResetPin(GPIO_TypeDef * GPIOx, uint32_t Pin){
+    hostSim_writeOutput(GPIOx, Pin, 0);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t __wrap_Time_GetTicks(void)
+* Stand in for the firmware's Time_GetTicks. Before HostSim_Start nothing
+* else moves the count, so each read moves it on a tick, as the count would
+* while the core spins on it.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+uint32_t __wrap_Time_GetTicks(void){
+    if(hostSimTicking == 0){
+        WRITE_REG(TIM2->CNT, READ_REG(TIM2->CNT) + 1U);
+    }
+
+    return __real_Time_GetTicks();
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostSim_mapRegion(uintptr_t start, size_t size)
+* Maps zeroed memory at a fixed address, the run can not go on without it
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostSim_mapRegion(uintptr_t start, size_t size){
+    void * region;
+
+    region = mmap((void *) start, size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE | MAP_NORESERVE, -1, 0);
+    if(region != (void *) start){
+        fprintf(stderr, "HostSim: can not map registers at 0x%08lx\n", (unsigned long) start);
+        exit(EXIT_FAILURE);
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostSim_setCount(uint32_t count)
+* Moves TIM2 and its reset mode slaves to a new count, and sets the flags of
+* every compare that matches there. Passing through zero is an overflow.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostSim_setCount(uint32_t count){
+    TIM_TypeDef * const slaves[4] = {TIM3, TIM4, TIM5, TIM8};
+    uint32_t x;
+
+    WRITE_REG(TIM2->CNT, count);
+    for(x = 0; x < 4U; x++){
+        WRITE_REG(slaves[x]->CNT, count & READ_REG(slaves[x]->ARR));
+    }
+
+    hostSim_compareMatch(count);
+
+    if(count == 0){
+        SET_BIT(TIM2->SR, TIM_SR_UIF);
+    }
+
+    if(READ_REG(TIM2->CCR1) == count){ SET_BIT(TIM2->SR, TIM_SR_CC1IF); }
+    if(READ_REG(TIM2->CCR2) == count){ SET_BIT(TIM2->SR, TIM_SR_CC2IF); }
+    if(READ_REG(TIM2->CCR3) == count){ SET_BIT(TIM2->SR, TIM_SR_CC3IF); }
+    if(READ_REG(TIM2->CCR4) == count){ SET_BIT(TIM2->SR, TIM_SR_CC4IF); }
+
+    if(READ_REG(TIM8->CCR1) == READ_REG(TIM8->CNT)){ SET_BIT(TIM8->SR, TIM_SR_CC1IF); }
+    if(READ_REG(TIM8->CCR2) == READ_REG(TIM8->CNT)){ SET_BIT(TIM8->SR, TIM_SR_CC2IF); }
+    if(READ_REG(TIM8->CCR3) == READ_REG(TIM8->CNT)){ SET_BIT(TIM8->SR, TIM_SR_CC3IF); }
+    if(READ_REG(TIM8->CCR4) == READ_REG(TIM8->CNT)){ SET_BIT(TIM8->SR, TIM_SR_CC4IF); }
+
+    hostSim_timer6Count(count);
+
+    if(hostSimAdcConverting && (count == hostSimAdcDue)){
+        hostSimAdcConverting = 0;
+        WRITE_REG(ADC1->JDR1, hostSimAdcValue);
+        hostSimAdcPending = ADC_ISR_JEOS;
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint64_t hostSim_nextMatch(uint32_t now)
+* Returns how many ticks after now the next enabled compare matches or the
+* count overflows. TIM8 only compares its low 16 bits, as do the TIM3 and
+* TIM4 output compares, which count without an interupt being enabled. The
+* end of a TIM6 delay and of an injected conversion are steps too.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint64_t hostSim_nextMatch(uint32_t now){
+    volatile uint32_t * const tim2Compare[4] = {&TIM2->CCR1, &TIM2->CCR2, &TIM2->CCR3, &TIM2->CCR4};
+    volatile uint32_t * const tim8Compare[4] = {&TIM8->CCR1, &TIM8->CCR2, &TIM8->CCR3, &TIM8->CCR4};
+    uint64_t next;
+    uint64_t distance;
+    uint32_t mode;
+    uint32_t x;
+
+    next = HOSTSIM_NO_MATCH - now;
+
+    if(hostSimTicking){
+        next = (uint32_t)(hostSimNextTick - now);
+    }
+
+    for(x = 0; x < 4U; x++){
+        if(READ_BIT(TIM2->DIER, TIM_DIER_CC1IE << x)){
+            distance = (uint32_t)(*tim2Compare[x] - now);
+            if((distance != 0) && (distance < next)){
+                next = distance;
+            }
+        }
+        if(READ_BIT(TIM8->DIER, TIM_DIER_CC1IE << x)){
+            distance = (uint16_t)(*tim8Compare[x] - now);
+            if(distance == 0){
+                distance = 0x10000U;
+            }
+            if(distance < next){
+                next = distance;
+            }
+        }
+    }
+
+    for(x = 0; x < HOSTSIM_COMPARE_CHANNELS; x++){
+        mode = hostSim_compareMode(x);
+        if((mode >= HOSTSIM_OC_ACTIVE) && (mode <= HOSTSIM_OC_TOGGLE)){
+            distance = (uint16_t)(*hostSimCompareRegister[x] - READ_REG(hostSimCompareTimer[x]->CNT));
+            if(distance == 0){
+                distance = 0x10000U;
+            }
+            if(distance < next){
+                next = distance;
+            }
+        }
+    }
+
+    if(hostSimTimer6Running){
+        distance = (uint32_t)((hostSimTimer6Start + ((READ_REG(TIM6->ARR) + 1U) * hostSim_timer6Ticks())) - now);
+        if((distance != 0) && (distance < next)){
+            next = distance;
+        }
+    }
+    if(hostSimAdcConverting){
+        distance = (uint32_t)(hostSimAdcDue - now);
+        if((distance != 0) && (distance < next)){
+            next = distance;
+        }
+    }
+
+    return next;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostSim_softwareEvents(void)
+* Acts on register writes that the hardware reacts to straight away, update
+* and compare events generated through EGR, forced output compare levels, and
+* TIM6 being started or stopped
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostSim_softwareEvents(void){
+    TIM_TypeDef * const timers[2] = {TIM2, TIM8};
+    uint32_t tim2Status;
+    uint32_t tim8Status;
+    uint32_t x;
+
+    // UG restarts TIM2 and, through TRGO, every timer slaved to it. The firmware
+    // clears the flags after its UG, so none are raised by the restart here.
+    if(READ_BIT(TIM2->EGR, TIM_EGR_UG)){
+        CLEAR_BIT(TIM2->EGR, TIM_EGR_UG);
+        tim2Status = READ_REG(TIM2->SR);
+        tim8Status = READ_REG(TIM8->SR);
+        hostSim_setCount(0);
+        WRITE_REG(TIM2->SR, tim2Status);
+        WRITE_REG(TIM8->SR, tim8Status);
+    }
+
+    for(x = 0; x < 2U; x++){
+        if(READ_REG(timers[x]->EGR)){
+            SET_BIT(timers[x]->SR, READ_REG(timers[x]->EGR) & (TIM_SR_CC1IF | TIM_SR_CC2IF | TIM_SR_CC3IF | TIM_SR_CC4IF));
+            WRITE_REG(timers[x]->EGR, 0);
+        }
+    }
+
+    hostSim_compareForce();
+    hostSim_timer6Events();
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t hostSim_pending(hostSimIrq_t irq)
+* Returns non zero if an interupt is enabled in the NVIC and has a flag up
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint32_t hostSim_pending(hostSimIrq_t irq){
+    uint32_t irqNumber = (uint32_t) hostSimIrqNumber[irq];
+
+    if((hostSimIrqHandler[irq] == 0) || ((NVIC->ISER[irqNumber >> 5] & (1UL << (irqNumber & 31U))) == 0)){
+        return 0;
+    }
+
+    switch(irq){
+        case HOSTSIM_IRQ_TIM2:      return READ_REG(TIM2->SR) & READ_REG(TIM2->DIER) & HOSTSIM_TIM_IRQ_MASK;
+        case HOSTSIM_IRQ_TIM8_CC:   return READ_REG(TIM8->SR) & READ_REG(TIM8->DIER) & HOSTSIM_TIM_IRQ_MASK & ~TIM_SR_UIF;
+        case HOSTSIM_IRQ_EXTI1:     return hostSimExtiPending & READ_REG(EXTI->IMR1) & EXTI_IMR1_IM1;
+        case HOSTSIM_IRQ_EXTI3:     return hostSimExtiPending & READ_REG(EXTI->IMR1) & EXTI_IMR1_IM3;
+        case HOSTSIM_IRQ_ADC1_2:    return hostSimAdcPending & READ_REG(ADC1->IER) & ADC_IER_JEOSIE;
+        default:                    return 0;
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t hostSim_serviceInterrupts(void)
+* Runs pending interupts until none are left, returns how many ran
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint32_t hostSim_serviceInterrupts(void){
+    uint32_t serviced = 0;
+    uint32_t passes;
+    uint32_t x;
+    uint32_t ran;
+
+    for(passes = 0; passes < HOSTSIM_MAX_IRQ_PASSES; passes++){
+        hostSim_softwareEvents();
+
+        ran = 0;
+        for(x = 0; (x < HOSTSIM_IRQ_COUNT) && (ran == 0); x++){
+            if(hostSim_pending(hostSimIrqOrder[x])){
+                hostSim_runIrq(hostSimIrqOrder[x]);
+                ran = 1;
+            }
+        }
+
+        if(ran == 0){
+            return serviced;
+        }
+        serviced++;
+    }
+
+    fprintf(stderr, "HostSim: interupts still pending after %u passes\n", HOSTSIM_MAX_IRQ_PASSES);
+    exit(EXIT_FAILURE);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostSim_runIrq(hostSimIrq_t irq)
+* Calls a handler with the tick interupt masked, like an interupt at
+* configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY, and times it. The tasks it
+* wakes all have a lower priority than the hardware task, so its yield does
+* not switch away. On the ECU the handler starts once the core is free, and
+* its pin writes land one entry time after that.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostSim_runIrq(hostSimIrq_t irq){
+    struct timespec startTime;
+    struct timespec end;
+    uint64_t nanoseconds;
+    uint32_t line = 0;
+    uint32_t start;
+
+    if(irq == HOSTSIM_IRQ_EXTI1){
+        line = EXTI_PR1_PIF1;
+    }
+    else if(irq == HOSTSIM_IRQ_EXTI3){
+        line = EXTI_PR1_PIF3;
+    }
+    WRITE_REG(EXTI->PR1, hostSimExtiPending);
+    MODIFY_REG(ADC1->ISR, ADC_ISR_JEOS, hostSimAdcPending);
+
+    hostSimIrqDue = READ_REG(TIM2->CNT);
+    start = (TIME_DIFF(hostSimCoreFree, hostSimIrqDue) > 0) ? hostSimCoreFree : hostSimIrqDue;
+    hostSimIrqPinTime = start + HOSTSIM_NS_TO_TICKS(HOSTSIM_IRQ_ENTRY_NS);
+    hostSimInIrq = 1;
+
+    taskENTER_CRITICAL();
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    hostSimIrqHandler[irq]();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    taskEXIT_CRITICAL();
+
+    // A channel forced by the handler moves with its other writes
+    hostSim_compareForce();
+    hostSimInIrq = 0;
+    hostSimCoreFree = hostSimIrqPinTime + hostSimIrqTicks;
+
+    // Taking the EXTI interupt clears its pending line, the ADC handler always
+    // clears JEOS
+    hostSimExtiPending &= ~line;
+    WRITE_REG(EXTI->PR1, hostSimExtiPending);
+    if(irq == HOSTSIM_IRQ_ADC1_2){
+        hostSimAdcPending = 0;
+        CLEAR_BIT(ADC1->ISR, ADC_ISR_JEOS);
+    }
+
+    nanoseconds = ((uint64_t)(end.tv_sec - startTime.tv_sec) * 1000000000ULL) + (uint64_t) end.tv_nsec - (uint64_t) startTime.tv_nsec;
+    hostSimIrqStats[irq].calls++;
+    hostSimIrqStats[irq].nanoseconds += nanoseconds;
+    if(nanoseconds > hostSimIrqStats[irq].worstNanoseconds){
+        hostSimIrqStats[irq].worstNanoseconds = nanoseconds;
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t hostSim_tick(void)
+* Gives the RTOS its tick when the count reaches it, the way the SysTick
+* handler does. Returns non zero if a tick was given.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint32_t hostSim_tick(void){
+    if((hostSimTicking == 0) || (READ_REG(TIM2->CNT) != hostSimNextTick)){
+        return 0;
+    }
+
+    hostSimNextTick += HOSTSIM_TICK_PERIOD;
+
+    taskENTER_CRITICAL();
+    xTaskIncrementTick();
+    taskEXIT_CRITICAL();
+
+    return 1;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostSim_writeOutput(GPIO_TypeDef * port, uint32_t pin, uint32_t level)
+* Does what a BSRR write does to ODR, and reports the pins that changed. A pin
+* handed to a peripheral does not follow ODR, so it is not reported.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostSim_writeOutput(GPIO_TypeDef * port, uint32_t pin, uint32_t level){
+    uint32_t changed;
+
+    changed = (READ_REG(port->ODR) ^ (level ? pin : 0)) & pin;
+
+    WRITE_REG(port->BSRR, level ? pin : (pin << 16));
+    if(level){
+        SET_BIT(port->ODR, pin);
+    }
+    else{
+        CLEAR_BIT(port->ODR, pin);
+    }
+    WRITE_REG(port->BSRR, 0);
+
+    if(changed && hostSim_isAlternate(port, changed, 0xFFFFFFFFU)){
+        changed = 0;
+    }
+
+    if(changed && hostSimOutputCallback){
+        hostSimOutputCallback(port, changed, level, hostSim_pinTime(), hostSimInIrq ? hostSimIrqDue : READ_REG(TIM2->CNT));
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t hostSim_pinTime(void)
+* Returns the TIM2 time a pin written now would move on the ECU. Tasks only
+* run once the handlers before them are done.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint32_t hostSim_pinTime(void){
+    uint32_t now = READ_REG(TIM2->CNT);
+
+    if(hostSimInIrq){
+        return hostSimIrqPinTime;
+    }
+
+    return (TIME_DIFF(hostSimCoreFree, now) > 0) ? hostSimCoreFree : now;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t hostSim_isAlternate(GPIO_TypeDef * port, uint32_t pin, uint32_t alternateFunction)
+* Returns non zero if a pin is in alternate function mode, with the alternate
+* function given (0xFFFFFFFF for any)
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint32_t hostSim_isAlternate(GPIO_TypeDef * port, uint32_t pin, uint32_t alternateFunction){
+    uint32_t position = (uint32_t) __builtin_ctz(pin);
+    uint32_t selected;
+
+    if(((READ_REG(port->MODER) >> (position * 2U)) & 0x3U) != 0x2U){
+        return 0;
+    }
+
+    selected = (READ_REG(port->AFR[position >> 3U]) >> ((position & 0x7U) * 4U)) & 0xFU;
+
+    return (alternateFunction == 0xFFFFFFFFU) || (selected == alternateFunction);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t hostSim_compareMode(uint32_t x)
+* Returns the OCxM mode of output compare channel x, 0 (frozen) unless the
+* channel is an enabled output
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint32_t hostSim_compareMode(uint32_t x){
+    TIM_TypeDef * timer = hostSimCompareTimer[x];
+    uint32_t channel = hostSimCompareChannel[x];
+
+    // CCxS (output is 00) and OCxM of channel 2 sit 8 bits above channel 1's
+    if((READ_REG(timer->CCMR1) & (TIM_CCMR1_CC1S << (channel * 8U))) ||
+       (READ_BIT(timer->CCER, TIM_CCER_CC1E << (channel * 4U)) == 0)){
+        return 0;
+    }
+
+    return (READ_REG(timer->CCMR1) >> (TIM_CCMR1_OC1M_Pos + (channel * 8U))) & 0x7U;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostSim_compareMatch(uint32_t count)
+* Moves OCxREF of every channel in a match mode whose compare equals the new
+* count, and the pins they drive with it, exactly on time
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostSim_compareMatch(uint32_t count){
+    uint32_t mode;
+    uint32_t x;
+
+    for(x = 0; x < HOSTSIM_COMPARE_CHANNELS; x++){
+        if((uint16_t) *hostSimCompareRegister[x] != (uint16_t) READ_REG(hostSimCompareTimer[x]->CNT)){
+            continue;
+        }
+
+        SET_BIT(hostSimCompareTimer[x]->SR, TIM_SR_CC1IF << hostSimCompareChannel[x]);
+
+        mode = hostSim_compareMode(x);
+        if(mode == HOSTSIM_OC_ACTIVE){
+            hostSimCompareRef[x] = 1;
+        }
+        else if(mode == HOSTSIM_OC_INACTIVE){
+            hostSimCompareRef[x] = 0;
+        }
+        else if(mode == HOSTSIM_OC_TOGGLE){
+            hostSimCompareRef[x] ^= 1U;
+        }
+    }
+
+    hostSim_compareOutputs(count, count);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostSim_compareForce(void)
+* Applies the forced modes as soon as they are written. The firmware only
+* forces an edge it was too late to match, so the edge was due at the
+* compare value, the last time the 16 bit count passed it.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostSim_compareForce(void){
+    uint32_t mode;
+    uint32_t now;
+    uint32_t due = 0;
+    uint32_t forced = 0;
+    uint32_t x;
+
+    now = READ_REG(TIM2->CNT);
+
+    for(x = 0; x < HOSTSIM_COMPARE_CHANNELS; x++){
+        mode = hostSim_compareMode(x);
+        if((mode != HOSTSIM_OC_FORCE_INACTIVE) && (mode != HOSTSIM_OC_FORCE_ACTIVE)){
+            continue;
+        }
+
+        if(hostSimCompareRef[x] != (mode == HOSTSIM_OC_FORCE_ACTIVE)){
+            hostSimCompareRef[x] = (mode == HOSTSIM_OC_FORCE_ACTIVE);
+            due = now - (uint16_t)((uint16_t) READ_REG(hostSimCompareTimer[x]->CNT) - (uint16_t) *hostSimCompareRegister[x]);
+            forced = 1;
+        }
+    }
+
+    if(forced){
+        hostSim_compareOutputs(hostSim_pinTime(), due);
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostSim_compareOutputs(uint32_t time, uint32_t due)
+* Reports each pin routed to an output compare channel that no longer shows
+* its OCxREF, as moving at a time
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostSim_compareOutputs(uint32_t time, uint32_t due){
+    uint32_t channel;
+    uint32_t x;
+
+    for(x = 0; x < (sizeof(hostSimCompareRoutes) / sizeof(hostSimCompareRoutes[0])); x++){
+        channel = hostSimCompareRoutes[x].channel;
+
+        if((hostSimRouteLevel[x] == hostSimCompareRef[channel]) ||
+           (hostSim_isAlternate(hostSimCompareRoutes[x].port, hostSimCompareRoutes[x].pin, hostSimCompareRoutes[x].alternateFunction) == 0) ||
+           (READ_BIT(hostSimCompareTimer[channel]->CCER, TIM_CCER_CC1E << (hostSimCompareChannel[channel] * 4U)) == 0)){
+            continue;
+        }
+
+        hostSimRouteLevel[x] = hostSimCompareRef[channel];
+
+        if(hostSimOutputCallback){
+            hostSimOutputCallback(hostSimCompareRoutes[x].port, hostSimCompareRoutes[x].pin, hostSimRouteLevel[x], time, due);
+        }
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t hostSim_timer6Ticks(void)
+* Returns the TIM2 ticks in one TIM6 count, from its prescaler
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint32_t hostSim_timer6Ticks(void){
+    return (((READ_REG(TIM6->PSC) + 1U) * TIME_TICKS_PER_US) + (TIME_TIMER_CLOCK_MHZ / 2U)) / TIME_TIMER_CLOCK_MHZ;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostSim_timer6Events(void)
+* A UG restarts the count and, with TRGO on update, starts an injected
+* conversion. Setting CEN starts the count from CNT, and the firmware writing
+* CNT or ARR while it runs starts it again from there. Only upcounting is
+* modelled.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostSim_timer6Events(void){
+    uint32_t now = READ_REG(TIM2->CNT);
+
+    if(READ_BIT(TIM6->EGR, TIM_EGR_UG)){
+        WRITE_REG(TIM6->EGR, 0);
+        WRITE_REG(TIM6->CNT, 0);
+        hostSimTimer6Running = 0;
+        hostSim_injectedTrigger(now);
+    }
+
+    if(READ_BIT(TIM6->CR1, TIM_CR1_CEN) == 0){
+        hostSimTimer6Running = 0;
+        return;
+    }
+
+    if((hostSimTimer6Running == 0) || (READ_REG(TIM6->CNT) != hostSimTimer6Seen) ||
+       (READ_REG(TIM6->ARR) != hostSimTimer6Reload)){
+        hostSimTimer6Running = 1;
+        hostSimTimer6Seen = READ_REG(TIM6->CNT);
+        hostSimTimer6Reload = READ_REG(TIM6->ARR);
+        hostSimTimer6Start = now - (hostSimTimer6Seen * hostSim_timer6Ticks());
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostSim_timer6Count(uint32_t count)
+* Moves TIM6 along with TIM2. It updates on the count after ARR, which stops
+* it in one pulse mode and sends TRGO.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostSim_timer6Count(uint32_t count){
+    uint32_t counts;
+
+    if(hostSimTimer6Running == 0){
+        return;
+    }
+
+    counts = (uint32_t)(count - hostSimTimer6Start) / hostSim_timer6Ticks();
+    if(counts <= READ_REG(TIM6->ARR)){
+        hostSimTimer6Seen = counts;
+        WRITE_REG(TIM6->CNT, counts);
+        return;
+    }
+
+    WRITE_REG(TIM6->CNT, 0);
+    hostSimTimer6Seen = 0;
+    hostSimTimer6Start = count;
+    if(READ_BIT(TIM6->CR1, TIM_CR1_OPM)){
+        CLEAR_BIT(TIM6->CR1, TIM_CR1_CEN);
+        hostSimTimer6Running = 0;
+    }
+    hostSim_injectedTrigger(count);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostSim_injectedTrigger(uint32_t time)
+* TIM6 TRGO. If ADC1 is waiting on it for an injected conversion, the first
+* channel of JSQR is sampled now and JEOS is raised once it is converted. A
+* trigger during a conversion is lost, as on the ADC.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostSim_injectedTrigger(uint32_t time){
+    uint32_t sequence = READ_REG(ADC1->JSQR);
+    uint32_t channel;
+
+    if((READ_BIT(TIM6->CR2, TIM_CR2_MMS) != TIM_CR2_MMS_1) || (READ_BIT(ADC1->CR, ADC_CR_JADSTART) == 0) ||
+       ((sequence & ADC_JSQR_JEXTEN) == 0) ||
+       (((sequence & ADC_JSQR_JEXTSEL) >> ADC_JSQR_JEXTSEL_Pos) != HOSTSIM_JEXTSEL_TIM6_TRGO) ||
+       hostSimAdcConverting){
+        return;
+    }
+
+    channel = (sequence & ADC_JSQR_JSQ1) >> ADC_JSQR_JSQ1_Pos;
+    hostSimAdcValue = hostSimAnalogCallback ? (hostSimAnalogCallback(ADC1, channel, time) & 0xFFFU) : 0;
+    hostSimAdcDue = time + HOSTSIM_NS_TO_TICKS(HOSTSIM_ADC_CONVERSION_NS);
+    hostSimAdcConverting = 1;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void * hostSim_bootThread(void * argument)
+* Plays the ADCs while the firmware starts: a calibration ends as soon as it
+* is seen
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void * hostSim_bootThread(void * argument){
+    ADC_TypeDef * const adcs[HOSTSIM_ADC_COUNT] = {ADC1, ADC2, ADC3, ADC4, ADC5};
+    uint32_t x;
+
+    (void) argument;
+
+    while(hostSimBooting){
+        for(x = 0; x < HOSTSIM_ADC_COUNT; x++){
+            if(READ_BIT(adcs[x]->CR, ADC_CR_ADCAL)){
+                CLEAR_BIT(adcs[x]->CR, ADC_CR_ADCAL);
+            }
+        }
+        usleep(HOSTSIM_BOOT_POLL_US);
+    }
+    return 0;
+}
+/*****************************************************************************/
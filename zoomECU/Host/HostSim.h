@@ -0,0 +1,167 @@
+/******************************************************************************
+* File:                    HostSim.h
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Simulated peripherals for the host build. The STM32
+*                          register blocks are mapped as plain memory at their
+*                          real addresses, and this module plays the part of
+*                          the hardware around them: the TIM2 count and its
+*                          slaves, compare flags, the TIM3/TIM4 output
+*                          compares, EXTI pending bits, GPIO IDR/ODR/BSRR,
+*                          TIM6 and the injected conversions of ADC1 it
+*                          starts, and the NVIC.
+******************************************************************************/
+#ifndef HOSTSIM_H
+#define HOSTSIM_H
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+#include "stm32g4xx.h"
+
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+// Priority of the task that plays the hardware. It must be the highest in
+// the system, so simulated interupts are never preempted by a task.
+#define HOSTSIM_TASK_PRIORITY       (configMAX_PRIORITIES - 1)
+
+
+/******************************************************************************
+* Public Types
+******************************************************************************/
+// Called on every change of an output pin, with the TIM2 time the pin moved at
+// on the ECU and the time it was due: the count when the code that wrote it
+// ran, or the compare value of an output compare
+typedef void (*hostSimOutputCallback_t)(GPIO_TypeDef * port, uint32_t pin, uint32_t level, uint32_t time, uint32_t due);
+
+// Gives the 12 bit reading of an ADC channel sampled at a TIM2 time
+typedef uint32_t (*hostSimAnalogCallback_t)(ADC_TypeDef * adc, uint32_t channel, uint32_t time);
+
+// Interupt counts and the host time spent in the handlers, in nS
+typedef struct{
+    uint64_t calls;
+    uint64_t nanoseconds;
+    uint64_t worstNanoseconds;
+}hostSimIrqStats_t;
+
+typedef enum{
+    HOSTSIM_IRQ_TIM2,
+    HOSTSIM_IRQ_TIM8_CC,
+    HOSTSIM_IRQ_EXTI1,
+    HOSTSIM_IRQ_EXTI3,
+    HOSTSIM_IRQ_ADC1_2,
+    HOSTSIM_IRQ_COUNT
+}hostSimIrq_t;
+
+
+/******************************************************************************
+* Public Function Prototypes
+******************************************************************************/
+    /******************************************************************************
+    * void HostSim_Init(void)
+    * Maps the register blocks and plays the ADCs until HostSim_Start, must
+    * be called before any firmware init
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void HostSim_Init(void);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void HostSim_Start(void)
+    * Makes the calling task the hardware task and ticks the RTOS from the
+    * simulated time from now on. Called first thing in the hardware task.
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void HostSim_Start(void);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void HostSim_AdvanceTo(uint32_t time)
+    * Runs the timers forward to a TIM2 time, raising every compare and
+    * overflow on the way. Only called from the hardware task.
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void HostSim_AdvanceTo(uint32_t time);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void HostSim_SetInput(GPIO_TypeDef * port, uint32_t pin, uint32_t level)
+    * Drives an input pin, raising its EXTI line on a matching edge. Only
+    * called from the hardware task.
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void HostSim_SetInput(GPIO_TypeDef * port, uint32_t pin, uint32_t level);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void HostSim_WaitIdle(void)
+    * Blocks the hardware task until every other task is blocked
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void HostSim_WaitIdle(void);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void HostSim_SetOutputCallback(hostSimOutputCallback_t callback)
+    * Sets the function told about every GPIO output change
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void HostSim_SetOutputCallback(hostSimOutputCallback_t callback);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void HostSim_SetAnalogCallback(hostSimAnalogCallback_t callback)
+    * Sets the function that gives the reading of each injected conversion.
+    * Without one every conversion reads 0.
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void HostSim_SetAnalogCallback(hostSimAnalogCallback_t callback);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void HostSim_SetIrqTime(uint32_t nanoseconds)
+    * Sets how long each handler keeps the core busy on the ECU, which delays
+    * the pin writes of any handler raised while it runs
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void HostSim_SetIrqTime(uint32_t nanoseconds);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void HostSim_GetIrqStats(hostSimIrq_t irq, hostSimIrqStats_t * stats)
+    * Copies the counts and handler times of an interupt
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void HostSim_GetIrqStats(hostSimIrq_t irq, hostSimIrqStats_t * stats);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * uint32_t HostSim_GetCoreTime(void)
+    * TIM2 time the code running now would be at on the ECU, later than the
+    * count while earlier handlers keep the core busy
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    uint32_t HostSim_GetCoreTime(void);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * uint32_t HostSim_GetRunTimeCounter(void)
+    * Host CPU time of the process in uS, the FreeRTOS run time stats counter
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    uint32_t HostSim_GetRunTimeCounter(void);
+    /*****************************************************************************/
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+#endif // ifdef HOSTSIM_H
@@ -0,0 +1,227 @@
+/******************************************************************************
+* File:                    HostSnap.c
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Throttle snap replay, see HostSnap.h.
+*
+* The trace holds a light load cruise, then opens the throttle from 10% to
+* 90% in 50mS while the engine pulls up from 2000 to 3500 rpm. MAP follows
+* the throttle with the lag of the manifold filling.
+*
+* At the first tooth of each cycle the firmware's fuel task reads MAP and
+* TPS and steps FuelControl_UpdateTransient, as on the engine. The cylinder
+* then takes its air half a cycle later, at the MAP of that time, and needs
+* FuelControl_CalcFuel of it to burn at lambda 1. Of each injection X lands
+* on the port walls, and each cycle 1 - e^(-t/tau) of the wall fuel reaches
+* the cylinder, with the same X and tau the firmware is set to. Lambda is the
+* fuel needed over the fuel that got there.
+*
+* The base run injects the steady state fuel at the MAP read, with nothing
+* for the walls or the snap, to show the excursion the transient fuel takes
+* out.
+*
+* Fuel worked out once per cycle can do nothing for a cylinder that fills
+* after the throttle moved, when its fuel was worked out before. That cycle
+* goes lean on any once per cycle fuel, it is kept apart from the others.
+*******************************************************************************
+* Includes
+******************************************************************************/
+#include "HostSnap.h"
+
+#include "FuelControl.h"
+
+#include <math.h>
+#include <string.h>
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+// Cruise before the snap, long enough for the wall fuel to settle
+#define HOSTSNAP_SNAP_TIME          1.5
+#define HOSTSNAP_END_TIME           3.5
+
+// Throttle from and to, and the time it takes to open
+#define HOSTSNAP_TPS_CLOSED         10.0
+#define HOSTSNAP_TPS_OPEN           90.0
+#define HOSTSNAP_TPS_TIME           0.05
+
+// MAP at the throttle, and the time constant of the manifold filling
+#define HOSTSNAP_MAP_CLOSED         35.0
+#define HOSTSNAP_MAP_PER_TPS        0.75
+#define HOSTSNAP_MAP_TAU            0.04
+
+// The engine pulls up over this time after the snap
+#define HOSTSNAP_RPM_START          2000.0
+#define HOSTSNAP_RPM_END            3500.0
+#define HOSTSNAP_RPM_TIME           1.5
+
+// Cycles before the snap that are measured
+#define HOSTSNAP_LEAD_TIME          0.2
+
+// Steps MAP is integrated over
+#define HOSTSNAP_STEP               0.0005
+
+
+/******************************************************************************
+* Public Types
+******************************************************************************/
+// The cylinder side of the model, the fuel on the port walls
+typedef struct{
+    double film;
+}hostSnapPort_t;
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+/******************************************************************************
+* Private Function Prototypes (static)
+******************************************************************************/
+static double hostSnap_tps(double seconds);
+static double hostSnap_rpm(double seconds);
+static double hostSnap_advanceMap(double map, double from, double to);
+static double hostSnap_burn(hostSnapPort_t * port, double inject, double needed, double cycleSeconds);
+
+/******************************************************************************
+* Private Variables (static)
+******************************************************************************/
+
+
+/******************************************************************************
+* Function Code
+******************************************************************************/
+
+
+/******************************************************************************
+* void HostSnap_Run(hostSnapResult_t * result)
+* Steps the trace one engine cycle at a time. The transient fuel and its port
+* model, and the steady state fuel and its port model, see the same engine.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void HostSnap_Run(hostSnapResult_t * result){
+    fuelTransient_t state;
+    hostSnapPort_t port;
+    hostSnapPort_t basePort;
+    double seconds = 0;
+    double map = HOSTSNAP_MAP_CLOSED + (HOSTSNAP_MAP_PER_TPS * HOSTSNAP_TPS_CLOSED);
+    double intakeMap;
+    double cycleSeconds;
+    double rpm;
+    double tps;
+    double needed;
+    double lambda;
+    double baseLambda;
+
+    memset(&state, 0, sizeof(state));
+    memset(&port, 0, sizeof(port));
+    memset(&basePort, 0, sizeof(basePort));
+
+    result->cycles = 0;
+    result->richest = 1.0;
+    result->leanest = 1.0;
+    result->baseRichest = 1.0;
+    result->baseLeanest = 1.0;
+    result->missedLeanest = 1.0;
+
+    while(seconds < HOSTSNAP_END_TIME){
+        rpm = hostSnap_rpm(seconds);
+        tps = hostSnap_tps(seconds);
+        cycleSeconds = 120.0 / rpm;
+
+        // The fuel task at the first tooth
+        FuelControl_UpdateTransient(&state, FuelControl_CalcFuel((float) rpm, (float) map),
+                                    (float) tps, (float) map, (float)(cycleSeconds * 1000000.0));
+
+        // The cylinder fills half a cycle later
+        intakeMap = hostSnap_advanceMap(map, seconds, seconds + (cycleSeconds * 0.5));
+        needed = FuelControl_CalcFuel((float) rpm, (float) intakeMap);
+
+        baseLambda = hostSnap_burn(&basePort, FuelControl_CalcFuel((float) rpm, (float) map), needed, cycleSeconds);
+        lambda = hostSnap_burn(&port, state.pulse[0], needed, cycleSeconds);
+
+        if(seconds < (HOSTSNAP_SNAP_TIME - HOSTSNAP_LEAD_TIME)){
+            // Settling
+        }
+        else if(hostSnap_tps(seconds) != hostSnap_tps(seconds + (cycleSeconds * 0.5))){
+            // The throttle moved after this cycle's fuel was worked out
+            result->missedLeanest = fmax(result->missedLeanest, lambda);
+        }
+        else{
+            result->cycles++;
+            result->richest = fmin(result->richest, lambda);
+            result->leanest = fmax(result->leanest, lambda);
+            result->baseRichest = fmin(result->baseRichest, baseLambda);
+            result->baseLeanest = fmax(result->baseLeanest, baseLambda);
+        }
+
+        map = hostSnap_advanceMap(map, seconds, seconds + cycleSeconds);
+        seconds += cycleSeconds;
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* double hostSnap_tps(double seconds)
+* double hostSnap_rpm(double seconds)
+* Throttle and engine speed of the trace
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static double hostSnap_tps(double seconds){
+    double opened = (seconds - HOSTSNAP_SNAP_TIME) / HOSTSNAP_TPS_TIME;
+
+    opened = fmin(fmax(opened, 0.0), 1.0);
+    return HOSTSNAP_TPS_CLOSED + ((HOSTSNAP_TPS_OPEN - HOSTSNAP_TPS_CLOSED) * opened);
+}
+
+static double hostSnap_rpm(double seconds){
+    double pulled = (seconds - HOSTSNAP_SNAP_TIME) / HOSTSNAP_RPM_TIME;
+
+    pulled = fmin(fmax(pulled, 0.0), 1.0);
+    return HOSTSNAP_RPM_START + ((HOSTSNAP_RPM_END - HOSTSNAP_RPM_START) * pulled);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* double hostSnap_advanceMap(double map, double from, double to)
+* Moves MAP on from one time to another, filling towards the MAP of the
+* throttle at each step
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static double hostSnap_advanceMap(double map, double from, double to){
+    double step;
+    double target;
+
+    while(from < to){
+        step = fmin(HOSTSNAP_STEP, to - from);
+        target = HOSTSNAP_MAP_CLOSED + (HOSTSNAP_MAP_PER_TPS * hostSnap_tps(from));
+        map = map + ((target - map) * (1.0 - exp(-step / HOSTSNAP_MAP_TAU)));
+        from += step;
+    }
+    return map;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* double hostSnap_burn(port, inject, needed, cycleSeconds)
+* Puts one injection through the port walls and returns the lambda the
+* cylinder burns
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static double hostSnap_burn(hostSnapPort_t * port, double inject, double needed, double cycleSeconds){
+    double evaporated = 1.0 - exp(-cycleSeconds / (fuelWallTau * 0.001));
+    double delivered;
+
+    delivered = ((1.0 - fuelWallFraction) * inject) + (evaporated * port->film);
+    port->film = (port->film * (1.0 - evaporated)) + (fuelWallFraction * inject);
+
+    return (delivered > 0) ? (needed / delivered) : HUGE_VAL;
+}
+/*****************************************************************************/
@@ -0,0 +1,55 @@
+/******************************************************************************
+* File:                    HostSnap.h
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Throttle snap replay for the host build. A snap
+*                          trace is run through the firmware's transient fuel
+*                          one engine cycle at a time, into a model of the
+*                          port wall fuel and the air the cylinder takes in,
+*                          and the lambda each cycle burns is measured.
+******************************************************************************/
+#ifndef HOSTSNAP_H
+#define HOSTSNAP_H
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <stdint.h>
+
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+
+
+/******************************************************************************
+* Public Types
+******************************************************************************/
+typedef struct{
+    uint32_t cycles;                // Cycles measured, from just before the snap
+    double richest;                 // Lowest lambda burnt
+    double leanest;                 // Highest lambda burnt
+    double baseRichest;             // The same with the steady state fuel only
+    double baseLeanest;
+    double missedLeanest;           // Cycles whose fuel was worked out before the throttle moved
+}hostSnapResult_t;
+
+
+/******************************************************************************
+* Public Function Prototypes
+******************************************************************************/
+    /******************************************************************************
+    * void HostSnap_Run(hostSnapResult_t * result)
+    * Replays the throttle snap with and without the transient fuel
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void HostSnap_Run(hostSnapResult_t * result);
+    /*****************************************************************************/
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+#endif // ifdef HOSTSNAP_H
@@ -0,0 +1,292 @@
+/******************************************************************************
+* File:                    HostStimulus.c
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Crank and cam edge streams for the host build. The
+*                          wheel is moved in small angle steps, the speed of
+*                          each step set by the rpm profile at that time and
+*                          the compression ripple at that angle, so an edge
+*                          lands where a real engine would put it.
+*
+* Noise pulses are HOSTSTIMULUS_NOISE_WIDTH long and land at a random time
+* between two edges. A dropped edge leaves its trigger where it was, so the
+* edge after it is lost too, like a missing tooth. The random numbers come
+* from the profile's seed, so a run can be repeated.
+*******************************************************************************
+* Includes
+******************************************************************************/
+#include "HostStimulus.h"
+
+#include <math.h>
+
+#include "Time.h"
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+#define HOSTSTIMULUS_CYCLE_ANGLE    720.0
+
+// Degrees moved per integration step
+#define HOSTSTIMULUS_STEP_ANGLE     0.5
+
+// One compression stroke every 180* on a 4 cylinder
+#define HOSTSTIMULUS_RIPPLE_PERIOD  180.0
+
+#define HOSTSTIMULUS_NOISE_WIDTH    ((double) TIME_US_TO_TICKS(2U))
+
+#define HOSTSTIMULUS_TICKS_PER_S    ((double) TIME_US_TO_TICKS(1000000U))
+
+#define HOSTSTIMULUS_PI             3.14159265358979323846
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+/******************************************************************************
+* Private Function Prototypes (static)
+******************************************************************************/
+static void hostStimulus_advance(hostStimulus_t * stimulus);
+static double hostStimulus_speed(const hostStimulus_t * stimulus, double time, double angle);
+static double hostStimulus_rpmAt(const hostStimulus_t * stimulus, double time);
+static void hostStimulus_queue(hostStimulus_t * stimulus, double time, uint8_t primary, uint8_t level);
+static double hostStimulus_random(hostStimulus_t * stimulus);
+
+/******************************************************************************
+* Private Variables (static)
+******************************************************************************/
+
+
+/******************************************************************************
+* Function Code
+******************************************************************************/
+
+
+/******************************************************************************
+* void HostStimulus_Init(hostStimulus_t * stimulus, const hostWheel_t * wheel,
+*                        const hostStimulusProfile_t * profile, uint32_t startTime)
+* Puts the wheel at 0* at a TIM2 time, with the triggers at their levels there
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void HostStimulus_Init(hostStimulus_t * stimulus, const hostWheel_t * wheel,
+                       const hostStimulusProfile_t * profile, uint32_t startTime){
+    stimulus->wheel = wheel;
+    stimulus->profile = *profile;
+    stimulus->startTime = startTime;
+    stimulus->random = (profile->seed != 0) ? profile->seed : 1U;
+
+    stimulus->time = 0;
+    stimulus->angle = 0;
+    stimulus->cycle = 0;
+    stimulus->edge = 0;
+    stimulus->segmentTime = 0;
+    stimulus->segmentAngle = 0;
+
+    stimulus->level[0] = wheel->secondaryStart;
+    stimulus->level[1] = wheel->primaryStart;
+
+    stimulus->queueHead = 0;
+    stimulus->queueCount = 0;
+    stimulus->noiseEdges = 0;
+    stimulus->droppedEdges = 0;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void HostStimulus_Next(hostStimulus_t * stimulus, hostStimulusEvent_t * event)
+* Hands out the queued events, moving the wheel on to its next edge whenever
+* the queue runs dry
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void HostStimulus_Next(hostStimulus_t * stimulus, hostStimulusEvent_t * event){
+    while(stimulus->queueCount == 0){
+        hostStimulus_advance(stimulus);
+    }
+
+    *event = stimulus->queue[stimulus->queueHead];
+    stimulus->queueHead = (stimulus->queueHead + 1U) % HOSTSTIMULUS_QUEUE_LENGTH;
+    stimulus->queueCount--;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* double HostStimulus_AngleAt(const hostStimulus_t * stimulus, uint32_t time)
+* Moves the wheel again from the start of the current stretch up to a time,
+* in the same steps as the edges were placed with
+* David Tolsma, 10/17/2026
+******************************************************************************/
+double HostStimulus_AngleAt(const hostStimulus_t * stimulus, uint32_t time){
+    double target;
+    double now;
+    double angle;
+    double step;
+    double speed;
+
+    // Measured from the start of the stretch, a run can last longer than
+    // TIME_DIFF reaches (2^31 ticks) from its start
+    now = stimulus->segmentTime;
+    target = now + (double) TIME_DIFF(time, stimulus->startTime + (uint32_t) llround(now));
+    angle = stimulus->segmentAngle;
+
+    while(now < target){
+        speed = hostStimulus_speed(stimulus, now, angle + (0.5 * HOSTSTIMULUS_STEP_ANGLE));
+        step = HOSTSTIMULUS_STEP_ANGLE / speed;
+        if((now + step) > target){
+            angle += (target - now) * speed;
+            break;
+        }
+        now += step;
+        angle += HOSTSTIMULUS_STEP_ANGLE;
+    }
+
+    return fmod(angle, HOSTSTIMULUS_CYCLE_ANGLE);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* double HostStimulus_GetRpm(const hostStimulus_t * stimulus)
+* Returns the mean rpm of the profile where the wheel is now
+* David Tolsma, 10/17/2026
+******************************************************************************/
+double HostStimulus_GetRpm(const hostStimulus_t * stimulus){
+    return hostStimulus_rpmAt(stimulus, stimulus->time);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostStimulus_advance(hostStimulus_t * stimulus)
+* Moves the wheel to its next edge and queues what happens on the way: maybe
+* a noise pulse, then the edge unless it is dropped
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostStimulus_advance(hostStimulus_t * stimulus){
+    const hostWheelEdge_t * edge;
+    double target;
+    double step;
+    double pulseTime;
+    uint8_t primary;
+
+    edge = &stimulus->wheel->edges[stimulus->edge];
+    target = ((double) stimulus->cycle * HOSTSTIMULUS_CYCLE_ANGLE) + edge->angle;
+    primary = edge->primary;
+
+    stimulus->segmentTime = stimulus->time;
+    stimulus->segmentAngle = stimulus->angle;
+
+    while(stimulus->angle < target){
+        step = target - stimulus->angle;
+        if(step > HOSTSTIMULUS_STEP_ANGLE){
+            step = HOSTSTIMULUS_STEP_ANGLE;
+        }
+        stimulus->time += step / hostStimulus_speed(stimulus, stimulus->time, stimulus->angle + (0.5 * step));
+        stimulus->angle += step;
+    }
+    stimulus->angle = target;
+
+    if(hostStimulus_random(stimulus) < stimulus->profile.noiseRate){
+        pulseTime = stimulus->segmentTime + (hostStimulus_random(stimulus) * (stimulus->time - stimulus->segmentTime));
+        if((pulseTime + HOSTSTIMULUS_NOISE_WIDTH) < stimulus->time){
+            hostStimulus_queue(stimulus, pulseTime, primary, (uint8_t) !stimulus->level[primary]);
+            hostStimulus_queue(stimulus, pulseTime + HOSTSTIMULUS_NOISE_WIDTH, primary, stimulus->level[primary]);
+            stimulus->noiseEdges += 2U;
+        }
+    }
+
+    if(hostStimulus_random(stimulus) < stimulus->profile.dropoutRate){
+        stimulus->droppedEdges++;
+    }
+    else{
+        stimulus->level[primary] = edge->level;
+        hostStimulus_queue(stimulus, stimulus->time, primary, edge->level);
+    }
+
+    stimulus->edge++;
+    if(stimulus->edge >= stimulus->wheel->edgeCount){
+        stimulus->edge = 0;
+        stimulus->cycle++;
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* double hostStimulus_speed(const hostStimulus_t * stimulus, double time, double angle)
+* Returns the wheel speed in degrees per tick at a time and angle
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static double hostStimulus_speed(const hostStimulus_t * stimulus, double time, double angle){
+    double speed;
+
+    speed = (hostStimulus_rpmAt(stimulus, time) * 6.0) / HOSTSTIMULUS_TICKS_PER_S;
+    speed *= 1.0 + (stimulus->profile.ripple * sin((2.0 * HOSTSTIMULUS_PI * angle) / HOSTSTIMULUS_RIPPLE_PERIOD));
+
+    return speed;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* double hostStimulus_rpmAt(const hostStimulus_t * stimulus, double time)
+* Returns the mean rpm of the profile a number of ticks after the start
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static double hostStimulus_rpmAt(const hostStimulus_t * stimulus, double time){
+    double seconds;
+
+    seconds = time / HOSTSTIMULUS_TICKS_PER_S;
+    if(seconds >= stimulus->profile.rampSeconds){
+        return stimulus->profile.endRpm;
+    }
+
+    return stimulus->profile.startRpm +
+           ((stimulus->profile.endRpm - stimulus->profile.startRpm) * (seconds / stimulus->profile.rampSeconds));
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostStimulus_queue(hostStimulus_t * stimulus, double time, uint8_t primary, uint8_t level)
+* Adds an event to the back of the queue
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostStimulus_queue(hostStimulus_t * stimulus, double time, uint8_t primary, uint8_t level){
+    hostStimulusEvent_t * event;
+
+    event = &stimulus->queue[(stimulus->queueHead + stimulus->queueCount) % HOSTSTIMULUS_QUEUE_LENGTH];
+    event->time = stimulus->startTime + (uint32_t) llround(time);
+    event->primary = primary;
+    event->level = level;
+    stimulus->queueCount++;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* double hostStimulus_random(hostStimulus_t * stimulus)
+* Returns a number from 0 up to 1, from a xorshift generator
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static double hostStimulus_random(hostStimulus_t * stimulus){
+    uint32_t x = stimulus->random;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    stimulus->random = x;
+
+    return (double)(x >> 8) / 16777216.0;
+}
+/*****************************************************************************/
@@ -0,0 +1,121 @@
+/******************************************************************************
+* File:                    HostStimulus.h
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Crank and cam edge streams for the host build. A
+*                          wheel from HostWheel is turned through an rpm
+*                          profile, with compression ripple, noise edges and
+*                          dropped edges added on request.
+******************************************************************************/
+#ifndef HOSTSTIMULUS_H
+#define HOSTSTIMULUS_H
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <stdint.h>
+
+#include "HostWheel.h"
+
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+// Most events waiting to be handed out, a wheel edge and a noise pulse
+#define HOSTSTIMULUS_QUEUE_LENGTH   4U
+
+
+/******************************************************************************
+* Public Types
+******************************************************************************/
+// How the wheel is turned. The rpm moves in a straight line from startRpm to
+// endRpm over rampSeconds, then holds. Rates are chances per wheel edge.
+typedef struct{
+    double startRpm;
+    double endRpm;
+    double rampSeconds;
+    double ripple;                  // Speed swing from compression, fraction of the mean
+    double noiseRate;               // Chance of a short noise pulse before an edge
+    double dropoutRate;             // Chance an edge never arrives
+    uint32_t seed;
+}hostStimulusProfile_t;
+
+typedef struct{
+    uint32_t time;                  // TIM2 time of the edge
+    uint8_t primary;                // 1 for the crank, 0 for the cam
+    uint8_t level;                  // Level of that trigger after the edge
+}hostStimulusEvent_t;
+
+typedef struct{
+    const hostWheel_t * wheel;
+    hostStimulusProfile_t profile;
+    uint32_t startTime;
+    uint32_t random;
+
+    // Where the wheel is, in ticks and degrees since the start
+    double time;
+    double angle;
+    uint32_t cycle;
+    uint32_t edge;
+
+    // The stretch of travel the queued events lie in, for HostStimulus_AngleAt
+    double segmentTime;
+    double segmentAngle;
+
+    // Level each trigger is at, noise and dropouts included
+    uint8_t level[2];
+
+    hostStimulusEvent_t queue[HOSTSTIMULUS_QUEUE_LENGTH];
+    uint32_t queueHead;
+    uint32_t queueCount;
+
+    uint32_t noiseEdges;
+    uint32_t droppedEdges;
+}hostStimulus_t;
+
+
+/******************************************************************************
+* Public Function Prototypes
+******************************************************************************/
+    /******************************************************************************
+    * void HostStimulus_Init(hostStimulus_t * stimulus, const hostWheel_t * wheel,
+    *                        const hostStimulusProfile_t * profile, uint32_t startTime)
+    * Puts the wheel at 0* at a TIM2 time, with the triggers at their levels there
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void HostStimulus_Init(hostStimulus_t * stimulus, const hostWheel_t * wheel,
+                           const hostStimulusProfile_t * profile, uint32_t startTime);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void HostStimulus_Next(hostStimulus_t * stimulus, hostStimulusEvent_t * event)
+    * Returns the next edge, in time order
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void HostStimulus_Next(hostStimulus_t * stimulus, hostStimulusEvent_t * event);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * double HostStimulus_AngleAt(const hostStimulus_t * stimulus, uint32_t time)
+    * Returns the true crank angle, 0 up to 720, at a TIM2 time between the
+    * last event handed out and the one before it
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    double HostStimulus_AngleAt(const hostStimulus_t * stimulus, uint32_t time);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * double HostStimulus_GetRpm(const hostStimulus_t * stimulus)
+    * Returns the mean rpm of the profile where the wheel is now
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    double HostStimulus_GetRpm(const hostStimulus_t * stimulus);
+    /*****************************************************************************/
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+#endif // ifdef HOSTSTIMULUS_H
@@ -0,0 +1,434 @@
+/******************************************************************************
+* File:                    HostTable.c
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       3D table checks, see HostTable.h.
+*
+* The table holds a + bx + cy + dxy on uneven axes. That is a straight line
+* along each axis, so bilinear interpolation gives it exactly inside every
+* cell and any error is float rounding or the wrong cell. The points are
+* walked in order and then jumped about, so the search from the last bin is
+* checked both moving a step and moving far.
+*
+* The reader thread is a plain host thread on its own core, like the
+* snapshot reader in HostMain.c. The writer fills the whole table with one
+* value and then another, so a lookup that mixed two writes blends them and
+* reads neither.
+*******************************************************************************
+* Includes
+******************************************************************************/
+#include "HostTable.h"
+
+#include "Table3D.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+// The exact table, a + bx + cy + dxy
+#define HOSTTABLE_A                 3.0
+#define HOSTTABLE_B                 0.5
+#define HOSTTABLE_C                 -0.25
+#define HOSTTABLE_D                 0.01
+
+// Points checked along each axis, end to end
+#define HOSTTABLE_STEPS             97U
+
+// Points jumped between in a random order
+#define HOSTTABLE_JUMPS             20000U
+
+// The two fills of the concurrent writer
+#define HOSTTABLE_FILL_A            1.0f
+#define HOSTTABLE_FILL_B            2.0f
+
+
+/******************************************************************************
+* Public Types
+******************************************************************************/
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+/******************************************************************************
+* Private Function Prototypes (static)
+******************************************************************************/
+static int32_t hostTable_fill(void);
+static double hostTable_exact(double x, double y);
+static double hostTable_clamp(const float * axis, float value);
+static uint32_t hostTable_check(float x, float y, hostTableResult_t * result);
+static void hostTable_clamping(hostTableResult_t * result);
+static void hostTable_axes(hostTableResult_t * result);
+static void hostTable_concurrent(hostTableResult_t * result);
+static void * hostTable_reader(void * argument);
+static uint32_t hostTable_random(void);
+
+/******************************************************************************
+* Private Variables (static)
+******************************************************************************/
+static table3D_t hostTableTable;
+static float hostTableXAxis[TABLE3D_SIZE];
+static float hostTableYAxis[TABLE3D_SIZE];
+
+static uint32_t hostTableSeed = 1U;
+
+// Shared with the reader thread
+static volatile uint32_t hostTableReading;
+static volatile uint64_t hostTableReads;
+static volatile uint64_t hostTableTornReads;
+
+/******************************************************************************
+* Function Code
+******************************************************************************/
+
+
+/******************************************************************************
+* void HostTable_Run(hostTableResult_t * result)
+* Fills the exact table, then checks lookups over it and off its ends, the
+* axis checks and lookups against a writer
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void HostTable_Run(hostTableResult_t * result){
+    float lowX;
+    float highX;
+    float lowY;
+    float highY;
+    float x;
+    float y;
+    uint32_t xStep;
+    uint32_t yStep;
+
+    memset(result, 0, sizeof(*result));
+
+    if(hostTable_fill() != TABLE3D_OK){
+        result->axisFailures++;
+    }
+
+    lowX = hostTableXAxis[0];
+    highX = hostTableXAxis[TABLE3D_SIZE - 1U];
+    lowY = hostTableYAxis[0];
+    highY = hostTableYAxis[TABLE3D_SIZE - 1U];
+
+    // Walked up x inside each y, then down y inside each x
+    for(yStep = 0; yStep < HOSTTABLE_STEPS; yStep++){
+        y = lowY + (((highY - lowY) * (float) yStep) / (float)(HOSTTABLE_STEPS - 1U));
+        for(xStep = 0; xStep < HOSTTABLE_STEPS; xStep++){
+            x = lowX + (((highX - lowX) * (float) xStep) / (float)(HOSTTABLE_STEPS - 1U));
+            result->failures += hostTable_check(x, y, result);
+        }
+    }
+    for(xStep = 0; xStep < HOSTTABLE_STEPS; xStep++){
+        x = lowX + (((highX - lowX) * (float) xStep) / (float)(HOSTTABLE_STEPS - 1U));
+        for(yStep = HOSTTABLE_STEPS; yStep > 0; yStep--){
+            y = lowY + (((highY - lowY) * (float)(yStep - 1U)) / (float)(HOSTTABLE_STEPS - 1U));
+            result->failures += hostTable_check(x, y, result);
+        }
+    }
+
+    // Every axis point, where a lookup falls right on a bin edge
+    for(yStep = 0; yStep < TABLE3D_SIZE; yStep++){
+        for(xStep = 0; xStep < TABLE3D_SIZE; xStep++){
+            result->failures += hostTable_check(hostTableXAxis[xStep], hostTableYAxis[yStep], result);
+        }
+    }
+
+    for(xStep = 0; xStep < HOSTTABLE_JUMPS; xStep++){
+        x = lowX + ((highX - lowX) * ((float)(hostTable_random() % 10000U) / 9999.0f));
+        y = lowY + ((highY - lowY) * ((float)(hostTable_random() % 10000U) / 9999.0f));
+        result->failures += hostTable_check(x, y, result);
+    }
+
+    hostTable_clamping(result);
+    hostTable_axes(result);
+    hostTable_concurrent(result);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* int32_t hostTable_fill(void)
+* Puts the uneven axes in the table and the exact value at every point.
+* Returns what Table3D_SetAxes did with the axes.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static int32_t hostTable_fill(void){
+    static float values[TABLE3D_SIZE * TABLE3D_SIZE];
+    uint32_t x;
+    uint32_t y;
+
+    for(x = 0; x < TABLE3D_SIZE; x++){
+        hostTableXAxis[x] = 500.0f + (40.0f * (float)(x * x));
+        hostTableYAxis[x] = 20.0f + (7.0f * (float) x) + (0.5f * (float)(x * x));
+    }
+    for(y = 0; y < TABLE3D_SIZE; y++){
+        for(x = 0; x < TABLE3D_SIZE; x++){
+            values[(y * TABLE3D_SIZE) + x] = (float) hostTable_exact(hostTableXAxis[x], hostTableYAxis[y]);
+        }
+    }
+
+    Table3D_SetValues(&hostTableTable, values);
+    return Table3D_SetAxes(&hostTableTable, hostTableXAxis, hostTableYAxis);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* double hostTable_exact(double x, double y)
+* Returns the value the table holds at a point
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static double hostTable_exact(double x, double y){
+    return HOSTTABLE_A + (HOSTTABLE_B * x) + (HOSTTABLE_C * y) + (HOSTTABLE_D * x * y);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* double hostTable_clamp(const float * axis, float value)
+* Returns where a lookup should read along an axis, the value held to the
+* ends of the axis and the low end if it is not a number
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static double hostTable_clamp(const float * axis, float value){
+    if(isnan(value) || (value < axis[0])){
+        return axis[0];
+    }
+    if(value > axis[TABLE3D_SIZE - 1U]){
+        return axis[TABLE3D_SIZE - 1U];
+    }
+    return value;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t hostTable_check(float x, float y, hostTableResult_t * result)
+* Looks a point up and measures it against the exact value at the point
+* held to the axes. Returns 1 if it is out by more than HOSTTABLE_TOLERANCE.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint32_t hostTable_check(float x, float y, hostTableResult_t * result){
+    double exact;
+    double error;
+    float value;
+
+    value = Table3D_Lookup(&hostTableTable, x, y);
+    exact = hostTable_exact(hostTable_clamp(hostTableXAxis, x), hostTable_clamp(hostTableYAxis, y));
+    error = fabs((double) value - exact) / fmax(1.0, fabs(exact));
+    if(isnan(value)){
+        error = INFINITY;
+    }
+
+    result->lookups++;
+    if(error > result->worstError){
+        result->worstError = error;
+    }
+
+    return (error > HOSTTABLE_TOLERANCE);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostTable_clamping(hostTableResult_t * result)
+* Looks up points off each end of each axis, at infinity and not a number,
+* with the other coordinate inside the table, below it and above it. Each
+* must read the edge.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostTable_clamping(hostTableResult_t * result){
+    // Off each end of the axis, then where the other coordinate is put
+    const float offX[] = {
+        hostTableXAxis[0] - 100.0f, -INFINITY, NAN,
+        hostTableXAxis[TABLE3D_SIZE - 1U] + 100.0f, INFINITY,
+    };
+    const float offY[] = {
+        hostTableYAxis[0] - 10.0f, -INFINITY, NAN,
+        hostTableYAxis[TABLE3D_SIZE - 1U] + 10.0f, INFINITY,
+    };
+    const float acrossY[] = {
+        hostTableYAxis[0] - 10.0f, 0.5f * (hostTableYAxis[0] + hostTableYAxis[TABLE3D_SIZE - 1U]), 1e30f,
+    };
+    const float acrossX[] = {
+        hostTableXAxis[0] - 100.0f, 0.5f * (hostTableXAxis[0] + hostTableXAxis[TABLE3D_SIZE - 1U]), 1e30f,
+    };
+    uint32_t x;
+    uint32_t y;
+
+    for(x = 0; x < (sizeof(offX) / sizeof(offX[0])); x++){
+        for(y = 0; y < (sizeof(acrossY) / sizeof(acrossY[0])); y++){
+            result->clampFailures += hostTable_check(offX[x], acrossY[y], result);
+            result->clampFailures += hostTable_check(acrossX[y], offY[x], result);
+        }
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostTable_axes(hostTableResult_t * result)
+* Offers axes with two points the same, a point lower than the one before it
+* and a point that is not a number, at the start, the middle and the end of
+* each axis. Every one must be refused and the table left on its axes, then
+* the table's own axes taken again.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostTable_axes(hostTableResult_t * result){
+    static const uint32_t points[] = {0, TABLE3D_SIZE / 2U, TABLE3D_SIZE - 1U};
+    float axis[TABLE3D_SIZE];
+    uint32_t point;
+    uint32_t fault;
+    uint32_t which;
+    uint32_t index;
+    int32_t status;
+
+    for(which = 0; which < 2U; which++){
+        for(point = 0; point < (sizeof(points) / sizeof(points[0])); point++){
+            for(fault = 0; fault < 3U; fault++){
+                memcpy(axis, which ? hostTableYAxis : hostTableXAxis, sizeof(axis));
+                index = points[point];
+
+                // The point matched, or pushed below, its neighbour
+                if(fault == 0){
+                    axis[index] = (index > 0) ? axis[index - 1U] : axis[1];
+                }
+                else if(fault == 1){
+                    axis[index] = (index > 0) ? (axis[index - 1U] - 1.0f) : (axis[1] + 1.0f);
+                }
+                else{
+                    axis[index] = NAN;
+                }
+
+                if(which){
+                    status = Table3D_SetAxes(&hostTableTable, hostTableXAxis, axis);
+                }
+                else{
+                    status = Table3D_SetAxes(&hostTableTable, axis, hostTableYAxis);
+                }
+
+                if((status != TABLE3D_BAD_AXIS) ||
+                   (memcmp(hostTableTable.xAxis, hostTableXAxis, sizeof(hostTableXAxis)) != 0) ||
+                   (memcmp(hostTableTable.yAxis, hostTableYAxis, sizeof(hostTableYAxis)) != 0)){
+                    result->axisFailures++;
+                    if(Table3D_SetAxes(&hostTableTable, hostTableXAxis, hostTableYAxis) != TABLE3D_OK){
+                        result->axisFailures++;
+                    }
+                }
+            }
+        }
+    }
+
+    if(Table3D_SetAxes(&hostTableTable, hostTableXAxis, hostTableYAxis) != TABLE3D_OK){
+        result->axisFailures++;
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostTable_concurrent(hostTableResult_t * result)
+* Starts the reader thread, waits for its first lookup, then fills the table
+* HOSTTABLE_WRITES times, each time with the other value. Every signal is
+* blocked in the reader, they belong to the RTOS port.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostTable_concurrent(hostTableResult_t * result){
+    static float fills[2][TABLE3D_SIZE * TABLE3D_SIZE];
+    pthread_t reader;
+    sigset_t blocked;
+    sigset_t previous;
+    uint32_t x;
+
+    for(x = 0; x < (TABLE3D_SIZE * TABLE3D_SIZE); x++){
+        fills[0][x] = HOSTTABLE_FILL_A;
+        fills[1][x] = HOSTTABLE_FILL_B;
+    }
+    Table3D_SetValues(&hostTableTable, fills[0]);
+
+    hostTableReads = 0;
+    hostTableTornReads = 0;
+    hostTableReading = 1;
+
+    sigfillset(&blocked);
+    pthread_sigmask(SIG_SETMASK, &blocked, &previous);
+    if(pthread_create(&reader, 0, &hostTable_reader, 0) != 0){
+        fprintf(stderr, "could not start the table reader thread\n");
+        exit(EXIT_FAILURE);
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, 0);
+
+    while(hostTableReads == 0){
+    }
+
+    for(x = 0; x < HOSTTABLE_WRITES; x++){
+        Table3D_SetValues(&hostTableTable, fills[(x + 1U) & 1U]);
+    }
+
+    hostTableReading = 0;
+    pthread_join(reader, 0);
+
+    result->writes = HOSTTABLE_WRITES;
+    result->reads = hostTableReads;
+    result->tornReads = hostTableTornReads;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void * hostTable_reader(void * argument)
+* Looks up points inside cells all over the table as fast as it can and
+* counts those that read neither fill
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void * hostTable_reader(void * argument){
+    float x;
+    float y;
+    float value;
+    uint32_t step = 0;
+
+    (void) argument;
+
+    while(hostTableReading){
+        x = 0.5f * (hostTableXAxis[step % (TABLE3D_SIZE - 1U)] + hostTableXAxis[(step % (TABLE3D_SIZE - 1U)) + 1U]);
+        y = 0.5f * (hostTableYAxis[(step / 7U) % (TABLE3D_SIZE - 1U)] + hostTableYAxis[((step / 7U) % (TABLE3D_SIZE - 1U)) + 1U]);
+        step++;
+
+        value = Table3D_Lookup(&hostTableTable, x, y);
+        if((value != HOSTTABLE_FILL_A) && (value != HOSTTABLE_FILL_B)){
+            hostTableTornReads = hostTableTornReads + 1U;
+        }
+        hostTableReads = hostTableReads + 1U;
+    }
+
+    return 0;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t hostTable_random(void)
+* Returns the next of a repeatable run of pseudo random numbers
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint32_t hostTable_random(void){
+    hostTableSeed = (hostTableSeed * 1103515245U) + 12345U;
+    return hostTableSeed >> 8;
+}
+/*****************************************************************************/
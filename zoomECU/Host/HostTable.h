@@ -0,0 +1,63 @@
+/******************************************************************************
+* File:                    HostTable.h
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Checks of the 3D table lookups for the host build.
+*                          Interpolation and clamping against a table whose
+*                          exact value is known everywhere, the axis checks,
+*                          and lookups from a host thread while a task
+*                          rewrites the table.
+******************************************************************************/
+#ifndef HOSTTABLE_H
+#define HOSTTABLE_H
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <stdint.h>
+
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+// Times the writer replaces the whole table while the reader looks it up
+#define HOSTTABLE_WRITES            200000U
+
+// A lookup is right if it is this close to the exact value, relative to it
+#define HOSTTABLE_TOLERANCE         1e-5
+
+
+/******************************************************************************
+* Public Types
+******************************************************************************/
+typedef struct{
+    uint32_t lookups;               // Lookups checked against the exact value
+    uint32_t failures;              // Lookups inside the table further off than HOSTTABLE_TOLERANCE
+    double worstError;              // Furthest any lookup was from the exact value, relative to it
+    uint32_t clampFailures;         // Lookups off the axes, or not a number, that did not read the edge
+    uint32_t axisFailures;          // Axes accepted or refused wrongly
+    uint32_t writes;
+    uint64_t reads;                 // Lookups by the reader thread while the table was written
+    uint64_t tornReads;             // Lookups that mixed two writes
+}hostTableResult_t;
+
+
+/******************************************************************************
+* Public Function Prototypes
+******************************************************************************/
+    /******************************************************************************
+    * void HostTable_Run(hostTableResult_t * result)
+    * Runs every table check. Only called from the hardware task, the writer
+    * masks interupts as a task does.
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void HostTable_Run(hostTableResult_t * result);
+    /*****************************************************************************/
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+#endif // ifdef HOSTTABLE_H
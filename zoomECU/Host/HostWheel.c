@@ -0,0 +1,253 @@
+/******************************************************************************
+* File:                    HostWheel.c
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Builds the crank and cam edges of one 720* cycle
+*                          from a trigger pattern. A pattern only lists the
+*                          edges it counts, so the rest are filled in: a
+*                          trigger counting both edges alternates rising and
+*                          falling, and a trigger counting one edge gets the
+*                          other half way to its nearest neighbour. Which way
+*                          round the alternating triggers start is taken from
+*                          the expected levels in the pattern's flag tables.
+*******************************************************************************
+* Includes
+******************************************************************************/
+#include "HostWheel.h"
+
+#include <stdlib.h>
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+#define HOSTWHEEL_CYCLE_ANGLE       720.0f
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+/******************************************************************************
+* Private Function Prototypes (static)
+******************************************************************************/
+static void hostWheel_addTrigger(hostWheel_t * wheel, const float * angles, uint32_t eventCount,
+                                 uint32_t countedEdges, uint32_t polarity, uint8_t primary);
+static void hostWheel_addEdge(hostWheel_t * wheel, float angle, uint8_t primary, uint8_t level);
+static uint8_t hostWheel_levelAt(const hostWheel_t * wheel, uint8_t primary, float angle);
+static uint32_t hostWheel_mismatches(const triggerPattern_t * pattern, const hostWheel_t * wheel);
+static int hostWheel_compare(const void * a, const void * b);
+
+/******************************************************************************
+* Private Variables (static)
+******************************************************************************/
+
+
+/******************************************************************************
+* Function Code
+******************************************************************************/
+
+
+/******************************************************************************
+* uint32_t HostWheel_Build(const triggerPattern_t * pattern, hostWheel_t * wheel)
+* Tries the four ways round the two triggers can start, and keeps the first
+* that meets every expected level (or the one that misses the fewest).
+* David Tolsma, 10/17/2026
+******************************************************************************/
+uint32_t HostWheel_Build(const triggerPattern_t * pattern, hostWheel_t * wheel){
+    uint32_t polarity;
+    uint32_t best = 0;
+    uint32_t bestMismatches = UINT32_MAX;
+    uint32_t mismatches;
+
+    for(polarity = 0; polarity < 4U; polarity++){
+        wheel->edgeCount = 0;
+        hostWheel_addTrigger(wheel, pattern->primaryEventAngles, pattern->primaryEventCount,
+                             pattern->primaryEdges, polarity & 1U, 1);
+        hostWheel_addTrigger(wheel, pattern->secondaryEventAngles, pattern->secondaryEventCount,
+                             pattern->secondaryEdges, polarity >> 1, 0);
+        qsort(wheel->edges, wheel->edgeCount, sizeof(hostWheelEdge_t), hostWheel_compare);
+
+        mismatches = hostWheel_mismatches(pattern, wheel);
+        if(mismatches < bestMismatches){
+            best = polarity;
+            bestMismatches = mismatches;
+        }
+        if(mismatches == 0){
+            break;
+        }
+    }
+
+    // Build the best one again if a later try was left in the table
+    if(polarity != best){
+        wheel->edgeCount = 0;
+        hostWheel_addTrigger(wheel, pattern->primaryEventAngles, pattern->primaryEventCount,
+                             pattern->primaryEdges, best & 1U, 1);
+        hostWheel_addTrigger(wheel, pattern->secondaryEventAngles, pattern->secondaryEventCount,
+                             pattern->secondaryEdges, best >> 1, 0);
+        qsort(wheel->edges, wheel->edgeCount, sizeof(hostWheelEdge_t), hostWheel_compare);
+    }
+
+    wheel->primaryStart = hostWheel_levelAt(wheel, 1, 0);
+    wheel->secondaryStart = hostWheel_levelAt(wheel, 0, 0);
+
+    return bestMismatches;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostWheel_addTrigger(wheel, angles, eventCount, countedEdges, polarity, primary)
+* Adds the edges of one trigger. Counting both edges, event 0 is rising
+* unless polarity is set. Counting one edge, the other edge is added half way
+* to the closer of the events either side.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostWheel_addTrigger(hostWheel_t * wheel, const float * angles, uint32_t eventCount,
+                                 uint32_t countedEdges, uint32_t polarity, uint8_t primary){
+    uint32_t x;
+    float next;
+    float previous;
+    float width;
+
+    for(x = 0; x < eventCount; x++){
+        if(countedEdges == TRIG_EDGE_BOTH){
+            hostWheel_addEdge(wheel, angles[x], primary, (uint8_t)(((x & 1U) == 0) ^ polarity));
+            continue;
+        }
+
+        next = angles[(x + 1) % eventCount] - angles[x];
+        previous = angles[x] - angles[(x + eventCount - 1) % eventCount];
+        if(next <= 0){
+            next += HOSTWHEEL_CYCLE_ANGLE;
+        }
+        if(previous <= 0){
+            previous += HOSTWHEEL_CYCLE_ANGLE;
+        }
+        width = 0.5f * ((next < previous) ? next : previous);
+
+        if(countedEdges == TRIG_EDGE_RISE){
+            hostWheel_addEdge(wheel, angles[x], primary, 1);
+            hostWheel_addEdge(wheel, angles[x] + width, primary, 0);
+        }
+        else{
+            hostWheel_addEdge(wheel, angles[x], primary, 0);
+            hostWheel_addEdge(wheel, angles[x] - width, primary, 1);
+        }
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void hostWheel_addEdge(hostWheel_t * wheel, float angle, uint8_t primary, uint8_t level)
+* Adds one edge, wrapped into 0 to 720
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void hostWheel_addEdge(hostWheel_t * wheel, float angle, uint8_t primary, uint8_t level){
+    if(wheel->edgeCount >= HOSTWHEEL_MAX_EDGES){
+        return;
+    }
+
+    while(angle >= HOSTWHEEL_CYCLE_ANGLE){
+        angle -= HOSTWHEEL_CYCLE_ANGLE;
+    }
+    while(angle < 0){
+        angle += HOSTWHEEL_CYCLE_ANGLE;
+    }
+
+    wheel->edges[wheel->edgeCount].angle = angle;
+    wheel->edges[wheel->edgeCount].primary = primary;
+    wheel->edges[wheel->edgeCount].level = level;
+    wheel->edgeCount++;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint8_t hostWheel_levelAt(const hostWheel_t * wheel, uint8_t primary, float angle)
+* Returns the level of a trigger just before an angle, set by its last edge
+* before there, or by its last edge of the cycle
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint8_t hostWheel_levelAt(const hostWheel_t * wheel, uint8_t primary, float angle){
+    uint8_t level = 0;
+    uint8_t lastLevel = 0;
+    uint32_t found = 0;
+    uint32_t x;
+
+    // Edges are in angle order
+    for(x = 0; x < wheel->edgeCount; x++){
+        if(wheel->edges[x].primary != primary){
+            continue;
+        }
+        if(wheel->edges[x].angle < angle){
+            level = wheel->edges[x].level;
+            found = 1;
+        }
+        lastLevel = wheel->edges[x].level;
+    }
+
+    return found ? level : lastLevel;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t hostWheel_mismatches(const triggerPattern_t * pattern, const hostWheel_t * wheel)
+* Counts the events whose other trigger is not at the level the pattern expects
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint32_t hostWheel_mismatches(const triggerPattern_t * pattern, const hostWheel_t * wheel){
+    uint32_t mismatches = 0;
+    uint32_t expected;
+    uint32_t x;
+
+    for(x = 0; x < pattern->primaryEventCount; x++){
+        expected = pattern->primaryEventFlags[x] & TRIG_EXPECT_ANY;
+        if(hostWheel_levelAt(wheel, 0, pattern->primaryEventAngles[x])){
+            mismatches += ((expected & TRIG_EXPECT_HIGH) == 0);
+        }
+        else{
+            mismatches += ((expected & TRIG_EXPECT_LOW) == 0);
+        }
+    }
+
+    for(x = 0; x < pattern->secondaryEventCount; x++){
+        expected = pattern->secondaryEventFlags[x] & TRIG_EXPECT_ANY;
+        if(hostWheel_levelAt(wheel, 1, pattern->secondaryEventAngles[x])){
+            mismatches += ((expected & TRIG_EXPECT_HIGH) == 0);
+        }
+        else{
+            mismatches += ((expected & TRIG_EXPECT_LOW) == 0);
+        }
+    }
+
+    return mismatches;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* int hostWheel_compare(const void * a, const void * b)
+* Orders edges by angle for qsort
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static int hostWheel_compare(const void * a, const void * b){
+    const hostWheelEdge_t * edgeA = (const hostWheelEdge_t *) a;
+    const hostWheelEdge_t * edgeB = (const hostWheelEdge_t *) b;
+
+    if(edgeA->angle < edgeB->angle){
+        return -1;
+    }
+    if(edgeA->angle > edgeB->angle){
+        return 1;
+    }
+    return 0;
+}
+/*****************************************************************************/
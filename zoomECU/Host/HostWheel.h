@@ -0,0 +1,62 @@
+/******************************************************************************
+* File:                    HostWheel.h
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Builds the crank and cam edges of one 720* cycle
+*                          from a trigger pattern, for driving the host build
+******************************************************************************/
+#ifndef HOSTWHEEL_H
+#define HOSTWHEEL_H
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <stdint.h>
+
+#include "TriggerPattern.h"
+
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+// Most edges in one cycle, both edges of every counted event
+#define HOSTWHEEL_MAX_EDGES         512U
+
+
+/******************************************************************************
+* Public Types
+******************************************************************************/
+typedef struct{
+    float angle;                    // Crank angle, 0 up to 720
+    uint8_t primary;                // 1 for the crank, 0 for the cam
+    uint8_t level;                  // Level of that trigger after the edge
+}hostWheelEdge_t;
+
+// Edges in angle order, and the level of each trigger at 0*
+typedef struct{
+    hostWheelEdge_t edges[HOSTWHEEL_MAX_EDGES];
+    uint32_t edgeCount;
+    uint8_t primaryStart;
+    uint8_t secondaryStart;
+}hostWheel_t;
+
+
+/******************************************************************************
+* Public Function Prototypes
+******************************************************************************/
+    /******************************************************************************
+    * uint32_t HostWheel_Build(const triggerPattern_t * pattern, hostWheel_t * wheel)
+    * Fills in the edges of a pattern. Returns the number of events whose
+    * expected other trigger level could not be met, 0 for a good wheel.
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    uint32_t HostWheel_Build(const triggerPattern_t * pattern, hostWheel_t * wheel);
+    /*****************************************************************************/
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+#endif // ifdef HOSTWHEEL_H
@@ -0,0 +1,98 @@
+/******************************************************************************
+* File:                    Calibration.h
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Conversion of raw sensor readings to engineering
+*                          units through precomputed tables
+******************************************************************************/
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <stdint.h>
+
+#include "Sensors.h"
+
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+// Each table holds one point every 2^CALIBRATION_SHIFT raw counts over the
+// 16 bit range, plus the end point. Must match Tools/generateCalibration.py.
+#define CALIBRATION_SHIFT           9U
+#define CALIBRATION_TABLE_SIZE      ((65536U >> CALIBRATION_SHIFT) + 1U)
+
+// Units returned for each sensor:
+//  MAP  0.1 kPa
+//  AFM  mV at the pin
+//  TPS  0.1 % open
+//  O2   lambda x 1000
+//  IAT  0.1 degrees C
+//  CTS  0.1 degrees C
+//  BAT  mV
+
+
+/******************************************************************************
+* Public Types
+******************************************************************************/
+// Range a sensor is clamped to after the table lookup, in its units. The
+// tables follow the sensor past its limits, so the clamp lands exactly where
+// the sensor reaches it instead of somewhere between two table points.
+typedef struct{
+    int16_t low;
+    int16_t high;
+}calibrationLimits_t;
+
+
+/******************************************************************************
+* Public Function Prototypes
+******************************************************************************/
+    /******************************************************************************
+    * int32_t Calibration_Lookup(const int16_t * table, uint16_t raw)
+    * Interpolates a calibration table at a raw reading
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    int32_t Calibration_Lookup(const int16_t * table, uint16_t raw);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * int32_t Calibration_Convert(sensor_t sensor, uint16_t raw)
+    * Converts a raw reading of a sensor to its engineering units, within its limits
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    int32_t Calibration_Convert(sensor_t sensor, uint16_t raw);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * int32_t Calibration_Read(sensor_t sensor)
+    * Returns the latest reading of a sensor in its engineering units
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    int32_t Calibration_Read(sensor_t sensor);
+    /*****************************************************************************/
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+// Generated into CalibrationTables.c by Tools/generateCalibration.py
+extern const int16_t calibrationTableMAP[CALIBRATION_TABLE_SIZE];
+extern const int16_t calibrationTableAFM[CALIBRATION_TABLE_SIZE];
+extern const int16_t calibrationTableTPS[CALIBRATION_TABLE_SIZE];
+extern const int16_t calibrationTableO2[CALIBRATION_TABLE_SIZE];
+extern const int16_t calibrationTableIAT[CALIBRATION_TABLE_SIZE];
+extern const int16_t calibrationTableCTS[CALIBRATION_TABLE_SIZE];
+extern const int16_t calibrationTableBAT[CALIBRATION_TABLE_SIZE];
+
+extern const calibrationLimits_t calibrationLimitsMAP;
+extern const calibrationLimits_t calibrationLimitsAFM;
+extern const calibrationLimits_t calibrationLimitsTPS;
+extern const calibrationLimits_t calibrationLimitsO2;
+extern const calibrationLimits_t calibrationLimitsIAT;
+extern const calibrationLimits_t calibrationLimitsCTS;
+extern const calibrationLimits_t calibrationLimitsBAT;
+
+
+#endif // ifdef CALIBRATION_H
@@ -0,0 +1,164 @@
+/******************************************************************************
+* File:                    Datalog.h
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Binary datalogger to the SD card. A sampler task
+*                          fills one of two RAM buffers with fixed size frames
+*                          every DATALOG_PERIOD_MS, a flush task at the idle
+*                          priority writes the other buffer out with one
+*                          multiple block write. Control tasks never wait on
+*                          the card: if a buffer is still being written when
+*                          the next one fills, frames are dropped and counted.
+*
+* The card is written raw, with no file system. Block 0, the card's
+* partition table, is never written. Block DATALOG_INDEX_BLOCK holds a
+* datalogIndex_t, which points at the newest log and the first block no log
+* has reached. Each power up, or restart after a failed write, starts a new
+* log there, so the logs follow each other up the card from
+* DATALOG_START_BLOCK until it is full. A log is a block holding a
+* datalogHeader_t, which points back at the log before it, then the frames,
+* DATALOG_FRAMES_PER_BLOCK to a block. The frame sequence starts at the
+* header's firstSequence and counts up by one, so the log ends where the
+* sequence breaks. Tools/decodeLog.py reads them back.
+*
+* The index is written ahead of the log, DATALOG_INDEX_AHEAD_BLOCKS at a
+* time, so it never points into a log that was running when the power went.
+* Zero the index block to start the card over.
+*
+* Uncomment DATALOG_MEASURE_CYCLES to time each sample with the DWT cycle
+* counter.
+******************************************************************************/
+#ifndef DATALOG_H
+#define DATALOG_H
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <stdint.h>
+
+#include "SdCard.h"
+
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+//#define DATALOG_MEASURE_CYCLES
+
+#define DATALOG_PERIOD_MS           1U
+
+// The log keeps out of the first MiB, where partition tables live
+#define DATALOG_INDEX_BLOCK         1U
+#define DATALOG_START_BLOCK         2048U
+
+// Blocks the index is moved on ahead of the log each time, 8S at 1kHz
+#define DATALOG_INDEX_AHEAD_BLOCKS  (DATALOG_BLOCKS_PER_BUFFER * 64U)
+
+// Each buffer is written in one go, 128 frames (128mS at 1kHz) per buffer
+#define DATALOG_BLOCKS_PER_BUFFER   8U
+
+#define DATALOG_VERSION             2U
+#define DATALOG_MAGIC               "ZOOMLOG"
+#define DATALOG_INDEX_MAGIC         "ZOOMIDX"
+
+// angle with no sync
+#define DATALOG_NO_ANGLE            0xFFFFU
+
+
+/******************************************************************************
+* Public Types
+******************************************************************************/
+// One sample, 32 bytes. Must match Tools/decodeLog.py.
+typedef struct{
+    uint32_t time;                  // Time_GetTicks
+    uint16_t sequence;
+    uint16_t rpm;
+    uint16_t angle;                 // 0.1 degrees, DATALOG_NO_ANGLE without sync
+    int16_t advance;                // 0.1 degrees BTDC, of the last spark created
+    uint16_t dwell;                 // uS, of the last spark created
+    int16_t map;                    // Sensors in their Calibration_Read units
+    int16_t tps;
+    int16_t o2;
+    int16_t iat;
+    int16_t cts;
+    int16_t bat;
+    int16_t afm;
+    uint8_t sync;
+    uint8_t syncConfidence;         // Capped at 255
+    uint16_t dropped;               // Frames dropped since the log started
+}datalogFrame_t;
+
+#define DATALOG_FRAMES_PER_BLOCK    (SDCARD_BLOCK_SIZE / sizeof(datalogFrame_t))
+
+// Start of the first block of a log
+typedef struct{
+    char magic[8];                  // DATALOG_MAGIC
+    uint16_t version;
+    uint16_t frameSize;
+    uint16_t framesPerBlock;
+    uint16_t periodMs;
+    uint16_t ticksPerUs;
+    uint16_t firstSequence;
+    uint32_t session;               // Count of logs on the card, this one included
+    uint32_t previousBlock;         // Header block of the log before, 0 for the first
+}datalogHeader_t;
+
+// Start of block DATALOG_INDEX_BLOCK
+typedef struct{
+    char magic[8];                  // DATALOG_INDEX_MAGIC
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t sessions;              // Logs on the card
+    uint32_t lastBlock;             // Header block of the newest log, 0 with none
+    uint32_t nextBlock;             // No log reaches this block, the next one starts here
+}datalogIndex_t;
+
+typedef struct{
+    uint32_t framesLogged;
+    uint32_t framesDropped;
+    uint32_t blocksWritten;
+    uint32_t writes;                // Calls to SdCard_WriteBlocks
+    uint32_t writeTicksMax;         // Longest write, in Time_GetTicks ticks
+    uint32_t writeTicksTotal;       // Time spent writing, blocksWritten * 512 / this is the throughput
+    uint32_t errors;                // Card restarts after a failed write
+    uint32_t session;               // Of the log running now, 0 before one starts
+#ifdef DATALOG_MEASURE_CYCLES
+    uint32_t sampleCycles;          // Cycles the last sample took, and the worst seen
+    uint32_t sampleCyclesMax;
+#endif
+}datalogStats_t;
+
+
+/******************************************************************************
+* Public Function Prototypes
+******************************************************************************/
+    /******************************************************************************
+    * void Datalog_Init(void)
+    * Creates the sampler and flush tasks. Logging starts once a card is found.
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void Datalog_Init(void);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * uint32_t Datalog_IsLogging(void)
+    * Returns 1 while frames are being logged to a card
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    uint32_t Datalog_IsLogging(void);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void Datalog_GetStats(datalogStats_t * stats)
+    * Copies the logging and card write statistics
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void Datalog_GetStats(datalogStats_t * stats);
+    /*****************************************************************************/
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+#endif // ifdef DATALOG_H
@@ -4,7 +4,7 @@
 * Date Modified:           05/25/2020
 * Breif Description:       Brief Description of Module
 ******************************************************************************/
-#ifndef ENGINECONTROLLER
+#ifndef ENGINECONTROLLER_H
 #define ENGINECONTROLLER_H
 
 /******************************************************************************
@@ -15,6 +15,24 @@
 /******************************************************************************
 * Defines
 ******************************************************************************/
+// Cylinders of the engine. Compression TDC of the first is ENGINE_FIRST_TDC
+// into the 720 degree cycle of the trigger decoder, the rest follow evenly
+// spaced in firing order. Fuel, ignition and the MAP windows all time from
+// these.
+#ifndef ENGINE_CYLINDERS
+#define ENGINE_CYLINDERS            4U
+#endif
+#define ENGINE_FIRST_TDC            90.0f
+#define ENGINE_TDC_ANGLE(cylinder)  (ENGINE_FIRST_TDC + ((720.0f / (float) ENGINE_CYLINDERS) * (float)(cylinder)))
+
+// The engine is RUNNING once it is above ENGINE_RUNNING_RPM, and goes back to
+// CRANKING when it drops ENGINE_RUNNING_HYSTERESIS below that
+#ifndef ENGINE_RUNNING_RPM
+#define ENGINE_RUNNING_RPM          500.0f
+#endif
+#ifndef ENGINE_RUNNING_HYSTERESIS
+#define ENGINE_RUNNING_HYSTERESIS   100.0f
+#endif
 
 
 /******************************************************************************
@@ -0,0 +1,102 @@
+/******************************************************************************
+* File:                    FuelControl.h
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Sequential fuel injection on the LSD outputs
+******************************************************************************/
+#ifndef FUELCONTROL_H
+#define FUELCONTROL_H
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "Table3D.h"
+#include "EngineController.h"
+
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+// Number of cylinders injected, one injector each on LSD_1 and up (8 at most)
+#define FUEL_CYLINDERS              ENGINE_CYLINDERS
+
+// Pulse width in uS that fills a cylinder at 100% VE and 100 kPa, without
+// the injector dead time. Set from the engine size and injector flow.
+#ifndef FUEL_REQUIRED_FUEL
+#define FUEL_REQUIRED_FUEL          7600.0f
+#endif
+
+// Uncomment to count the core clock cycles spent working out the pulse widths
+// of each engine cycle with the DWT cycle counter. Read fuelCalcCycles and
+// fuelCalcCyclesMax with the debugger.
+//#define FUEL_MEASURE_CYCLES
+
+
+/******************************************************************************
+* Public Types
+******************************************************************************/
+// Transient fuel state, updated once per engine cycle. Fuel amounts are in uS
+// of injector open time without the dead time. Per cylinder values are kept
+// as arrays so a cycle's update is one short loop.
+typedef struct{
+    float film[FUEL_CYLINDERS];     // Fuel left on the port walls
+    float pulse[FUEL_CYLINDERS];    // Fuel to inject this cycle
+    float lastTps;                  // % open, last cycle
+    float lastMap;                  // kPa, last cycle
+    float accel;                    // Accel enrichment, fraction of the fuel added
+    uint32_t primed;                // 0 until the first cycle has been seen
+}fuelTransient_t;
+
+
+/******************************************************************************
+* Public Function Prototypes
+******************************************************************************/
+    /******************************************************************************
+    * void FuelControl_Init(void)
+    * Creates the fuel task and starts injecting once the trigger has sync
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void FuelControl_Init(void);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * float FuelControl_CalcFuel(float rpm, float map)
+    * Returns the steady state fuel per cylinder in uS, without dead time
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    float FuelControl_CalcFuel(float rpm, float map);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void FuelControl_UpdateTransient(state, fuel, tps, map, cycleTime)
+    * Steps the wall wetting and accel enrichment by one engine cycle
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void FuelControl_UpdateTransient(fuelTransient_t * state, float fuel, float tps, float map, float cycleTime);
+    /*****************************************************************************/
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+// This is the handle to the fuel task.
+extern TaskHandle_t FuelControlTaskHandle;
+
+// Volumetric efficiency in %, over rpm (x) and MAP in kPa (y)
+extern table3D_t fuelVeTable;
+
+// Crank angle before TDC of each cylinder that its injection ends at
+extern volatile float fuelEndOfInjection;
+
+// Wall wetting: the fraction of each injection that lands on the port walls,
+// and the time constant in mS the wall fuel evaporates into the cylinder with
+extern volatile float fuelWallFraction;
+extern volatile float fuelWallTau;
+
+
+#endif // ifdef FUELCONTROL_H
@@ -61,6 +61,14 @@
     void Gpio_TogglePin(GPIO_TypeDef *GPIOx, uint32_t Pin);
     /*****************************************************************************/
 
+    /******************************************************************************
+    * void Gpio_SetAlternateFunction(Port, Pin, AlternateFunction)
+    * Hands an STM32G4 GPIO pin over to one of its alternate functions (0-15)
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void Gpio_SetAlternateFunction(GPIO_TypeDef *GPIOx, uint32_t Pin, uint32_t AlternateFunction);
+    /*****************************************************************************/
+
     /******************************************************************************
     * void Gpio_On(void)
     * Turns on all outputs (for testing)
@@ -17,6 +17,8 @@
 #include "queue.h"
 #include "event_groups.h"
 
+#include "Table3D.h"
+
 /******************************************************************************
 * Defines
 ******************************************************************************/
@@ -25,6 +27,28 @@
 #define IGN_SCH_3  (0x1UL << 2)
 #define IGN_SCH_4  (0x1UL << 3)
 
+// Uncomment to drive PP_1-4 from timer output compare channels (TIM3_CH1/2,
+// TIM4_CH1/2) instead of setting the pins from TIM2_IRQHandler. TIM2 then only
+// arms each coil edge shortly before it happens, and the timer switches the pin
+// at the exact count.
+//#define IGNITION_OUTPUT_COMPARE
+
+// Sensor giving the load axis of the spark table, read in kPa for SENSOR_MAP
+// or % open for SENSOR_TPS. The load axis of ignitionSparkTable must match.
+#ifndef IGNITION_LOAD_SENSOR
+#define IGNITION_LOAD_SENSOR    SENSOR_MAP
+#endif
+
+/******************************************************************************
+* Public Types
+******************************************************************************/
+// Schedules that could not be set and were tried again IGNITION_RETRY_TIME
+// later, counted by reason
+typedef struct{
+    uint32_t noConfidence;          // No angle, speed or spark angle yet
+    uint32_t late;                  // Too close to the dwell start to arm it
+}ignitionRetryStats_t;
+
 /******************************************************************************
 * Public Function Prototypes
 ******************************************************************************/
@@ -36,6 +60,56 @@
     ******************************************************************************/
     void IgnitionControl_Init(void);
     /*****************************************************************************/
+
+    /******************************************************************************
+    * void IgnitionControl_Start(void)
+    * Starts creating ignition schedules, each one chains on to its next spark
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void IgnitionControl_Start(void);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void IgnitionControl_Stop(void)
+    * Stops creating ignition schedules once the ones set have sparked
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void IgnitionControl_Stop(void);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * float IgnitionControl_calcNextIgnitionAngle(int32_t ignSchedule)
+    * Returns the angle in the 720 degree cycle that a schedule (IGN_SCH_x)
+    * sparks at for the current rpm and load
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    float IgnitionControl_calcNextIgnitionAngle(int32_t ignSchedule);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * float IgnitionControl_GetAdvance(void)
+    * Returns the spark table advance, in degrees before TDC, of the last spark
+    * created. Cylinder trims are not included.
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    float IgnitionControl_GetAdvance(void);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * float IgnitionControl_GetDwell(void)
+    * Returns the dwell of the last spark created, in microseconds
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    float IgnitionControl_GetDwell(void);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void IgnitionControl_GetRetryStats(ignitionRetryStats_t * stats)
+    * Copies the counts of schedules that had to be tried again
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void IgnitionControl_GetRetryStats(ignitionRetryStats_t * stats);
+    /*****************************************************************************/
     
 /******************************************************************************
 * Public Variables
@@ -43,7 +117,14 @@
 // This is the handle to the event creation task.
 TaskHandle_t IgnitionControlEventCreationTaskHandle;
 
-// This event group is set when one of the 4 ignition schedules is cleared.
-EventGroupHandle_t ignitionScheduleFinishedEventGroup;
+// Spark advance in degrees before TDC, over rpm (x) and load (y). Tune it
+// with the Table3D_Set functions while the engine runs.
+extern table3D_t ignitionSparkTable;
+
+// Degrees of advance added to the table for each cylinder
+extern volatile float ignitionSparkTrim[4];
+
+// Coil dwell in uS, over rpm (x) and battery voltage (y)
+extern table3D_t ignitionDwellTable;
 
 #endif // ifdef IGNITIONCONTROL_H
@@ -0,0 +1,187 @@
+/******************************************************************************
+* File:                    Latency.h
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Interupt and task wake up timing with the DWT cycle
+*                          counter. Each timed interupt records how long after
+*                          its hardware event it started and how long it ran,
+*                          each timed task how long it waited to run after it
+*                          was notified. Min, max and a histogram are kept per
+*                          source, and every sample goes into a ring for the
+*                          debugger.
+*
+* Uncomment LATENCY_MEASURE (or define it on the command line) to build it in.
+* With it off every LATENCY_* macro is empty and nothing is built.
+******************************************************************************/
+#ifndef LATENCY_H
+#define LATENCY_H
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <stdint.h>
+
+#include "stm32g4xx.h"
+
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+//#define LATENCY_MEASURE
+
+// Samples kept in the ring, must be a power of two
+#define LATENCY_LOG_SIZE            256U
+#define LATENCY_LOG_MASK            (LATENCY_LOG_SIZE - 1U)
+
+// Histogram bins are powers of two: bin 0 holds 0 cycles, bin n holds
+// 2^(n-1) up to 2^n - 1 cycles and the last bin everything longer.
+// 16 bins reach 32767 cycles, 193uS at 170MHz.
+#define LATENCY_HISTOGRAM_BINS      16U
+
+// Latency of interupts with no hardware time stamp (the EXTI lines), only the
+// run time is kept for them
+#define LATENCY_NO_EVENT_TIME       0xFFFFFFFFU
+
+// Run time of a task sample, tasks only have a wake up latency and are kept
+// out of the run time statistics
+#define LATENCY_NO_RUN_TIME         0xFFFFFFFFU
+
+#ifdef LATENCY_MEASURE
+#define LATENCY_ISR_ENTER(entry)                        Latency_IsrEnter(&(entry))
+#define LATENCY_ISR_TIMER_EVENT(entry, timer, status)   Latency_IsrTimerEvent(&(entry), (timer), (status))
+#define LATENCY_ISR_EXIT(entry, source)                 Latency_IsrExit(&(entry), (source))
+#define LATENCY_TASK_READY(source)                      Latency_TaskReadyFromISR(source)
+#define LATENCY_TASK_RUNNING(source)                    Latency_TaskRunning(source)
+#else
+#define LATENCY_ISR_ENTER(entry)
+#define LATENCY_ISR_TIMER_EVENT(entry, timer, status)
+#define LATENCY_ISR_EXIT(entry, source)
+#define LATENCY_TASK_READY(source)
+#define LATENCY_TASK_RUNNING(source)
+#endif
+
+
+/******************************************************************************
+* Public Types
+******************************************************************************/
+typedef enum{
+    LATENCY_CRANK_ISR = 0,          // EXTI3, or TIM5 with TRIGGER_INPUT_CAPTURE
+    LATENCY_CAM_ISR,                // EXTI1, or TIM3 with TRIGGER_INPUT_CAPTURE
+    LATENCY_IGNITION_ISR,           // TIM2
+    LATENCY_SCHEDULER_ISR,          // TIM8_CC
+    LATENCY_TRIGGER_TASK,           // TriggerDecoder_Task, woken by the trigger ISRs
+    LATENCY_IGNITION_TASK,          // IgnitionControl_EventCreationTask, woken by TIM2
+    LATENCY_SOURCES
+}latencySource_t;
+
+// Taken at the top of a timed interupt
+typedef struct{
+    uint32_t cycles;
+    uint32_t ticks;
+    uint32_t eventTime;             // Time_GetTicks time of the hardware event, if known
+}latencyEntry_t;
+
+// For interupts the latency is from the hardware event to the first line of
+// the handler and the run time is the handler itself. For tasks the latency
+// is from being notified to running, with no run time.
+typedef struct{
+    uint32_t count;
+    uint32_t latencyCount;          // Samples that had a latency, see LATENCY_NO_EVENT_TIME
+    uint32_t runCount;              // Samples that had a run time, see LATENCY_NO_RUN_TIME
+    uint32_t latencyMin;
+    uint32_t latencyMax;
+    uint32_t runMin;
+    uint32_t runMax;
+    uint32_t latencyHistogram[LATENCY_HISTOGRAM_BINS];
+    uint32_t runHistogram[LATENCY_HISTOGRAM_BINS];
+}latencyStats_t;
+
+// One sample in the ring, all times in core clock cycles
+typedef struct{
+    uint32_t time;                  // DWT->CYCCNT at the start of the interupt or task
+    uint32_t latency;               // LATENCY_NO_EVENT_TIME if not known
+    uint32_t run;                   // LATENCY_NO_RUN_TIME for tasks
+    uint32_t source;
+}latencyRecord_t;
+
+
+/******************************************************************************
+* Public Function Prototypes
+******************************************************************************/
+#ifdef LATENCY_MEASURE
+    /******************************************************************************
+    * void Latency_Init(void)
+    * Starts the DWT cycle counter and clears all samples
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void Latency_Init(void);
+
+    /******************************************************************************
+    * void Latency_IsrEnter(latencyEntry_t * entry)
+    * Notes the cycle count and tick time at the top of an interupt
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void Latency_IsrEnter(latencyEntry_t * entry);
+
+    /******************************************************************************
+    * void Latency_IsrTimerEvent(latencyEntry_t * entry, TIM_TypeDef * timer, uint32_t status)
+    * Takes the event time of a timer interupt from the compare or capture
+    * register of the first channel flagged in status, or the update if none.
+    * Must be called before the handler moves the compare.
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void Latency_IsrTimerEvent(latencyEntry_t * entry, TIM_TypeDef * timer, uint32_t status);
+
+    /******************************************************************************
+    * void Latency_IsrExit(const latencyEntry_t * entry, latencySource_t source)
+    * Records an interupt at the bottom of its handler
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void Latency_IsrExit(const latencyEntry_t * entry, latencySource_t source);
+
+    /******************************************************************************
+    * void Latency_TaskReadyFromISR(latencySource_t source)
+    * Notes the time a task was notified. Only the first notify before the
+    * task runs counts.
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void Latency_TaskReadyFromISR(latencySource_t source);
+
+    /******************************************************************************
+    * void Latency_TaskRunning(latencySource_t source)
+    * Records how long a task waited since it was notified, called by the task
+    * as its wait returns
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void Latency_TaskRunning(latencySource_t source);
+
+    /******************************************************************************
+    * void Latency_GetStats(latencySource_t source, latencyStats_t * stats)
+    * Copies the statistics of one source
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void Latency_GetStats(latencySource_t source, latencyStats_t * stats);
+
+    /******************************************************************************
+    * uint32_t Latency_GetRecords(latencyRecord_t * records, uint32_t maxRecords)
+    * Copies up to maxRecords of the newest samples, oldest first, and returns
+    * how many were copied
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    uint32_t Latency_GetRecords(latencyRecord_t * records, uint32_t maxRecords);
+
+    /******************************************************************************
+    * void Latency_Reset(void)
+    * Clears all statistics and the ring
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void Latency_Reset(void);
+#endif
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+#endif // ifdef LATENCY_H
@@ -50,6 +50,13 @@
 #define PP_7_PORT GPIOE
 #define PP_8_PORT GPIOE
 
+// Alternate functions used when PP_1-4 are driven by output compare
+// PB4 = TIM3_CH1, PB5 = TIM3_CH2, PB6 = TIM4_CH1, PB7 = TIM4_CH2
+#define PP_1_COMPARE_AF 2U
+#define PP_2_COMPARE_AF 2U
+#define PP_3_COMPARE_AF 2U
+#define PP_4_COMPARE_AF 2U
+
 // Variable Reluctance Decoder
 #define VR_1_PIN (0x1UL << 1)
 #define VR_2_PIN (0x1UL << 0)
@@ -64,6 +71,11 @@
 #define CRANK_PORT GPIOA
 #define CAM_PORT GPIOB
 
+// Alternate functions used when the triggers are timer captured
+// PA3 = TIM5_CH4, PB1 = TIM3_CH4
+#define CRANK_CAPTURE_AF 2U
+#define CAM_CAPTURE_AF 2U
+
 // Stepper Motor Driver
 #define STEP_EN_PIN (0x1UL << 2)
 #define STEP_DIR_PIN (0x1UL << 3)
@@ -121,6 +133,17 @@
 #define IN_B_PORT GPIOD
 #define IN_C_PORT GPIOE
 
+// ADC channels of the sensor inputs
+// PA0 = ADC1_IN1, PA1 = ADC1_IN2, PC5 = ADC2_IN11, PE9 = ADC3_IN2,
+// PE14 = ADC4_IN1, PE15 = ADC4_IN2, PB12 = ADC4_IN3
+#define MAP_ADC_CHANNEL 1U
+#define AFM_ADC_CHANNEL 2U
+#define TPS_ADC_CHANNEL 11U
+#define O2_ADC_CHANNEL 2U
+#define IAT_ADC_CHANNEL 1U
+#define CTS_ADC_CHANNEL 2U
+#define BAT_ADC_CHANNEL 3U
+
 // CAN Bus
 #define CAN_TX_PIN (0x1UL << 1)
 #define CAN_RX_PIN (0x1UL << 0)
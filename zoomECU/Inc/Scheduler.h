@@ -0,0 +1,88 @@
+/******************************************************************************
+* File:                    Scheduler.h
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Timed output event scheduler on the TIM8 compare
+*                          channels
+******************************************************************************/
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <stdint.h>
+
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+// Number of compare channels events can be spread over (TIM8 CC1-CC4)
+#define SCHEDULER_CHANNELS          4U
+
+// Outputs the scheduler is sized for, 8 coils and 8 injectors
+#define SCHEDULER_MAX_OUTPUTS       16U
+
+// An output has at most its on and its off event waiting at once
+#define SCHEDULER_EVENTS_PER_OUTPUT 2U
+
+// Number of events each channel can hold at once, enough for every output to
+// share one channel
+#define SCHEDULER_QUEUE_SIZE        (SCHEDULER_MAX_OUTPUTS * SCHEDULER_EVENTS_PER_OUTPUT)
+
+// Return values of Scheduler_Add
+#define SCHEDULER_OK                0
+#define SCHEDULER_FULL              -1
+#define SCHEDULER_BAD_CHANNEL       -2
+
+
+/******************************************************************************
+* Public Types
+******************************************************************************/
+// Action run from the compare interrupt when an event is due. It must be
+// short, as every other event on the channel waits for it.
+typedef void (*schedulerCallback_t)(void * argument);
+
+
+/******************************************************************************
+* Public Function Prototypes
+******************************************************************************/
+    /******************************************************************************
+    * void Scheduler_Init(void)
+    * Sets up the compare channels and their interrupt
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void Scheduler_Init(void);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * int32_t Scheduler_Add(channel, time, callback, argument)
+    * Queues callback(argument) to run at a Time_GetTicks time. Task use only.
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    int32_t Scheduler_Add(uint32_t channel, uint32_t time, schedulerCallback_t callback, void * argument);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * int32_t Scheduler_AddFromISR(channel, time, callback, argument)
+    * Same as Scheduler_Add, for use from interrupts
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    int32_t Scheduler_AddFromISR(uint32_t channel, uint32_t time, schedulerCallback_t callback, void * argument);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * uint32_t Scheduler_GetPending(uint32_t channel)
+    * Returns the number of events waiting on a channel
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    uint32_t Scheduler_GetPending(uint32_t channel);
+    /*****************************************************************************/
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+#endif // ifdef SCHEDULER_H
@@ -0,0 +1,83 @@
+/******************************************************************************
+* File:                    SdCard.h
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       SD card in SPI mode on SPI1 (SD_NSS/SCLK/MISO/MOSI
+*                          on GPIOA). Commands are sent a byte at a time,
+*                          blocks written are moved by DMA while the calling
+*                          task sleeps. Only used from one task.
+******************************************************************************/
+#ifndef SDCARD_H
+#define SDCARD_H
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <stdint.h>
+
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+#define SDCARD_BLOCK_SIZE           512U
+
+// Level of SD_DETECT with a card in the socket (the switch pulls it to ground)
+#define SDCARD_DETECT_LEVEL         0U
+
+// Return values
+#define SDCARD_OK                   0
+#define SDCARD_NO_CARD              -1
+#define SDCARD_TIMEOUT              -2
+#define SDCARD_ERROR                -3      // The card refused a command or a block
+
+
+/******************************************************************************
+* Public Function Prototypes
+******************************************************************************/
+    /******************************************************************************
+    * int32_t SdCard_Init(void)
+    * Sets up SPI1 and its DMA, then wakes the card up and reads its size.
+    * Returns SDCARD_OK once the card is ready for SdCard_WriteBlocks. Must be
+    * called from a task, it sleeps while the card starts.
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    int32_t SdCard_Init(void);
+
+    /******************************************************************************
+    * uint32_t SdCard_IsPresent(void)
+    * Returns 1 if SD_DETECT shows a card in the socket
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    uint32_t SdCard_IsPresent(void);
+
+    /******************************************************************************
+    * uint32_t SdCard_GetBlockCount(void)
+    * Returns the size of the card in blocks, 0 until SdCard_Init succeeds
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    uint32_t SdCard_GetBlockCount(void);
+
+    /******************************************************************************
+    * int32_t SdCard_ReadBlock(uint32_t block, uint8_t * data)
+    * Reads one block into data. The calling task sleeps a tick at a time
+    * while the card finds the block. Returns one of the SDCARD_ values.
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    int32_t SdCard_ReadBlock(uint32_t block, uint8_t * data);
+
+    /******************************************************************************
+    * int32_t SdCard_WriteBlocks(uint32_t block, const uint8_t * data, uint32_t count)
+    * Writes count blocks from block on with one multiple block write. The
+    * calling task sleeps while each block is moved by DMA and while the card
+    * is busy. Returns one of the SDCARD_ values.
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    int32_t SdCard_WriteBlocks(uint32_t block, const uint8_t * data, uint32_t count);
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+#endif // ifdef SDCARD_H
@@ -0,0 +1,102 @@
+/******************************************************************************
+* File:                    Sensors.h
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Continuous DMA scan of the analog sensor inputs
+******************************************************************************/
+#ifndef SENSORS_H
+#define SENSORS_H
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <stdint.h>
+
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+// Full scale of a raw reading, 12 bits oversampled up to 16 bits
+#define SENSORS_FULL_SCALE          65535U
+
+// ADC reference voltage
+#define SENSORS_VREF                3.3f
+
+// Number of cylinders that can each have a crank angle MAP window
+#define SENSORS_MAP_MAX_CYLINDERS   8U
+
+
+/******************************************************************************
+* Public Types
+******************************************************************************/
+typedef enum{
+    SENSOR_MAP,
+    SENSOR_AFM,
+    SENSOR_TPS,
+    SENSOR_O2,
+    SENSOR_IAT,
+    SENSOR_CTS,
+    SENSOR_BAT,
+    SENSOR_COUNT
+}sensor_t;
+
+
+/******************************************************************************
+* Public Function Prototypes
+******************************************************************************/
+    /******************************************************************************
+    * void Sensors_Init(void)
+    * Sets up the ADCs and DMA and starts scanning every sensor input
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void Sensors_Init(void);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * uint16_t Sensors_GetRaw(sensor_t sensor)
+    * Returns the latest 16 bit reading of a sensor, safe to call from anywhere
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    uint16_t Sensors_GetRaw(sensor_t sensor);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * float Sensors_GetVoltage(sensor_t sensor)
+    * Returns the latest reading of a sensor in volts at the pin
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    float Sensors_GetVoltage(sensor_t sensor);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * uint32_t Sensors_SetMapWindow(cylinder, startAngle, endAngle, samples)
+    * Samples MAP at crank angles spread over a window, once per engine cycle
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    uint32_t Sensors_SetMapWindow(uint32_t cylinder, float startAngle, float endAngle, uint32_t samples);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void Sensors_ResetMap(void)
+    * Drops the crank angle MAP readings on losing sync, MAP reads from the scan
+    * until a window completes again
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void Sensors_ResetMap(void);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * uint32_t Sensors_GetMapCycle(cylinder, minimum, average)
+    * Returns the lowest and average MAP of the last complete window of a cylinder
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    uint32_t Sensors_GetMapCycle(uint32_t cylinder, uint16_t * minimum, uint16_t * average);
+    /*****************************************************************************/
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+#endif // ifdef SENSORS_H
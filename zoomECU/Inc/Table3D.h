@@ -0,0 +1,92 @@
+/******************************************************************************
+* File:                    Table3D.h
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       2D lookup maps (value over an x and y axis) with
+*                          bilinear interpolation, tunable while running
+******************************************************************************/
+#ifndef TABLE3D_H
+#define TABLE3D_H
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <stdint.h>
+
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+// Number of points on each axis of a table
+#define TABLE3D_SIZE                16U
+
+// Return values of Table3D_SetAxes
+#define TABLE3D_OK                  0
+#define TABLE3D_BAD_AXIS            -1
+
+
+/******************************************************************************
+* Public Types
+******************************************************************************/
+// Axes must be strictly increasing. values[y][x] is the value at xAxis[x],
+// yAxis[y]. Only change a table through the Table3D_Set functions, so a
+// lookup running at the same time never sees half an update.
+typedef struct{
+    float xAxis[TABLE3D_SIZE];
+    float yAxis[TABLE3D_SIZE];
+    float values[TABLE3D_SIZE][TABLE3D_SIZE];
+
+    // Odd while a writer is changing the table
+    volatile uint32_t sequence;
+
+    // Axis bins used by the last lookup, the next search starts from them
+    volatile uint32_t xBin;
+    volatile uint32_t yBin;
+}table3D_t;
+
+
+/******************************************************************************
+* Public Function Prototypes
+******************************************************************************/
+    /******************************************************************************
+    * float Table3D_Lookup(table3D_t * table, float x, float y)
+    * Interpolates a table at a point, clamped to the ends of its axes. A
+    * coordinate that is not a number reads the low end of its axis.
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    float Table3D_Lookup(table3D_t * table, float x, float y);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void Table3D_SetValue(table, xIndex, yIndex, value)
+    * Changes one cell of a table, must only be called from tasks
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void Table3D_SetValue(table3D_t * table, uint32_t xIndex, uint32_t yIndex, float value);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void Table3D_SetValues(table3D_t * table, const float * values)
+    * Replaces every cell of a table, row by row of y, from tasks only
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void Table3D_SetValues(table3D_t * table, const float * values);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * int32_t Table3D_SetAxes(table3D_t * table, const float * xAxis, const float * yAxis)
+    * Replaces both axes of a table, must only be called from tasks. Returns
+    * TABLE3D_BAD_AXIS, leaving the table as it was, unless both axes are
+    * strictly increasing.
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    int32_t Table3D_SetAxes(table3D_t * table, const float * xAxis, const float * yAxis);
+    /*****************************************************************************/
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+#endif // ifdef TABLE3D_H
@@ -10,11 +10,39 @@
 /******************************************************************************
 * Includes
 ******************************************************************************/
+#include <stdint.h>
 
 
 /******************************************************************************
 * Defines
 ******************************************************************************/
+// Clock into timer 2 in MHz (the core clock)
+#define TIME_TIMER_CLOCK_MHZ        170U
+
+// Resolution of the system time, in ticks per microsecond. Timer 2 counts at
+// TIME_TIMER_CLOCK_MHZ / TIME_TICKS_PER_US, so this must divide 170 evenly
+// (1, 2, 5, 10, 17, 34, 85 or 170). More ticks per microsecond shortens the
+// time it takes the 32 bit count to wrap, 71 minutes at 1 down to 25 seconds
+// at 170, and the reach of the 16 bit slave timers, 65.5mS down to 385uS.
+#ifndef TIME_TICKS_PER_US
+#define TIME_TICKS_PER_US           1U
+#endif
+
+#if (TIME_TIMER_CLOCK_MHZ % TIME_TICKS_PER_US) != 0
+#error "TIME_TICKS_PER_US must divide the timer clock evenly"
+#endif
+
+// Conversion between microseconds and ticks. Both work with integers or floats,
+// an integer conversion to microseconds rounds down.
+#define TIME_US_TO_TICKS(us)        ((us) * TIME_TICKS_PER_US)
+#define TIME_TICKS_TO_US(ticks)     ((ticks) / TIME_TICKS_PER_US)
+
+// Wrap safe compares of two Time_GetTicks times. The difference of two times
+// is taken as signed, so these hold as long as the times are less than half
+// the timer period apart, even across the 32 bit wrap.
+#define TIME_DIFF(a, b)             ((int32_t)((uint32_t)(a) - (uint32_t)(b)))
+#define TIME_BEFORE(a, b)           (TIME_DIFF(a, b) < 0)
+#define TIME_AFTER(a, b)            (TIME_DIFF(a, b) > 0)
 
 
 /******************************************************************************
@@ -28,11 +56,33 @@
     void Time_Timer2Init(void);
 
     /******************************************************************************
-    * int32_t Time_GetTimeuSeconds(void)
-    * Returns the current value for microseconds
-    * David Tolsma, 05/25/2020
+    * uint32_t Time_GetTicks(void)
+    * Returns the current time in ticks of 1 / TIME_TICKS_PER_US microseconds
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    uint32_t Time_GetTicks(void);
+
+    /******************************************************************************
+    * void Time_SyncSlaveTimers(void)
+    * Restarts timer 2 and the timers slaved to it so their counts line up.
+    * Only called once, from main after every slave timer is set up.
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void Time_SyncSlaveTimers(void);
+
+    /******************************************************************************
+    * uint64_t Time_Get64(void)
+    * Returns ticks since boot, this does not wrap
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    uint64_t Time_Get64(void);
+
+    /******************************************************************************
+    * void Time_Timer2UpdateFromISR(void)
+    * Counts timer 2 overflows, called from TIM2_IRQHandler on the update event
+    * David Tolsma, 10/17/2026
     ******************************************************************************/
-    uint32_t Time_GetTimeuSeconds(void);
+    void Time_Timer2UpdateFromISR(void);
 
 /******************************************************************************
 * Public Variables
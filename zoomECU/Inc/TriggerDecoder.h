@@ -12,11 +12,84 @@
 ******************************************************************************/
 #include "FreeRTOS.h"
 #include "event_groups.h"
+#include "TriggerPattern.h"
 
 
 /******************************************************************************
 * Defines
 ******************************************************************************/
+// Uncomment to timestamp the crank and cam edges with timer input capture
+// (crank on TIM5_CH4, cam on TIM3_CH4) instead of the EXTI interrupts. The
+// timestamps are latched in hardware and moved to a ring by DMA, so interrupt
+// latency no longer shows up as angle error.
+//#define TRIGGER_INPUT_CAPTURE
+
+// Uncomment to keep every edge the decoder is handed, with the sync state it
+// left, in a ring for TriggerDecoder_GetToothLog. The ring stops itself
+// TRIGGER_TOOTH_LOG_AFTER_LOSS edges after sync is lost, so the edges that
+// lost it are still there to be read out. Stalls do not stop it, a stopped
+// engine is not a fault.
+//#define TRIGGER_TOOTH_LOG
+
+// Edges kept, must be a power of 2. Each takes 8 bytes.
+#define TRIGGER_TOOTH_LOG_SIZE          1024U
+
+// Edges logged after sync is lost, enough to see the decoder find it again
+#define TRIGGER_TOOTH_LOG_AFTER_LOSS    64U
+
+// triggerToothLogEntry_t edge bits
+#define TRIG_LOG_EVENT_MASK     0x03U           // triggerEventID_t of the edge
+#define TRIG_LOG_PRIMARY_HIGH   (0x1U << 2)     // Trigger levels with the edge
+#define TRIG_LOG_SECONDARY_HIGH (0x1U << 3)
+#define TRIG_LOG_SYNC           (0x1U << 4)     // Decoder had sync after the edge
+#define TRIG_LOG_OVERFLOW       (0x1U << 5)     // Edges were dropped from the event ring before this one
+
+// Bits set in triggerDecoderEventGroup
+#define TRIG_EVT_SYNC_GAINED    (0x1UL << 0)
+#define TRIG_EVT_SYNC_LOST      (0x1UL << 1)
+#define TRIG_EVT_TOOTH          (0x1UL << 2)
+#define TRIG_EVT_RPM_ABOVE      (0x1UL << 3)
+#define TRIG_EVT_RPM_BELOW      (0x1UL << 4)
+
+// Tooth of interest that is never seen, so TRIG_EVT_TOOTH is not raised
+#define TRIG_NO_TOOTH           0xFFFFFFFFUL
+
+
+/******************************************************************************
+* Public Types
+******************************************************************************/
+// How the current angle is extrapolated from the most recent primary event
+typedef enum{
+    TRIGGER_PREDICT_LINEAR,         // Average speed over the last 4 primary events
+    TRIGGER_PREDICT_SECOND_ORDER    // Speed and acceleration over the last 2 tooth periods,
+                                    // scaled by a correction learned for each tooth
+}triggerPrediction_t;
+
+// Called on every primary event while sync is trusted, with the time of the
+// event and the speed over the tooth that just ended. Runs from the trigger
+// ISRs or from the decoder task with interrupts masked, so it must be short.
+typedef void (*triggerToothCallback_t)(uint32_t primaryEventNumber, uint32_t timeStamp, float usPerDegree);
+
+// Angle, speed and sync state of the engine, all taken from the same primary
+// event so they are consistent with each other.
+typedef struct{
+    uint32_t hasSync;
+    uint32_t syncConfidence;
+    uint32_t timeStamp;         // Time (Time_GetTicks) that currentAngle is estimated for
+    float currentAngle;         // -1 if sync is not trusted yet
+    float rpm;                  // 0 if sync is not trusted yet
+    float usPerDegree;          // -1 if sync is not trusted yet
+    float degreePerUs;          // -1 if sync is not trusted yet
+    int32_t isCranking;
+}triggerSnapshot_t;
+
+// One edge in the tooth log
+typedef struct{
+    uint32_t timeStamp;
+    uint8_t edge;                   // TRIG_LOG_* bits
+    uint8_t primaryEventNumber;     // Where the decoder put the engine after the edge
+    uint16_t syncConfidence;        // Capped at 65535
+}triggerToothLogEntry_t;
 
 
 /******************************************************************************
@@ -39,6 +112,74 @@
     void TriggerDecoder_Task(void * pvParameters);
     /*****************************************************************************/
 
+    /******************************************************************************
+    * void TriggerDecoder_SetPattern(const triggerPattern_t * pattern)
+    * Selects the trigger wheel pattern to decode (triggerPatternStock by default)
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void TriggerDecoder_SetPattern(const triggerPattern_t * pattern);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void TriggerDecoder_SetToothOfInterest(uint32_t primaryEventNumber)
+    * Selects the primary event that raises TRIG_EVT_TOOTH while in sync, or
+    * TRIG_NO_TOOTH (the default) for none
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void TriggerDecoder_SetToothOfInterest(uint32_t primaryEventNumber);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void TriggerDecoder_SetRpmThresholds(float low, float high)
+    * Raises TRIG_EVT_RPM_ABOVE / TRIG_EVT_RPM_BELOW as the rpm crosses them
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void TriggerDecoder_SetRpmThresholds(float low, float high);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * uint32_t TriggerDecoder_AddToothCallback(triggerToothCallback_t callback)
+    * Registers a function to be called on every primary event while in sync
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    uint32_t TriggerDecoder_AddToothCallback(triggerToothCallback_t callback);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * uint32_t TriggerDecoder_GetReferenceTooth(float angle, float * offset)
+    * Returns the last primary event at or before an engine angle, and the angle
+    * from that event to the requested angle
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    uint32_t TriggerDecoder_GetReferenceTooth(float angle, float * offset);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * float TriggerDecoder_GetToothAngle(uint32_t primaryEventNumber)
+    * Returns the engine angle of a primary event in the 720 degree cycle, event
+    * numbers past the last wrap round to the first
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    float TriggerDecoder_GetToothAngle(uint32_t primaryEventNumber);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void TriggerDecoder_SetPredictionMode(triggerPrediction_t mode)
+    * Selects how the current angle is extrapolated (linear by default)
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void TriggerDecoder_SetPredictionMode(triggerPrediction_t mode);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * void TriggerDecoder_GetSnapshot(triggerSnapshot_t * snapshot)
+    * Fills in the angle, speed and sync state of the engine in one call. Never
+    * blocks, so it is safe to use from any task.
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void TriggerDecoder_GetSnapshot(triggerSnapshot_t * snapshot);
+    /*****************************************************************************/
+
     /******************************************************************************
     * float TriggerDecoder_GetRPM(void)
     * Returns the current rpm estimate
@@ -95,8 +236,45 @@
     int32_t TriggerDecoder_GetSyncConfidece(void);
     /*****************************************************************************/
 
+    /******************************************************************************
+    * uint32_t TriggerDecoder_GetEventOverflows(void)
+    * Returns the number of edges dropped because the decoder task fell behind
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    uint32_t TriggerDecoder_GetEventOverflows(void);
+    /*****************************************************************************/
+
+#ifdef TRIGGER_TOOTH_LOG
+    /******************************************************************************
+    * void TriggerDecoder_ToothLogArm(void)
+    * Empties the tooth log and starts it logging again
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    void TriggerDecoder_ToothLogArm(void);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * uint32_t TriggerDecoder_ToothLogIsFrozen(void)
+    * Returns 1 once the tooth log has stopped after a sync loss (or a read)
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    uint32_t TriggerDecoder_ToothLogIsFrozen(void);
+    /*****************************************************************************/
+
+    /******************************************************************************
+    * uint32_t TriggerDecoder_GetToothLog(triggerToothLogEntry_t * entries, uint32_t maxEntries)
+    * Stops the tooth log if it is still running, then copies up to maxEntries
+    * of the newest edges, oldest first. Returns how many were copied.
+    * David Tolsma, 10/17/2026
+    ******************************************************************************/
+    uint32_t TriggerDecoder_GetToothLog(triggerToothLogEntry_t * entries, uint32_t maxEntries);
+    /*****************************************************************************/
+#endif
+
 /******************************************************************************
 * Public Variables
 ******************************************************************************/
+// Sync gained/lost and tooth of interest events are published here, see TRIG_EVT_*
+extern EventGroupHandle_t triggerDecoderEventGroup;
 
 #endif // ifdef TRIGGERDECODER_H
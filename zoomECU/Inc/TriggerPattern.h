@@ -0,0 +1,98 @@
+/******************************************************************************
+* File:                    TriggerPattern.h
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Trigger wheel pattern descriptors for the decoder
+******************************************************************************/
+#ifndef TRIGGERPATTERN_H
+#define TRIGGERPATTERN_H
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <stdint.h>
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+// Expected level of the other trigger when an edge is seen. An edge is valid
+// if the measured level is one of the bits set in its flags.
+#define TRIG_EXPECT_HIGH    (0x1U << 0)
+#define TRIG_EXPECT_LOW     (0x1U << 1)
+#define TRIG_EXPECT_ANY     (TRIG_EXPECT_HIGH | TRIG_EXPECT_LOW)
+
+// Set on a primary event that directly follows the missing tooth gap.
+#define TRIG_GAP_BEFORE     (0x1U << 2)
+
+// Which edges of a trigger input are counted as events by a pattern.
+#define TRIG_EDGE_RISE      (0x1U << 0)
+#define TRIG_EDGE_FALL      (0x1U << 1)
+#define TRIG_EDGE_BOTH      (TRIG_EDGE_RISE | TRIG_EDGE_FALL)
+
+/******************************************************************************
+* Public Types
+******************************************************************************/
+typedef enum{
+    PRIMARY_RISE,
+    PRIMARY_FALL,
+    SECONDARY_RISE,
+    SECONDARY_FALL,
+}triggerEventID_t;
+
+typedef enum{
+    PRIMARY_HIGH,
+    PRIMARY_LOW,
+    SECONDARY_HIGH,
+    SECONDARY_LOW
+}triggerValue_t;
+
+// A sync rule describes an edge at which the decoder can tell exactly where in
+// the 720* cycle it is. When the edge, the level of the other trigger and the
+// gap condition all match, the event numbers below are loaded. While in sync
+// the same rule is used as a cross check.
+typedef struct{
+    triggerEventID_t eventID;           // Edge that can establish sync
+    uint8_t otherLevel;                 // TRIG_EXPECT_* level of the other trigger
+    uint8_t requiresGap;                // Rule only applies directly after the gap
+    uint8_t primaryEventNumber;         // Primary event number loaded on sync
+    uint8_t secondaryEventNumber;       // Secondary event number loaded on sync
+}triggerSyncRule_t;
+
+// Describes one trigger wheel setup (crank + cam) over a full 720* cycle.
+// Event numbers index the angle and flag tables, which are walked by the
+// decoder with no pattern specific code.
+typedef struct{
+    const char * name;
+
+    uint32_t primaryEventCount;         // Counted primary edges per 720*
+    uint32_t secondaryEventCount;       // Counted secondary edges per 720*
+    uint32_t primaryEdges;              // TRIG_EDGE_* counted on the primary
+    uint32_t secondaryEdges;            // TRIG_EDGE_* counted on the secondary
+
+    const float * primaryEventAngles;   // Crank angle of each primary event
+    const float * secondaryEventAngles; // Crank angle of each secondary event
+    const uint8_t * primaryEventFlags;  // Expected secondary level (+ gap) per primary event
+    const uint8_t * secondaryEventFlags;// Expected primary level per secondary event
+
+    const triggerSyncRule_t * syncRules;
+    uint32_t syncRuleCount;
+
+    // A primary period longer than gapRatio times the previous period is
+    // treated as the missing tooth gap. Zero disables gap detection.
+    float gapRatio;
+
+    // High tooth count wheels are decoded edge by edge inside the trigger ISRs,
+    // so that only sync changes and the tooth of interest wake a task.
+    uint32_t decodeInIsr;
+}triggerPattern_t;
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+// Built in patterns
+extern const triggerPattern_t triggerPatternStock;  // 4 tooth crank, 2 tooth cam, both edges
+extern const triggerPattern_t triggerPattern36_1;   // 36-1 crank, half moon cam
+extern const triggerPattern_t triggerPattern60_2;   // 60-2 crank, half moon cam
+extern const triggerPattern_t triggerPattern24_1;   // 24 tooth crank, single tooth cam
+
+#endif // ifdef TRIGGERPATTERN_H
@@ -0,0 +1,118 @@
+/******************************************************************************
+* File:                    Calibration.c
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Conversion of raw sensor readings to engineering
+*                          units. The tables are generated ahead of time with
+*                          Tools/generateCalibration.py, so a conversion is a
+*                          shift, two loads and a multiply instead of a log()
+*                          or a search.
+*******************************************************************************
+* Includes
+******************************************************************************/
+#include "Calibration.h"
+#include "Sensors.h"
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+#define CALIBRATION_FRACTION_MASK   ((1U << CALIBRATION_SHIFT) - 1U)
+#define CALIBRATION_ROUNDING        (1 << (CALIBRATION_SHIFT - 1U))
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+/******************************************************************************
+* Private Function Prototypes (static)
+******************************************************************************/
+
+
+/******************************************************************************
+* Private Variables (static)
+******************************************************************************/
+// Table of each sensor, in sensor_t order
+static const int16_t * const calibrationTables[SENSOR_COUNT] = {
+    calibrationTableMAP,
+    calibrationTableAFM,
+    calibrationTableTPS,
+    calibrationTableO2,
+    calibrationTableIAT,
+    calibrationTableCTS,
+    calibrationTableBAT,
+};
+
+// Limits of each sensor, in sensor_t order
+static const calibrationLimits_t * const calibrationLimits[SENSOR_COUNT] = {
+    &calibrationLimitsMAP,
+    &calibrationLimitsAFM,
+    &calibrationLimitsTPS,
+    &calibrationLimitsO2,
+    &calibrationLimitsIAT,
+    &calibrationLimitsCTS,
+    &calibrationLimitsBAT,
+};
+
+
+/******************************************************************************
+* Function Code
+******************************************************************************/
+
+
+/******************************************************************************
+* int32_t Calibration_Lookup(const int16_t * table, uint16_t raw)
+* The table points are evenly spaced over the raw range, so the upper bits of
+* the reading pick the two points either side and the lower bits are the
+* fraction between them. No branches, and the raw range can not leave the
+* table as it carries one point past the last full step.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+int32_t Calibration_Lookup(const int16_t * table, uint16_t raw){
+    uint32_t index = (uint32_t) raw >> CALIBRATION_SHIFT;
+    int32_t fraction = (int32_t)((uint32_t) raw & CALIBRATION_FRACTION_MASK);
+    int32_t low = table[index];
+    int32_t high = table[index + 1];
+
+    return low + ((((high - low) * fraction) + CALIBRATION_ROUNDING) >> CALIBRATION_SHIFT);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* int32_t Calibration_Convert(sensor_t sensor, uint16_t raw)
+* Converts a raw reading of a sensor to the units listed in Calibration.h,
+* clamped to the sensor's limits
+* David Tolsma, 10/17/2026
+******************************************************************************/
+int32_t Calibration_Convert(sensor_t sensor, uint16_t raw){
+    int32_t value;
+
+    if(sensor >= SENSOR_COUNT){
+        return 0;
+    }
+
+    value = Calibration_Lookup(calibrationTables[sensor], raw);
+    if(value < calibrationLimits[sensor]->low){
+        value = calibrationLimits[sensor]->low;
+    }
+    else if(value > calibrationLimits[sensor]->high){
+        value = calibrationLimits[sensor]->high;
+    }
+    return value;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* int32_t Calibration_Read(sensor_t sensor)
+* Returns the latest reading of a sensor in the units listed in Calibration.h
+* David Tolsma, 10/17/2026
+******************************************************************************/
+int32_t Calibration_Read(sensor_t sensor){
+    return Calibration_Convert(sensor, Sensors_GetRaw(sensor));
+}
+/*****************************************************************************/
@@ -0,0 +1,125 @@
+/******************************************************************************
+* File:                    CalibrationTables.c
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Raw ADC to engineering unit tables. Generated by
+*                          Tools/generateCalibration.py, do not edit.
+*******************************************************************************
+* Includes
+******************************************************************************/
+#include "Calibration.h"
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+// MAP: 0.1 kPa, MPX4250AP through a 5V to 3.3V divider, linear. Worst interpolation error 0.96 at 1955.
+const int16_t calibrationTableMAP[CALIBRATION_TABLE_SIZE] = {
+    100, 120, 139, 159, 178, 198, 217, 237, 256, 276, 295, 315,
+    334, 354, 373, 393, 413, 432, 452, 471, 491, 510, 530, 549,
+    569, 588, 608, 627, 647, 666, 686, 705, 725, 745, 764, 784,
+    803, 823, 842, 862, 881, 901, 920, 940, 959, 979, 998, 1018,
+    1038, 1057, 1077, 1096, 1116, 1135, 1155, 1174, 1194, 1213, 1233, 1252,
+    1272, 1291, 1311, 1330, 1350, 1370, 1389, 1409, 1428, 1448, 1467, 1487,
+    1506, 1526, 1545, 1565, 1584, 1604, 1623, 1643, 1663, 1682, 1702, 1721,
+    1741, 1760, 1780, 1799, 1819, 1838, 1858, 1877, 1897, 1916, 1936, 1955,
+    1975, 1995, 2014, 2034, 2053, 2073, 2092, 2112, 2131, 2151, 2170, 2190,
+    2209, 2229, 2248, 2268, 2288, 2307, 2327, 2346, 2366, 2385, 2405, 2424,
+    2444, 2463, 2483, 2502, 2522, 2541, 2561, 2581, 2600,
+};
+const calibrationLimits_t calibrationLimitsMAP = {0, 3000};
+
+// AFM: mV at the pin, linear. Worst interpolation error 0.96 at 1833.
+const int16_t calibrationTableAFM[CALIBRATION_TABLE_SIZE] = {
+    0, 26, 52, 77, 103, 129, 155, 180, 206, 232, 258, 284,
+    309, 335, 361, 387, 413, 438, 464, 490, 516, 541, 567, 593,
+    619, 645, 670, 696, 722, 748, 773, 799, 825, 851, 877, 902,
+    928, 954, 980, 1005, 1031, 1057, 1083, 1109, 1134, 1160, 1186, 1212,
+    1238, 1263, 1289, 1315, 1341, 1366, 1392, 1418, 1444, 1470, 1495, 1521,
+    1547, 1573, 1598, 1624, 1650, 1676, 1702, 1727, 1753, 1779, 1805, 1830,
+    1856, 1882, 1908, 1934, 1959, 1985, 2011, 2037, 2063, 2088, 2114, 2140,
+    2166, 2191, 2217, 2243, 2269, 2295, 2320, 2346, 2372, 2398, 2423, 2449,
+    2475, 2501, 2527, 2552, 2578, 2604, 2630, 2656, 2681, 2707, 2733, 2759,
+    2784, 2810, 2836, 2862, 2888, 2913, 2939, 2965, 2991, 3016, 3042, 3068,
+    3094, 3120, 3145, 3171, 3197, 3223, 3248, 3274, 3300,
+};
+const calibrationLimits_t calibrationLimitsAFM = {0, 3300};
+
+// TPS: 0.1 % open, linear. Worst interpolation error 0.97 at 48.
+const int16_t calibrationTableTPS[CALIBRATION_TABLE_SIZE] = {
+    -200, -190, -179, -169, -159, -148, -138, -128, -117, -107, -97, -87,
+    -76, -66, -56, -45, -35, -25, -14, -4, 6, 17, 27, 37,
+    48, 58, 68, 78, 89, 99, 109, 120, 130, 140, 151, 161,
+    171, 182, 192, 202, 213, 223, 233, 243, 254, 264, 274, 285,
+    295, 305, 316, 326, 336, 347, 357, 367, 378, 388, 398, 408,
+    419, 429, 439, 450, 460, 470, 481, 491, 501, 512, 522, 532,
+    543, 553, 563, 573, 584, 594, 604, 615, 625, 635, 646, 656,
+    666, 677, 687, 697, 708, 718, 728, 738, 749, 759, 769, 780,
+    790, 800, 811, 821, 831, 842, 852, 862, 873, 883, 893, 903,
+    914, 924, 934, 945, 955, 965, 976, 986, 996, 1007, 1017, 1027,
+    1038, 1048, 1058, 1068, 1079, 1089, 1099, 1110, 1120,
+};
+const calibrationLimits_t calibrationLimitsTPS = {0, 1000};
+
+// O2: lambda x 1000, 0-5V wideband through a divider, linear. Worst interpolation error 0.96 at 723.
+const int16_t calibrationTableO2[CALIBRATION_TABLE_SIZE] = {
+    680, 685, 691, 696, 701, 707, 712, 717, 723, 728, 733, 738,
+    744, 749, 754, 760, 765, 770, 776, 781, 786, 792, 797, 802,
+    808, 813, 818, 823, 829, 834, 839, 845, 850, 855, 861, 866,
+    871, 877, 882, 887, 893, 898, 903, 908, 914, 919, 924, 930,
+    935, 940, 946, 951, 956, 962, 967, 972, 978, 983, 988, 993,
+    999, 1004, 1009, 1015, 1020, 1025, 1031, 1036, 1041, 1047, 1052, 1057,
+    1063, 1068, 1073, 1078, 1084, 1089, 1094, 1100, 1105, 1110, 1116, 1121,
+    1126, 1132, 1137, 1142, 1148, 1153, 1158, 1163, 1169, 1174, 1179, 1185,
+    1190, 1195, 1201, 1206, 1211, 1217, 1222, 1227, 1233, 1238, 1243, 1248,
+    1254, 1259, 1264, 1270, 1275, 1280, 1286, 1291, 1296, 1302, 1307, 1312,
+    1318, 1323, 1328, 1333, 1339, 1344, 1349, 1355, 1360,
+};
+const calibrationLimits_t calibrationLimitsO2 = {680, 1360};
+
+// IAT: 0.1 degrees C, Steinhart-Hart NTC, 2490 ohm pull up. Worst interpolation error 3.90 at 1378.
+const int16_t calibrationTableIAT[CALIBRATION_TABLE_SIZE] = {
+    1500, 1862, 1536, 1374, 1263, 1179, 1114, 1057, 1011, 970, 933, 901,
+    871, 844, 819, 796, 774, 754, 735, 717, 700, 683, 668, 653,
+    639, 625, 612, 599, 587, 575, 563, 552, 541, 530, 520, 510,
+    500, 490, 481, 471, 462, 453, 444, 436, 427, 419, 411, 402,
+    394, 386, 379, 371, 363, 356, 348, 341, 333, 326, 319, 311,
+    304, 297, 290, 283, 276, 269, 262, 255, 248, 241, 234, 227,
+    220, 213, 207, 200, 193, 186, 179, 172, 165, 158, 151, 144,
+    136, 129, 122, 115, 107, 100, 92, 85, 77, 69, 61, 53,
+    45, 37, 29, 20, 11, 2, -7, -16, -26, -35, -45, -56,
+    -67, -78, -89, -101, -114, -127, -140, -155, -170, -187, -204, -224,
+    -244, -267, -294, -324, -359, -404, -465, -562, -400,
+};
+const calibrationLimits_t calibrationLimitsIAT = {-400, 1500};
+
+// CTS: 0.1 degrees C, Steinhart-Hart NTC, 2490 ohm pull up. Worst interpolation error 3.90 at 1378.
+const int16_t calibrationTableCTS[CALIBRATION_TABLE_SIZE] = {
+    1500, 1862, 1536, 1374, 1263, 1179, 1114, 1057, 1011, 970, 933, 901,
+    871, 844, 819, 796, 774, 754, 735, 717, 700, 683, 668, 653,
+    639, 625, 612, 599, 587, 575, 563, 552, 541, 530, 520, 510,
+    500, 490, 481, 471, 462, 453, 444, 436, 427, 419, 411, 402,
+    394, 386, 379, 371, 363, 356, 348, 341, 333, 326, 319, 311,
+    304, 297, 290, 283, 276, 269, 262, 255, 248, 241, 234, 227,
+    220, 213, 207, 200, 193, 186, 179, 172, 165, 158, 151, 144,
+    136, 129, 122, 115, 107, 100, 92, 85, 77, 69, 61, 53,
+    45, 37, 29, 20, 11, 2, -7, -16, -26, -35, -45, -56,
+    -67, -78, -89, -101, -114, -127, -140, -155, -170, -187, -204, -224,
+    -244, -267, -294, -324, -359, -404, -465, -562, -400,
+};
+const calibrationLimits_t calibrationLimitsCTS = {-400, 1500};
+
+// BAT: mV, 6:1 divider, linear. Worst interpolation error 0.99 at 12219.
+const int16_t calibrationTableBAT[CALIBRATION_TABLE_SIZE] = {
+    0, 155, 309, 464, 619, 773, 928, 1083, 1238, 1392, 1547, 1702,
+    1856, 2011, 2166, 2320, 2475, 2630, 2784, 2939, 3094, 3248, 3403, 3558,
+    3713, 3867, 4022, 4177, 4331, 4486, 4641, 4795, 4950, 5105, 5259, 5414,
+    5569, 5724, 5878, 6033, 6188, 6342, 6497, 6652, 6806, 6961, 7116, 7270,
+    7425, 7580, 7734, 7889, 8044, 8199, 8353, 8508, 8663, 8817, 8972, 9127,
+    9281, 9436, 9591, 9745, 9900, 10055, 10210, 10364, 10519, 10674, 10828, 10983,
+    11138, 11292, 11447, 11602, 11756, 11911, 12066, 12220, 12375, 12530, 12685, 12839,
+    12994, 13149, 13303, 13458, 13613, 13767, 13922, 14077, 14231, 14386, 14541, 14696,
+    14850, 15005, 15160, 15314, 15469, 15624, 15778, 15933, 16088, 16242, 16397, 16552,
+    16707, 16861, 17016, 17171, 17325, 17480, 17635, 17789, 17944, 18099, 18253, 18408,
+    18563, 18717, 18872, 19027, 19182, 19336, 19491, 19646, 19800,
+};
+const calibrationLimits_t calibrationLimitsBAT = {0, 19800};
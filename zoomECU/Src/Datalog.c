@@ -0,0 +1,451 @@
+/******************************************************************************
+* File:                    Datalog.c
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Binary datalogger to the SD card, see Datalog.h.
+*
+* The sampler runs at priority 1, under the trigger, fuel and ignition tasks,
+* and only copies values the other modules already hold, so the cost to the
+* control tasks is the sample itself (DATALOG_MEASURE_CYCLES) plus the SPI
+* DMA interupt once per block. The flush task runs at the idle priority and
+* sleeps while each block is moved and while the card is busy.
+*
+* The two buffers are handed over with datalogFlushing: the sampler sets it
+* when it gives a full buffer to the flush task, the flush task clears it once
+* the buffer is on the card. The sampler is the higher priority so it is never
+* interupted by the flush task part way through a frame.
+*******************************************************************************
+* Includes
+******************************************************************************/
+#include "Datalog.h"
+#include "SdCard.h"
+#include "TriggerDecoder.h"
+#include "IgnitionControl.h"
+#include "Calibration.h"
+#include "Time.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "stm32g4xx.h"
+
+#include <string.h>
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+#define DATALOG_FRAMES_PER_BUFFER   (DATALOG_BLOCKS_PER_BUFFER * DATALOG_FRAMES_PER_BLOCK)
+
+// How often the flush task looks for a card
+#define DATALOG_DETECT_PERIOD_MS    500U
+
+// datalog_start found no room on the card for another log
+#define DATALOG_CARD_FULL           1
+
+_Static_assert((SDCARD_BLOCK_SIZE % sizeof(datalogFrame_t)) == 0, "Frames must fill a block exactly");
+_Static_assert(sizeof(datalogHeader_t) <= SDCARD_BLOCK_SIZE, "The header must fit in a block");
+_Static_assert(sizeof(datalogIndex_t) <= SDCARD_BLOCK_SIZE, "The index must fit in a block");
+
+#ifdef DATALOG_MEASURE_CYCLES
+#define DATALOG_CYCLES_START()      (cycleStart = DWT->CYCCNT)
+#define DATALOG_CYCLES_END()        do{ datalogStats.sampleCycles = DWT->CYCCNT - cycleStart;           \
+                                        if(datalogStats.sampleCycles > datalogStats.sampleCyclesMax){   \
+                                            datalogStats.sampleCyclesMax = datalogStats.sampleCycles;   \
+                                        }                                                               \
+                                    }while(0)
+#else
+#define DATALOG_CYCLES_START()
+#define DATALOG_CYCLES_END()
+#endif
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+TaskHandle_t DatalogSampleTaskHandle;
+TaskHandle_t DatalogFlushTaskHandle;
+
+
+/******************************************************************************
+* Private Function Prototypes (static)
+******************************************************************************/
+static void datalog_sampleTask(void * pvParameters);
+static void datalog_flushTask(void * pvParameters);
+static void datalog_sample(datalogFrame_t * frame);
+static int32_t datalog_start(void);
+static int32_t datalog_writeIndex(uint8_t * block, uint32_t nextBlock);
+static void datalog_stop(void);
+
+/******************************************************************************
+* Private Variables (static)
+******************************************************************************/
+static datalogFrame_t datalogBuffer[2][DATALOG_FRAMES_PER_BUFFER];
+
+// Buffer the sampler is filling and the next frame in it
+static uint32_t datalogFill;
+static uint32_t datalogIndex;
+
+// Set while the flush task owns the other buffer
+static volatile uint32_t datalogFlushing;
+
+// Set once the card is started, cleared if a write fails or the card fills
+static volatile uint32_t datalogLogging;
+
+// Next block to write and the end of the card
+static uint32_t datalogBlock;
+static uint32_t datalogEndBlock;
+
+// As last written to the card
+static datalogIndex_t datalogCardIndex;
+
+static uint16_t datalogSequence;
+
+static datalogStats_t datalogStats;
+
+/******************************************************************************
+* Function Code
+******************************************************************************/
+
+
+/******************************************************************************
+* void Datalog_Init(void)
+* Creates the sampler and flush tasks. Logging starts once a card is found.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void Datalog_Init(void){
+#ifdef DATALOG_MEASURE_CYCLES
+    // Start the DWT cycle counter
+    SET_BIT(CoreDebug->DEMCR, CoreDebug_DEMCR_TRCENA_Msk);
+    SET_BIT(DWT->CTRL, DWT_CTRL_CYCCNTENA_Msk);
+#endif
+
+    xTaskCreate(datalog_sampleTask,                 /* Function that implements the task. */
+                "datalogSample",                    /* Text name for the task. */
+                200,                                /* Stack size in words, not bytes. */
+                ( void * ) 0,                       /* Parameter passed into the task. */
+                1,                                  /* Priority at which the task is created. */
+                &DatalogSampleTaskHandle);          /* Used to pass out the created task's handle. */
+
+    xTaskCreate(datalog_flushTask,                  /* Function that implements the task. */
+                "datalogFlush",                     /* Text name for the task. */
+                200,                                /* Stack size in words, not bytes. */
+                ( void * ) 0,                       /* Parameter passed into the task. */
+                tskIDLE_PRIORITY,                   /* Priority at which the task is created. */
+                &DatalogFlushTaskHandle);           /* Used to pass out the created task's handle. */
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t Datalog_IsLogging(void)
+* Returns 1 while frames are being logged to a card
+* David Tolsma, 10/17/2026
+******************************************************************************/
+uint32_t Datalog_IsLogging(void){
+    return datalogLogging;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void Datalog_GetStats(datalogStats_t * stats)
+* Copies the logging and card write statistics
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void Datalog_GetStats(datalogStats_t * stats){
+    taskENTER_CRITICAL();
+    *stats = datalogStats;
+    taskEXIT_CRITICAL();
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void datalog_sampleTask(void * pvParameters)
+* Sleeps until the flush task starts a log, then takes a frame every
+* DATALOG_PERIOD_MS until logging stops. When the buffer fills it is handed
+* to the flush task and the other one is filled, unless the flush task still
+* has it, then frames are dropped until it is free.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void datalog_sampleTask(void * pvParameters){
+    TickType_t lastWake;
+#ifdef DATALOG_MEASURE_CYCLES
+    uint32_t cycleStart;
+#endif
+
+    while(1){
+        // No card or no log, nothing to wake for
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        lastWake = xTaskGetTickCount();
+
+        while(datalogLogging){
+            vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(DATALOG_PERIOD_MS));
+
+            if(!datalogLogging){
+                break;
+            }
+
+            DATALOG_CYCLES_START();
+
+            if(datalogIndex >= DATALOG_FRAMES_PER_BUFFER){
+                if(datalogFlushing){
+                    datalogStats.framesDropped++;
+                    continue;
+                }
+
+                datalogFlushing = 1;
+                datalogFill ^= 1;
+                datalogIndex = 0;
+                xTaskNotifyGive(DatalogFlushTaskHandle);
+            }
+
+            datalog_sample(&datalogBuffer[datalogFill][datalogIndex]);
+            datalogIndex++;
+            datalogStats.framesLogged++;
+
+            DATALOG_CYCLES_END();
+        }
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void datalog_flushTask(void * pvParameters)
+* Waits for a card, starts a log on it, then writes out each buffer the
+* sampler hands over, moving the index on ahead of the log as it goes. If a
+* write fails the card is started again from a new log, if the card fills
+* logging stops.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void datalog_flushTask(void * pvParameters){
+    const uint8_t * data;
+    uint32_t start;
+    uint32_t ticks;
+    int32_t result;
+
+    while(1){
+        while((result = datalog_start()) != SDCARD_OK){
+            if(result == DATALOG_CARD_FULL){
+                datalog_stop();
+            }
+            vTaskDelay(pdMS_TO_TICKS(DATALOG_DETECT_PERIOD_MS));
+        }
+
+        datalogLogging = 1;
+        xTaskNotifyGive(DatalogSampleTaskHandle);
+
+        while(datalogLogging){
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+            if(datalogBlock + DATALOG_BLOCKS_PER_BUFFER > datalogEndBlock){
+                datalog_stop();
+            }
+
+            data = (const uint8_t *) datalogBuffer[datalogFill ^ 1];
+
+            start = Time_GetTicks();
+            result = SdCard_WriteBlocks(datalogBlock, data, DATALOG_BLOCKS_PER_BUFFER);
+            ticks = Time_GetTicks() - start;
+
+            taskENTER_CRITICAL();
+            datalogStats.writes++;
+            datalogStats.writeTicksTotal += ticks;
+            if(ticks > datalogStats.writeTicksMax){
+                datalogStats.writeTicksMax = ticks;
+            }
+            if(result == SDCARD_OK){
+                datalogStats.blocksWritten += DATALOG_BLOCKS_PER_BUFFER;
+            }
+            else{
+                datalogStats.errors++;
+                datalogLogging = 0;
+            }
+            taskEXIT_CRITICAL();
+
+            datalogBlock += DATALOG_BLOCKS_PER_BUFFER;
+
+            // The index moves on before the next write could pass it. The buffer just
+            // written is free to build it in until datalogFlushing is cleared.
+            if(datalogLogging && ((datalogBlock + DATALOG_BLOCKS_PER_BUFFER) > datalogCardIndex.nextBlock) &&
+               (datalog_writeIndex((uint8_t *) datalogBuffer[datalogFill ^ 1], datalogBlock + DATALOG_INDEX_AHEAD_BLOCKS) != SDCARD_OK)){
+                taskENTER_CRITICAL();
+                datalogStats.errors++;
+                datalogLogging = 0;
+                taskEXIT_CRITICAL();
+            }
+
+            datalogFlushing = 0;
+        }
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void datalog_sample(datalogFrame_t * frame)
+* Fills in a frame from the current engine state
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void datalog_sample(datalogFrame_t * frame){
+    triggerSnapshot_t snapshot;
+    float dwell;
+
+    TriggerDecoder_GetSnapshot(&snapshot);
+
+    frame->time = Time_GetTicks();
+    frame->sequence = datalogSequence++;
+    frame->rpm = (uint16_t) snapshot.rpm;
+
+    if(snapshot.currentAngle >= 0){
+        frame->angle = (uint16_t)(snapshot.currentAngle * 10.0f);
+    }
+    else{
+        frame->angle = DATALOG_NO_ANGLE;
+    }
+
+    frame->advance = (int16_t)(IgnitionControl_GetAdvance() * 10.0f);
+
+    dwell = IgnitionControl_GetDwell();
+    frame->dwell = (dwell < 65535.0f) ? (uint16_t) dwell : 0xFFFFU;
+
+    frame->map = (int16_t) Calibration_Read(SENSOR_MAP);
+    frame->tps = (int16_t) Calibration_Read(SENSOR_TPS);
+    frame->o2 = (int16_t) Calibration_Read(SENSOR_O2);
+    frame->iat = (int16_t) Calibration_Read(SENSOR_IAT);
+    frame->cts = (int16_t) Calibration_Read(SENSOR_CTS);
+    frame->bat = (int16_t) Calibration_Read(SENSOR_BAT);
+    frame->afm = (int16_t) Calibration_Read(SENSOR_AFM);
+
+    frame->sync = (uint8_t) snapshot.hasSync;
+    frame->syncConfidence = (snapshot.syncConfidence < 255U) ? (uint8_t) snapshot.syncConfidence : 255U;
+    frame->dropped = (uint16_t) datalogStats.framesDropped;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* int32_t datalog_start(void)
+* Starts the card and writes the header of a new log where the index says the
+* last one ended, then points the index at it. A card without an index is
+* started from DATALOG_START_BLOCK. The sequence starts from the low bits of
+* the time, so frames left on the card from before do not carry on from this
+* log. Returns DATALOG_CARD_FULL if there is no room for another log. Only
+* called while the sampler is not logging.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static int32_t datalog_start(void){
+    // The second buffer is free until the first one fills
+    uint8_t * block = (uint8_t *) datalogBuffer[1];
+    datalogHeader_t * header;
+    uint32_t headerBlock;
+    int32_t result;
+
+    result = SdCard_Init();
+    if(result != SDCARD_OK){
+        return result;
+    }
+
+    datalogEndBlock = SdCard_GetBlockCount();
+    datalogSequence = (uint16_t) Time_GetTicks();
+
+    result = SdCard_ReadBlock(DATALOG_INDEX_BLOCK, block);
+    if(result != SDCARD_OK){
+        return result;
+    }
+
+    memcpy(&datalogCardIndex, block, sizeof(datalogCardIndex));
+    if((memcmp(datalogCardIndex.magic, DATALOG_INDEX_MAGIC, sizeof(DATALOG_INDEX_MAGIC)) != 0) ||
+       (datalogCardIndex.version != DATALOG_VERSION) ||
+       (datalogCardIndex.nextBlock < DATALOG_START_BLOCK) || (datalogCardIndex.nextBlock > datalogEndBlock)){
+        memset(&datalogCardIndex, 0, sizeof(datalogCardIndex));
+        memcpy(datalogCardIndex.magic, DATALOG_INDEX_MAGIC, sizeof(DATALOG_INDEX_MAGIC));
+        datalogCardIndex.version = DATALOG_VERSION;
+        datalogCardIndex.nextBlock = DATALOG_START_BLOCK;
+    }
+
+    // Room for the header and one buffer
+    headerBlock = datalogCardIndex.nextBlock;
+    if((headerBlock + 1U + DATALOG_BLOCKS_PER_BUFFER) > datalogEndBlock){
+        return DATALOG_CARD_FULL;
+    }
+
+    memset(block, 0, SDCARD_BLOCK_SIZE);
+    header = (datalogHeader_t *) block;
+    memcpy(header->magic, DATALOG_MAGIC, sizeof(DATALOG_MAGIC));
+    header->version = DATALOG_VERSION;
+    header->frameSize = sizeof(datalogFrame_t);
+    header->framesPerBlock = DATALOG_FRAMES_PER_BLOCK;
+    header->periodMs = DATALOG_PERIOD_MS;
+    header->ticksPerUs = TIME_TICKS_PER_US;
+    header->firstSequence = datalogSequence;
+    header->session = datalogCardIndex.sessions + 1U;
+    header->previousBlock = datalogCardIndex.lastBlock;
+
+    result = SdCard_WriteBlocks(headerBlock, block, 1);
+    if(result != SDCARD_OK){
+        return result;
+    }
+
+    // The index points at this log before any of its frames are written. Until
+    // it does, the next start writes over this header.
+    datalogCardIndex.sessions++;
+    datalogCardIndex.lastBlock = headerBlock;
+    result = datalog_writeIndex(block, headerBlock + 1U + DATALOG_INDEX_AHEAD_BLOCKS);
+    if(result != SDCARD_OK){
+        return result;
+    }
+
+    // A buffer handed over before a failed write is not written to the new log
+    ulTaskNotifyTake(pdTRUE, 0);
+
+    datalogBlock = headerBlock + 1U;
+    datalogFill = 0;
+    datalogIndex = 0;
+    datalogFlushing = 0;
+    datalogStats.session = datalogCardIndex.sessions;
+
+    return SDCARD_OK;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* int32_t datalog_writeIndex(uint8_t * block, uint32_t nextBlock)
+* Moves the index on to nextBlock, or the end of the card if that is nearer,
+* and writes it out. block is a free buffer to build it in.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static int32_t datalog_writeIndex(uint8_t * block, uint32_t nextBlock){
+    datalogCardIndex.nextBlock = (nextBlock < datalogEndBlock) ? nextBlock : datalogEndBlock;
+
+    memset(block, 0, SDCARD_BLOCK_SIZE);
+    memcpy(block, &datalogCardIndex, sizeof(datalogCardIndex));
+
+    return SdCard_WriteBlocks(DATALOG_INDEX_BLOCK, block, 1);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void datalog_stop(void)
+* Stops logging for good once the card is full. The logs stay as they are
+* until the index is cleared.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void datalog_stop(void){
+    datalogLogging = 0;
+    while(1){
+        vTaskDelay(portMAX_DELAY);
+    }
+}
+/*****************************************************************************/
@@ -8,18 +8,23 @@
 ******************************************************************************/
 #include "TriggerDecoder.h"
 #include "IgnitionControl.h"
+#include "EngineController.h"
+#include "Sensors.h"
 
 #include "FreeRTOS.h"
 #include "task.h"
 #include "timers.h"
 #include "semphr.h"
 #include "queue.h"
+#include "event_groups.h"
 
 #include <stdio.h>
 
 /******************************************************************************
 * Defines
 ******************************************************************************/
+// Decoder events the engine controller is woken by
+#define ENGINE_EVENTS   (TRIG_EVT_SYNC_GAINED | TRIG_EVT_SYNC_LOST | TRIG_EVT_RPM_ABOVE | TRIG_EVT_RPM_BELOW)
 
 
 /******************************************************************************
@@ -43,9 +48,9 @@ typedef enum{
 * Private Function Prototypes (static)
 ******************************************************************************/
 void EngineController_task(void * pvParameters);
-engineState_t EngineController_Off(void);
-engineState_t EngineController_Cranking(void);
-engineState_t EngineController_Running(void);
+engineState_t EngineController_Off(uint32_t events);
+engineState_t EngineController_Cranking(uint32_t events);
+engineState_t EngineController_Running(uint32_t events);
 
 
 /******************************************************************************
@@ -84,36 +89,48 @@ void EngineController_task(void * pvParameters){
     // This entire engine controller task implements a state machine indicating
     // the state of the engine. The states can be OFF, CRANKING, RUNNING.
 
-    // When we are in the OFF state, we repeatedly check to see if the engine is
-    // cranking. If if it is, we change states to CRANKING.
+    // The task only runs when the trigger decoder raises an event, so it uses
+    // no CPU at all while the engine is stopped.
 
-    // In CRANKING, we schedule ignition events using a fixed ignition angle and
-    // check RPM unill we reach a RUNNING threashold in which case we change to 
-    // RUNNING state. If the RPMs drop below a threshold, we transition to OFF.
+    // In OFF, we wait for the decoder to gain sync on a turning engine and then
+    // start ignition and change to CRANKING.
 
-    // In RUNNING, we check schedule ignition events not on a fixed ignition 
-    // angle. We check to see if the RPMs drop below a threshold in which case
-    // we transition to off. 
+    // In CRANKING, the rpm rising above ENGINE_RUNNING_RPM changes to RUNNING.
+    // In RUNNING, the rpm falling ENGINE_RUNNING_HYSTERESIS below that goes back
+    // to CRANKING. Ignition picks its cranking or running settings from the rpm.
 
-    // This task is implemented as a never ending loop. We do not need the idle 
-    // task as we do not need to delete any tasks in the program and therefore
-    // do not need it to clean up any memory.
+    // In any state, losing sync (including the decoder seeing the engine stall)
+    // stops ignition and changes to OFF. The crank angle MAP readings are
+    // dropped with it, even if sync was gained and lost again before we woke.
 
     engineState_t engineState = OFF;
+    uint32_t events;
+
+    TriggerDecoder_SetRpmThresholds(ENGINE_RUNNING_RPM - ENGINE_RUNNING_HYSTERESIS, ENGINE_RUNNING_RPM);
 
     while(1){
 
+        events = xEventGroupWaitBits(triggerDecoderEventGroup,
+                                     ENGINE_EVENTS,     // Bits to wait for
+                                     pdTRUE,            // Clear bits on exit
+                                     pdFALSE,           // Wake on any bit
+                                     portMAX_DELAY);
+
+        if((events & TRIG_EVT_SYNC_LOST) && !TriggerDecoder_GetSyncStatus()){
+            Sensors_ResetMap();
+        }
+
         switch(engineState){
             case OFF:{
-                engineState = EngineController_Off();
+                engineState = EngineController_Off(events);
                 break;
             }
             case CRANKING:{
-                engineState = EngineController_Cranking();
+                engineState = EngineController_Cranking(events);
                 break;
             }
             case RUNNING:{
-                engineState = EngineController_Running();
+                engineState = EngineController_Running(events);
                 break;
             }
             default: {while(1);}
@@ -125,16 +142,20 @@ void EngineController_task(void * pvParameters){
 
 
 /******************************************************************************
-* engineState_t EngineController_Off(void)
+* engineState_t EngineController_Off(uint32_t events)
 * This handles OFF state logic.
-* David Tolsma, 05/25/2020
+* David Tolsma, 10/17/2026
 ******************************************************************************/
-engineState_t EngineController_Off(void){
+engineState_t EngineController_Off(uint32_t events){
     // This ensures that the state does not change unless intentially changed below
     engineState_t nextState = OFF;
 
-    if(TriggerDecoder_IsCranking()) {nextState = CRANKING;}
-    
+    // Sync can be gained and lost again before we see the events, so check it is still held
+    if((events & TRIG_EVT_SYNC_GAINED) && TriggerDecoder_GetSyncStatus()){
+        IgnitionControl_Start();
+        nextState = (events & TRIG_EVT_RPM_ABOVE) ? RUNNING : CRANKING;
+    }
+
     return nextState;
 }
 /*****************************************************************************/
@@ -142,45 +163,21 @@ engineState_t EngineController_Off(void){
 
 
 /******************************************************************************
-* engineState_t EngineController_Cranking(void)
+* engineState_t EngineController_Cranking(uint32_t events)
 * This handles CRANKING state logic.
-* David Tolsma, 05/25/2020
+* David Tolsma, 10/17/2026
 ******************************************************************************/
-engineState_t EngineController_Cranking(void){
+engineState_t EngineController_Cranking(uint32_t events){
     // This ensures that the state does not change unless intentially changed below
     engineState_t nextState = CRANKING;
-    int32_t tempRPM;
-    int32_t ignScheduleFinished;
-
-    // Since no ignition schedules have been set, we cannot pend of the ignition schedule
-    // finished event group. We need to manually trigger the first schedule when transitioning
-    // from OFF state to CRANKING state. 
-
-    xTaskNotify(IgnitionControlEventCreationTaskHandle,
-                IGN_SCH_1 | IGN_SCH_2 | IGN_SCH_3 | IGN_SCH_4,
-                eSetBits);
-
-    tempRPM = TriggerDecoder_GetRPM();
-
-    while(tempRPM > 50 & tempRPM < 500){
-
-    	ignScheduleFinished = xEventGroupWaitBits(
-			ignitionScheduleFinishedEventGroup,
-			IGN_SCH_1 | IGN_SCH_2 | IGN_SCH_3 | IGN_SCH_4,  // Bits to wait for
-			pdTRUE,     									// Clear bits on exit
-			pdFALSE,    									// Delay on all bits
-			portMAX_DELAY);
 
-        xTaskNotify(IgnitionControlEventCreationTaskHandle,
-                    (ignScheduleFinished | 0x1111),
-                    eSetBits);
-
-        tempRPM = TriggerDecoder_GetRPM();
+    if((events & TRIG_EVT_SYNC_LOST) && !TriggerDecoder_GetSyncStatus()){
+        IgnitionControl_Stop();
+        nextState = OFF;
+    }
+    else if(events & TRIG_EVT_RPM_ABOVE){
+        nextState = RUNNING;
     }
-
-    // Check what state to change to.
-    if(tempRPM > 500) {nextState = RUNNING;}
-    else if (tempRPM < 50) {nextState = OFF;}
 
     return nextState;
 }
@@ -189,38 +186,22 @@ engineState_t EngineController_Cranking(void){
 
 
 /******************************************************************************
-* engineState_t EngineController_Running(void)
+* engineState_t EngineController_Running(uint32_t events)
 * This handles RUNNING state logic.
-* David Tolsma, 05/25/2020
+* David Tolsma, 10/17/2026
 ******************************************************************************/
-engineState_t EngineController_Running(void){
+engineState_t EngineController_Running(uint32_t events){
     // This ensures that the state does not change unless intentially changed below
     engineState_t nextState = RUNNING;
-    static int32_t tempRPM;
-    int32_t ignScheduleFinished;
-
-    tempRPM = TriggerDecoder_GetRPM();
-
-    while(tempRPM > 50){
-
-    	ignScheduleFinished = xEventGroupWaitBits(
-			ignitionScheduleFinishedEventGroup,
-			IGN_SCH_1 | IGN_SCH_2 | IGN_SCH_3 | IGN_SCH_4,  // Bits to wait for
-			pdTRUE,     									// Clear bits on exit
-			pdFALSE,    									// Delay on all bits
-			portMAX_DELAY);
-
-        xTaskNotify(IgnitionControlEventCreationTaskHandle,
-                    (ignScheduleFinished | 0x1111),
-                    eSetBits);
-
-        tempRPM = TriggerDecoder_GetRPM();
 
+    if((events & TRIG_EVT_SYNC_LOST) && !TriggerDecoder_GetSyncStatus()){
+        IgnitionControl_Stop();
+        nextState = OFF;
+    }
+    else if(events & TRIG_EVT_RPM_BELOW){
+        nextState = CRANKING;
     }
-    
-
-    if(tempRPM < 50) {nextState = OFF;}
 
     return nextState;
 }
-/*****************************************************************************/
\ No newline at end of file
+/*****************************************************************************/
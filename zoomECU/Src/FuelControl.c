@@ -0,0 +1,501 @@
+/******************************************************************************
+* File:                    FuelControl.c
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Sequential fuel injection on the LSD outputs. Once
+*                          per engine cycle the fuel task works out the pulse
+*                          width from the VE table and MAP, corrects it for
+*                          wall wetting and acceleration, and adds the
+*                          injector dead time. Each injector is then timed
+*                          from a tooth so its pulse ends at a set angle
+*                          before TDC, and the open and close are queued on
+*                          the TIM8 scheduler.
+*******************************************************************************
+* Includes
+******************************************************************************/
+#include "FuelControl.h"
+#include "Scheduler.h"
+#include "TriggerDecoder.h"
+#include "Calibration.h"
+#include "Time.h"
+#include "Gpio.h"
+#include "PinoutConfiguration.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "stm32g4xx.h"
+
+#include <math.h>
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+// Crank angle each pulse must fit in, ending at the end of injection angle.
+// Pulses longer than this are cut short, so an injector is held open for at
+// most half of each cycle.
+#define FUEL_INJECTION_WINDOW       360.0f
+
+// The close is timed from a tooth near the end of the window. Crank angle
+// past the end, seen from the window start, at which the injector is closed
+// anyway, so it is never left open if sync is lost before the close tooth.
+#define FUEL_CLOSE_BACKSTOP         90.0f
+
+// Where the window of a cylinder is up to
+#define FUEL_IDLE                   0U
+#define FUEL_OPENING                1U      // Open not queued yet
+#define FUEL_CLOSING                2U      // Open queued, close not yet
+
+// Injector outputs, LSD_1 to LSD_8
+#define FUEL_INJECTOR_COUNT         8U
+
+_Static_assert((FUEL_CYLINDERS > 0) && (FUEL_CYLINDERS <= FUEL_INJECTOR_COUNT), "One injector output per cylinder");
+
+// Points on the dead time curve
+#define FUEL_DEAD_TIME_POINTS       8U
+
+// Wall fraction used at most. The injection is divided by 1 - fraction, at 1
+// nothing would ever reach the cylinder.
+#define FUEL_WALL_FRACTION_MAX      0.9f
+
+// Accel enrichment from the rate of change of TPS (%/S) and MAP (kPa/S) over
+// a cycle. Rates above the threshold add this much fuel per unit, the
+// enrichment then decays by FUEL_AE_DECAY each cycle.
+#define FUEL_AE_TPS_THRESHOLD       40.0f
+#define FUEL_AE_TPS_GAIN            0.0001f
+#define FUEL_AE_MAP_THRESHOLD       60.0f
+#define FUEL_AE_MAP_GAIN            0.0003f
+#define FUEL_AE_MAX                 0.5f
+#define FUEL_AE_DECAY               0.7f
+
+#ifdef FUEL_MEASURE_CYCLES
+#define FUEL_CYCLES_START()         (cycleStart = DWT->CYCCNT)
+#define FUEL_CYCLES_END()           do{ fuelCalcCycles = DWT->CYCCNT - cycleStart;                       \
+                                        if(fuelCalcCycles > fuelCalcCyclesMax){                         \
+                                            fuelCalcCyclesMax = fuelCalcCycles;                         \
+                                        }                                                               \
+                                    }while(0)
+#else
+#define FUEL_CYCLES_START()
+#define FUEL_CYCLES_END()
+#endif
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+TaskHandle_t FuelControlTaskHandle;
+
+// A starting map for a naturally aspirated engine, flat above 100 kPa
+table3D_t fuelVeTable = {
+    .xAxis = {500, 750, 1000, 1250, 1500, 2000, 2500, 3000, 3500, 4000, 4500, 5000, 5500, 6000, 6500, 7000},   // rpm
+    .yAxis = {20, 30, 40, 50, 60, 70, 80, 90, 100, 120, 140, 160, 180, 200, 225, 250},                        // kPa
+    .values = {
+        {37, 38, 38, 39, 40, 42, 44, 46, 49, 50, 51, 50, 49, 46, 44, 42},
+        {40, 41, 41, 42, 43, 45, 48, 50, 53, 55, 55, 55, 53, 50, 48, 45},
+        {43, 44, 44, 45, 46, 48, 51, 54, 57, 59, 59, 59, 57, 54, 51, 48},
+        {46, 47, 48, 48, 49, 52, 55, 58, 61, 63, 64, 63, 61, 58, 55, 52},
+        {50, 50, 51, 52, 53, 55, 59, 62, 65, 67, 68, 67, 65, 62, 59, 55},
+        {53, 53, 54, 55, 56, 59, 62, 66, 69, 71, 72, 71, 69, 66, 62, 59},
+        {56, 56, 57, 58, 59, 62, 66, 70, 73, 76, 76, 76, 73, 70, 66, 62},
+        {59, 60, 60, 61, 63, 66, 70, 74, 77, 80, 81, 80, 77, 74, 70, 66},
+        {62, 63, 64, 65, 66, 69, 73, 77, 81, 84, 85, 84, 81, 77, 73, 69},
+        {62, 63, 64, 65, 66, 69, 73, 77, 81, 84, 85, 84, 81, 77, 73, 69},
+        {62, 63, 64, 65, 66, 69, 73, 77, 81, 84, 85, 84, 81, 77, 73, 69},
+        {62, 63, 64, 65, 66, 69, 73, 77, 81, 84, 85, 84, 81, 77, 73, 69},
+        {62, 63, 64, 65, 66, 69, 73, 77, 81, 84, 85, 84, 81, 77, 73, 69},
+        {62, 63, 64, 65, 66, 69, 73, 77, 81, 84, 85, 84, 81, 77, 73, 69},
+        {62, 63, 64, 65, 66, 69, 73, 77, 81, 84, 85, 84, 81, 77, 73, 69},
+        {62, 63, 64, 65, 66, 69, 73, 77, 81, 84, 85, 84, 81, 77, 73, 69},
+    },
+};
+
+// Injection ends near intake valve opening
+volatile float fuelEndOfInjection = 360.0f;
+
+volatile float fuelWallFraction = 0.25f;
+volatile float fuelWallTau = 150.0f;
+
+#ifdef FUEL_MEASURE_CYCLES
+// Cycles spent on the last engine cycle's pulse widths, and the worst seen
+volatile uint32_t fuelCalcCycles = 0;
+volatile uint32_t fuelCalcCyclesMax = 0;
+#endif
+
+
+/******************************************************************************
+* Private Function Prototypes (static)
+******************************************************************************/
+static void fuelControl_task(void * pvParameters);
+static void fuelControl_toothCallback(uint32_t primaryEventNumber, uint32_t timeStamp, float usPerDegree);
+static float fuelControl_deadTime(float battery);
+static void fuelControl_open(void * argument);
+static void fuelControl_close(void * argument);
+
+/******************************************************************************
+* Private Variables (static)
+******************************************************************************/
+struct fuelInjector_t{
+    GPIO_TypeDef * port;
+    uint32_t pin;
+};
+
+static const struct fuelInjector_t fuelInjector[FUEL_INJECTOR_COUNT] = {
+    {LSD_1_PORT, LSD_1_PIN}, {LSD_2_PORT, LSD_2_PIN}, {LSD_3_PORT, LSD_3_PIN}, {LSD_4_PORT, LSD_4_PIN},
+    {LSD_5_PORT, LSD_5_PIN}, {LSD_6_PORT, LSD_6_PIN}, {LSD_7_PORT, LSD_7_PIN}, {LSD_8_PORT, LSD_8_PIN},
+};
+
+// Worked out by the fuel task once per cycle, used by the tooth callback. The
+// injection window of a cylinder starts referenceOffset degrees after its
+// reference tooth, and ends at windowEnd, closeOffset degrees after its close
+// tooth.
+struct fuelSchedule_t{
+    uint32_t armed;
+    uint32_t referenceTooth;
+    float referenceOffset;
+    float windowEnd;
+    uint32_t closeTooth;
+    float closeOffset;
+    float pulseWidth;       // uS
+
+    // The window under way. Kept apart from the above, which the task sets for
+    // the next cycle before a late window ends.
+    uint32_t state;
+    uint32_t windowStartTime;
+    float activeEnd;
+    uint32_t activeCloseTooth;
+    float activeCloseOffset;
+    float activePulseWidth;
+    uint32_t openTime;
+};
+
+static struct fuelSchedule_t fuelSchedule[FUEL_CYLINDERS];
+
+static fuelTransient_t fuelTransient;
+
+// Injector opening delay in uS against battery voltage
+static const float fuelDeadTimeVolts[FUEL_DEAD_TIME_POINTS] = {6, 8, 10, 12, 13, 14, 15, 16};
+static const float fuelDeadTimeUs[FUEL_DEAD_TIME_POINTS] = {2400, 1600, 1150, 900, 800, 720, 660, 610};
+
+/******************************************************************************
+* Function Code
+******************************************************************************/
+
+
+/******************************************************************************
+* void FuelControl_Init(void)
+* Creates the fuel task and hooks the injectors onto the trigger teeth. The
+* injectors stay closed until the trigger decoder is in sync.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void FuelControl_Init(void){
+#ifdef FUEL_MEASURE_CYCLES
+    // Start the DWT cycle counter
+    SET_BIT(CoreDebug->DEMCR, CoreDebug_DEMCR_TRCENA_Msk);
+    SET_BIT(DWT->CTRL, DWT_CTRL_CYCCNTENA_Msk);
+#endif
+
+    TriggerDecoder_AddToothCallback(&fuelControl_toothCallback);
+
+    xTaskCreate(fuelControl_task,                   /* Function that implements the task. */
+                "fuelControlTask",                  /* Text name for the task. */
+                300,                                /* Stack size in words, not bytes. */
+                ( void * ) 0,                       /* Parameter passed into the task. */
+                3,                                  /* Priority at which the task is created. */
+                &FuelControlTaskHandle);            /* Used to pass out the created task's handle. */
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* float FuelControl_CalcFuel(float rpm, float map)
+* Speed density fuel: the required fuel scaled by VE and by MAP against
+* 100 kPa.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+float FuelControl_CalcFuel(float rpm, float map){
+    float ve;
+
+    ve = Table3D_Lookup(&fuelVeTable, rpm, map);
+
+    return FUEL_REQUIRED_FUEL * 0.0001f * ve * map;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void FuelControl_UpdateTransient(state, fuel, tps, map, cycleTime)
+* Works out the fuel each cylinder needs injected this cycle from the steady
+* state fuel, the TPS (%) and MAP (kPa) now and the length of the cycle (uS).
+*
+* Accel enrichment follows the faster of TPS and MAP opening over the last
+* cycle and decays once they settle. Wall wetting uses the X-tau model: X of
+* every injection goes onto the port walls, and each cycle 1 - e^(-t/tau) of
+* the wall fuel evaporates into the cylinder. The injection is sized so that
+* what reaches the cylinder is the fuel wanted. X is held below
+* FUEL_WALL_FRACTION_MAX, as the injection is divided by 1 - X.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void FuelControl_UpdateTransient(fuelTransient_t * state, float fuel, float tps, float map, float cycleTime){
+    float perSecond;
+    float accel;
+    float mapAccel;
+    float wanted;
+    float fraction;
+    float evaporated;
+    float inject;
+    uint32_t x;
+
+    if(!state->primed){
+        state->lastTps = tps;
+        state->lastMap = map;
+        state->accel = 0;
+        state->primed = 1;
+    }
+
+    perSecond = 1000000.0f / cycleTime;
+
+    accel = (((tps - state->lastTps) * perSecond) - FUEL_AE_TPS_THRESHOLD) * FUEL_AE_TPS_GAIN;
+    mapAccel = (((map - state->lastMap) * perSecond) - FUEL_AE_MAP_THRESHOLD) * FUEL_AE_MAP_GAIN;
+    if(mapAccel > accel){
+        accel = mapAccel;
+    }
+    state->accel = state->accel * FUEL_AE_DECAY;
+    if(accel > state->accel){
+        state->accel = (accel > FUEL_AE_MAX) ? FUEL_AE_MAX : accel;
+    }
+    state->lastTps = tps;
+    state->lastMap = map;
+
+    wanted = fuel * (1.0f + state->accel);
+    fraction = fuelWallFraction;
+    if(fraction > FUEL_WALL_FRACTION_MAX){
+        fraction = FUEL_WALL_FRACTION_MAX;
+    }
+    else if(fraction < 0){
+        fraction = 0;
+    }
+    evaporated = 1.0f - expf(-cycleTime / (fuelWallTau * 1000.0f));
+
+    for(x = 0; x < FUEL_CYLINDERS; x++){
+        inject = (wanted - (evaporated * state->film[x])) / (1.0f - fraction);
+        if(inject < 0){
+            inject = 0;
+        }
+        state->film[x] = (state->film[x] * (1.0f - evaporated)) + (fraction * inject);
+        state->pulse[x] = inject;
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void fuelControl_task(void * pvParameters)
+* Woken by the first tooth of every cycle. Steps the transient fuel on by one
+* cycle, then works out the tooth each injection window is timed from and
+* arms every cylinder that needs fuel for its next reference tooth.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void fuelControl_task(void * pvParameters){
+    float usPerDegree;
+    float map;
+    float deadTime;
+    float windowEnd;
+    float windowStart;
+    float offset;
+    float closeOffset;
+    uint32_t referenceTooth;
+    uint32_t closeTooth;
+    uint32_t x;
+#ifdef FUEL_MEASURE_CYCLES
+    uint32_t cycleStart;
+#endif
+
+    while(1){
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        FUEL_CYCLES_START();
+
+        // Sync was lost since the tooth woke us
+        usPerDegree = TriggerDecoder_GetUsPerDegree();
+        if(usPerDegree <= 0){
+            continue;
+        }
+
+        map = (float) Calibration_Read(SENSOR_MAP) * 0.1f;
+        FuelControl_UpdateTransient(&fuelTransient,
+                                    FuelControl_CalcFuel(TriggerDecoder_GetRPM(), map),
+                                    (float) Calibration_Read(SENSOR_TPS) * 0.1f,
+                                    map,
+                                    usPerDegree * 720);
+        deadTime = fuelControl_deadTime((float) Calibration_Read(SENSOR_BAT) * 0.001f);
+
+        for(x = 0; x < FUEL_CYLINDERS; x++){
+            if(fuelTransient.pulse[x] <= 0){
+                continue;
+            }
+
+            windowEnd = ENGINE_TDC_ANGLE(x) - fuelEndOfInjection;
+            while(windowEnd < 0){
+                windowEnd += 720;
+            }
+            windowStart = windowEnd - FUEL_INJECTION_WINDOW;
+            while(windowStart < 0){
+                windowStart += 720;
+            }
+            referenceTooth = TriggerDecoder_GetReferenceTooth(windowStart, &offset);
+            closeTooth = TriggerDecoder_GetReferenceTooth(windowEnd, &closeOffset);
+
+            taskENTER_CRITICAL();
+            fuelSchedule[x].referenceTooth = referenceTooth;
+            fuelSchedule[x].referenceOffset = offset;
+            fuelSchedule[x].windowEnd = windowEnd;
+            fuelSchedule[x].closeTooth = closeTooth;
+            fuelSchedule[x].closeOffset = closeOffset;
+            fuelSchedule[x].pulseWidth = fuelTransient.pulse[x] + deadTime;
+            fuelSchedule[x].armed = 1;
+            taskEXIT_CRITICAL();
+        }
+
+        FUEL_CYCLES_END();
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void fuelControl_toothCallback(primaryEventNumber, timeStamp, usPerDegree)
+* Called by the trigger decoder on every primary tooth while in sync. Wakes
+* the fuel task at the start of each cycle and moves each cylinder's window
+* on, retiming it from every tooth like the ignition does, so no edge is
+* extrapolated across more than one tooth gap however long the window is.
+*
+* The window starts on its reference tooth. The open is one pulse width
+* before the end of injection angle, and is queued from the last tooth before
+* it. The close is queued from the last tooth before the end of injection
+* angle, so the end of injection is held and the pulse width takes up what
+* the speed did in the tooth gap before the open. A backstop close is queued
+* when the window starts in case sync is lost in the middle.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void fuelControl_toothCallback(uint32_t primaryEventNumber, uint32_t timeStamp, float usPerDegree){
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    struct fuelSchedule_t * schedule;
+    float toothAngle;
+    float toEnd;
+    float toNext;
+    uint32_t openTime;
+    uint32_t closeTime;
+    uint32_t x;
+
+    toothAngle = TriggerDecoder_GetToothAngle(primaryEventNumber);
+    toNext = TriggerDecoder_GetToothAngle(primaryEventNumber + 1) - toothAngle;
+    if(toNext <= 0){
+        toNext += 720;
+    }
+
+    for(x = 0; x < FUEL_CYLINDERS; x++){
+        schedule = &fuelSchedule[x];
+
+        if(schedule->armed && (schedule->referenceTooth == primaryEventNumber)){
+            schedule->armed = 0;
+
+            schedule->windowStartTime = timeStamp + (uint32_t) TIME_US_TO_TICKS(schedule->referenceOffset * usPerDegree);
+            schedule->activeEnd = schedule->windowEnd;
+            schedule->activeCloseTooth = schedule->closeTooth;
+            schedule->activeCloseOffset = schedule->closeOffset;
+            schedule->activePulseWidth = schedule->pulseWidth;
+            schedule->state = FUEL_OPENING;
+
+            closeTime = schedule->windowStartTime + (uint32_t) TIME_US_TO_TICKS((FUEL_INJECTION_WINDOW + FUEL_CLOSE_BACKSTOP) * usPerDegree);
+            Scheduler_AddFromISR(x % SCHEDULER_CHANNELS, closeTime, &fuelControl_close, (void *) &fuelInjector[x]);
+        }
+
+        if(schedule->state == FUEL_OPENING){
+            toEnd = schedule->activeEnd - toothAngle;
+            if(toEnd < 0){
+                toEnd += 720;
+            }
+            closeTime = timeStamp + (uint32_t) TIME_US_TO_TICKS(toEnd * usPerDegree);
+            openTime = closeTime - (uint32_t) TIME_US_TO_TICKS(schedule->activePulseWidth);
+
+            // Too long for the window, open for the whole window instead
+            if(TIME_BEFORE(openTime, schedule->windowStartTime)){
+                openTime = schedule->windowStartTime;
+            }
+
+            if((primaryEventNumber == schedule->activeCloseTooth) ||
+               TIME_BEFORE(openTime, timeStamp + (uint32_t) TIME_US_TO_TICKS(toNext * usPerDegree))){
+                Scheduler_AddFromISR(x % SCHEDULER_CHANNELS, openTime, &fuelControl_open, (void *) &fuelInjector[x]);
+                schedule->openTime = openTime;
+                schedule->state = FUEL_CLOSING;
+            }
+        }
+
+        if((schedule->state == FUEL_CLOSING) && (primaryEventNumber == schedule->activeCloseTooth)){
+            closeTime = timeStamp + (uint32_t) TIME_US_TO_TICKS(schedule->activeCloseOffset * usPerDegree);
+            // The open must run first, or the injector would be left open
+            if(!TIME_AFTER(closeTime, schedule->openTime)){
+                closeTime = schedule->openTime + 1U;
+            }
+            Scheduler_AddFromISR(x % SCHEDULER_CHANNELS, closeTime, &fuelControl_close, (void *) &fuelInjector[x]);
+            schedule->state = FUEL_IDLE;
+        }
+    }
+
+    if(primaryEventNumber == 0){
+        vTaskNotifyGiveFromISR(FuelControlTaskHandle, &xHigherPriorityTaskWoken);
+        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* float fuelControl_deadTime(float battery)
+* Interpolates the injector dead time curve, clamped at both ends
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static float fuelControl_deadTime(float battery){
+    uint32_t x;
+
+    if(battery <= fuelDeadTimeVolts[0]){
+        return fuelDeadTimeUs[0];
+    }
+
+    for(x = 1; x < FUEL_DEAD_TIME_POINTS; x++){
+        if(battery < fuelDeadTimeVolts[x]){
+            return fuelDeadTimeUs[x - 1] + ((fuelDeadTimeUs[x] - fuelDeadTimeUs[x - 1]) *
+                   (battery - fuelDeadTimeVolts[x - 1]) / (fuelDeadTimeVolts[x] - fuelDeadTimeVolts[x - 1]));
+        }
+    }
+
+    return fuelDeadTimeUs[FUEL_DEAD_TIME_POINTS - 1];
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void fuelControl_open(void * argument)
+* void fuelControl_close(void * argument)
+* Scheduler events that open and close an injector
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void fuelControl_open(void * argument){
+    const struct fuelInjector_t * injector = argument;
+
+    Gpio_SetPin(injector->port, injector->pin);
+}
+
+static void fuelControl_close(void * argument){
+    const struct fuelInjector_t * injector = argument;
+
+    Gpio_ResetPin(injector->port, injector->pin);
+}
+/*****************************************************************************/
@@ -113,6 +113,21 @@ void Gpio_Init(void)
     gpio_initPin(STEP_DIR_PORT, STEP_DIR_PIN, GPIO_MODE_OUTPUT, GPIO_SPEED_VERY_HIGH, GPIO_OUTPUT_PUSHPULL, GPIO_PULL_NO, GPIO_AF_0);
     gpio_initPin(STEP_STEP_PORT, STEP_STEP_PIN, GPIO_MODE_OUTPUT, GPIO_SPEED_VERY_HIGH, GPIO_OUTPUT_PUSHPULL, GPIO_PULL_NO, GPIO_AF_0);
 
+    gpio_initPin(MAP_PORT, MAP_PIN, GPIO_MODE_ANALOG, GPIO_SPEED_LOW, GPIO_OUTPUT_PUSHPULL, GPIO_PULL_NO, GPIO_AF_0);
+    gpio_initPin(AFM_PORT, AFM_PIN, GPIO_MODE_ANALOG, GPIO_SPEED_LOW, GPIO_OUTPUT_PUSHPULL, GPIO_PULL_NO, GPIO_AF_0);
+    gpio_initPin(TPS__PORT, TPS_PIN, GPIO_MODE_ANALOG, GPIO_SPEED_LOW, GPIO_OUTPUT_PUSHPULL, GPIO_PULL_NO, GPIO_AF_0);
+    gpio_initPin(O2_PORT, O2_PIN, GPIO_MODE_ANALOG, GPIO_SPEED_LOW, GPIO_OUTPUT_PUSHPULL, GPIO_PULL_NO, GPIO_AF_0);
+    gpio_initPin(IAT_PORT, IAT_PIN, GPIO_MODE_ANALOG, GPIO_SPEED_LOW, GPIO_OUTPUT_PUSHPULL, GPIO_PULL_NO, GPIO_AF_0);
+    gpio_initPin(CTS_PORT, CTS_PIN, GPIO_MODE_ANALOG, GPIO_SPEED_LOW, GPIO_OUTPUT_PUSHPULL, GPIO_PULL_NO, GPIO_AF_0);
+    gpio_initPin(BAT_PORT, BAT_PIN, GPIO_MODE_ANALOG, GPIO_SPEED_LOW, GPIO_OUTPUT_PUSHPULL, GPIO_PULL_NO, GPIO_AF_0);
+
+    // SPI1 on AF5, NSS is driven by SdCard as a GPIO
+    gpio_initPin(SD_NSS_PORT, SD_NSS_PIN, GPIO_MODE_OUTPUT, GPIO_SPEED_VERY_HIGH, GPIO_OUTPUT_PUSHPULL, GPIO_PULL_NO, GPIO_AF_0);
+    gpio_initPin(SD_SCLK_PORT, SD_SCLK_PIN, GPIO_MODE_ALTERNATE, GPIO_SPEED_VERY_HIGH, GPIO_OUTPUT_PUSHPULL, GPIO_PULL_NO, GPIO_AF_5);
+    gpio_initPin(SD_MISO_PORT, SD_MISO_PIN, GPIO_MODE_ALTERNATE, GPIO_SPEED_VERY_HIGH, GPIO_OUTPUT_PUSHPULL, GPIO_PULL_UP, GPIO_AF_5);
+    gpio_initPin(SD_MOSI_PORT, SD_MOSI_PIN, GPIO_MODE_ALTERNATE, GPIO_SPEED_VERY_HIGH, GPIO_OUTPUT_PUSHPULL, GPIO_PULL_NO, GPIO_AF_5);
+    gpio_initPin(SD_DETECT_PORT, SD_DETECT_PIN, GPIO_MODE_INPUT, GPIO_SPEED_LOW, GPIO_OUTPUT_PUSHPULL, GPIO_PULL_UP, GPIO_AF_0);
+
     gpio_initPin(DEV_LED_PORT, DEV_LED_PIN, GPIO_MODE_OUTPUT, GPIO_SPEED_VERY_HIGH, GPIO_OUTPUT_PUSHPULL, GPIO_PULL_NO, GPIO_AF_0);
 }
 /*****************************************************************************/
@@ -166,6 +181,23 @@ void Gpio_TogglePin(GPIO_TypeDef *GPIOx, uint32_t Pin)
 /*****************************************************************************/
 
 
+/******************************************************************************
+* void Gpio_SetAlternateFunction(Port, Pin, AlternateFunction)
+* Hands an STM32G4 GPIO pin over to one of its alternate functions (0-15).
+* Unlike gpio_initPin this also covers pins 8-15, which live in AFR[1].
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void Gpio_SetAlternateFunction(GPIO_TypeDef *GPIOx, uint32_t Pin, uint32_t AlternateFunction)
+{
+    uint32_t position = POSITION_VAL(Pin);
+
+    // Select the alternate function before switching the pin mode so the pin never glitches
+    MODIFY_REG(GPIOx->AFR[position >> 3U], (GPIO_AFRL_AFSEL0 << ((position & 0x7U) * 4U)), (AlternateFunction << ((position & 0x7U) * 4U)));
+    MODIFY_REG(GPIOx->MODER, (GPIO_MODER_MODE0 << (position * 2U)), (GPIO_MODE_ALTERNATE << (position * 2U)));
+}
+/*****************************************************************************/
+
+
 /******************************************************************************
 * void gpio_initPin(Port, Pin, Mode, Speed, OutputType, Pull, AlternateMode))
 * Library function for initializing STM32G4 GPIO pin
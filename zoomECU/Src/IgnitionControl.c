@@ -12,8 +12,12 @@
 #include "IgnitionControl.h"
 #include "TriggerDecoder.h"
 #include "Time.h"
+#include "Latency.h"
+#include "Calibration.h"
+#include "Table3D.h"
 #include "Gpio.h"
 #include "PinoutConfiguration.h"
+#include "EngineController.h"
 
 #include "FreeRTOS.h"
 #include "task.h"
@@ -22,16 +26,115 @@
 #include "queue.h"
 #include "event_groups.h"
 
-#include <stdio.h>
-
 /******************************************************************************
 * Defines
 ******************************************************************************/
+// Uncomment to count the core clock cycles spent creating each ignition schedule
+// with the DWT cycle counter. Read ignitionScheduleCycles and
+// ignitionScheduleCyclesMax with the debugger.
+//#define IGNITION_MEASURE_CYCLES
+
+#ifdef IGNITION_OUTPUT_COMPARE
+// TIM2 arms each coil edge in the output compare timers this long before
+// it is due. This must be longer than the worst TIM2_IRQHandler latency, and
+// shorter than the dwell time.
+#define IGNITION_COMPARE_LEAD       TIME_US_TO_TICKS(50)
+#else
+#define IGNITION_COMPARE_LEAD       0
+#endif
+
+// One schedule and coil output per cylinder, IGN_SCH_1 to IGN_SCH_4
+_Static_assert(ENGINE_CYLINDERS == 4U, "Ignition drives 4 cylinders");
+
+// A schedule is only moved by its reference tooth if the new compare time is at
+// least this far ahead, otherwise the original time is kept.
+#define IGNITION_MIN_REARM_LEAD     TIME_US_TO_TICKS(5)
+
+// Least time ahead of now that a coil edge can be armed for. Signed, so it
+// compares with TIME_DIFF.
+#define IGNITION_MIN_ARM_TIME       ((int32_t)(IGNITION_MIN_REARM_LEAD + IGNITION_COMPARE_LEAD))
+
+// Below this rpm the engine is cranking. The starter pulls the battery down
+// furthest then, so the dwell still follows the battery, taken from the dwell
+// table at this rpm rather than the rpm of the moment, which jumps with each
+// compression.
+#define IGNITION_CRANKING_RPM       500.0f
+
+// Crank angle between two sparks of the same coil, 360 for wasted spark. The
+// dwell is held to this fraction of that time, so the coil is never on for
+// longer than it has between sparks at high rpm.
+#define IGNITION_COIL_SPARK_ANGLE   720.0f
+#define IGNITION_MAX_DWELL_DUTY     0.5f
+
+// How long to wait before trying again to set a schedule that could not be
+// set, ie. while the decoder is still gaining confidence
+#define IGNITION_RETRY_TIME         pdMS_TO_TICKS(5)
+
+#ifdef IGNITION_MEASURE_CYCLES
+#define IGNITION_CYCLES_START()     (cycleStart = DWT->CYCCNT)
+#define IGNITION_CYCLES_END()       do{ ignitionScheduleCycles = DWT->CYCCNT - cycleStart;               \
+                                        if(ignitionScheduleCycles > ignitionScheduleCyclesMax){         \
+                                            ignitionScheduleCyclesMax = ignitionScheduleCycles;         \
+                                        }                                                               \
+                                    }while(0)
+#else
+#define IGNITION_CYCLES_START()
+#define IGNITION_CYCLES_END()
+#endif
 
 
 /******************************************************************************
 * Public Variables
 ******************************************************************************/
+// A conservative starting map, richer in advance at light load and high rpm
+table3D_t ignitionSparkTable = {
+    .xAxis = {500, 750, 1000, 1250, 1500, 2000, 2500, 3000, 3500, 4000, 4500, 5000, 5500, 6000, 6500, 7000},   // rpm
+    .yAxis = {20, 30, 40, 50, 60, 70, 80, 90, 100, 120, 140, 160, 180, 200, 225, 250},                        // kPa
+    .values = {
+        {18.0f, 20.0f, 22.0f, 24.5f, 27.0f, 32.0f, 35.0f, 38.0f, 40.0f, 42.0f, 42.5f, 42.5f, 43.0f, 43.5f, 43.5f, 44.0f},
+        {16.0f, 18.0f, 20.0f, 22.5f, 25.0f, 30.0f, 33.0f, 36.0f, 38.0f, 40.0f, 40.5f, 40.5f, 41.0f, 41.5f, 41.5f, 42.0f},
+        {14.0f, 16.0f, 18.0f, 20.5f, 23.0f, 28.0f, 31.0f, 34.0f, 36.0f, 38.0f, 38.5f, 38.5f, 39.0f, 39.5f, 39.5f, 40.0f},
+        {12.0f, 14.0f, 16.0f, 18.5f, 21.0f, 26.0f, 29.0f, 32.0f, 34.0f, 36.0f, 36.5f, 36.5f, 37.0f, 37.5f, 37.5f, 38.0f},
+        {10.0f, 12.0f, 14.0f, 16.5f, 19.0f, 24.0f, 27.0f, 30.0f, 32.0f, 34.0f, 34.5f, 34.5f, 35.0f, 35.5f, 35.5f, 36.0f},
+        { 9.0f, 11.0f, 13.0f, 15.5f, 18.0f, 23.0f, 26.0f, 29.0f, 31.0f, 33.0f, 33.5f, 34.0f, 34.0f, 34.5f, 35.0f, 35.0f},
+        { 8.5f, 10.5f, 12.5f, 15.0f, 17.5f, 22.5f, 25.5f, 28.5f, 30.5f, 32.5f, 32.5f, 33.0f, 33.5f, 33.5f, 34.0f, 34.5f},
+        { 7.5f,  9.5f, 11.5f, 14.0f, 16.5f, 21.5f, 24.5f, 27.5f, 29.5f, 31.5f, 32.0f, 32.5f, 32.5f, 33.0f, 33.5f, 33.5f},
+        { 7.0f,  9.0f, 11.0f, 13.5f, 16.0f, 21.0f, 24.0f, 27.0f, 29.0f, 31.0f, 31.0f, 31.5f, 32.0f, 32.0f, 32.5f, 33.0f},
+        { 4.0f,  6.0f,  8.0f, 10.5f, 13.0f, 18.0f, 21.0f, 24.0f, 26.0f, 28.0f, 28.0f, 28.5f, 29.0f, 29.0f, 29.5f, 30.0f},
+        { 4.0f,  4.0f,  5.0f,  7.5f, 10.0f, 15.0f, 18.0f, 21.0f, 23.0f, 25.0f, 25.0f, 25.5f, 26.0f, 26.0f, 26.5f, 27.0f},
+        { 4.0f,  4.0f,  4.0f,  4.5f,  7.0f, 12.0f, 15.0f, 18.0f, 20.0f, 22.0f, 22.0f, 22.5f, 23.0f, 23.0f, 23.5f, 24.0f},
+        { 4.0f,  4.0f,  4.0f,  4.0f,  4.0f,  9.0f, 12.0f, 15.0f, 17.0f, 19.0f, 19.0f, 19.5f, 20.0f, 20.0f, 20.5f, 21.0f},
+        { 4.0f,  4.0f,  4.0f,  4.0f,  4.0f,  6.0f,  9.0f, 12.0f, 14.0f, 16.0f, 16.0f, 16.5f, 17.0f, 17.0f, 17.5f, 18.0f},
+        { 4.0f,  4.0f,  4.0f,  4.0f,  4.0f,  4.0f,  5.0f,  8.0f, 10.0f, 12.0f, 12.5f, 12.5f, 13.0f, 13.5f, 13.5f, 14.0f},
+        { 4.0f,  4.0f,  4.0f,  4.0f,  4.0f,  4.0f,  4.0f,  4.5f,  6.5f,  8.5f,  8.5f,  9.0f,  9.5f,  9.5f, 10.0f, 10.5f},
+    },
+};
+
+volatile float ignitionSparkTrim[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+// Coil charge time in uS, longer at low battery to reach the same current
+table3D_t ignitionDwellTable = {
+    .xAxis = {500, 750, 1000, 1250, 1500, 2000, 2500, 3000, 3500, 4000, 4500, 5000, 5500, 6000, 6500, 7000},   // rpm
+    .yAxis = {6, 7, 8, 9, 10, 11, 12, 13, 13.5f, 14, 14.5f, 15, 16, 17, 18, 20},                              // V
+    .values = {
+        {6000, 6000, 6000, 6000, 6000, 6000, 6000, 6000, 6000, 6000, 5900, 5800, 5700, 5600, 5500, 5400},
+        {5250, 5250, 5250, 5250, 5250, 5250, 5250, 5250, 5250, 5250, 5160, 5080, 4990, 4900, 4810, 4720},
+        {4500, 4500, 4500, 4500, 4500, 4500, 4500, 4500, 4500, 4500, 4420, 4350, 4280, 4200, 4120, 4050},
+        {4000, 4000, 4000, 4000, 4000, 4000, 4000, 4000, 4000, 4000, 3930, 3870, 3800, 3730, 3670, 3600},
+        {3500, 3500, 3500, 3500, 3500, 3500, 3500, 3500, 3500, 3500, 3440, 3380, 3320, 3270, 3210, 3150},
+        {3150, 3150, 3150, 3150, 3150, 3150, 3150, 3150, 3150, 3150, 3100, 3040, 2990, 2940, 2890, 2840},
+        {2800, 2800, 2800, 2800, 2800, 2800, 2800, 2800, 2800, 2800, 2750, 2710, 2660, 2610, 2570, 2520},
+        {2600, 2600, 2600, 2600, 2600, 2600, 2600, 2600, 2600, 2600, 2560, 2510, 2470, 2430, 2380, 2340},
+        {2500, 2500, 2500, 2500, 2500, 2500, 2500, 2500, 2500, 2500, 2460, 2420, 2380, 2330, 2290, 2250},
+        {2400, 2400, 2400, 2400, 2400, 2400, 2400, 2400, 2400, 2400, 2360, 2320, 2280, 2240, 2200, 2160},
+        {2320, 2320, 2320, 2320, 2320, 2320, 2320, 2320, 2320, 2320, 2290, 2250, 2210, 2170, 2130, 2090},
+        {2250, 2250, 2250, 2250, 2250, 2250, 2250, 2250, 2250, 2250, 2210, 2180, 2140, 2100, 2060, 2020},
+        {2100, 2100, 2100, 2100, 2100, 2100, 2100, 2100, 2100, 2100, 2060, 2030, 2000, 1960, 1920, 1890},
+        {2000, 2000, 2000, 2000, 2000, 2000, 2000, 2000, 2000, 2000, 1970, 1930, 1900, 1870, 1830, 1800},
+        {1900, 1900, 1900, 1900, 1900, 1900, 1900, 1900, 1900, 1900, 1870, 1840, 1800, 1770, 1740, 1710},
+        {1800, 1800, 1800, 1800, 1800, 1800, 1800, 1800, 1800, 1800, 1770, 1740, 1710, 1680, 1650, 1620},
+    },
+};
 
 
 /******************************************************************************
@@ -48,8 +151,22 @@ void testStartCallback3(void);
 void testEndCallback4(void);
 void testStartCallback4(void);
 
-float IgnitionControl_calcNextIgnitionAngle(int32_t ignSchedule);
-int32_t IgnitionControl_calcDwellTime(void);
+uint32_t IgnitionControl_calcDwellTime(float uSPerDegree);
+void IgnitionControl_setSparkAngle(int32_t x, float sparkAngle, uint32_t dwellTicks);
+void IgnitionControl_armSchedule(int32_t x);
+#ifdef IGNITION_OUTPUT_COMPARE
+void IgnitionControl_outputCompareInit(void);
+void IgnitionControl_armOutput(int32_t x, uint32_t time, uint32_t active);
+void compareStartCallback1(void);
+void compareEndCallback1(void);
+void compareStartCallback2(void);
+void compareEndCallback2(void);
+void compareStartCallback3(void);
+void compareEndCallback3(void);
+void compareStartCallback4(void);
+void compareEndCallback4(void);
+#endif
+void IgnitionControl_toothCallback(uint32_t primaryEventNumber, uint32_t timeStamp, float usPerDegree);
 
 /******************************************************************************
 * Private Variables (static)
@@ -64,10 +181,41 @@ struct Schedule {
   	void (*endCallback)(); //Start Callback function for schedule
 
   	volatile enum scheduleStatusStates status;
+
+	// The spark is also stored as an angle in the cycle, so every tooth before
+	// it can time it again
+	volatile float sparkAngle;
+	volatile uint32_t dwellTicks;
 };
 
 struct Schedule ignitionSchedule[4];
 
+// Compare register driving each ignition schedule
+static volatile uint32_t * const ignitionCompare[4] = {&TIM2->CCR1, &TIM2->CCR2, &TIM2->CCR3, &TIM2->CCR4};
+
+#ifdef IGNITION_OUTPUT_COMPARE
+// Output compare timer and channel (1 or 2) driving the coil of each ignition schedule
+static TIM_TypeDef * const ignitionOutputTimer[4] = {TIM3, TIM3, TIM4, TIM4};
+static const uint32_t ignitionOutputChannel[4] = {1, 2, 1, 2};
+#endif
+
+// Set while the engine controller wants sparks. Finished schedules are only
+// created again while this is set.
+static volatile uint32_t ignitionEnabled = 0;
+
+// Advance (degrees, no trim) and dwell (ticks) of the last spark created, for logging
+static volatile float ignitionLastAdvance = 0;
+static volatile uint32_t ignitionLastDwellTicks = 0;
+
+// Schedules tried again, only written by the event creation task
+static ignitionRetryStats_t ignitionRetryStats;
+
+#ifdef IGNITION_MEASURE_CYCLES
+// Cycles spent on the last ignition schedule created, and the worst seen
+volatile uint32_t ignitionScheduleCycles = 0;
+volatile uint32_t ignitionScheduleCyclesMax = 0;
+#endif
+
 /******************************************************************************
 * Function Code
 ******************************************************************************/
@@ -80,6 +228,23 @@ struct Schedule ignitionSchedule[4];
 ******************************************************************************/
 void IgnitionControl_Init(void){
 
+#ifdef IGNITION_OUTPUT_COMPARE
+    // Hand the coil outputs to the output compare timers
+    IgnitionControl_outputCompareInit();
+
+    // Set up callbacks for ignition schedules, these arm the output compare channels
+    ignitionSchedule[0].startCallback = &compareStartCallback1;
+    ignitionSchedule[0].endCallback = &compareEndCallback1;
+
+    ignitionSchedule[1].startCallback = &compareStartCallback2;
+    ignitionSchedule[1].endCallback = &compareEndCallback2;
+
+    ignitionSchedule[2].startCallback = &compareStartCallback3;
+    ignitionSchedule[2].endCallback = &compareEndCallback3;
+
+    ignitionSchedule[3].startCallback = &compareStartCallback4;
+    ignitionSchedule[3].endCallback = &compareEndCallback4;
+#else
     // Set up callbacks for ignition schedules
     ignitionSchedule[0].startCallback = &testStartCallback1;
     ignitionSchedule[0].endCallback = &testEndCallback1;
@@ -92,9 +257,17 @@ void IgnitionControl_Init(void){
 
     ignitionSchedule[3].startCallback = &testStartCallback4;
     ignitionSchedule[3].endCallback = &testEndCallback4;
+#endif
+
+    // Re-time the sparks as each tooth arrives
+    TriggerDecoder_AddToothCallback(&IgnitionControl_toothCallback);
 
-    // Create ignition schedule event group
-    ignitionScheduleFinishedEventGroup = xEventGroupCreate();
+#ifdef IGNITION_MEASURE_CYCLES
+    // Start the DWT cycle counter
+    SET_BIT(CoreDebug->DEMCR, CoreDebug_DEMCR_TRCENA_Msk);
+    WRITE_REG(DWT->CYCCNT, 0);
+    SET_BIT(DWT->CTRL, DWT_CTRL_CYCCNTENA_Msk);
+#endif
 
     // Create the trigger decoder task
     xTaskCreate(IgnitionControl_EventCreationTask,              /* Function that implements the task. */
@@ -107,6 +280,57 @@ void IgnitionControl_Init(void){
 /*****************************************************************************/
 
 
+/******************************************************************************
+* void IgnitionControl_Start(void)
+* Starts creating ignition schedules. Each schedule creates its next spark
+* when it finishes, so only the schedules that are not already set are
+* kicked off here.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void IgnitionControl_Start(void){
+    uint32_t notificationValue = 0;
+    int32_t x;
+
+    taskENTER_CRITICAL();
+    ignitionEnabled = 1;
+    for(x = 0; x < 4; x++){
+        if(ignitionSchedule[x].status == OFF){
+            notificationValue |= (IGN_SCH_1 << x);
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    xTaskNotify(IgnitionControlEventCreationTaskHandle,
+                notificationValue,
+                eSetBits);
+}
+/*****************************************************************************/
+
+
+/******************************************************************************
+* void IgnitionControl_Stop(void)
+* Stops creating ignition schedules. A coil that is charging still sparks, so
+* it is never left on, but schedules still waiting to dwell are cancelled.
+* They were timed from a sync that is gone, and one aimed while the engine
+* was stalling can be seconds out.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void IgnitionControl_Stop(void){
+    int32_t x;
+
+    taskENTER_CRITICAL();
+    ignitionEnabled = 0;
+    for(x = 0; x < 4; x++){
+        if(ignitionSchedule[x].status == PENDING){
+            CLEAR_BIT(TIM2->DIER, TIM_DIER_CC1IE << x);
+            ignitionSchedule[x].status = OFF;
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+/*****************************************************************************/
+
+
 /******************************************************************************
 * void IgnitionControl_EventCreationTask(void)
 * Creates and schedules all ignition events
@@ -116,6 +340,7 @@ void IgnitionControl_EventCreationTask(void * pvParameters){
 
     uint32_t bitsToClearOnExit;
     uint32_t notificationValue;
+    uint32_t retryBits = 0;
     uint32_t status;
     uint32_t endTime;
     uint32_t startTime;
@@ -123,29 +348,50 @@ void IgnitionControl_EventCreationTask(void * pvParameters){
     float currentAngle;
     uint32_t currentTime;
     float nextIgnAngle;
-    int32_t dwellTime;
+    uint32_t dwellTicks;
     float deltaAngle;
-    int32_t uSPerDegree;
+    float uSPerDegree;
+    triggerSnapshot_t trigger;
+#ifdef IGNITION_MEASURE_CYCLES
+    uint32_t cycleStart;
+#endif
 
     while(1){
 
-        xTaskNotifyWait(0,                  //do not clear any bits on entry
-                        0xffffffff,
-                        &notificationValue,
-                        portMAX_DELAY);
+        // Schedules that could not be set are tried again after a short wait,
+        // otherwise we sleep until a schedule finishes or ignition is started.
+        if(xTaskNotifyWait(0,                  //do not clear any bits on entry
+                           0xffffffff,
+                           &notificationValue,
+                           retryBits ? IGNITION_RETRY_TIME : portMAX_DELAY) == pdFALSE){
+            notificationValue = 0;
+        }
+        else{
+            LATENCY_TASK_RUNNING(LATENCY_IGNITION_TASK);
+        }
+        notificationValue |= retryBits;
+        retryBits = 0;
+
+        // Stopped, let the schedules that are still set finish on their own
+        if(!ignitionEnabled){
+            notificationValue = 0;
+        }
         
         if(notificationValue & IGN_SCH_1){
 
+            IGNITION_CYCLES_START();
+
             nextIgnAngle = IgnitionControl_calcNextIgnitionAngle(IGN_SCH_1);
-            currentAngle = TriggerDecoder_GetCurrentAngle();
-            currentTime = Time_GetTimeuSeconds();
-            uSPerDegree = TriggerDecoder_GetUsPerDegree();
-            dwellTime = IgnitionControl_calcDwellTime();
+            // One snapshot gives an angle, speed and time that all agree with each other
+            TriggerDecoder_GetSnapshot(&trigger);
+            currentAngle = trigger.currentAngle;
+            currentTime = trigger.timeStamp;
+            uSPerDegree = trigger.usPerDegree;
+            dwellTicks = IgnitionControl_calcDwellTime(uSPerDegree);
 
             if((nextIgnAngle == -1) | (currentAngle == -1) | (uSPerDegree == -1)){
-                printf("Error: Ignition 1 not set, failed confidence check. \n");
-                xEventGroupSetBits( ignitionScheduleFinishedEventGroup,        /* The event group being updated. */
-                                    IGN_SCH_1);                                /* The bits being set. */
+                ignitionRetryStats.noConfidence++;
+                retryBits |= IGN_SCH_1;
             }
             
             else{
@@ -156,35 +402,46 @@ void IgnitionControl_EventCreationTask(void * pvParameters){
                     deltaAngle = (720 - currentAngle) + nextIgnAngle;
                 }
 
-                endTime = currentTime + (uSPerDegree * deltaAngle);
-                ignitionSchedule[0].endTime = endTime;
+                endTime = currentTime + (uint32_t) TIME_US_TO_TICKS(uSPerDegree * deltaAngle);
+                startTime = endTime - dwellTicks;
 
-                startTime = ignitionSchedule[0].endTime - dwellTime;
+                // No time to dwell for this cycle's spark, it has usually just fired
+                // from the last schedule. Aim at the spark one cycle on instead.
+                if(TIME_DIFF(startTime, Time_GetTicks()) < IGNITION_MIN_ARM_TIME){
+                    deltaAngle += 720;
+                    endTime = currentTime + (uint32_t) TIME_US_TO_TICKS(uSPerDegree * deltaAngle);
+                    startTime = endTime - dwellTicks;
+                }
+
+                ignitionSchedule[0].endTime = endTime;
                 ignitionSchedule[0].startTime = startTime;
 
-                if(startTime <= currentTime){
-					printf("Error: Ignition 1 not set, event set in past. \n");
-					xEventGroupSetBits( ignitionScheduleFinishedEventGroup,        /* The event group being updated. */
-										IGN_SCH_1);                                /* The bits being set. */
+                if(TIME_DIFF(startTime, Time_GetTicks()) < IGNITION_MIN_ARM_TIME){
+					ignitionRetryStats.late++;
+					retryBits |= IGN_SCH_1;
 				}
                 else{
-                    WRITE_REG(TIM2->CCR1, ignitionSchedule[0].startTime);
-                    ignitionSchedule[0].status = PENDING;
+                    IgnitionControl_setSparkAngle(0, nextIgnAngle, dwellTicks);
+                    IgnitionControl_armSchedule(0);
                 }
             }
+
+            IGNITION_CYCLES_END();
         }
 
         if(notificationValue & IGN_SCH_2){
+            IGNITION_CYCLES_START();
+
             nextIgnAngle = IgnitionControl_calcNextIgnitionAngle(IGN_SCH_2);
-            currentAngle = TriggerDecoder_GetCurrentAngle();
-            currentTime = Time_GetTimeuSeconds();
-            uSPerDegree = TriggerDecoder_GetUsPerDegree();
-            dwellTime = IgnitionControl_calcDwellTime();
+            TriggerDecoder_GetSnapshot(&trigger);
+            currentAngle = trigger.currentAngle;
+            currentTime = trigger.timeStamp;
+            uSPerDegree = trigger.usPerDegree;
+            dwellTicks = IgnitionControl_calcDwellTime(uSPerDegree);
 
             if((nextIgnAngle == -1) | (currentAngle == -1) | (uSPerDegree == -1)){
-                printf("Error: Ignition 2 not set, failed confidence check. \n");
-                xEventGroupSetBits( ignitionScheduleFinishedEventGroup,        /* The event group being updated. */
-                                    IGN_SCH_2);                                /* The bits being set. */
+                ignitionRetryStats.noConfidence++;
+                retryBits |= IGN_SCH_2;
             }
             
             else{
@@ -195,35 +452,46 @@ void IgnitionControl_EventCreationTask(void * pvParameters){
                     deltaAngle = (720 - currentAngle) + nextIgnAngle;
                 }
 
-                endTime = currentTime + (uSPerDegree * deltaAngle);
-                ignitionSchedule[1].endTime = endTime;
+                endTime = currentTime + (uint32_t) TIME_US_TO_TICKS(uSPerDegree * deltaAngle);
+                startTime = endTime - dwellTicks;
 
-                startTime = ignitionSchedule[1].endTime - dwellTime;
+                // No time to dwell for this cycle's spark, it has usually just fired
+                // from the last schedule. Aim at the spark one cycle on instead.
+                if(TIME_DIFF(startTime, Time_GetTicks()) < IGNITION_MIN_ARM_TIME){
+                    deltaAngle += 720;
+                    endTime = currentTime + (uint32_t) TIME_US_TO_TICKS(uSPerDegree * deltaAngle);
+                    startTime = endTime - dwellTicks;
+                }
+
+                ignitionSchedule[1].endTime = endTime;
                 ignitionSchedule[1].startTime = startTime;
 
-                if(startTime <= currentTime){
-					printf("Error: Ignition 2 not set, event set in past. \n");
-					xEventGroupSetBits( ignitionScheduleFinishedEventGroup,        /* The event group being updated. */
-										IGN_SCH_2);                                /* The bits being set. */
+                if(TIME_DIFF(startTime, Time_GetTicks()) < IGNITION_MIN_ARM_TIME){
+					ignitionRetryStats.late++;
+					retryBits |= IGN_SCH_2;
 				}
                 else{
-                    WRITE_REG(TIM2->CCR2, ignitionSchedule[1].startTime);
-                    ignitionSchedule[1].status = PENDING;
+                    IgnitionControl_setSparkAngle(1, nextIgnAngle, dwellTicks);
+                    IgnitionControl_armSchedule(1);
                 }
             }
+
+            IGNITION_CYCLES_END();
         }
 
         if(notificationValue & IGN_SCH_3){
+            IGNITION_CYCLES_START();
+
             nextIgnAngle = IgnitionControl_calcNextIgnitionAngle(IGN_SCH_3);
-            currentAngle = TriggerDecoder_GetCurrentAngle();
-            currentTime = Time_GetTimeuSeconds();
-            uSPerDegree = TriggerDecoder_GetUsPerDegree();
-            dwellTime = IgnitionControl_calcDwellTime();
+            TriggerDecoder_GetSnapshot(&trigger);
+            currentAngle = trigger.currentAngle;
+            currentTime = trigger.timeStamp;
+            uSPerDegree = trigger.usPerDegree;
+            dwellTicks = IgnitionControl_calcDwellTime(uSPerDegree);
 
             if((nextIgnAngle == -1) | (currentAngle == -1) | (uSPerDegree == -1)){
-                printf("Error: Ignition 3 not set, failed confidence check. \n");
-                xEventGroupSetBits( ignitionScheduleFinishedEventGroup,        /* The event group being updated. */
-                                    IGN_SCH_3);                                /* The bits being set. */
+                ignitionRetryStats.noConfidence++;
+                retryBits |= IGN_SCH_3;
             }
             
             else{
@@ -234,35 +502,46 @@ void IgnitionControl_EventCreationTask(void * pvParameters){
                     deltaAngle = (720 - currentAngle) + nextIgnAngle;
                 }
 
-                endTime = currentTime + (uSPerDegree * deltaAngle);
-                ignitionSchedule[2].endTime = endTime;
+                endTime = currentTime + (uint32_t) TIME_US_TO_TICKS(uSPerDegree * deltaAngle);
+                startTime = endTime - dwellTicks;
 
-                startTime = ignitionSchedule[2].endTime - dwellTime;
+                // No time to dwell for this cycle's spark, it has usually just fired
+                // from the last schedule. Aim at the spark one cycle on instead.
+                if(TIME_DIFF(startTime, Time_GetTicks()) < IGNITION_MIN_ARM_TIME){
+                    deltaAngle += 720;
+                    endTime = currentTime + (uint32_t) TIME_US_TO_TICKS(uSPerDegree * deltaAngle);
+                    startTime = endTime - dwellTicks;
+                }
+
+                ignitionSchedule[2].endTime = endTime;
                 ignitionSchedule[2].startTime = startTime;
 
-                if(startTime <= currentTime){
-					printf("Error: Ignition 3 not set, event set in past. \n");
-					xEventGroupSetBits( ignitionScheduleFinishedEventGroup,        /* The event group being updated. */
-										IGN_SCH_3);                                /* The bits being set. */
+                if(TIME_DIFF(startTime, Time_GetTicks()) < IGNITION_MIN_ARM_TIME){
+					ignitionRetryStats.late++;
+					retryBits |= IGN_SCH_3;
 				}
                 else{
-                    WRITE_REG(TIM2->CCR3, ignitionSchedule[2].startTime);
-                    ignitionSchedule[2].status = PENDING;
+                    IgnitionControl_setSparkAngle(2, nextIgnAngle, dwellTicks);
+                    IgnitionControl_armSchedule(2);
                 }
             }
+
+            IGNITION_CYCLES_END();
         }
 
         if(notificationValue & IGN_SCH_4){
+            IGNITION_CYCLES_START();
+
             nextIgnAngle = IgnitionControl_calcNextIgnitionAngle(IGN_SCH_4);
-            currentAngle = TriggerDecoder_GetCurrentAngle();
-            currentTime = Time_GetTimeuSeconds();
-            uSPerDegree = TriggerDecoder_GetUsPerDegree();
-            dwellTime = IgnitionControl_calcDwellTime();
+            TriggerDecoder_GetSnapshot(&trigger);
+            currentAngle = trigger.currentAngle;
+            currentTime = trigger.timeStamp;
+            uSPerDegree = trigger.usPerDegree;
+            dwellTicks = IgnitionControl_calcDwellTime(uSPerDegree);
 
             if((nextIgnAngle == -1) | (currentAngle == -1) | (uSPerDegree == -1)){
-                printf("Error: Ignition 4 not set, failed confidence check. \n");
-                xEventGroupSetBits( ignitionScheduleFinishedEventGroup,        /* The event group being updated. */
-                                    IGN_SCH_4);                                /* The bits being set. */
+                ignitionRetryStats.noConfidence++;
+                retryBits |= IGN_SCH_4;
             }
             
             else{
@@ -273,32 +552,152 @@ void IgnitionControl_EventCreationTask(void * pvParameters){
                     deltaAngle = (720 - currentAngle) + nextIgnAngle;
                 }
 
-                endTime = currentTime + (uSPerDegree * deltaAngle);
-                ignitionSchedule[3].endTime = endTime;
+                endTime = currentTime + (uint32_t) TIME_US_TO_TICKS(uSPerDegree * deltaAngle);
+                startTime = endTime - dwellTicks;
 
-                startTime = ignitionSchedule[3].endTime - dwellTime;
+                // No time to dwell for this cycle's spark, it has usually just fired
+                // from the last schedule. Aim at the spark one cycle on instead.
+                if(TIME_DIFF(startTime, Time_GetTicks()) < IGNITION_MIN_ARM_TIME){
+                    deltaAngle += 720;
+                    endTime = currentTime + (uint32_t) TIME_US_TO_TICKS(uSPerDegree * deltaAngle);
+                    startTime = endTime - dwellTicks;
+                }
+
+                ignitionSchedule[3].endTime = endTime;
                 ignitionSchedule[3].startTime = startTime;
 
-                if(startTime <= currentTime){
-					printf("Error: Ignition 4 not set, event set in past. \n");
-					xEventGroupSetBits( ignitionScheduleFinishedEventGroup,        /* The event group being updated. */
-										IGN_SCH_4);                                /* The bits being set. */
+                if(TIME_DIFF(startTime, Time_GetTicks()) < IGNITION_MIN_ARM_TIME){
+					ignitionRetryStats.late++;
+					retryBits |= IGN_SCH_4;
 				}
                 else{
-                    WRITE_REG(TIM2->CCR4, ignitionSchedule[3].startTime);
-                    ignitionSchedule[3].status = PENDING;
+                    IgnitionControl_setSparkAngle(3, nextIgnAngle, dwellTicks);
+                    IgnitionControl_armSchedule(3);
                 }
             }
+
+            IGNITION_CYCLES_END();
         }   
     }
 }
 /*****************************************************************************/
 
 
+/******************************************************************************
+* void IgnitionControl_setSparkAngle(x, sparkAngle, dwellTicks)
+* Stores the spark angle and dwell of an ignition schedule for the teeth to
+* time it from. Must be called before the schedule is set to PENDING.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void IgnitionControl_setSparkAngle(int32_t x, float sparkAngle, uint32_t dwellTicks){
+    ignitionSchedule[x].sparkAngle = sparkAngle;
+    ignitionSchedule[x].dwellTicks = dwellTicks;
+}
+/*****************************************************************************/
+
+
+/******************************************************************************
+* void IgnitionControl_armSchedule(int32_t x)
+* Loads the dwell start of an ignition schedule into its compare register and
+* enables its interupt. A flag left by the old compare value is cleared
+* first. TIM2_IRQHandler disables the interupt again when the schedule ends.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void IgnitionControl_armSchedule(int32_t x){
+    taskENTER_CRITICAL();
+    WRITE_REG(*ignitionCompare[x], ignitionSchedule[x].startTime - IGNITION_COMPARE_LEAD);
+    CLEAR_BIT(TIM2->SR, TIM_SR_CC1IF << x);
+    ignitionSchedule[x].status = PENDING;
+    SET_BIT(TIM2->DIER, TIM_DIER_CC1IE << x);
+    taskEXIT_CRITICAL();
+}
+/*****************************************************************************/
+
+
+/******************************************************************************
+* void IgnitionControl_toothCallback(primaryEventNumber, timeStamp, usPerDegree)
+* Called by the trigger decoder on every primary event. Every schedule whose
+* spark has not fired yet has its spark time worked out again from this
+* tooth's time and the latest tooth period. The schedule is made a cycle
+* ahead from one speed, and a speed a little off (compression ripple, or the
+* engine speeding up) adds up to degrees over 720. Timed again from each tooth,
+* the last time is never extrapolated further than one tooth gap. If the
+* dwell has not started yet it is moved with the spark.
+*
+* Runs from the trigger ISRs, or the decoder task with interrupts masked, so
+* TIM2_IRQHandler can not run at the same time.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void IgnitionControl_toothCallback(uint32_t primaryEventNumber, uint32_t timeStamp, float usPerDegree){
+    int32_t x;
+    uint32_t currentTime;
+    uint32_t endTime;
+    uint32_t startTime;
+    int32_t halfCycle;
+    int32_t moved;
+    float offset;
+    float toothAngle;
+
+    currentTime = Time_GetTicks();
+    toothAngle = TriggerDecoder_GetToothAngle(primaryEventNumber);
+    halfCycle = (int32_t) TIME_US_TO_TICKS(usPerDegree * 360.0f);
+
+    for(x = 0; x < 4; x++){
+        if(ignitionSchedule[x].status == OFF){
+            continue;
+        }
+
+        offset = ignitionSchedule[x].sparkAngle - toothAngle;
+        if(offset < 0){
+            offset += 720;
+        }
+        endTime = timeStamp + (uint32_t) TIME_US_TO_TICKS(offset * usPerDegree);
+
+        // A spark aimed a cycle ahead is passed once before it is due, and so is one
+        // that is running late past its angle. Only move a spark by less than half a cycle.
+        moved = TIME_DIFF(endTime, ignitionSchedule[x].endTime);
+        if((moved > halfCycle) || (moved < -halfCycle)){
+            continue;
+        }
+
+        // Too late to move the spark, keep the time it was scheduled with
+        if(TIME_DIFF(endTime, currentTime) < IGNITION_MIN_ARM_TIME){
+            continue;
+        }
+
+        if(ignitionSchedule[x].status == RUNNING){
+            // Dwell has started, only the spark can move
+            ignitionSchedule[x].endTime = endTime;
+            WRITE_REG(*ignitionCompare[x], endTime - IGNITION_COMPARE_LEAD);
+        }
+        else if(ignitionSchedule[x].status == PENDING){
+            // The new spark time is loaded when the dwell starts. Move the dwell start with it if
+            // there is still time, otherwise the dwell is a little longer or shorter this cycle.
+            // A spark that has moved to before the dwell start (the engine sped up a lot since
+            // the schedule was made) keeps the time it was scheduled with, or it would be armed
+            // in the past and not fire until TIM2 came round again.
+            startTime = endTime - ignitionSchedule[x].dwellTicks;
+            if(TIME_DIFF(startTime, currentTime) >= IGNITION_MIN_ARM_TIME){
+                ignitionSchedule[x].endTime = endTime;
+                ignitionSchedule[x].startTime = startTime;
+                WRITE_REG(*ignitionCompare[x], startTime - IGNITION_COMPARE_LEAD);
+            }
+            else if(TIME_DIFF(endTime, ignitionSchedule[x].startTime) > (int32_t) IGNITION_MIN_REARM_LEAD){
+                ignitionSchedule[x].endTime = endTime;
+            }
+        }
+    }
+}
+/*****************************************************************************/
+
+
 /******************************************************************************
 * void TIM2_IRQHandler(void)
-* Handler for timer 2. Timer 2 overflows approximatly every 71 minutes. 
-* This interupt handles all ignition schedule callback functions. 
+* Handler for timer 2. Timer 2 overflows approximatly every 71 minutes, the
+* overflows are counted by Time for the 64 bit time.
+* This interupt handles all ignition schedule callback functions. A channel's
+* compare interupt is only enabled while its schedule is set, the old compare
+* value matches again each time the count comes round.
 * David Tolsma, 05/25/2020
 ******************************************************************************/
 void TIM2_IRQHandler(void){
@@ -307,8 +706,16 @@ void TIM2_IRQHandler(void){
     uint32_t notificationBit;
 
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+#ifdef LATENCY_MEASURE
+    latencyEntry_t latencyEntry;
+#endif
+
+    LATENCY_ISR_ENTER(latencyEntry);
 
-    irqStatus = TIM2->SR;
+    // Compare flags are still set by channels that are not armed, only the
+    // enabled ones are handled
+    irqStatus = TIM2->SR & TIM2->DIER;
+    LATENCY_ISR_TIMER_EVENT(latencyEntry, TIM2, irqStatus);
 
     //Check for count compare interupts
     if(irqStatus & TIM_SR_CC1IF){
@@ -320,26 +727,30 @@ void TIM2_IRQHandler(void){
 			case PENDING:{
 				ignitionSchedule[x].startCallback();
 				ignitionSchedule[x].status = RUNNING;
-				TIM2->CCR1 = ignitionSchedule[x].endTime;
+				TIM2->CCR1 = ignitionSchedule[x].endTime - IGNITION_COMPARE_LEAD;
 				break;
 			}
 			case RUNNING:{
 				ignitionSchedule[x].endCallback();
 				ignitionSchedule[x].status = OFF;
-
-				// Inform that the relevant ignition schedule is now off.
-				xEventGroupSetBitsFromISR(  ignitionScheduleFinishedEventGroup,      /* The event group being updated. */
-											notificationBit,                    /* The bits being set. */
-											&xHigherPriorityTaskWoken );
+				CLEAR_BIT(TIM2->DIER, TIM_DIER_CC1IE << x);
+
+				// Create the next spark of this schedule while ignition is started
+				if(ignitionEnabled){
+					LATENCY_TASK_READY(LATENCY_IGNITION_TASK);
+					xTaskNotifyFromISR(IgnitionControlEventCreationTaskHandle,
+					                   notificationBit,
+					                   eSetBits,
+					                   &xHigherPriorityTaskWoken);
+				}
 
 				break;
 			}
-			case OFF:{
-				while(1); //should never be in IRQ with no schedule
-				break;
-			}
+			case OFF:
 			default:{
-				while(1); //should never be in IRQ with no schedule
+				// A schedule that is not set has its interupt disabled, so only a
+				// stale flag gets here. It is already cleared, make sure it stays off.
+				CLEAR_BIT(TIM2->DIER, TIM_DIER_CC1IE << x);
 				break;
 			}
 		}
@@ -354,26 +765,30 @@ void TIM2_IRQHandler(void){
 			case PENDING:{
 				ignitionSchedule[x].startCallback();
 				ignitionSchedule[x].status = RUNNING;
-				TIM2->CCR2 = ignitionSchedule[x].endTime;
+				TIM2->CCR2 = ignitionSchedule[x].endTime - IGNITION_COMPARE_LEAD;
 				break;
 			}
 			case RUNNING:{
 				ignitionSchedule[x].endCallback();
 				ignitionSchedule[x].status = OFF;
-
-				// Inform that the relevant ignition schedule is now off.
-				xEventGroupSetBitsFromISR(  ignitionScheduleFinishedEventGroup,      /* The event group being updated. */
-											notificationBit,                    /* The bits being set. */
-											&xHigherPriorityTaskWoken );
+				CLEAR_BIT(TIM2->DIER, TIM_DIER_CC1IE << x);
+
+				// Create the next spark of this schedule while ignition is started
+				if(ignitionEnabled){
+					LATENCY_TASK_READY(LATENCY_IGNITION_TASK);
+					xTaskNotifyFromISR(IgnitionControlEventCreationTaskHandle,
+					                   notificationBit,
+					                   eSetBits,
+					                   &xHigherPriorityTaskWoken);
+				}
 
 				break;
 			}
-			case OFF:{
-				while(1); //should never be in IRQ with no schedule
-				break;
-			}
+			case OFF:
 			default:{
-				while(1); //should never be in IRQ with no schedule
+				// A schedule that is not set has its interupt disabled, so only a
+				// stale flag gets here. It is already cleared, make sure it stays off.
+				CLEAR_BIT(TIM2->DIER, TIM_DIER_CC1IE << x);
 				break;
 			}
         }
@@ -388,26 +803,30 @@ void TIM2_IRQHandler(void){
 			case PENDING:{
 				ignitionSchedule[x].startCallback();
 				ignitionSchedule[x].status = RUNNING;
-				TIM2->CCR3 = ignitionSchedule[x].endTime;
+				TIM2->CCR3 = ignitionSchedule[x].endTime - IGNITION_COMPARE_LEAD;
 				break;
 			}
 			case RUNNING:{
 				ignitionSchedule[x].endCallback();
 				ignitionSchedule[x].status = OFF;
+				CLEAR_BIT(TIM2->DIER, TIM_DIER_CC1IE << x);
+
+				// Create the next spark of this schedule while ignition is started
+				if(ignitionEnabled){
+					LATENCY_TASK_READY(LATENCY_IGNITION_TASK);
+					xTaskNotifyFromISR(IgnitionControlEventCreationTaskHandle,
+					                   notificationBit,
+					                   eSetBits,
+					                   &xHigherPriorityTaskWoken);
+				}
 
-				// Inform that the relevant ignition schedule is now off.
-				xEventGroupSetBitsFromISR(  ignitionScheduleFinishedEventGroup,      /* The event group being updated. */
-											notificationBit,                    /* The bits being set. */
-											&xHigherPriorityTaskWoken );
-
-				break;
-			}
-			case OFF:{
-				while(1); //should never be in IRQ with no schedule
 				break;
 			}
+			case OFF:
 			default:{
-				while(1); //should never be in IRQ with no schedule
+				// A schedule that is not set has its interupt disabled, so only a
+				// stale flag gets here. It is already cleared, make sure it stays off.
+				CLEAR_BIT(TIM2->DIER, TIM_DIER_CC1IE << x);
 				break;
 			}
         }
@@ -422,36 +841,43 @@ void TIM2_IRQHandler(void){
 			case PENDING:{
 				ignitionSchedule[x].startCallback();
 				ignitionSchedule[x].status = RUNNING;
-				TIM2->CCR4 = ignitionSchedule[x].endTime;
+				TIM2->CCR4 = ignitionSchedule[x].endTime - IGNITION_COMPARE_LEAD;
 				break;
 			}
 			case RUNNING:{
 				ignitionSchedule[x].endCallback();
 				ignitionSchedule[x].status = OFF;
+				CLEAR_BIT(TIM2->DIER, TIM_DIER_CC1IE << x);
+
+				// Create the next spark of this schedule while ignition is started
+				if(ignitionEnabled){
+					LATENCY_TASK_READY(LATENCY_IGNITION_TASK);
+					xTaskNotifyFromISR(IgnitionControlEventCreationTaskHandle,
+					                   notificationBit,
+					                   eSetBits,
+					                   &xHigherPriorityTaskWoken);
+				}
 
-				// Inform that the relevant ignition schedule is now off.
-				xEventGroupSetBitsFromISR(  ignitionScheduleFinishedEventGroup,      /* The event group being updated. */
-											notificationBit,                    /* The bits being set. */
-											&xHigherPriorityTaskWoken );
-
-				break;
-			}
-			case OFF:{
-				while(1); //should never be in IRQ with no schedule
 				break;
 			}
+			case OFF:
 			default:{
-				while(1); //should never be in IRQ with no schedule
+				// A schedule that is not set has its interupt disabled, so only a
+				// stale flag gets here. It is already cleared, make sure it stays off.
+				CLEAR_BIT(TIM2->DIER, TIM_DIER_CC1IE << x);
 				break;
 			}
         }
     }
 
-    // Check for update interupts
+    // Check for update interupts, timer 2 has overflowed
     if (irqStatus & TIM_SR_UIF){
         CLEAR_BIT(TIM2->SR, TIM_SR_UIF);
+        Time_Timer2UpdateFromISR();
         x = -1; // in this case, we dont want to run the state machine
     }
+
+    LATENCY_ISR_EXIT(latencyEntry, LATENCY_IGNITION_ISR);
     
     // If we have woken a higer priority task, we should yield to that task
     portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
@@ -462,51 +888,132 @@ void TIM2_IRQHandler(void){
 /******************************************************************************
 * float IgnitionControl_calcNextIgnitionAngle(int32_t ignSchedule)
 * 
-* This function takes an ignition shceudule input and returns a fixed ignition
-* angle as an output. It is fixed for testing purpouses, but will later dynamicly
-* change the ignition angle based on engine conditions.
+* This function takes an ignition schedule input and returns the angle in the
+* 720 degree cycle to spark at. The advance comes from the spark table at the
+* current rpm and load, plus the trim of that cylinder.
 * 
-* David Tolsma, 05/25/2020
+* David Tolsma, 10/17/2026
 ******************************************************************************/
 float IgnitionControl_calcNextIgnitionAngle(int32_t ignSchedule){
     float ignAngle;
+    float advance;
+    float load;
+    uint32_t cylinder;
 
     switch(ignSchedule){
         case IGN_SCH_1: {
-            ignAngle = 90;
+            cylinder = 0;
             break;
         }
         case IGN_SCH_2: {
-            ignAngle = 270;
+            cylinder = 1;
             break;
         }
         case IGN_SCH_3: {
-            ignAngle = 450;
+            cylinder = 2;
             break;
         }
         case IGN_SCH_4: {
-            ignAngle = 630;
+            cylinder = 3;
             break;
         }
         default: while(1);
     }
-    
+
+    load = (float) Calibration_Read(IGNITION_LOAD_SENSOR) * 0.1f;
+    advance = Table3D_Lookup(&ignitionSparkTable, TriggerDecoder_GetRPM(), load);
+    ignitionLastAdvance = advance;
+    advance += ignitionSparkTrim[cylinder];
+
+    ignAngle = ENGINE_TDC_ANGLE(cylinder) - advance;
+    if(ignAngle < 0){
+        ignAngle += 720;
+    }
+    else if(ignAngle >= 720){
+        ignAngle -= 720;
+    }
+
     return ignAngle;
 }
 /*****************************************************************************/
 
 
+
+/******************************************************************************
+* float IgnitionControl_GetAdvance(void)
+* Returns the spark table advance, in degrees before TDC, of the last spark
+* created. Cylinder trims are not included.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+float IgnitionControl_GetAdvance(void){
+    return ignitionLastAdvance;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* float IgnitionControl_GetDwell(void)
+* Returns the dwell of the last spark created, in microseconds
+* David Tolsma, 10/17/2026
+******************************************************************************/
+float IgnitionControl_GetDwell(void){
+    return TIME_TICKS_TO_US((float) ignitionLastDwellTicks);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void IgnitionControl_GetRetryStats(ignitionRetryStats_t * stats)
+* Copies the counts of schedules that had to be tried again. A schedule that
+* can not be set is tried every IGNITION_RETRY_TIME, so these count up fast
+* while the decoder is gaining sync.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void IgnitionControl_GetRetryStats(ignitionRetryStats_t * stats){
+    taskENTER_CRITICAL();
+    *stats = ignitionRetryStats;
+    taskEXIT_CRITICAL();
+}
+/*****************************************************************************/
+
+
 /******************************************************************************
-* int32_t IgnitionControl_calcDwellTime(void)
+* uint32_t IgnitionControl_calcDwellTime(float uSPerDegree)
 * 
-* This function returns the currently needed dwell time for the ignition events.
-* It currentle returns a fixed 1ms dwell time, but will later dynamicly change
-* dwell time based on engine conditions. 
+* This function returns the dwell for the next spark of an ignition schedule,
+* in timer ticks. It comes from the dwell table at the battery voltage and the
+* current rpm, or IGNITION_CRANKING_RPM while cranking. Either way it is
+* limited to IGNITION_MAX_DWELL_DUTY of the time between sparks.
 *
-* David Tolsma, 05/25/2020
+* It is worked out once per cycle when the schedule is created, and the ticks
+* are kept with the schedule for the reference tooth to use.
+*
+* David Tolsma, 10/17/2026
 ******************************************************************************/
-int32_t IgnitionControl_calcDwellTime(void){
-    return 1000; // returns a fixed dwell time of 1mS
+uint32_t IgnitionControl_calcDwellTime(float uSPerDegree){
+    float rpm;
+    float battery;
+    float dwell;
+    float maxDwell;
+
+    rpm = TriggerDecoder_GetRPM();
+    if(rpm < IGNITION_CRANKING_RPM){
+        rpm = IGNITION_CRANKING_RPM;
+    }
+
+    battery = (float) Calibration_Read(SENSOR_BAT) * 0.001f;
+    dwell = Table3D_Lookup(&ignitionDwellTable, rpm, battery);
+
+    maxDwell = uSPerDegree * (IGNITION_COIL_SPARK_ANGLE * IGNITION_MAX_DWELL_DUTY);
+    if((uSPerDegree > 0) && (dwell > maxDwell)){
+        dwell = maxDwell;
+    }
+
+    ignitionLastDwellTicks = (uint32_t) TIME_US_TO_TICKS(dwell);
+
+    return ignitionLastDwellTicks;
 }
 /*****************************************************************************/
 
@@ -550,4 +1057,135 @@ void testStartCallback4(void){
 void testEndCallback4(void){
 	Gpio_ResetPin(PP_4_PORT, PP_4_PIN);
 }
-/*****************************************************************************/
\ No newline at end of file
+/*****************************************************************************/
+
+
+#ifdef IGNITION_OUTPUT_COMPARE
+/******************************************************************************
+* void IgnitionControl_outputCompareInit(void)
+* Routes PP_1/PP_2 to TIM3_CH1/CH2 and PP_3/PP_4 to TIM4_CH1/CH2. Both timers
+* are reset by TIM2, so their 16 bit counts are the low half of the TIM2 time
+* base and a compare value is simply the low 16 bits of a TIM2 time.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void IgnitionControl_outputCompareInit(void){
+    SET_BIT(RCC->APB1ENR1, RCC_APB1ENR1_TIM3EN);
+    SET_BIT(RCC->APB1ENR1, RCC_APB1ENR1_TIM4EN);
+
+    // Count at the same rate as TIM2
+    WRITE_REG(TIM3->PSC, READ_REG(TIM2->PSC));
+    WRITE_REG(TIM4->PSC, READ_REG(TIM2->PSC));
+    WRITE_REG(TIM3->ARR, 0xFFFF);
+    WRITE_REG(TIM4->ARR, 0xFFFF);
+
+    // Channels 1 and 2 are outputs with no preload, starting forced inactive (coils off)
+    MODIFY_REG(TIM3->CCMR1, TIM_CCMR1_CC1S | TIM_CCMR1_OC1PE | TIM_CCMR1_OC1M | TIM_CCMR1_CC2S | TIM_CCMR1_OC2PE | TIM_CCMR1_OC2M,
+                            TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC2M_2);
+    MODIFY_REG(TIM4->CCMR1, TIM_CCMR1_CC1S | TIM_CCMR1_OC1PE | TIM_CCMR1_OC1M | TIM_CCMR1_CC2S | TIM_CCMR1_OC2PE | TIM_CCMR1_OC2M,
+                            TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC2M_2);
+
+    // Enable the outputs, active high
+    SET_BIT(TIM3->CCER, TIM_CCER_CC1E | TIM_CCER_CC2E);
+    SET_BIT(TIM4->CCER, TIM_CCER_CC1E | TIM_CCER_CC2E);
+
+    // Slave reset mode on ITR1 (TIM2 TRGO), so an update of TIM2 restarts both timers with it
+    MODIFY_REG(TIM3->SMCR, TIM_SMCR_TS | TIM_SMCR_SMS, TIM_SMCR_TS_0 | TIM_SMCR_SMS_2);
+    MODIFY_REG(TIM4->SMCR, TIM_SMCR_TS | TIM_SMCR_SMS, TIM_SMCR_TS_0 | TIM_SMCR_SMS_2);
+
+    // Start the timers, Main lines them up with TIM2 once every slave is set up
+    SET_BIT(TIM3->CR1, TIM_CR1_CEN);
+    SET_BIT(TIM4->CR1, TIM_CR1_CEN);
+
+    // Hand the pins over to the timers
+    Gpio_SetAlternateFunction(PP_1_PORT, PP_1_PIN, PP_1_COMPARE_AF);
+    Gpio_SetAlternateFunction(PP_2_PORT, PP_2_PIN, PP_2_COMPARE_AF);
+    Gpio_SetAlternateFunction(PP_3_PORT, PP_3_PIN, PP_3_COMPARE_AF);
+    Gpio_SetAlternateFunction(PP_4_PORT, PP_4_PIN, PP_4_COMPARE_AF);
+}
+/*****************************************************************************/
+
+
+/******************************************************************************
+* void IgnitionControl_armOutput(int32_t x, uint32_t time, uint32_t active)
+* Sets up the output compare channel of ignition schedule x to switch its coil
+* on (active) or off at a TIM2 time, which must be less than 65536 ticks away. If the
+* time has already passed by the time it is armed, the output is forced
+* straight away instead of waiting for the 16 bit count to come around.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void IgnitionControl_armOutput(int32_t x, uint32_t time, uint32_t active){
+    TIM_TypeDef * timer = ignitionOutputTimer[x];
+    uint32_t shift;
+    uint32_t matchMode;
+    uint32_t forceMode;
+
+    // OC2M sits 8 bits above OC1M in CCMR1
+    shift = (ignitionOutputChannel[x] == 1) ? 0 : 8;
+
+    if(active){
+        matchMode = TIM_CCMR1_OC1M_0;                       // Set active on match
+        forceMode = TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC1M_0;    // Force active
+    }
+    else{
+        matchMode = TIM_CCMR1_OC1M_1;                       // Set inactive on match
+        forceMode = TIM_CCMR1_OC1M_2;                       // Force inactive
+    }
+
+    if(ignitionOutputChannel[x] == 1){
+        WRITE_REG(timer->CCR1, (uint16_t) time);
+    }
+    else{
+        WRITE_REG(timer->CCR2, (uint16_t) time);
+    }
+    MODIFY_REG(timer->CCMR1, TIM_CCMR1_OC1M << shift, matchMode << shift);
+
+    // Checked after arming, so a match that happens while we check still switches the pin
+    if((int16_t)((uint16_t) time - (uint16_t) READ_REG(timer->CNT)) <= 0){
+        MODIFY_REG(timer->CCMR1, TIM_CCMR1_OC1M << shift, forceMode << shift);
+    }
+}
+/*****************************************************************************/
+
+
+/******************************************************************************
+* void compareStartCallbackx(void)
+* void compareEndCallbackx(void)
+* Start and stop call back functions used with output compare. TIM2 calls
+* these IGNITION_COMPARE_LEAD before the coil edge is due, and they arm the
+* output compare channel to switch the coil at the exact time.
+*
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void compareStartCallback1(void){
+	IgnitionControl_armOutput(0, ignitionSchedule[0].startTime, 1);
+}
+
+void compareEndCallback1(void){
+	IgnitionControl_armOutput(0, ignitionSchedule[0].endTime, 0);
+}
+
+void compareStartCallback2(void){
+	IgnitionControl_armOutput(1, ignitionSchedule[1].startTime, 1);
+}
+
+void compareEndCallback2(void){
+	IgnitionControl_armOutput(1, ignitionSchedule[1].endTime, 0);
+}
+
+void compareStartCallback3(void){
+	IgnitionControl_armOutput(2, ignitionSchedule[2].startTime, 1);
+}
+
+void compareEndCallback3(void){
+	IgnitionControl_armOutput(2, ignitionSchedule[2].endTime, 0);
+}
+
+void compareStartCallback4(void){
+	IgnitionControl_armOutput(3, ignitionSchedule[3].startTime, 1);
+}
+
+void compareEndCallback4(void){
+	IgnitionControl_armOutput(3, ignitionSchedule[3].endTime, 0);
+}
+/*****************************************************************************/
+#endif
@@ -0,0 +1,326 @@
+/******************************************************************************
+* File:                    Latency.c
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Interupt and task wake up timing with the DWT cycle
+*                          counter, see Latency.h.
+*
+* Start latencies are measured in Time_GetTicks ticks from the hardware time
+* stamp (a compare or capture register) to the top of the handler, so they
+* are only as fine as one tick. Build with TIME_TICKS_PER_US at 170 to see
+* single cycles. Run times and task wake ups are counted in cycles.
+*
+* Every timed interupt runs at configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY,
+* so they can not preempt each other part way through a record. Tasks mask
+* them while they record.
+*******************************************************************************
+* Includes
+******************************************************************************/
+#include "Latency.h"
+
+#ifdef LATENCY_MEASURE
+
+#include "Time.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+// Core clock cycles per Time_GetTicks tick
+#define LATENCY_CYCLES_PER_TICK     (TIME_TIMER_CLOCK_MHZ / TIME_TICKS_PER_US)
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+/******************************************************************************
+* Private Function Prototypes (static)
+******************************************************************************/
+static void latency_record(latencySource_t source, uint32_t time, uint32_t latency, uint32_t run);
+static uint32_t latency_bin(uint32_t cycles);
+
+/******************************************************************************
+* Private Variables (static)
+******************************************************************************/
+static latencyStats_t latencyStats[LATENCY_SOURCES];
+
+static latencyRecord_t latencyLog[LATENCY_LOG_SIZE];
+static uint32_t latencyLogHead;
+
+// Cycle count each task was notified at, while latencyReady is set
+static uint32_t latencyReadyTime[LATENCY_SOURCES];
+static volatile uint32_t latencyReady[LATENCY_SOURCES];
+
+/******************************************************************************
+* Function Code
+******************************************************************************/
+
+
+/******************************************************************************
+* void Latency_Init(void)
+* Starts the DWT cycle counter and clears all samples
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void Latency_Init(void){
+    // Start the DWT cycle counter
+    SET_BIT(CoreDebug->DEMCR, CoreDebug_DEMCR_TRCENA_Msk);
+    SET_BIT(DWT->CTRL, DWT_CTRL_CYCCNTENA_Msk);
+
+    Latency_Reset();
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void Latency_IsrEnter(latencyEntry_t * entry)
+* Notes the cycle count and tick time at the top of an interupt
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void Latency_IsrEnter(latencyEntry_t * entry){
+    entry->cycles = DWT->CYCCNT;
+    entry->ticks = Time_GetTicks();
+    entry->eventTime = LATENCY_NO_EVENT_TIME;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void Latency_IsrTimerEvent(latencyEntry_t * entry, TIM_TypeDef * timer, uint32_t status)
+* Takes the event time of a timer interupt from the compare or capture
+* register of the first channel flagged in status, or the update (a count of
+* zero) if none. The 16 bit timers count the low bits of the tick time, the
+* rest is taken from the entry time.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void Latency_IsrTimerEvent(latencyEntry_t * entry, TIM_TypeDef * timer, uint32_t status){
+    uint32_t count;
+
+    if(status & TIM_SR_CC1IF){
+        count = timer->CCR1;
+    }
+    else if(status & TIM_SR_CC2IF){
+        count = timer->CCR2;
+    }
+    else if(status & TIM_SR_CC3IF){
+        count = timer->CCR3;
+    }
+    else if(status & TIM_SR_CC4IF){
+        count = timer->CCR4;
+    }
+    else{
+        count = 0;
+    }
+
+    if(IS_TIM_32B_COUNTER_INSTANCE(timer)){
+        entry->eventTime = count;
+    }
+    else{
+        entry->eventTime = entry->ticks - (uint16_t)((uint16_t) entry->ticks - count);
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void Latency_IsrExit(const latencyEntry_t * entry, latencySource_t source)
+* Records an interupt at the bottom of its handler
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void Latency_IsrExit(const latencyEntry_t * entry, latencySource_t source){
+    uint32_t latency = LATENCY_NO_EVENT_TIME;
+
+    if(entry->eventTime != LATENCY_NO_EVENT_TIME){
+        latency = (entry->ticks - entry->eventTime) * LATENCY_CYCLES_PER_TICK;
+    }
+
+    latency_record(source, entry->cycles, latency, DWT->CYCCNT - entry->cycles);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void Latency_TaskReadyFromISR(latencySource_t source)
+* Notes the time a task was notified. Only the first notify before the task
+* runs counts.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void Latency_TaskReadyFromISR(latencySource_t source){
+    if(latencyReady[source] == 0){
+        latencyReadyTime[source] = DWT->CYCCNT;
+        latencyReady[source] = 1;
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void Latency_TaskRunning(latencySource_t source)
+* Records how long a task waited since it was notified. Wake ups that were
+* not from a timed notify (timeouts, notifies from tasks) are skipped.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void Latency_TaskRunning(latencySource_t source){
+    uint32_t now;
+
+    taskENTER_CRITICAL();
+
+    if(latencyReady[source]){
+        now = DWT->CYCCNT;
+        latency_record(source, now, now - latencyReadyTime[source], LATENCY_NO_RUN_TIME);
+        latencyReady[source] = 0;
+    }
+
+    taskEXIT_CRITICAL();
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void Latency_GetStats(latencySource_t source, latencyStats_t * stats)
+* Copies the statistics of one source
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void Latency_GetStats(latencySource_t source, latencyStats_t * stats){
+    taskENTER_CRITICAL();
+    *stats = latencyStats[source];
+    taskEXIT_CRITICAL();
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t Latency_GetRecords(latencyRecord_t * records, uint32_t maxRecords)
+* Copies up to maxRecords of the newest samples, oldest first, and returns
+* how many were copied
+* David Tolsma, 10/17/2026
+******************************************************************************/
+uint32_t Latency_GetRecords(latencyRecord_t * records, uint32_t maxRecords){
+    uint32_t count;
+    uint32_t index;
+    uint32_t x;
+
+    taskENTER_CRITICAL();
+
+    count = (latencyLogHead < LATENCY_LOG_SIZE) ? latencyLogHead : LATENCY_LOG_SIZE;
+    if(count > maxRecords){
+        count = maxRecords;
+    }
+
+    index = latencyLogHead - count;
+    for(x = 0; x < count; x++){
+        records[x] = latencyLog[(index + x) & LATENCY_LOG_MASK];
+    }
+
+    taskEXIT_CRITICAL();
+
+    return count;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void Latency_Reset(void)
+* Clears all statistics and the ring
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void Latency_Reset(void){
+    uint32_t x;
+    uint32_t y;
+
+    taskENTER_CRITICAL();
+
+    for(x = 0; x < LATENCY_SOURCES; x++){
+        latencyStats[x].count = 0;
+        latencyStats[x].latencyCount = 0;
+        latencyStats[x].runCount = 0;
+        latencyStats[x].latencyMin = 0xFFFFFFFFU;
+        latencyStats[x].latencyMax = 0;
+        latencyStats[x].runMin = 0xFFFFFFFFU;
+        latencyStats[x].runMax = 0;
+        for(y = 0; y < LATENCY_HISTOGRAM_BINS; y++){
+            latencyStats[x].latencyHistogram[y] = 0;
+            latencyStats[x].runHistogram[y] = 0;
+        }
+        latencyReady[x] = 0;
+    }
+    latencyLogHead = 0;
+
+    taskEXIT_CRITICAL();
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void latency_record(latencySource_t source, uint32_t time, uint32_t latency, uint32_t run)
+* Adds a sample to the statistics of its source and to the ring. A latency
+* of LATENCY_NO_EVENT_TIME or a run of LATENCY_NO_RUN_TIME is left out of
+* its statistics. Must be called with the timed interupts masked, or from one
+* of them.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void latency_record(latencySource_t source, uint32_t time, uint32_t latency, uint32_t run){
+    latencyStats_t * stats = &latencyStats[source];
+    latencyRecord_t * record;
+
+    stats->count++;
+
+    if(latency != LATENCY_NO_EVENT_TIME){
+        stats->latencyCount++;
+        if(latency < stats->latencyMin){
+            stats->latencyMin = latency;
+        }
+        if(latency > stats->latencyMax){
+            stats->latencyMax = latency;
+        }
+        stats->latencyHistogram[latency_bin(latency)]++;
+    }
+
+    if(run != LATENCY_NO_RUN_TIME){
+        stats->runCount++;
+        if(run < stats->runMin){
+            stats->runMin = run;
+        }
+        if(run > stats->runMax){
+            stats->runMax = run;
+        }
+        stats->runHistogram[latency_bin(run)]++;
+    }
+
+    record = &latencyLog[latencyLogHead & LATENCY_LOG_MASK];
+    record->time = time;
+    record->latency = latency;
+    record->run = run;
+    record->source = source;
+    latencyLogHead++;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t latency_bin(uint32_t cycles)
+* Returns the histogram bin of a number of cycles, the bit length of the
+* count capped at the last bin
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint32_t latency_bin(uint32_t cycles){
+    uint32_t bin = 32U - __CLZ(cycles);
+
+    return (bin < LATENCY_HISTOGRAM_BINS) ? bin : (LATENCY_HISTOGRAM_BINS - 1U);
+}
+/*****************************************************************************/
+
+#endif // ifdef LATENCY_MEASURE
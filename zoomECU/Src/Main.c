@@ -10,9 +10,14 @@
 #include "Gpio.h"
 #include "PinoutConfiguration.h"
 #include "Time.h"
+#include "Latency.h"
+#include "Scheduler.h"
+#include "Sensors.h"
 #include "IgnitionControl.h"
+#include "FuelControl.h"
 #include "TriggerDecoder.h"
 #include "EngineController.h"
+#include "Datalog.h"
 
 #include "FreeRTOS.h"
 #include "task.h"
@@ -59,14 +64,29 @@ int main(void)
 
 	Time_Timer2Init();
 
+#ifdef LATENCY_MEASURE
+	Latency_Init();
+#endif
+
 	Gpio_Init();
 
+	Scheduler_Init();
+
+	Sensors_Init();
+
 	IgnitionControl_Init();
 
+	FuelControl_Init();
+
 	EngineController_Init();
 
 	TriggerDecoder_Init();
 
+	// Every timer slaved to timer 2 is set up, restart them all together
+	Time_SyncSlaveTimers();
+
+	Datalog_Init();
+
 	vTaskStartScheduler();
 
 	while(1){} // We should never reach here, error trap.
@@ -0,0 +1,329 @@
+/******************************************************************************
+* File:                    Scheduler.c
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Timed output event scheduler on the TIM8 compare
+*                          channels. Any number of events (injectors,
+*                          auxiliary outputs, extra coils) can share a compare
+*                          channel, each channel keeps its events in a min-heap
+*                          ordered by time so the next one is always on top.
+*******************************************************************************
+* Includes
+******************************************************************************/
+#include "Scheduler.h"
+#include "Time.h"
+#include "Latency.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "stm32g4xx.h"
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+/******************************************************************************
+* Private Function Prototypes (static)
+******************************************************************************/
+struct schedulerQueue_t;
+
+static int32_t scheduler_add(uint32_t channel, uint32_t time, schedulerCallback_t callback, void * argument);
+static void scheduler_pop(struct schedulerQueue_t * queue);
+static void scheduler_armChannel(uint32_t channel);
+static void scheduler_serviceChannel(uint32_t channel);
+
+/******************************************************************************
+* Private Variables (static)
+******************************************************************************/
+struct schedulerEvent_t{
+    uint32_t time;
+    schedulerCallback_t callback;
+    void * argument;
+};
+
+// events[0] is always the next event due on the channel
+struct schedulerQueue_t{
+    struct schedulerEvent_t events[SCHEDULER_QUEUE_SIZE];
+    uint32_t count;
+};
+
+static struct schedulerQueue_t schedulerQueue[SCHEDULER_CHANNELS];
+
+// TIM8 is only 16 bits, so a compare matches once every 65536 ticks. Events further
+// away than that just see the compare come around again before they are due.
+static volatile uint32_t * const schedulerCompare[SCHEDULER_CHANNELS] = {&TIM8->CCR1, &TIM8->CCR2, &TIM8->CCR3, &TIM8->CCR4};
+
+/******************************************************************************
+* Function Code
+******************************************************************************/
+
+
+/******************************************************************************
+* void Scheduler_Init(void)
+* Sets up TIM8 as a slave of TIM2, so its count is the low 16 bits of the
+* tick time. The compare interrupt of each channel is only enabled while it
+* has events queued.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void Scheduler_Init(void){
+    // Enable clock to timer
+    SET_BIT(RCC->APB2ENR, RCC_APB2ENR_TIM8EN);
+
+    // Count at the same rate as TIM2
+    WRITE_REG(TIM8->PSC, READ_REG(TIM2->PSC));
+    WRITE_REG(TIM8->ARR, 0xFFFF);
+
+    // Slave reset mode on ITR1 (TIM2 TRGO), so an update of TIM2 restarts TIM8 with it
+    MODIFY_REG(TIM8->SMCR, TIM_SMCR_TS | TIM_SMCR_SMS, TIM_SMCR_TS_0 | TIM_SMCR_SMS_2);
+
+    // Start the timer, Main lines it up with TIM2 once every slave is set up
+    SET_BIT(TIM8->CR1, TIM_CR1_CEN);
+
+    // Clear all interupts
+    CLEAR_REG(TIM8->SR);
+
+    // Set interupt priority to allow for FreeRTOS system calls
+    NVIC_SetPriority(TIM8_CC_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY);
+    NVIC_EnableIRQ(TIM8_CC_IRQn);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* int32_t Scheduler_Add(channel, time, callback, argument)
+* Queues callback(argument) to run from the compare interrupt at a
+* Time_GetTicks time. Events already due run straight away. Returns
+* SCHEDULER_OK, or SCHEDULER_FULL / SCHEDULER_BAD_CHANNEL if the event was
+* not queued. Must only be called from tasks.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+int32_t Scheduler_Add(uint32_t channel, uint32_t time, schedulerCallback_t callback, void * argument){
+    int32_t result;
+
+    taskENTER_CRITICAL();
+    result = scheduler_add(channel, time, callback, argument);
+    taskEXIT_CRITICAL();
+
+    return result;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* int32_t Scheduler_AddFromISR(channel, time, callback, argument)
+* Same as Scheduler_Add, for use from interrupts at or below
+* configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+int32_t Scheduler_AddFromISR(uint32_t channel, uint32_t time, schedulerCallback_t callback, void * argument){
+    UBaseType_t savedInterruptStatus;
+    int32_t result;
+
+    savedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+    result = scheduler_add(channel, time, callback, argument);
+    taskEXIT_CRITICAL_FROM_ISR(savedInterruptStatus);
+
+    return result;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t Scheduler_GetPending(uint32_t channel)
+* Returns the number of events waiting on a channel
+* David Tolsma, 10/17/2026
+******************************************************************************/
+uint32_t Scheduler_GetPending(uint32_t channel){
+    if(channel >= SCHEDULER_CHANNELS){
+        return 0;
+    }
+    return schedulerQueue[channel].count;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* int32_t scheduler_add(channel, time, callback, argument)
+* Inserts an event into the heap of a channel, O(log n). The event sifts up
+* past every event due after it. If it ends up on top, the compare is moved
+* to it. Must be called with interrupts masked.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static int32_t scheduler_add(uint32_t channel, uint32_t time, schedulerCallback_t callback, void * argument){
+    struct schedulerQueue_t * queue;
+    uint32_t child;
+    uint32_t parent;
+
+    if(channel >= SCHEDULER_CHANNELS){
+        return SCHEDULER_BAD_CHANNEL;
+    }
+
+    queue = &schedulerQueue[channel];
+    if(queue->count >= SCHEDULER_QUEUE_SIZE){
+        return SCHEDULER_FULL;
+    }
+
+    // Wrap safe compares, so this holds across the 32 bit wrap
+    child = queue->count;
+    while(child > 0){
+        parent = (child - 1) / 2;
+        if(TIME_DIFF(time, queue->events[parent].time) >= 0){
+            break;
+        }
+        queue->events[child] = queue->events[parent];
+        child = parent;
+    }
+
+    queue->events[child].time = time;
+    queue->events[child].callback = callback;
+    queue->events[child].argument = argument;
+    queue->count++;
+
+    if(child == 0){
+        scheduler_armChannel(channel);
+    }
+
+    return SCHEDULER_OK;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void scheduler_pop(struct schedulerQueue_t * queue)
+* Removes the event on top of a heap, O(log n). The last event is moved to the
+* top and sifts down past every event due before it.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void scheduler_pop(struct schedulerQueue_t * queue){
+    struct schedulerEvent_t last;
+    uint32_t parent;
+    uint32_t child;
+
+    queue->count--;
+    if(queue->count == 0){
+        return;
+    }
+
+    last = queue->events[queue->count];
+    parent = 0;
+    while(1){
+        child = (2 * parent) + 1;
+        if(child >= queue->count){
+            break;
+        }
+
+        // Take the earlier of the two children
+        if(((child + 1) < queue->count) && TIME_BEFORE(queue->events[child + 1].time, queue->events[child].time)){
+            child++;
+        }
+        if(!TIME_AFTER(last.time, queue->events[child].time)){
+            break;
+        }
+
+        queue->events[parent] = queue->events[child];
+        parent = child;
+    }
+    queue->events[parent] = last;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void scheduler_armChannel(uint32_t channel)
+* Loads the compare of a channel with the event on top of its heap. If that
+* event fell due while it was being armed, the compare interrupt is raised in
+* software so it is not left waiting for the count to come around again. An
+* empty channel has its interrupt turned off, or its old compare would match
+* again on every 16 bit wrap.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void scheduler_armChannel(uint32_t channel){
+    struct schedulerQueue_t * queue = &schedulerQueue[channel];
+
+    if(queue->count == 0){
+        CLEAR_BIT(TIM8->DIER, TIM_DIER_CC1IE << channel);
+        return;
+    }
+
+    // A match from while the channel was off must not run the new event early
+    if(!READ_BIT(TIM8->DIER, TIM_DIER_CC1IE << channel)){
+        CLEAR_BIT(TIM8->SR, TIM_SR_CC1IF << channel);
+    }
+
+    WRITE_REG(*schedulerCompare[channel], (uint16_t) queue->events[0].time);
+    SET_BIT(TIM8->DIER, TIM_DIER_CC1IE << channel);
+
+    // EGR reads as zero, so this raises only this channel, and a channel armed
+    // just before in the same critical section keeps its event
+    if(!TIME_AFTER(queue->events[0].time, Time_GetTicks())){
+        SET_BIT(TIM8->EGR, TIM_EGR_CC1G << channel);
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void scheduler_serviceChannel(uint32_t channel)
+* Runs every event on a channel that is due, in time order, then arms the
+* compare for the next one. The next event is always on top of the heap, so
+* a compare that fires early (16 bit wrap) costs one compare and a re-arm.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void scheduler_serviceChannel(uint32_t channel){
+    struct schedulerQueue_t * queue = &schedulerQueue[channel];
+    struct schedulerEvent_t event;
+
+    while((queue->count > 0) && (!TIME_AFTER(queue->events[0].time, Time_GetTicks()))){
+        // Take the event off the heap first, the callback may queue the next one
+        event = queue->events[0];
+        scheduler_pop(queue);
+        event.callback(event.argument);
+    }
+
+    scheduler_armChannel(channel);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void TIM8_CC_IRQHandler(void)
+* Handler for the TIM8 compare channels, each channel runs its due events.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void TIM8_CC_IRQHandler(void){
+    uint32_t irqStatus;
+    uint32_t channel;
+#ifdef LATENCY_MEASURE
+    latencyEntry_t latencyEntry;
+#endif
+
+    LATENCY_ISR_ENTER(latencyEntry);
+
+    irqStatus = TIM8->SR & TIM8->DIER;
+    LATENCY_ISR_TIMER_EVENT(latencyEntry, TIM8, irqStatus);
+
+    for(channel = 0; channel < SCHEDULER_CHANNELS; channel++){
+        if(irqStatus & (TIM_SR_CC1IF << channel)){
+            CLEAR_BIT(TIM8->SR, TIM_SR_CC1IF << channel);
+            scheduler_serviceChannel(channel);
+        }
+    }
+
+    LATENCY_ISR_EXIT(latencyEntry, LATENCY_SCHEDULER_ISR);
+}
+/*****************************************************************************/
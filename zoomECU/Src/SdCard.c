@@ -0,0 +1,597 @@
+/******************************************************************************
+* File:                    SdCard.c
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       SD card in SPI mode on SPI1. Commands and their
+*                          replies are a few bytes and are polled, each 512
+*                          byte block written is moved by DMA1 channels 3 (RX)
+*                          and 4 (TX) while the calling task sleeps on a
+*                          semaphore given by the RX complete interupt. Cards
+*                          hold MISO low while they program a block, that is
+*                          polled in short bursts with a tick of sleep between
+*                          them so lower priority tasks still run.
+*
+* SPI1 runs from the 85MHz APB2 (see SystemClock.c), so the card is identified
+* at 332kHz, under the 400kHz limit, and writes then run at 21.25MHz.
+*******************************************************************************
+* Includes
+******************************************************************************/
+#include "SdCard.h"
+#include "Gpio.h"
+#include "PinoutConfiguration.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "stm32g4xx.h"
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+// SPI1 clock dividers of the 85MHz APB2, /256 (332kHz) to identify the card
+// and /4 (21.25MHz) after
+#define SDCARD_SPI_SLOW             (SPI_CR1_BR_2 | SPI_CR1_BR_1 | SPI_CR1_BR_0)
+#define SDCARD_SPI_FAST             (SPI_CR1_BR_0)
+
+// DMAMUX request inputs for SPI1 (RM0440, DMAMUX request table)
+#define SDCARD_DMAREQ_SPI1_RX       10U
+#define SDCARD_DMAREQ_SPI1_TX       11U
+
+// Commands, ACMDs are sent after CMD55
+#define SDCARD_ACMD                 0x80U
+#define SDCARD_CMD0                 0U      // GO_IDLE_STATE
+#define SDCARD_CMD8                 8U      // SEND_IF_COND
+#define SDCARD_CMD9                 9U      // SEND_CSD
+#define SDCARD_CMD16                16U     // SET_BLOCKLEN
+#define SDCARD_CMD17                17U     // READ_SINGLE_BLOCK
+#define SDCARD_CMD25                25U     // WRITE_MULTIPLE_BLOCK
+#define SDCARD_CMD55                55U     // APP_CMD
+#define SDCARD_CMD58                58U     // READ_OCR
+#define SDCARD_ACMD23               (SDCARD_ACMD | 23U)     // SET_WR_BLK_ERASE_COUNT
+#define SDCARD_ACMD41               (SDCARD_ACMD | 41U)     // SD_SEND_OP_COND
+
+#define SDCARD_R1_IDLE              0x01U
+#define SDCARD_IF_COND              0x000001AAU     // 2.7-3.6V and check pattern 0xAA
+#define SDCARD_HCS                  0x40000000U     // Host supports high capacity cards
+#define SDCARD_OCR_CCS              0x40U           // In the first OCR byte, card is block addressed
+
+#define SDCARD_TOKEN_READ           0xFEU
+#define SDCARD_TOKEN_WRITE_MULTI    0xFCU
+#define SDCARD_TOKEN_STOP           0xFDU
+#define SDCARD_DATA_ACCEPTED        0x05U
+
+// Bytes clocked out waiting for a command reply
+#define SDCARD_REPLY_BYTES          10U
+
+// Busy or read token bytes polled before sleeping a tick, about 25uS at 21.25MHz
+#define SDCARD_BUSY_POLLS           64U
+
+#define SDCARD_START_TIMEOUT_MS     1000U
+#define SDCARD_WRITE_TIMEOUT_MS     500U
+#define SDCARD_READ_TIMEOUT_MS      100U
+#define SDCARD_DMA_TIMEOUT          pdMS_TO_TICKS(10)
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+/******************************************************************************
+* Private Function Prototypes (static)
+******************************************************************************/
+static void sdCard_spiInit(void);
+static uint8_t sdCard_exchange(uint8_t byte);
+static void sdCard_select(void);
+static void sdCard_deselect(void);
+static uint8_t sdCard_command(uint8_t command, uint32_t argument);
+static int32_t sdCard_waitReady(uint32_t timeoutMs);
+static int32_t sdCard_readData(uint8_t * data, uint32_t length);
+static int32_t sdCard_sendBlock(const uint8_t * data);
+static uint32_t sdCard_parseCsd(const uint8_t * csd);
+
+/******************************************************************************
+* Private Variables (static)
+******************************************************************************/
+static SemaphoreHandle_t sdCardDmaDone = NULL;
+
+static uint32_t sdCardBlockCount = 0;
+static uint32_t sdCardHighCapacity = 0;
+
+// The RX DMA channel drops the bytes the card sends back while a block goes out here
+static volatile uint8_t sdCardRxSink;
+
+/******************************************************************************
+* Function Code
+******************************************************************************/
+
+
+/******************************************************************************
+* int32_t SdCard_Init(void)
+* Sets up SPI1 and its DMA, then wakes the card up and reads its size.
+* Returns SDCARD_OK once the card is ready for SdCard_WriteBlocks. Must be
+* called from a task, it sleeps while the card starts.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+int32_t SdCard_Init(void){
+    uint8_t reply[4];
+    uint8_t csd[16];
+    uint8_t r1;
+    uint32_t version2;
+    uint32_t x;
+    TickType_t start;
+
+    sdCardBlockCount = 0;
+
+    if(!SdCard_IsPresent()){
+        return SDCARD_NO_CARD;
+    }
+
+    sdCard_spiInit();
+
+    // At least 74 clocks with the card deselected puts it in SPI mode at the next CMD0
+    sdCard_deselect();
+    for(x = 0; x < 10U; x++){
+        sdCard_exchange(0xFF);
+    }
+
+    sdCard_select();
+
+    r1 = 0xFF;
+    for(x = 0; (x < 10U) && (r1 != SDCARD_R1_IDLE); x++){
+        r1 = sdCard_command(SDCARD_CMD0, 0);
+    }
+    if(r1 != SDCARD_R1_IDLE){
+        sdCard_deselect();
+        return SDCARD_TIMEOUT;
+    }
+
+    // Version 2 cards echo the check pattern, version 1 cards call CMD8 illegal
+    version2 = 0;
+    if(sdCard_command(SDCARD_CMD8, SDCARD_IF_COND) == SDCARD_R1_IDLE){
+        for(x = 0; x < 4U; x++){
+            reply[x] = sdCard_exchange(0xFF);
+        }
+        if(((reply[2] & 0x0FU) != 0x01U) || (reply[3] != 0xAAU)){
+            sdCard_deselect();
+            return SDCARD_ERROR;
+        }
+        version2 = 1;
+    }
+
+    // The card leaves the idle state once its power up is done
+    start = xTaskGetTickCount();
+    while(sdCard_command(SDCARD_ACMD41, version2 ? SDCARD_HCS : 0) != 0){
+        if((xTaskGetTickCount() - start) > pdMS_TO_TICKS(SDCARD_START_TIMEOUT_MS)){
+            sdCard_deselect();
+            return SDCARD_TIMEOUT;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    sdCardHighCapacity = 0;
+    if(version2){
+        if(sdCard_command(SDCARD_CMD58, 0) != 0){
+            sdCard_deselect();
+            return SDCARD_ERROR;
+        }
+        for(x = 0; x < 4U; x++){
+            reply[x] = sdCard_exchange(0xFF);
+        }
+        sdCardHighCapacity = ((reply[0] & SDCARD_OCR_CCS) != 0);
+    }
+
+    // Byte addressed cards are set to 512 byte blocks, high capacity cards always are
+    if(!sdCardHighCapacity && (sdCard_command(SDCARD_CMD16, SDCARD_BLOCK_SIZE) != 0)){
+        sdCard_deselect();
+        return SDCARD_ERROR;
+    }
+
+    if((sdCard_command(SDCARD_CMD9, 0) != 0) || (sdCard_readData(csd, sizeof(csd)) != SDCARD_OK)){
+        sdCard_deselect();
+        return SDCARD_ERROR;
+    }
+
+    sdCard_deselect();
+
+    MODIFY_REG(SPI1->CR1, SPI_CR1_BR, SDCARD_SPI_FAST);
+
+    sdCardBlockCount = sdCard_parseCsd(csd);
+
+    return (sdCardBlockCount > 0) ? SDCARD_OK : SDCARD_ERROR;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t SdCard_IsPresent(void)
+* Returns 1 if SD_DETECT shows a card in the socket
+* David Tolsma, 10/17/2026
+******************************************************************************/
+uint32_t SdCard_IsPresent(void){
+    return (Gpio_ReadInputPin(SD_DETECT_PORT, SD_DETECT_PIN) == SDCARD_DETECT_LEVEL);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t SdCard_GetBlockCount(void)
+* Returns the size of the card in blocks, 0 until SdCard_Init succeeds
+* David Tolsma, 10/17/2026
+******************************************************************************/
+uint32_t SdCard_GetBlockCount(void){
+    return sdCardBlockCount;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* int32_t SdCard_ReadBlock(uint32_t block, uint8_t * data)
+* Reads one block. The bytes are polled rather than moved by DMA, reads are
+* only made while starting a log. Returns one of the SDCARD_ values.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+int32_t SdCard_ReadBlock(uint32_t block, uint8_t * data){
+    int32_t result;
+
+    if(sdCardBlockCount == 0){
+        return SDCARD_NO_CARD;
+    }
+
+    sdCard_select();
+
+    if(sdCard_command(SDCARD_CMD17, sdCardHighCapacity ? block : (block * SDCARD_BLOCK_SIZE)) != 0){
+        sdCard_deselect();
+        return SDCARD_ERROR;
+    }
+
+    result = sdCard_readData(data, SDCARD_BLOCK_SIZE);
+
+    sdCard_deselect();
+
+    return result;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* int32_t SdCard_WriteBlocks(uint32_t block, const uint8_t * data, uint32_t count)
+* Writes count blocks from block on with one multiple block write. The
+* calling task sleeps while each block is moved by DMA and while the card is
+* busy. Returns one of the SDCARD_ values.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+int32_t SdCard_WriteBlocks(uint32_t block, const uint8_t * data, uint32_t count){
+    int32_t result = SDCARD_OK;
+    uint32_t x;
+
+    if(sdCardBlockCount == 0){
+        return SDCARD_NO_CARD;
+    }
+
+    sdCard_select();
+
+    // Telling the card how many blocks are coming lets it erase them ahead of the data
+    if((sdCard_command(SDCARD_ACMD23, count) != 0) ||
+       (sdCard_command(SDCARD_CMD25, sdCardHighCapacity ? block : (block * SDCARD_BLOCK_SIZE)) != 0)){
+        sdCard_deselect();
+        return SDCARD_ERROR;
+    }
+
+    for(x = 0; (x < count) && (result == SDCARD_OK); x++){
+        sdCard_exchange(0xFF);
+        sdCard_exchange(SDCARD_TOKEN_WRITE_MULTI);
+
+        result = sdCard_sendBlock(&data[x * SDCARD_BLOCK_SIZE]);
+
+        if(result == SDCARD_OK){
+            // CRC, not checked in SPI mode
+            sdCard_exchange(0xFF);
+            sdCard_exchange(0xFF);
+
+            if((sdCard_exchange(0xFF) & 0x1FU) != SDCARD_DATA_ACCEPTED){
+                result = SDCARD_ERROR;
+            }
+            else{
+                result = sdCard_waitReady(SDCARD_WRITE_TIMEOUT_MS);
+            }
+        }
+    }
+
+    // The write is ended with the stop token even after a refused block
+    sdCard_exchange(SDCARD_TOKEN_STOP);
+    sdCard_exchange(0xFF);
+    if(sdCard_waitReady(SDCARD_WRITE_TIMEOUT_MS) != SDCARD_OK){
+        result = SDCARD_TIMEOUT;
+    }
+
+    sdCard_deselect();
+
+    return result;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void sdCard_spiInit(void)
+* Sets SPI1 up as an 8 bit mode 0 master at the identification clock, with
+* DMA1 channel 3 on its RX and channel 4 on its TX requests
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void sdCard_spiInit(void){
+    // Enable clocks to SPI1 and the DMA
+    SET_BIT(RCC->APB2ENR, RCC_APB2ENR_SPI1EN);
+    SET_BIT(RCC->AHB1ENR, RCC_AHB1ENR_DMA1EN);
+    SET_BIT(RCC->AHB1ENR, RCC_AHB1ENR_DMAMUX1EN);
+
+    // The pins are set up in Gpio_Init, which leaves NSS low
+    Gpio_SetPin(SD_NSS_PORT, SD_NSS_PIN);
+
+    if(sdCardDmaDone == NULL){
+        sdCardDmaDone = xSemaphoreCreateBinary();
+    }
+
+    // Master, NSS is driven as a GPIO, mode 0
+    CLEAR_BIT(SPI1->CR1, SPI_CR1_SPE);
+    WRITE_REG(SPI1->CR1, SPI_CR1_MSTR | SPI_CR1_SSM | SPI_CR1_SSI | SDCARD_SPI_SLOW);
+
+    // 8 bit frames, RXNE on each byte
+    WRITE_REG(SPI1->CR2, SPI_CR2_DS_2 | SPI_CR2_DS_1 | SPI_CR2_DS_0 | SPI_CR2_FRXTH);
+
+    SET_BIT(SPI1->CR1, SPI_CR1_SPE);
+
+    WRITE_REG(DMAMUX1_Channel2->CCR, SDCARD_DMAREQ_SPI1_RX << DMAMUX_CxCR_DMAREQ_ID_Pos);
+    WRITE_REG(DMAMUX1_Channel3->CCR, SDCARD_DMAREQ_SPI1_TX << DMAMUX_CxCR_DMAREQ_ID_Pos);
+    WRITE_REG(DMA1_Channel3->CPAR, (uint32_t) &SPI1->DR);
+    WRITE_REG(DMA1_Channel4->CPAR, (uint32_t) &SPI1->DR);
+
+    // Storage is never urgent, the DMA interupt is below everything else
+    NVIC_SetPriority(DMA1_Channel3_IRQn, configLIBRARY_LOWEST_INTERRUPT_PRIORITY);
+    NVIC_EnableIRQ(DMA1_Channel3_IRQn);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint8_t sdCard_exchange(uint8_t byte)
+* Sends a byte and returns the byte received with it
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint8_t sdCard_exchange(uint8_t byte){
+    while((SPI1->SR & SPI_SR_TXE) == 0);
+    *((volatile uint8_t *) &SPI1->DR) = byte;
+
+    while((SPI1->SR & SPI_SR_RXNE) == 0);
+    return *((volatile uint8_t *) &SPI1->DR);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void sdCard_select(void)
+* void sdCard_deselect(void)
+* Drive SD_NSS. The card only lets go of MISO on the clock after it is
+* deselected, so one more byte is sent then.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void sdCard_select(void){
+    Gpio_ResetPin(SD_NSS_PORT, SD_NSS_PIN);
+}
+
+static void sdCard_deselect(void){
+    Gpio_SetPin(SD_NSS_PORT, SD_NSS_PIN);
+    sdCard_exchange(0xFF);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint8_t sdCard_command(uint8_t command, uint32_t argument)
+* Sends a command (an ACMD after CMD55) and returns its R1 reply, 0xFF if
+* the card did not answer. Any further reply bytes are left for the caller.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint8_t sdCard_command(uint8_t command, uint32_t argument){
+    uint8_t crc;
+    uint8_t r1;
+    uint32_t x;
+
+    if(command & SDCARD_ACMD){
+        r1 = sdCard_command(SDCARD_CMD55, 0);
+        if(r1 > SDCARD_R1_IDLE){
+            return r1;
+        }
+        command &= (uint8_t) ~SDCARD_ACMD;
+    }
+
+    // Only CMD0 and CMD8 have their CRC checked in SPI mode, the rest just need the end bit
+    if(command == SDCARD_CMD0){
+        crc = 0x95;
+    }
+    else if(command == SDCARD_CMD8){
+        crc = 0x87;
+    }
+    else{
+        crc = 0x01;
+    }
+
+    sdCard_exchange(0xFF);
+    sdCard_exchange(0x40U | command);
+    sdCard_exchange((uint8_t)(argument >> 24));
+    sdCard_exchange((uint8_t)(argument >> 16));
+    sdCard_exchange((uint8_t)(argument >> 8));
+    sdCard_exchange((uint8_t) argument);
+    sdCard_exchange(crc);
+
+    // The reply starts with a 0 bit, within 8 bytes of the command
+    r1 = 0xFF;
+    for(x = 0; (x < SDCARD_REPLY_BYTES) && (r1 & 0x80U); x++){
+        r1 = sdCard_exchange(0xFF);
+    }
+
+    return r1;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* int32_t sdCard_waitReady(uint32_t timeoutMs)
+* Waits for the card to release MISO after a block is programmed
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static int32_t sdCard_waitReady(uint32_t timeoutMs){
+    TickType_t start = xTaskGetTickCount();
+    uint32_t polls = 0;
+
+    while(sdCard_exchange(0xFF) != 0xFF){
+        polls++;
+        if(polls >= SDCARD_BUSY_POLLS){
+            if((xTaskGetTickCount() - start) > pdMS_TO_TICKS(timeoutMs)){
+                return SDCARD_TIMEOUT;
+            }
+            vTaskDelay(1);
+            polls = 0;
+        }
+    }
+
+    return SDCARD_OK;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* int32_t sdCard_readData(uint8_t * data, uint32_t length)
+* Reads a data block the card sends after a read command, the CSD or a block
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static int32_t sdCard_readData(uint8_t * data, uint32_t length){
+    TickType_t start = xTaskGetTickCount();
+    uint32_t polls = 0;
+    uint8_t token;
+    uint32_t x;
+
+    // A block read can keep the card busy for up to 100mS before the data comes
+    while((token = sdCard_exchange(0xFF)) == 0xFF){
+        polls++;
+        if(polls >= SDCARD_BUSY_POLLS){
+            if((xTaskGetTickCount() - start) > pdMS_TO_TICKS(SDCARD_READ_TIMEOUT_MS)){
+                return SDCARD_TIMEOUT;
+            }
+            vTaskDelay(1);
+            polls = 0;
+        }
+    }
+    if(token != SDCARD_TOKEN_READ){
+        return SDCARD_ERROR;
+    }
+
+    for(x = 0; x < length; x++){
+        data[x] = sdCard_exchange(0xFF);
+    }
+
+    // CRC
+    sdCard_exchange(0xFF);
+    sdCard_exchange(0xFF);
+
+    return SDCARD_OK;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* int32_t sdCard_sendBlock(const uint8_t * data)
+* Moves one block to the card by DMA. RX is set up first so no received byte
+* overruns, and the RX complete means the last byte has left the shifter.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static int32_t sdCard_sendBlock(const uint8_t * data){
+    int32_t result = SDCARD_OK;
+
+    WRITE_REG(DMA1_Channel3->CMAR, (uint32_t) &sdCardRxSink);
+    WRITE_REG(DMA1_Channel3->CNDTR, SDCARD_BLOCK_SIZE);
+    WRITE_REG(DMA1_Channel3->CCR, DMA_CCR_TCIE);
+
+    WRITE_REG(DMA1_Channel4->CMAR, (uint32_t) data);
+    WRITE_REG(DMA1_Channel4->CNDTR, SDCARD_BLOCK_SIZE);
+    WRITE_REG(DMA1_Channel4->CCR, DMA_CCR_DIR | DMA_CCR_MINC);
+
+    SET_BIT(SPI1->CR2, SPI_CR2_RXDMAEN);
+    SET_BIT(DMA1_Channel3->CCR, DMA_CCR_EN);
+    SET_BIT(DMA1_Channel4->CCR, DMA_CCR_EN);
+    SET_BIT(SPI1->CR2, SPI_CR2_TXDMAEN);
+
+    if(xSemaphoreTake(sdCardDmaDone, SDCARD_DMA_TIMEOUT) != pdTRUE){
+        result = SDCARD_TIMEOUT;
+    }
+
+    CLEAR_BIT(DMA1_Channel3->CCR, DMA_CCR_EN);
+    CLEAR_BIT(DMA1_Channel4->CCR, DMA_CCR_EN);
+    CLEAR_BIT(SPI1->CR2, SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN);
+
+    return result;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t sdCard_parseCsd(const uint8_t * csd)
+* Returns the size in blocks from a version 1 or 2 CSD, 0 if unknown
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint32_t sdCard_parseCsd(const uint8_t * csd){
+    uint32_t size;
+    uint32_t multiplier;
+    uint32_t blockLength;
+
+    switch(csd[0] >> 6){
+        case 0:{
+            // Standard capacity: (C_SIZE + 1) * 2^(C_SIZE_MULT + 2) blocks of 2^READ_BL_LEN bytes
+            blockLength = csd[5] & 0x0FU;
+            size = ((uint32_t)(csd[6] & 0x03U) << 10) | ((uint32_t) csd[7] << 2) | ((uint32_t) csd[8] >> 6);
+            multiplier = ((uint32_t)(csd[9] & 0x03U) << 1) | ((uint32_t) csd[10] >> 7);
+            return (size + 1U) << (multiplier + 2U + blockLength - 9U);
+        }
+        case 1:{
+            // High capacity: (C_SIZE + 1) * 512kB
+            size = ((uint32_t)(csd[7] & 0x3FU) << 16) | ((uint32_t) csd[8] << 8) | (uint32_t) csd[9];
+            return (size + 1U) * 1024U;
+        }
+        default:{
+            return 0;
+        }
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void DMA1_Channel3_IRQHandler(void)
+* SPI1 RX DMA complete, the block has gone out. Wakes the writing task.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void DMA1_Channel3_IRQHandler(void){
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    // Clear interupt source
+    WRITE_REG(DMA1->IFCR, DMA_IFCR_CGIF3);
+
+    xSemaphoreGiveFromISR(sdCardDmaDone, &xHigherPriorityTaskWoken);
+
+    // If we have woken a higer priority task, we should yield to that task
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+/*****************************************************************************/
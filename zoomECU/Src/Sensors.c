@@ -0,0 +1,697 @@
+/******************************************************************************
+* File:                    Sensors.c
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Continuous DMA scan of the analog sensor inputs.
+*                          Each ADC scans its sensors over and over, every
+*                          conversion oversampled to 16 bits in hardware, and
+*                          DMA writes the results into a double buffer. No
+*                          interupts are used, readers take whichever half
+*                          of the buffer DMA is not writing.
+*                          MAP can also be sampled at set crank angles, with
+*                          injected conversions started by TIM6 in hardware.
+*******************************************************************************
+* Includes
+******************************************************************************/
+#include "Sensors.h"
+#include "PinoutConfiguration.h"
+#include "TriggerDecoder.h"
+#include "Time.h"
+#include "EngineController.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "stm32g4xx.h"
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+// The sensor pins are spread over ADC1 to ADC4
+#define SENSORS_ADC_COUNT           4U
+
+// Most sensors scanned by a single ADC, the scan is kept in SQR1
+#define SENSORS_MAX_PER_ADC         4U
+
+// DMAMUX request inputs of the ADCs (RM0440, DMAMUX request table)
+#define SENSORS_DMAREQ_ADC1         5U
+#define SENSORS_DMAREQ_ADC2         36U
+#define SENSORS_DMAREQ_ADC3         37U
+#define SENSORS_DMAREQ_ADC4         38U
+
+// Sample time of every channel, 92.5 ADC clocks (SMPx = 101). With the ADC
+// clocked at HCLK / 4 (42.5 Mhz) one conversion takes 2.5uS, so with 256x
+// oversampling each sensor is read about every 630uS times its scan length.
+#define SENSORS_SAMPLE_TIME         0x5U
+
+// Oversample 256x (OVSR = 111) and shift the 20 bit sum right by 4 (OVSS = 0100)
+// for a 16 bit result
+#define SENSORS_OVERSAMPLE          (ADC_CFGR2_ROVSE | ADC_CFGR2_OVSR | ADC_CFGR2_OVSS_2)
+
+// ADC voltage regulator start up time (T_ADCVREG_STUP)
+#define SENSORS_REGULATOR_STARTUP   20U
+
+// Most crank angle MAP samples over all windows in one engine cycle
+#define SENSORS_MAP_MAX_SAMPLES     32U
+
+// TIM6 times each MAP sample from its tooth in steps of this many uS. TIM6 is
+// 16 bits, so a sample can be up to 262mS after its tooth (one 180* gap at
+// 115 rpm). Samples further out than that are skipped.
+#define SENSORS_MAP_TIMER_US        4U
+#define SENSORS_MAP_TIMER_MAX       0xFFFFU
+
+// ADC1/2 injected trigger input of TIM6_TRGO (RM0440, ADC1/2 injected triggers)
+#define SENSORS_JEXTSEL_TIM6_TRGO   14U
+
+// Injected conversions are not oversampled, 12 bits are scaled up to the raw range
+#define SENSORS_INJECTED_SHIFT      4U
+
+// MAP windows store the lowest reading in the upper half and the average in the lower
+#define SENSORS_MAP_PACK(minimum, average)  (((uint32_t)(minimum) << 16) | (uint32_t)(average))
+
+// Default MAP windows set up by Sensors_Init, one per cylinder over the middle
+// of its intake stroke. Intake TDC is a turn after compression TDC.
+#define SENSORS_MAP_DEFAULT_START       30.0f       // Degrees after intake TDC
+#define SENSORS_MAP_DEFAULT_END         150.0f
+#define SENSORS_MAP_DEFAULT_SAMPLES     4U
+
+_Static_assert(ENGINE_CYLINDERS <= SENSORS_MAP_MAX_CYLINDERS, "One MAP window per cylinder");
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+/******************************************************************************
+* Private Function Prototypes (static)
+******************************************************************************/
+static void sensors_adcInit(uint32_t adcIndex);
+static void sensors_mapInit(void);
+static void sensors_mapDefaultWindows(void);
+static void sensors_mapToothCallback(uint32_t primaryEventNumber, uint32_t timeStamp, float usPerDegree);
+static void sensors_mapSelectSample(uint32_t sample);
+static void sensors_mapArm(void);
+static void sensors_mapStore(uint32_t value);
+
+
+/******************************************************************************
+* Private Variables (static)
+******************************************************************************/
+struct sensorInput_t{
+    uint32_t adcIndex;          // Index into sensorsAdc
+    uint32_t channel;           // ADCx_INy input of the sensor pin
+};
+
+struct sensorsAdc_t{
+    ADC_TypeDef * adc;
+    DMA_Channel_TypeDef * dma;
+    DMAMUX_Channel_TypeDef * dmamux;
+    uint32_t request;
+};
+
+// Where each sensor is read, in sensor_t order
+static const struct sensorInput_t sensorInputs[SENSOR_COUNT] = {
+    {0, MAP_ADC_CHANNEL},
+    {0, AFM_ADC_CHANNEL},
+    {1, TPS_ADC_CHANNEL},
+    {2, O2_ADC_CHANNEL},
+    {3, IAT_ADC_CHANNEL},
+    {3, CTS_ADC_CHANNEL},
+    {3, BAT_ADC_CHANNEL},
+};
+
+// DMA2 channels 1-4 (DMAMUX channels 8-11) each follow one ADC
+static const struct sensorsAdc_t sensorsAdc[SENSORS_ADC_COUNT] = {
+    {ADC1, DMA2_Channel1, DMAMUX1_Channel8, SENSORS_DMAREQ_ADC1},
+    {ADC2, DMA2_Channel2, DMAMUX1_Channel9, SENSORS_DMAREQ_ADC2},
+    {ADC3, DMA2_Channel3, DMAMUX1_Channel10, SENSORS_DMAREQ_ADC3},
+    {ADC4, DMA2_Channel4, DMAMUX1_Channel11, SENSORS_DMAREQ_ADC4},
+};
+
+// Two full scans per ADC, DMA fills one half while the other is read
+static volatile uint16_t sensorsBuffer[SENSORS_ADC_COUNT][2 * SENSORS_MAX_PER_ADC];
+
+// Number of sensors scanned by each ADC, and the place of each sensor in its scan
+static uint32_t sensorsScanLength[SENSORS_ADC_COUNT];
+static uint32_t sensorsRank[SENSOR_COUNT];
+
+// One crank angle MAP sample. Samples are kept in angle order over the cycle.
+struct sensorsMapSample_t{
+    float angle;
+    uint8_t cylinder;
+    uint8_t firstOfWindow;      // Starts a new min / average for the cylinder
+    uint8_t lastOfWindow;       // Publishes the min / average of the cylinder
+};
+
+static struct sensorsMapSample_t sensorsMapSamples[SENSORS_MAP_MAX_SAMPLES];
+static uint32_t sensorsMapSampleCount = 0;
+
+// Sample waiting to be taken, and the tooth it is timed from (angle past that tooth)
+static uint32_t sensorsMapNext = 0;
+static uint32_t sensorsMapNextTooth;
+static float sensorsMapNextOffset;
+
+// Most recent tooth seen while in sync
+static uint32_t sensorsMapToothNumber;
+static uint32_t sensorsMapToothTime;
+static float sensorsMapToothUsPerDegree;
+static uint32_t sensorsMapHaveTooth = 0;
+
+// Running min / sum of the window open on each cylinder. A window is only open
+// once its first sample is taken (or missed), so one joined part way through,
+// after sync or a new window, is never published.
+static uint32_t sensorsMapMinimum[SENSORS_MAP_MAX_CYLINDERS];
+static uint32_t sensorsMapSum[SENSORS_MAP_MAX_CYLINDERS];
+static uint32_t sensorsMapCount[SENSORS_MAP_MAX_CYLINDERS];
+static uint32_t sensorsMapOpen[SENSORS_MAP_MAX_CYLINDERS];
+
+// Last complete window of each cylinder (SENSORS_MAP_PACK), 0 until one completes.
+// Packed into one word so a reader always gets a min and average that belong together.
+static volatile uint32_t sensorsMapResult[SENSORS_MAP_MAX_CYLINDERS];
+static volatile uint32_t sensorsMapLatest = 0;
+static volatile uint32_t sensorsMapValid = 0;
+
+
+/******************************************************************************
+* Function Code
+******************************************************************************/
+
+
+/******************************************************************************
+* void Sensors_Init(void)
+* Builds the scan of each ADC from sensorInputs, then powers up, calibrates
+* and starts every ADC in continuous mode with circular DMA. The sensor pins
+* are put in analog mode by Gpio_Init. Time_Timer2Init must have run.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void Sensors_Init(void){
+    uint32_t sensor;
+    uint32_t x;
+
+    // Enable clocks to the ADCs and the DMA
+    SET_BIT(RCC->AHB2ENR, RCC_AHB2ENR_ADC12EN | RCC_AHB2ENR_ADC345EN);
+    SET_BIT(RCC->AHB1ENR, RCC_AHB1ENR_DMA2EN);
+    SET_BIT(RCC->AHB1ENR, RCC_AHB1ENR_DMAMUX1EN);
+
+    // Clock the ADCs from HCLK / 4 (42.5 Mhz)
+    MODIFY_REG(ADC12_COMMON->CCR, ADC_CCR_CKMODE, ADC_CCR_CKMODE);
+    MODIFY_REG(ADC345_COMMON->CCR, ADC_CCR_CKMODE, ADC_CCR_CKMODE);
+
+    // Each sensor takes the next place in the scan of its ADC
+    for(sensor = 0; sensor < SENSOR_COUNT; sensor++){
+        x = sensorInputs[sensor].adcIndex;
+        sensorsRank[sensor] = sensorsScanLength[x];
+        sensorsScanLength[x]++;
+    }
+
+    for(x = 0; x < SENSORS_ADC_COUNT; x++){
+        if(sensorsScanLength[x] > 0){
+            sensors_adcInit(x);
+        }
+    }
+
+    sensors_mapInit();
+    sensors_mapDefaultWindows();
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint16_t Sensors_GetRaw(sensor_t sensor)
+* Returns the latest reading of a sensor, 0 to SENSORS_FULL_SCALE. The DMA
+* count tells which half of the buffer is being written, the other half holds
+* the last complete scan. A half is only overwritten a full scan (milliseconds)
+* after it is picked, and one 16 bit read can not be torn, so no lock is needed.
+*
+* Once a crank angle MAP window has completed, MAP reads as the average of the
+* latest window instead of the scan. Without sync no windows are taken, so MAP
+* goes back to the scan as soon as sync is lost, and stays there until
+* Sensors_ResetMap has run and a window has completed again.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+uint16_t Sensors_GetRaw(sensor_t sensor){
+    uint32_t x;
+    uint32_t length;
+    uint32_t half;
+
+    if(sensor >= SENSOR_COUNT){
+        return 0;
+    }
+
+    if((sensor == SENSOR_MAP) && sensorsMapValid && TriggerDecoder_GetSyncStatus()){
+        return (uint16_t) sensorsMapLatest;
+    }
+
+    x = sensorInputs[sensor].adcIndex;
+    length = sensorsScanLength[x];
+
+    // CNDTR counts down from 2 * length, above length the first half is being written
+    half = (READ_REG(sensorsAdc[x].dma->CNDTR) > length) ? length : 0;
+
+    return sensorsBuffer[x][half + sensorsRank[sensor]];
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* float Sensors_GetVoltage(sensor_t sensor)
+* Returns the latest reading of a sensor in volts at the pin
+* David Tolsma, 10/17/2026
+******************************************************************************/
+float Sensors_GetVoltage(sensor_t sensor){
+    return (float) Sensors_GetRaw(sensor) * (SENSORS_VREF / (float) SENSORS_FULL_SCALE);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t Sensors_SetMapWindow(cylinder, startAngle, endAngle, samples)
+* Samples MAP at evenly spaced crank angles from startAngle to endAngle
+* (0-720*, the window may cross 720*) once every engine cycle. The lowest and
+* average of the window are published when its last sample is taken. A single
+* sample reads MAP at one fixed angle, zero samples removes the window.
+* Returns 0 if the cylinder is out of range or there is no room for the samples.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+uint32_t Sensors_SetMapWindow(uint32_t cylinder, float startAngle, float endAngle, uint32_t samples){
+    struct sensorsMapSample_t sample;
+    float span;
+    uint32_t count;
+    uint32_t x;
+    uint32_t y;
+
+    if(cylinder >= SENSORS_MAP_MAX_CYLINDERS){
+        return 0;
+    }
+
+    span = endAngle - startAngle;
+    if(span < 0){
+        span = span + 720;
+    }
+
+    taskENTER_CRITICAL();
+
+    // Drop the old window of this cylinder
+    count = 0;
+    for(x = 0; x < sensorsMapSampleCount; x++){
+        if(sensorsMapSamples[x].cylinder != cylinder){
+            sensorsMapSamples[count] = sensorsMapSamples[x];
+            count++;
+        }
+    }
+
+    if((count + samples) > SENSORS_MAP_MAX_SAMPLES){
+        sensorsMapSampleCount = count;
+        sensors_mapSelectSample(0);
+        taskEXIT_CRITICAL();
+        return 0;
+    }
+
+    // Insert the new samples in angle order
+    for(x = 0; x < samples; x++){
+        sample.angle = startAngle;
+        if(samples > 1){
+            sample.angle = startAngle + (span * (float) x / (float)(samples - 1));
+        }
+        if(sample.angle >= 720){
+            sample.angle = sample.angle - 720;
+        }
+        sample.cylinder = (uint8_t) cylinder;
+        sample.firstOfWindow = (x == 0);
+        sample.lastOfWindow = (x == (samples - 1));
+
+        y = count;
+        while((y > 0) && (sensorsMapSamples[y - 1].angle > sample.angle)){
+            sensorsMapSamples[y] = sensorsMapSamples[y - 1];
+            y--;
+        }
+        sensorsMapSamples[y] = sample;
+        count++;
+    }
+
+    sensorsMapSampleCount = count;
+    sensorsMapOpen[cylinder] = 0;
+    sensorsMapResult[cylinder] = 0;
+    sensors_mapSelectSample(0);
+
+    taskEXIT_CRITICAL();
+
+    return 1;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void Sensors_ResetMap(void)
+* Throws away the crank angle MAP readings and any window half taken, and
+* stops the sample waiting on TIM6. Called when the trigger decoder loses
+* sync, including on a stall, so a reading from before the loss is never
+* used after sync is found again. MAP reads from the scan until the next
+* window completes. The first sample is timed from the pattern in use.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void Sensors_ResetMap(void){
+    uint32_t x;
+
+    taskENTER_CRITICAL();
+
+    CLEAR_BIT(TIM6->CR1, TIM_CR1_CEN);
+
+    sensorsMapValid = 0;
+    sensorsMapLatest = 0;
+    sensorsMapHaveTooth = 0;
+    for(x = 0; x < SENSORS_MAP_MAX_CYLINDERS; x++){
+        sensorsMapOpen[x] = 0;
+        sensorsMapResult[x] = 0;
+    }
+    sensors_mapSelectSample(0);
+
+    taskEXIT_CRITICAL();
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t Sensors_GetMapCycle(cylinder, minimum, average)
+* Gives the lowest and the average raw MAP reading over the last complete
+* window of a cylinder. Returns 0 if no window of the cylinder has completed.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+uint32_t Sensors_GetMapCycle(uint32_t cylinder, uint16_t * minimum, uint16_t * average){
+    uint32_t result;
+
+    if(cylinder >= SENSORS_MAP_MAX_CYLINDERS){
+        return 0;
+    }
+
+    result = sensorsMapResult[cylinder];
+    if(result == 0){
+        return 0;
+    }
+
+    *minimum = (uint16_t)(result >> 16);
+    *average = (uint16_t) result;
+    return 1;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void sensors_adcInit(uint32_t adcIndex)
+* Powers up and calibrates one ADC, loads its scan and starts it converting
+* continuously, with DMA copying every result into its half of the buffer.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void sensors_adcInit(uint32_t adcIndex){
+    const struct sensorsAdc_t * config = &sensorsAdc[adcIndex];
+    ADC_TypeDef * adc = config->adc;
+    uint32_t length = sensorsScanLength[adcIndex];
+    uint32_t sensor;
+    uint32_t channel;
+    uint32_t sequence;
+    uint32_t startTime;
+
+    // Leave deep power down and start the voltage regulator
+    CLEAR_BIT(adc->CR, ADC_CR_DEEPPWD);
+    SET_BIT(adc->CR, ADC_CR_ADVREGEN);
+    startTime = Time_GetTicks();
+    while(TIME_DIFF(Time_GetTicks(), startTime) < (int32_t) TIME_US_TO_TICKS(SENSORS_REGULATOR_STARTUP)){}
+
+    // Single ended calibration
+    CLEAR_BIT(adc->CR, ADC_CR_ADCALDIF);
+    SET_BIT(adc->CR, ADC_CR_ADCAL);
+    while(READ_BIT(adc->CR, ADC_CR_ADCAL)){}
+
+    // Enable the ADC
+    WRITE_REG(adc->ISR, ADC_ISR_ADRDY);
+    SET_BIT(adc->CR, ADC_CR_ADEN);
+    while(READ_BIT(adc->ISR, ADC_ISR_ADRDY) == 0){}
+
+    // Scan this ADC's sensors in rank order, each with the same sample time
+    sequence = (length - 1) << ADC_SQR1_L_Pos;
+    for(sensor = 0; sensor < SENSOR_COUNT; sensor++){
+        if(sensorInputs[sensor].adcIndex != adcIndex){
+            continue;
+        }
+
+        channel = sensorInputs[sensor].channel;
+        sequence |= channel << (ADC_SQR1_SQ1_Pos + (sensorsRank[sensor] * 6U));
+
+        if(channel < 10){
+            MODIFY_REG(adc->SMPR1, ADC_SMPR1_SMP0 << (channel * 3U), SENSORS_SAMPLE_TIME << (channel * 3U));
+        }
+        else{
+            MODIFY_REG(adc->SMPR2, ADC_SMPR2_SMP10 << ((channel - 10) * 3U), SENSORS_SAMPLE_TIME << ((channel - 10) * 3U));
+        }
+    }
+    WRITE_REG(adc->SQR1, sequence);
+
+    // Continuous conversions, circular DMA, keep the newest result on overrun
+    SET_BIT(adc->CFGR, ADC_CFGR_CONT | ADC_CFGR_DMAEN | ADC_CFGR_DMACFG | ADC_CFGR_OVRMOD);
+    WRITE_REG(adc->CFGR2, SENSORS_OVERSAMPLE);
+
+    // DMA copies each 16 bit result into the buffer, two scans long and circular
+    WRITE_REG(config->dmamux->CCR, config->request << DMAMUX_CxCR_DMAREQ_ID_Pos);
+    WRITE_REG(config->dma->CPAR, (uint32_t) &adc->DR);
+    WRITE_REG(config->dma->CMAR, (uint32_t) sensorsBuffer[adcIndex]);
+    WRITE_REG(config->dma->CNDTR, 2 * length);
+    WRITE_REG(config->dma->CCR, DMA_CCR_PL_0 | DMA_CCR_MSIZE_0 | DMA_CCR_PSIZE_0 | DMA_CCR_MINC | DMA_CCR_CIRC);
+    SET_BIT(config->dma->CCR, DMA_CCR_EN);
+
+    // Start converting
+    SET_BIT(adc->CR, ADC_CR_ADSTART);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void sensors_mapInit(void)
+* Sets up TIM6 as a one shot delay whose update starts an injected conversion
+* of MAP on ADC1, and follows the trigger teeth to time the MAP samples.
+* Injected conversions jump ahead of the regular scan, which picks up its
+* oversampling where it left off.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void sensors_mapInit(void){
+    // Enable clock to timer
+    SET_BIT(RCC->APB1ENR1, RCC_APB1ENR1_TIM6EN);
+
+    // One pulse mode, the update at the end of the delay is sent out on TRGO
+    WRITE_REG(TIM6->PSC, (TIME_TIMER_CLOCK_MHZ * SENSORS_MAP_TIMER_US) - 1);
+    SET_BIT(TIM6->CR1, TIM_CR1_OPM);
+    MODIFY_REG(TIM6->CR2, TIM_CR2_MMS, TIM_CR2_MMS_1);
+
+    // Load the prescaler, before ADC1 is listening to TRGO
+    WRITE_REG(TIM6->EGR, TIM_EGR_UG);
+
+    // One injected conversion of MAP on every rising TIM6 TRGO
+    WRITE_REG(ADC1->JSQR, (SENSORS_JEXTSEL_TIM6_TRGO << ADC_JSQR_JEXTSEL_Pos) | ADC_JSQR_JEXTEN_0 |
+                          (MAP_ADC_CHANNEL << ADC_JSQR_JSQ1_Pos));
+    WRITE_REG(ADC1->ISR, ADC_ISR_JEOS);
+    SET_BIT(ADC1->IER, ADC_IER_JEOSIE);
+    SET_BIT(ADC1->CR, ADC_CR_JADSTART);
+
+    // Set interupt priority to allow for FreeRTOS system calls
+    NVIC_SetPriority(ADC1_2_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY);
+    NVIC_EnableIRQ(ADC1_2_IRQn);
+
+    TriggerDecoder_AddToothCallback(&sensors_mapToothCallback);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void sensors_mapDefaultWindows(void)
+* Gives every cylinder a MAP window over the middle of its intake stroke, so
+* MAP is read at the same crank angles each cycle without any set up by the
+* application. Sensors_SetMapWindow replaces them.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void sensors_mapDefaultWindows(void){
+    float intakeTdc;
+    uint32_t x;
+
+    for(x = 0; x < ENGINE_CYLINDERS; x++){
+        intakeTdc = ENGINE_TDC_ANGLE(x) + 360.0f;
+        if(intakeTdc >= 720){
+            intakeTdc = intakeTdc - 720;
+        }
+
+        Sensors_SetMapWindow(x, intakeTdc + SENSORS_MAP_DEFAULT_START, intakeTdc + SENSORS_MAP_DEFAULT_END,
+                             SENSORS_MAP_DEFAULT_SAMPLES);
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void sensors_mapToothCallback(primaryEventNumber, timeStamp, usPerDegree)
+* Called by the trigger decoder on every primary event. If the next MAP sample
+* is timed from this tooth, TIM6 is started to trigger it.
+* Runs from the trigger ISRs, or the decoder task with interrupts masked, so
+* ADC1_2_IRQHandler can not run at the same time.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void sensors_mapToothCallback(uint32_t primaryEventNumber, uint32_t timeStamp, float usPerDegree){
+    sensorsMapToothNumber = primaryEventNumber;
+    sensorsMapToothTime = timeStamp;
+    sensorsMapToothUsPerDegree = usPerDegree;
+    sensorsMapHaveTooth = 1;
+
+    if((sensorsMapSampleCount > 0) && (sensorsMapNextTooth == primaryEventNumber)){
+        sensors_mapArm();
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void sensors_mapSelectSample(uint32_t sample)
+* Makes a sample the next one to be taken and works out the tooth it is
+* timed from. Must be called with interrupts masked.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void sensors_mapSelectSample(uint32_t sample){
+    if(sample >= sensorsMapSampleCount){
+        sample = 0;
+    }
+
+    sensorsMapNext = sample;
+    if(sensorsMapSampleCount > 0){
+        sensorsMapNextTooth = TriggerDecoder_GetReferenceTooth(sensorsMapSamples[sample].angle, &sensorsMapNextOffset);
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void sensors_mapArm(void)
+* Starts TIM6 so its update, and with it the injected conversion, lands at the
+* angle of the next sample. A sample that is already due is triggered straight
+* away with a software update. A sample too far from its tooth for TIM6 is
+* skipped. Must be called with interrupts masked.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void sensors_mapArm(void){
+    uint32_t sampleTime;
+    int32_t delay;
+    uint32_t counts;
+
+    sampleTime = sensorsMapToothTime + (uint32_t) TIME_US_TO_TICKS(sensorsMapNextOffset * sensorsMapToothUsPerDegree);
+    delay = TIME_DIFF(sampleTime, Time_GetTicks());
+
+    CLEAR_BIT(TIM6->CR1, TIM_CR1_CEN);
+
+    if(delay <= 0){
+        WRITE_REG(TIM6->EGR, TIM_EGR_UG);
+        return;
+    }
+
+    counts = TIME_TICKS_TO_US((uint32_t) delay) / SENSORS_MAP_TIMER_US;
+    if(counts == 0){
+        WRITE_REG(TIM6->EGR, TIM_EGR_UG);
+    }
+    else if(counts > SENSORS_MAP_TIMER_MAX){
+        // Too slow to time from this tooth, count the sample as missed
+        sensors_mapStore(0);
+    }
+    else{
+        WRITE_REG(TIM6->CNT, 0);
+        WRITE_REG(TIM6->ARR, counts);
+        SET_BIT(TIM6->CR1, TIM_CR1_CEN);
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void sensors_mapStore(uint32_t value)
+* Adds a MAP reading (0 if the sample was missed) to the window of its
+* cylinder, publishes the window if it was the last sample and the window
+* was open from its first, and moves on to the next sample. If the next
+* sample is later on the tooth just used it is armed straight away, otherwise
+* it waits for its tooth.
+* Must be called with interrupts masked.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void sensors_mapStore(uint32_t value){
+    const struct sensorsMapSample_t * sample = &sensorsMapSamples[sensorsMapNext];
+    uint32_t cylinder = sample->cylinder;
+    uint32_t average;
+    float offset;
+
+    if(sample->firstOfWindow){
+        sensorsMapMinimum[cylinder] = SENSORS_FULL_SCALE;
+        sensorsMapSum[cylinder] = 0;
+        sensorsMapCount[cylinder] = 0;
+        sensorsMapOpen[cylinder] = 1;
+    }
+
+    if(value > 0){
+        if(value < sensorsMapMinimum[cylinder]){
+            sensorsMapMinimum[cylinder] = value;
+        }
+        sensorsMapSum[cylinder] += value;
+        sensorsMapCount[cylinder]++;
+    }
+
+    if(sample->lastOfWindow){
+        if(sensorsMapOpen[cylinder] && (sensorsMapCount[cylinder] > 0)){
+            average = sensorsMapSum[cylinder] / sensorsMapCount[cylinder];
+            sensorsMapResult[cylinder] = SENSORS_MAP_PACK(sensorsMapMinimum[cylinder], average);
+            sensorsMapLatest = average;
+            sensorsMapValid = 1;
+        }
+        sensorsMapOpen[cylinder] = 0;
+    }
+
+    offset = sensorsMapNextOffset;
+    sensors_mapSelectSample(sensorsMapNext + 1);
+
+    // Chain on from the same tooth only if the sample is further along it, a
+    // single sample per cycle would otherwise retrigger itself
+    if(sensorsMapHaveTooth && (sensorsMapNextTooth == sensorsMapToothNumber) && (sensorsMapNextOffset > offset)){
+        sensors_mapArm();
+    }
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void ADC1_2_IRQHandler(void)
+* Handler for ADC1 and ADC2, only the end of an injected MAP conversion
+* interupts. The 12 bit reading is scaled to the raw range and stored.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void ADC1_2_IRQHandler(void){
+    uint32_t value;
+
+    if(READ_BIT(ADC1->ISR, ADC_ISR_JEOS)){
+        WRITE_REG(ADC1->ISR, ADC_ISR_JEOS);
+
+        value = READ_REG(ADC1->JDR1) << SENSORS_INJECTED_SHIFT;
+        if(value == 0){
+            value = 1; // 0 marks a missed sample
+        }
+
+        // A conversion started before Sensors_ResetMap is not counted
+        if((sensorsMapSampleCount > 0) && sensorsMapHaveTooth){
+            sensors_mapStore(value);
+        }
+    }
+}
+/*****************************************************************************/
@@ -90,8 +90,10 @@ void SystemClock_Init(void){
     // Set AHB1 Prescaler to a division of 1
     MODIFY_REG(RCC->CFGR, RCC_CFGR_PPRE1, 0);
 
-    // Set AHB2 Prescaler to a division of 1
-    MODIFY_REG(RCC->CFGR, RCC_CFGR_PPRE2, 0);
+    // Set APB2 Prescaler to a division of 2, 85MHz. The timers on APB2 (TIM8)
+    // are clocked at twice that, still 170MHz, and SPI1 can then divide down
+    // to the 400kHz an SD card is identified at.
+    MODIFY_REG(RCC->CFGR, RCC_CFGR_PPRE2, RCC_CFGR_PPRE2_DIV2);
 
     // Set PLL to be the core clock source
     MODIFY_REG(RCC->CFGR, RCC_CFGR_SW, RCC_CFGR_SW_PLL);
@@ -0,0 +1,249 @@
+/******************************************************************************
+* File:                    Table3D.c
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       2D lookup maps with bilinear interpolation. The
+*                          operating point moves slowly between lookups, so
+*                          each axis search starts from the bin found last
+*                          time and is usually done in one compare. Tables
+*                          are guarded by a sequence count, so they can be
+*                          read from anywhere while a tuner changes them.
+*******************************************************************************
+* Includes
+******************************************************************************/
+#include "Table3D.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "stm32g4xx.h"
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+
+
+/******************************************************************************
+* Public Variables
+******************************************************************************/
+
+
+/******************************************************************************
+* Private Function Prototypes (static)
+******************************************************************************/
+static uint32_t table3D_findBin(const float * axis, float value, uint32_t bin, float * fraction);
+static uint32_t table3D_isIncreasing(const float * axis);
+static void table3D_beginWrite(table3D_t * table);
+static void table3D_endWrite(table3D_t * table);
+
+/******************************************************************************
+* Private Variables (static)
+******************************************************************************/
+
+
+/******************************************************************************
+* Function Code
+******************************************************************************/
+
+
+/******************************************************************************
+* float Table3D_Lookup(table3D_t * table, float x, float y)
+* Finds the cell the point falls in and blends its four corners. Points off
+* the end of an axis use the end of the table. If a writer changed the table
+* while it was being read, the read is done again.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+float Table3D_Lookup(table3D_t * table, float x, float y){
+    uint32_t sequence;
+    uint32_t xBin;
+    uint32_t yBin;
+    float xFraction;
+    float yFraction;
+    float lowLow;
+    float lowHigh;
+    float highLow;
+    float highHigh;
+    float low;
+    float high;
+
+    do{
+        sequence = table->sequence;
+        __DMB();
+        xBin = table3D_findBin(table->xAxis, x, table->xBin, &xFraction);
+        yBin = table3D_findBin(table->yAxis, y, table->yBin, &yFraction);
+        lowLow = table->values[yBin][xBin];
+        lowHigh = table->values[yBin][xBin + 1];
+        highLow = table->values[yBin + 1][xBin];
+        highHigh = table->values[yBin + 1][xBin + 1];
+        __DMB();
+    }while((sequence & 1U) || (sequence != table->sequence));
+
+    table->xBin = xBin;
+    table->yBin = yBin;
+
+    low = lowLow + ((lowHigh - lowLow) * xFraction);
+    high = highLow + ((highHigh - highLow) * xFraction);
+
+    return low + ((high - low) * yFraction);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void Table3D_SetValue(table, xIndex, yIndex, value)
+* Changes one cell of a table. Out of range cells are ignored.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void Table3D_SetValue(table3D_t * table, uint32_t xIndex, uint32_t yIndex, float value){
+    if((xIndex >= TABLE3D_SIZE) || (yIndex >= TABLE3D_SIZE)){
+        return;
+    }
+
+    table3D_beginWrite(table);
+    table->values[yIndex][xIndex] = value;
+    table3D_endWrite(table);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void Table3D_SetValues(table3D_t * table, const float * values)
+* Replaces every cell of a table from TABLE3D_SIZE rows of TABLE3D_SIZE
+* values, the first row is at yAxis[0].
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void Table3D_SetValues(table3D_t * table, const float * values){
+    uint32_t x;
+    uint32_t y;
+
+    table3D_beginWrite(table);
+    for(y = 0; y < TABLE3D_SIZE; y++){
+        for(x = 0; x < TABLE3D_SIZE; x++){
+            table->values[y][x] = values[(y * TABLE3D_SIZE) + x];
+        }
+    }
+    table3D_endWrite(table);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* int32_t Table3D_SetAxes(table3D_t * table, const float * xAxis, const float * yAxis)
+* Replaces both axes of a table. The bin search relies on each axis being
+* strictly increasing, so axes that are not are refused and the table keeps
+* the ones it had.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+int32_t Table3D_SetAxes(table3D_t * table, const float * xAxis, const float * yAxis){
+    uint32_t x;
+
+    if(!table3D_isIncreasing(xAxis) || !table3D_isIncreasing(yAxis)){
+        return TABLE3D_BAD_AXIS;
+    }
+
+    table3D_beginWrite(table);
+    for(x = 0; x < TABLE3D_SIZE; x++){
+        table->xAxis[x] = xAxis[x];
+        table->yAxis[x] = yAxis[x];
+    }
+    table3D_endWrite(table);
+
+    return TABLE3D_OK;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t table3D_isIncreasing(const float * axis)
+* Returns 1 if every point of the axis is above the one before. Written so a
+* point that is not a number fails the compare.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint32_t table3D_isIncreasing(const float * axis){
+    uint32_t x;
+
+    for(x = 1; x < TABLE3D_SIZE; x++){
+        if(!(axis[x] > axis[x - 1U])){
+            return 0;
+        }
+    }
+
+    return 1;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t table3D_findBin(axis, value, bin, fraction)
+* Returns the bin (0 to TABLE3D_SIZE - 2) whose two axis points the value
+* falls between, and how far along the bin it is from 0 to 1. The search
+* steps from the bin given, so a value that has not moved far costs one or
+* two compares. A value that is not a number fails every compare, it is put
+* at the low end of the axis rather than left to interpolate to NaN.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint32_t table3D_findBin(const float * axis, float value, uint32_t bin, float * fraction){
+    if(value != value){
+        *fraction = 0.0f;
+        return 0;
+    }
+
+    if(bin > (TABLE3D_SIZE - 2U)){
+        bin = TABLE3D_SIZE - 2U;
+    }
+
+    while((bin > 0U) && (value < axis[bin])){
+        bin--;
+    }
+    while((bin < (TABLE3D_SIZE - 2U)) && (value >= axis[bin + 1U])){
+        bin++;
+    }
+
+    // Clamp to the ends of the axis
+    if(value <= axis[bin]){
+        *fraction = 0.0f;
+    }
+    else if(value >= axis[bin + 1U]){
+        *fraction = 1.0f;
+    }
+    else{
+        *fraction = (value - axis[bin]) / (axis[bin + 1U] - axis[bin]);
+    }
+
+    return bin;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void table3D_beginWrite(table3D_t * table)
+* Masks interupts and makes the sequence odd, so a lookup that was part way
+* through when the writer started reads the table again.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void table3D_beginWrite(table3D_t * table){
+    taskENTER_CRITICAL();
+    table->sequence++;
+    __DMB();
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void table3D_endWrite(table3D_t * table)
+* Makes the sequence even again and unmasks interupts
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void table3D_endWrite(table3D_t * table){
+    __DMB();
+    table->sequence++;
+    taskEXIT_CRITICAL();
+}
+/*****************************************************************************/
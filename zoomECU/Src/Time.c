@@ -34,6 +34,9 @@
 ******************************************************************************/
 static int32_t secondsSinceBoot;
 
+// Upper 32 bits of the 64 bit time, counted by the timer 2 update interupt
+static volatile uint32_t timer2Overflows;
+
 /******************************************************************************
 * Function Code
 ******************************************************************************/
@@ -53,27 +56,31 @@ void Time_Timer2Init(void){
 
     // Set prescaler, timer frequency = input clock / prescaler +1
     // For a 170 Mhz core, and a 1 Mhz timer, we need a prescaler value
-    // of 170 - 1 = 169.
-    WRITE_REG(TIM2->PSC, 169);
+    // of 170 - 1 = 169. Finer time bases divide by less, down to 0 for
+    // a 170 Mhz timer.
+    WRITE_REG(TIM2->PSC, (TIME_TIMER_CLOCK_MHZ / TIME_TICKS_PER_US) - 1);
 
     // Set auto-reload register (when the timer rolls back to zero)
-    // Resets once per second
     WRITE_REG(TIM2->ARR, (0xFFFFFFFF));
 
+    // Only an overflow sets the update flag, a software update (UG) still
+    // restarts the slave timers but is not counted as an overflow
+    SET_BIT(TIM2->CR1, TIM_CR1_URS);
+
+    // Send update events out on TRGO, timers slaved to timer 2 restart with it
+    MODIFY_REG(TIM2->CR2, TIM_CR2_MMS, TIM_CR2_MMS_1);
+
     // Reset timer to update the prescaler and autoreload register.
     WRITE_REG(TIM2->EGR, TIM_EGR_UG);
 
     // Enable timer 2
     SET_BIT(TIM2->CR1, TIM_CR1_CEN);
 
-    // Enable interupts from timer update event
-    //WRITE_REG(TIM2->DIER, TIM_DIER_UIE);
+    // Enable interupts from timer update event, used to extend the time to 64 bits
+    SET_BIT(TIM2->DIER, TIM_DIER_UIE);
 
-    // Enable interupts from timer compare registers 1-4
-    SET_BIT(TIM2->DIER, TIM_DIER_CC1IE);
-    SET_BIT(TIM2->DIER, TIM_DIER_CC2IE);
-    SET_BIT(TIM2->DIER, TIM_DIER_CC3IE);
-    SET_BIT(TIM2->DIER, TIM_DIER_CC4IE);
+    // Interupts from timer compare registers 1-4 are enabled by IgnitionControl
+    // while each ignition schedule is set
 
     // Clear all interupts
     CLEAR_REG(TIM2->SR);
@@ -87,11 +94,69 @@ void Time_Timer2Init(void){
 /*****************************************************************************/
 
 /******************************************************************************
-* int32_t Time_GetTimeuSeconds(void)
-* Returns the current value for microseconds seconds
-* David Tolsma, 05/25/2020
+* uint32_t Time_GetTicks(void)
+* Returns the timer 2 count, the time base shared by the trigger decoder,
+* ignition and the scheduler. Wraps, compare with TIME_DIFF.
+* David Tolsma, 10/17/2026
 ******************************************************************************/
-uint32_t Time_GetTimeuSeconds(void){
+uint32_t Time_GetTicks(void){
 	return TIM2->CNT;
 }
 /*****************************************************************************/
+
+/******************************************************************************
+* void Time_SyncSlaveTimers(void)
+* Restarts timer 2 together with every timer slaved to it (reset mode on
+* ITR1), so their counts line up with the microsecond time. Timer 2 restarts
+* from zero without counting an overflow, so Time_Get64 goes back. Called
+* once from main after every slave timer is set up, before any time is kept.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void Time_SyncSlaveTimers(void){
+    WRITE_REG(TIM2->EGR, TIM_EGR_UG);
+}
+/*****************************************************************************/
+
+
+/******************************************************************************
+* uint64_t Time_Get64(void)
+* Returns ticks since boot as 64 bits, made up of the timer 2 count and
+* the number of times it has overflowed. Lock free, the overflow count is read
+* either side of the timer count and the read is retried if it changed. If the
+* update interupt has not run yet (called with interupts masked, or from a
+* higher priority interupt) the pending update flag is used instead. A small
+* count with the flag set means the count has already wrapped.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+uint64_t Time_Get64(void){
+    uint32_t high;
+    uint32_t low;
+    uint32_t pending;
+
+    do{
+        high = timer2Overflows;
+        low = READ_REG(TIM2->CNT);
+        pending = READ_BIT(TIM2->SR, TIM_SR_UIF);
+    }while(high != timer2Overflows);
+
+    if(pending && (low < 0x80000000U)){
+        high++;
+    }
+
+    return ((uint64_t) high << 32) | low;
+}
+/*****************************************************************************/
+
+
+/******************************************************************************
+* void Time_Timer2UpdateFromISR(void)
+* Counts one overflow of timer 2. The caller clears the update flag first, so
+* Time_Get64 never sees the flag and the new count at the same time. Every
+* interupt that reads the time runs at the same priority as TIM2_IRQHandler,
+* so none of them can run between the flag clear and the count.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void Time_Timer2UpdateFromISR(void){
+    timer2Overflows++;
+}
+/*****************************************************************************/
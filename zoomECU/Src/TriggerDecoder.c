@@ -10,47 +10,116 @@
 #include "PinoutConfiguration.h"
 #include "Gpio.h"
 #include "Time.h"
+#include "Latency.h"
 
 #include "FreeRTOS.h"
 #include "task.h"
 #include "timers.h"
 #include "semphr.h"
-#include "queue.h"
 
 #include "stm32g4xx.h"
 
 /******************************************************************************
 * Defines
 ******************************************************************************/
-
+// Number of primary events that must be seen in sync before the speed and angle
+// estimates are trusted.
+#define TRIGGER_MIN_SYNC_CONFIDENCE 12
+
+// Number of primary event times kept, must be a power of 2.
+#define TRIGGER_PRIMARY_HISTORY_SIZE    16U
+#define TRIGGER_PRIMARY_HISTORY_MASK    (TRIGGER_PRIMARY_HISTORY_SIZE - 1U)
+
+// Number of edges the ISRs can queue for the decoder task, must be a power of 2.
+#define TRIGGER_EVENT_RING_SIZE         64U
+#define TRIGGER_EVENT_RING_MASK         (TRIGGER_EVENT_RING_SIZE - 1U)
+
+// Task notification bit set by the ISRs when the event ring goes from empty to
+// not empty. Kept clear of the TRIG_EVT_* bits, which share the notification.
+#define TRIGGER_NOTIFY_EVENTS           (0x1UL << 31)
+
+// Largest primaryEventCount of any trigger pattern, sizes the per tooth corrections
+#define TRIGGER_MAX_PRIMARY_EVENTS      128U
+
+// Sync is dropped if no primary event is seen for this long. This is longer
+// than a 360 degree tooth gap at the 50 rpm the decoder counts as cranking.
+#define TRIGGER_STALL_TIME_MS           1500U
+
+// Number of modules that can follow the teeth with a tooth callback
+#define TRIGGER_MAX_TOOTH_CALLBACKS     4U
+
+// Fraction of the error in a tooth period that is learned into its correction
+// each time the tooth is seen. Ratios outside the limits are treated as
+// noise or a speed change that has nothing to do with the tooth.
+#define TRIGGER_CORRECTION_GAIN         0.125f
+#define TRIGGER_CORRECTION_MIN_RATIO    0.5f
+#define TRIGGER_CORRECTION_MAX_RATIO    2.0f
+
+#ifdef TRIGGER_INPUT_CAPTURE
+// Number of captures each DMA ring can hold before the oldest is overwritten,
+// must be a power of 2.
+#define TRIGGER_CAPTURE_RING_SIZE   32U
+#define TRIGGER_CAPTURE_RING_MASK   (TRIGGER_CAPTURE_RING_SIZE - 1U)
+
+// DMAMUX request inputs for the capture channels (RM0440, DMAMUX1 request
+// mapping: TIM3_CH1 to CH4 are 61 to 64, TIM5_CH1 to CH4 are 72 to 75)
+#define TRIGGER_DMAREQ_TIM3_CH4     64U
+#define TRIGGER_DMAREQ_TIM5_CH4     75U
+
+// TIM3 only holds 16 bits of the time, so a cam capture must be read by the
+// decoder task before the count comes around. Keep that window above 5mS.
+#if (65536U / TIME_TICKS_PER_US) < 5000U
+#error "TRIGGER_INPUT_CAPTURE needs TIME_TICKS_PER_US of 10 or less"
+#endif
+#endif
+
+#ifdef TRIGGER_TOOTH_LOG
+#define TRIGGER_TOOTH_LOG_MASK      (TRIGGER_TOOTH_LOG_SIZE - 1U)
+
+// toothLogRemaining while no sync loss has been seen
+#define TRIGGER_TOOTH_LOG_RUNNING   0xFFFFFFFFU
+
+#define TRIGGER_LOG_TOOTH(event, notificationBits)  triggerDecoder_logTooth((event), (notificationBits))
+#else
+#define TRIGGER_LOG_TOOTH(event, notificationBits)
+#endif
 
 /******************************************************************************
 * Public Variables
 ******************************************************************************/
+EventGroupHandle_t triggerDecoderEventGroup;
 
 
 /******************************************************************************
 * Private Function Prototypes (static)
 ******************************************************************************/
-
+struct triggerEvent_t;
+struct triggerPublished_t;
+
+static uint32_t triggerDecoder_processEvent(const struct triggerEvent_t * event);
+static void triggerDecoder_postEventFromISR(const struct triggerEvent_t * event);
+static uint32_t triggerDecoder_drainEvents(void);
+static void triggerDecoder_publishStatus(void);
+static void triggerDecoder_readStatus(struct triggerPublished_t * status);
+static const triggerSyncRule_t * triggerDecoder_findSyncRule(triggerEventID_t eventID, uint32_t otherLevel, uint32_t gap);
+static uint32_t triggerDecoder_previousPrimaryEvent(uint32_t eventsBack);
+static float triggerDecoder_primaryAngleSpan(uint32_t eventsBack);
+static uint32_t triggerDecoder_primaryEventTime(uint32_t eventsBack);
+static void triggerDecoder_updatePrediction(void);
+static void triggerDecoder_resetCorrections(void);
+static uint32_t triggerDecoder_checkRpm(void);
+static uint32_t triggerDecoder_checkStall(void);
+#ifdef TRIGGER_INPUT_CAPTURE
+static void triggerDecoder_captureInit(void);
+static void triggerDecoder_drainCaptures(void);
+#endif
+#ifdef TRIGGER_TOOTH_LOG
+static void triggerDecoder_logTooth(const struct triggerEvent_t * event, uint32_t notificationBits);
+#endif
 
 /******************************************************************************
 * Private Variables (static)
 ******************************************************************************/
-typedef enum{
-    PRIMARY_RISE,
-    PRIMARY_FALL,
-    SECONDARY_RISE,
-    SECONDARY_FALL,
-}triggerEventID_t;
-
-typedef enum{
-    PRIMARY_HIGH,
-    PRIMARY_LOW,
-    SECONDARY_HIGH,
-    SECONDARY_LOW
-}triggerValue_t;
-
 struct triggerEvent_t{
     uint32_t timeStamp;
     triggerEventID_t eventID;
@@ -61,25 +130,109 @@ struct triggerEvent_t{
 struct triggerStatus_t{
     uint32_t hasSync;
     uint32_t syncConfidence;
-    uint32_t pastPrimaryEvents[4];
+    uint32_t pastPrimaryEvents[TRIGGER_PRIMARY_HISTORY_SIZE];  // Ring, see triggerDecoder_primaryEventTime
+    uint32_t primaryHistoryIndex;                               // Position of the newest primary event time
     uint32_t pastSecondaryEvents[4];
     uint32_t lastPrimaryEventNumber;
     uint32_t lastSecondaryEventNumber;
-    float primaryEventAngles[8];
-    float secondaryEventAngles[4];
+    const triggerPattern_t * pattern;
+
+    triggerPrediction_t predictionMode;
+    float predictedPeriod;                                      // Uncorrected prediction of the period now running, 0 if none
+    uint32_t predictedFrom;                                     // Time of the primary event the prediction was made at
+    float toothCorrection[TRIGGER_MAX_PRIMARY_EVENTS];          // Learned actual / predicted period, per primary event
 };
 
 struct triggerStatus_t triggerStatus = {
     .hasSync = 0,
     .syncConfidence = 0,
-    .pastPrimaryEvents = {0, 0, 0, 0},
+    .primaryHistoryIndex = 0,
     .pastSecondaryEvents = {0, 0, 0, 0},
-    .primaryEventAngles = {105, 175, 285, 355, 465, 535, 645, 715}
+    .pattern = &triggerPatternStock,
+    .predictionMode = TRIGGER_PREDICT_LINEAR,
+    .predictedPeriod = 0
+};
+
+// Everything the getters need, worked out once per counted event by the decoder
+// so the getters are just loads. The decoder only publishes with interrupts
+// masked (or from the trigger ISRs), and readers copy it out without blocking.
+// triggerPublishedSequence is odd while a write is in progress, and a reader
+// that sees it change while copying simply copies again. Single words can be
+// read on their own without the sequence check.
+struct triggerPublished_t{
+    uint32_t hasSync;
+    uint32_t syncConfidence;
+    uint32_t newestEventTime;       // Time of the most recent primary event
+    float newestEventAngle;         // Angle of the most recent primary event
+    float rpm;                      // 0 if sync is not trusted yet
+    float usPerDegree;              // -1 if sync is not trusted yet
+    float degreePerUs;              // -1 if sync is not trusted yet
+    int32_t isCranking;
+
+    // Angle extrapolation from the most recent primary event
+    float speed;                    // Degree per uS at the most recent primary event
+    float acceleration;             // Degree per uS^2, 0 for linear prediction
+    float timeScale;                // 1 / learned correction of the tooth now running
+};
+
+static struct triggerPublished_t triggerPublished;
+static volatile uint32_t triggerPublishedSequence = 0;
+
+// Edges waiting for the decoder task, packed down to 8 bytes. The trigger ISRs
+// are the only producer (they share a priority, so never preempt each other)
+// and the decoder task the only consumer, so the ring needs no lock. Head and
+// tail count up forever and are masked on use.
+struct triggerPackedEvent_t{
+    uint32_t timeStamp;
+    uint32_t eventID : 2;           // triggerEventID_t
+    uint32_t primaryHigh : 1;
+    uint32_t secondaryHigh : 1;
 };
 
+static struct triggerPackedEvent_t triggerEventRing[TRIGGER_EVENT_RING_SIZE];
+static volatile uint32_t triggerEventRingHead = 0;     // Written by the ISRs only
+static volatile uint32_t triggerEventRingTail = 0;     // Written by the decoder task only
+static volatile uint32_t triggerEventOverflows = 0;    // Edges dropped because the ring was full
+
 TaskHandle_t TriggerDecoderTaskHandle = NULL;
-QueueHandle_t triggerEventQHandle;
-SemaphoreHandle_t triggerStatusMutexHandle;
+
+// Primary event number that raises TRIG_EVT_TOOTH each time it is seen in sync.
+// None until one is asked for, so the event group is not set every cycle.
+static uint32_t toothOfInterest = TRIG_NO_TOOTH;
+
+// TRIG_EVT_RPM_ABOVE is raised when the rpm goes above the high threshold and
+// TRIG_EVT_RPM_BELOW when it then drops below the low one. A high threshold of
+// 0 raises neither.
+static float rpmThresholdLow = 0;
+static float rpmThresholdHigh = 0;
+static uint32_t rpmAbove = 0;
+
+// Called on every primary event while sync is trusted
+static triggerToothCallback_t toothCallbacks[TRIGGER_MAX_TOOTH_CALLBACKS];
+static uint32_t toothCallbackCount = 0;
+
+#ifdef TRIGGER_INPUT_CAPTURE
+// Filled by DMA1 channel 1 (crank, TIM5 is 32 bit) and channel 2 (cam, TIM3 is 16 bit)
+static volatile uint32_t crankCaptureRing[TRIGGER_CAPTURE_RING_SIZE];
+static volatile uint16_t camCaptureRing[TRIGGER_CAPTURE_RING_SIZE];
+static uint32_t crankCaptureReadIndex = 0;
+static uint32_t camCaptureReadIndex = 0;
+
+// A capture does not tell us which edge it was, so the trigger levels are tracked
+static uint32_t crankLevel;
+static uint32_t camLevel;
+#endif
+
+#ifdef TRIGGER_TOOTH_LOG
+// Written by whichever of the trigger ISRs or the decoder task decodes the
+// edges, always with the trigger interrupts masked. Head counts up forever
+// and is masked on use. Remaining is the number of edges still to be logged,
+// TRIGGER_TOOTH_LOG_RUNNING until sync is lost and 0 once frozen.
+static triggerToothLogEntry_t toothLog[TRIGGER_TOOTH_LOG_SIZE];
+static uint32_t toothLogHead = 0;
+static volatile uint32_t toothLogRemaining = 0;
+static uint32_t toothLogOverflows = 0;      // triggerEventOverflows at the last logged edge
+#endif
 
 /******************************************************************************
 * Function Code
@@ -92,6 +245,10 @@ SemaphoreHandle_t triggerStatusMutexHandle;
 * David Tolsma, 05/25/2020
 ******************************************************************************/
 void TriggerDecoder_Init(void){
+#ifdef TRIGGER_INPUT_CAPTURE
+    // Timestamp the triggers with the capture timers
+    triggerDecoder_captureInit();
+#else
     // Enable the System config controller
     SET_BIT(RCC->APB2ENR, RCC_APB2ENR_SYSCFGEN);
 
@@ -118,9 +275,17 @@ void TriggerDecoder_Init(void){
     // Set NVIC Priotities to allow FreeRTOS calls in interupt
     NVIC_SetPriority(EXTI1_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY);
     NVIC_SetPriority(EXTI3_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY);
+#endif
 
-    // Create mutual exclusion for shared triggerStatus struct
-    triggerStatusMutexHandle = xSemaphoreCreateMutex();
+    // No tooth corrections have been learned yet
+    triggerDecoder_resetCorrections();
+
+#ifdef TRIGGER_TOOTH_LOG
+    TriggerDecoder_ToothLogArm();
+#endif
+
+    // Create the event group used to publish sync changes and the tooth of interest
+    triggerDecoderEventGroup = xEventGroupCreate();
 
     // Create the trigger decoder task
     xTaskCreate( 	TriggerDecoder_Task,        	    /* Function that implements the task. */
@@ -134,6 +299,157 @@ void TriggerDecoder_Init(void){
 
 
 
+/******************************************************************************
+* void TriggerDecoder_SetPattern(const triggerPattern_t * pattern)
+* Selects the trigger wheel pattern to decode. Sync is dropped and has to be
+* found again on the new pattern. Patterns that decode in the ISR and patterns
+* that decode in the task can not be swapped for each other once the scheduler
+* is running, so the pattern should be picked before TriggerDecoder_Init.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void TriggerDecoder_SetPattern(const triggerPattern_t * pattern){
+    // The trigger ISRs and the decoder task also write to the status structure
+    taskENTER_CRITICAL();
+
+    triggerStatus.pattern = pattern;
+    triggerStatus.hasSync = 0;
+    triggerStatus.syncConfidence = 0;
+    triggerStatus.lastPrimaryEventNumber = 0;
+    triggerStatus.lastSecondaryEventNumber = 0;
+    triggerDecoder_resetCorrections();
+    triggerDecoder_publishStatus();
+
+    taskEXIT_CRITICAL();
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void TriggerDecoder_SetRpmThresholds(float low, float high)
+* Sets the rpm band that raises TRIG_EVT_RPM_ABOVE and TRIG_EVT_RPM_BELOW.
+* The gap between the two is the hysteresis, so an rpm hovering on one
+* threshold does not raise an event every tooth. The next primary event
+* raises TRIG_EVT_RPM_ABOVE if the engine is already above the band.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void TriggerDecoder_SetRpmThresholds(float low, float high){
+    taskENTER_CRITICAL();
+
+    rpmThresholdLow = low;
+    rpmThresholdHigh = high;
+    rpmAbove = 0;
+
+    taskEXIT_CRITICAL();
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t TriggerDecoder_AddToothCallback(triggerToothCallback_t callback)
+* Registers a function to be called on every primary event while sync is
+* trusted. Schedulers use it to correct events against the latest tooth, and
+* sensors to time angle based samples. Callbacks run in the order they were
+* added. Returns 0 if all TRIGGER_MAX_TOOTH_CALLBACKS are taken. Only called
+* during initialization.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+uint32_t TriggerDecoder_AddToothCallback(triggerToothCallback_t callback){
+    if(toothCallbackCount >= TRIGGER_MAX_TOOTH_CALLBACKS){
+        return 0;
+    }
+
+    toothCallbacks[toothCallbackCount] = callback;
+    toothCallbackCount++;
+    return 1;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t TriggerDecoder_GetReferenceTooth(float angle, float * offset)
+* Returns the last primary event of the active pattern at or before an engine
+* angle (0-720*), and the angle from that event to the requested angle. An
+* event stored as (tooth, offset) can be timed from the tooth when it arrives,
+* so it never has to be extrapolated across more than one tooth gap.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+uint32_t TriggerDecoder_GetReferenceTooth(float angle, float * offset){
+    const triggerPattern_t * pattern = triggerStatus.pattern;
+    uint32_t referenceTooth;
+    uint32_t x;
+
+    // Event angles are in increasing order, so this is the last event if the angle
+    // comes before the first event
+    referenceTooth = pattern->primaryEventCount - 1;
+    for(x = 0; x < pattern->primaryEventCount; x++){
+        if(pattern->primaryEventAngles[x] > angle){
+            break;
+        }
+        referenceTooth = x;
+    }
+
+    *offset = angle - pattern->primaryEventAngles[referenceTooth];
+    if(*offset < 0){
+        *offset = *offset + 720;
+    }
+
+    return referenceTooth;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* float TriggerDecoder_GetToothAngle(uint32_t primaryEventNumber)
+* Returns the engine angle of a primary event in the 720 degree cycle. Event
+* numbers past the last wrap round to the first, so the next event of the
+* last is event + 1.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+float TriggerDecoder_GetToothAngle(uint32_t primaryEventNumber){
+    const triggerPattern_t * pattern = triggerStatus.pattern;
+
+    return pattern->primaryEventAngles[primaryEventNumber % pattern->primaryEventCount];
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void TriggerDecoder_SetPredictionMode(triggerPrediction_t mode)
+* Selects how the current angle is extrapolated from the most recent primary
+* event. The per tooth corrections are learned again from scratch.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void TriggerDecoder_SetPredictionMode(triggerPrediction_t mode){
+    taskENTER_CRITICAL();
+
+    triggerStatus.predictionMode = mode;
+    triggerDecoder_resetCorrections();
+    triggerDecoder_publishStatus();
+
+    taskEXIT_CRITICAL();
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void TriggerDecoder_SetToothOfInterest(uint32_t primaryEventNumber)
+* Selects the primary event that raises TRIG_EVT_TOOTH each time it is seen
+* while in sync. TRIG_NO_TOOTH turns it off.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void TriggerDecoder_SetToothOfInterest(uint32_t primaryEventNumber){
+    toothOfInterest = primaryEventNumber;
+}
+/*****************************************************************************/
+
+
+
 /******************************************************************************
 * void TriggerDecoder_Task(void)
 * Pends on an event, then processes the event and updates the trigger
@@ -141,581 +457,918 @@ void TriggerDecoder_Init(void){
 * David Tolsma, 05/25/2020
 ******************************************************************************/
 void TriggerDecoder_Task(void * pvParameters){
-    // Create queue for events to be passed from ISRs to this function
-    triggerEventQHandle = xQueueCreate( 10, sizeof( struct triggerEvent_t) );
-    
-    struct triggerEvent_t eventBeingProcessed;
+    uint32_t notificationValue;
 
     // Enable interupt
+#ifdef TRIGGER_INPUT_CAPTURE
+	NVIC_EnableIRQ(TIM3_IRQn);
+	NVIC_EnableIRQ(TIM5_IRQn);
+#else
 	NVIC_EnableIRQ(EXTI1_IRQn);
 	NVIC_EnableIRQ(EXTI3_IRQn);
+#endif
 
 	while(1){
-        
-        // Pend on an event coming from the ISRs
-        xQueueReceive(triggerEventQHandle,
-					  &eventBeingProcessed,
-					  portMAX_DELAY);
-
-        // Grab mutex for the triggerStatus structure, then return it at the end of the function.
-        xSemaphoreTake(triggerStatusMutexHandle, portMAX_DELAY);
-
-        if((eventBeingProcessed.eventID == PRIMARY_RISE) || (eventBeingProcessed.eventID == PRIMARY_FALL)){
-            // Increment event number (and set to zero on overflow)
-            if( triggerStatus.lastPrimaryEventNumber < 7){
-                triggerStatus.lastPrimaryEventNumber++;
-            }
-            else if (triggerStatus.lastPrimaryEventNumber == 7){
-                triggerStatus.lastPrimaryEventNumber = 0;
-            }
-            else{
-                while(1); // Error trap, should never get here.
-            }
 
-            // Shift log, and add new event to log of past events (implemented without a for loop for speed)
-            triggerStatus.pastPrimaryEvents[3] = triggerStatus.pastPrimaryEvents[2];
-            triggerStatus.pastPrimaryEvents[2] = triggerStatus.pastPrimaryEvents[1];
-            triggerStatus.pastPrimaryEvents[1] = triggerStatus.pastPrimaryEvents[0];
-            triggerStatus.pastPrimaryEvents[0] = eventBeingProcessed.timeStamp;
+        // Patterns that decode in the ISRs wake us with the TRIG_EVT_* bits they raised,
+        // all others wake us with TRIGGER_NOTIFY_EVENTS when edges are waiting in the ring.
+        // While there are edges in the history we also wake every stall time to check the
+        // engine is still turning, with an empty history we sleep until an edge arrives.
+        if(xTaskNotifyWait(0,                  //do not clear any bits on entry
+                           0xffffffff,
+                           &notificationValue,
+                           (triggerDecoder_primaryEventTime(0) != 0) ? pdMS_TO_TICKS(TRIGGER_STALL_TIME_MS) : portMAX_DELAY) == pdFALSE){
+            notificationValue = triggerDecoder_checkStall();
+        }
+        else{
+            LATENCY_TASK_RUNNING(LATENCY_TRIGGER_TASK);
+        }
+
+        if(notificationValue & TRIGGER_NOTIFY_EVENTS){
+            notificationValue = (notificationValue & ~TRIGGER_NOTIFY_EVENTS) | triggerDecoder_drainEvents();
+        }
+
+        if(notificationValue != 0){
+            xEventGroupSetBits(triggerDecoderEventGroup, notificationValue);
+        }
+	}
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t triggerDecoder_processEvent(const struct triggerEvent_t * event)
+* Walks the active trigger pattern by one edge. The pattern tables give the
+* expected level of the other trigger (and the gap) for every event, so the
+* work per edge is a few table lookups no matter which wheel is fitted.
+* Returns the TRIG_EVT_* bits raised by this edge.
+* Must be called with interrupts masked, or from the trigger ISRs.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint32_t triggerDecoder_processEvent(const struct triggerEvent_t * event){
+    const triggerPattern_t * pattern = triggerStatus.pattern;
+    const triggerSyncRule_t * syncRule;
+    uint32_t edge;
+    uint32_t otherLevel;
+    uint32_t flags;
+    uint32_t gap;
+    uint32_t eventOk;
+    uint32_t hadSync = triggerStatus.hasSync;
+    uint32_t notificationBits = 0;
+    float toothUsPerDegree;
+    uint32_t x;
+
+    if((event->eventID == PRIMARY_RISE) || (event->eventID == PRIMARY_FALL)){
+        // Edges that the pattern does not count (ie. falling edges on a missing tooth wheel) are ignored
+        edge = (event->eventID == PRIMARY_RISE) ? TRIG_EDGE_RISE : TRIG_EDGE_FALL;
+        if((pattern->primaryEdges & edge) == 0){
+            return 0;
+        }
+
+        // Ratio test for the missing tooth gap, the period that just ended is compared
+        // against the one before it. No test is made until two periods have been seen.
+        gap = 0;
+        if((pattern->gapRatio > 0) && (triggerDecoder_primaryEventTime(1) != 0)){
+            gap = ((float)(event->timeStamp - triggerDecoder_primaryEventTime(0))) >
+                  (pattern->gapRatio * (float)(triggerDecoder_primaryEventTime(0) - triggerDecoder_primaryEventTime(1)));
+        }
+
+        // Increment event number (and set to zero on overflow)
+        triggerStatus.lastPrimaryEventNumber++;
+        if(triggerStatus.lastPrimaryEventNumber >= pattern->primaryEventCount){
+            triggerStatus.lastPrimaryEventNumber = 0;
+        }
+
+        // Add new event to the ring of past events, overwriting the oldest
+        triggerStatus.primaryHistoryIndex = (triggerStatus.primaryHistoryIndex + 1) & TRIGGER_PRIMARY_HISTORY_MASK;
+        triggerStatus.pastPrimaryEvents[triggerStatus.primaryHistoryIndex] = event->timeStamp;
 
-            // Check to see if the last added event makes sense with respect to what the secondary trigger is doing
+        otherLevel = (event->secondaryTriggerValue == SECONDARY_HIGH) ? TRIG_EXPECT_HIGH : TRIG_EXPECT_LOW;
+        syncRule = triggerDecoder_findSyncRule(event->eventID, otherLevel, gap);
 
+        if(triggerStatus.hasSync == 0){
             // If the trigger does not have sync, check if this is an event where we can establish sync
-            // On a primary trigger event, we can only establish sync if on a falling edge, we see that the secondary
-            // trigger is high. If it is high, then we know that we just saw primary event #4. We will then change
-            // the last seen event for the primary trigger to event #3, secondary trigger to event #0 and establish
-            // a sync condition
-            if(triggerStatus.hasSync == 0){
-                if( (eventBeingProcessed.eventID == PRIMARY_FALL) && (eventBeingProcessed.secondaryTriggerValue == SECONDARY_HIGH) ){
-                    triggerStatus.lastPrimaryEventNumber = 3;
-                    triggerStatus.lastSecondaryEventNumber = 0;
-                    triggerStatus.hasSync = 1;
-                    triggerStatus.syncConfidence = 1;
-                }
+            if(syncRule != NULL){
+                triggerStatus.lastPrimaryEventNumber = syncRule->primaryEventNumber;
+                triggerStatus.lastSecondaryEventNumber = syncRule->secondaryEventNumber;
+                triggerStatus.hasSync = 1;
+                triggerStatus.syncConfidence = 1;
             }
-            // If the trigger has sync, check if this is an event that matches the expected secondary trigger value, if
-            // it does not, then we have lost sync and should set .hasSync = 0.
-            else if(triggerStatus.hasSync == 1){
-                switch(triggerStatus.lastPrimaryEventNumber){
-                    case 0: {
-                        if(eventBeingProcessed.secondaryTriggerValue != SECONDARY_LOW){
-                            triggerStatus.hasSync = 0;
-                            triggerStatus.syncConfidence = 0;
-                        }
-                        else{
-                            triggerStatus.syncConfidence++;
-                        }
-                        break;
-                    }
-                    case 1: {
-                        if(eventBeingProcessed.secondaryTriggerValue != SECONDARY_LOW){
-                            triggerStatus.hasSync = 0;
-                            triggerStatus.syncConfidence = 0;
-                        }
-                        else{
-                            triggerStatus.syncConfidence++;
-                        }
-                        break;
-                    }
-                    case 2: {
-                        if(eventBeingProcessed.secondaryTriggerValue != SECONDARY_HIGH){
-                            triggerStatus.hasSync = 0;
-                            triggerStatus.syncConfidence = 0;
-                        }
-                        else{
-                            triggerStatus.syncConfidence++;
-                        }
-                        break;
-                    }
-                    case 3: {
-                        if(eventBeingProcessed.secondaryTriggerValue != SECONDARY_HIGH){
-                            triggerStatus.hasSync = 0;
-                            triggerStatus.syncConfidence = 0;
-                        }
-                        else{
-                            triggerStatus.syncConfidence++;
-                        }
-                        break;
-                    }
-                    case 4: {
-                        if(eventBeingProcessed.secondaryTriggerValue != SECONDARY_LOW){
-                            triggerStatus.hasSync = 0;
-                            triggerStatus.syncConfidence = 0;
-                        }
-                        else{
-                            triggerStatus.syncConfidence++;
-                        }
-                        break;
-                    }
-                    case 5: {
-                        if(eventBeingProcessed.secondaryTriggerValue != SECONDARY_LOW){
-                            triggerStatus.hasSync = 0;
-                            triggerStatus.syncConfidence = 0;
-                        }
-                        else{
-                            triggerStatus.syncConfidence++;
-                        }
-                        break;
-                    }
-                    case 6: {
-                        if(eventBeingProcessed.secondaryTriggerValue != SECONDARY_HIGH){
-                            triggerStatus.hasSync = 0;
-                            triggerStatus.syncConfidence = 0;
-                        }
-                        else{
-                            triggerStatus.syncConfidence++;
-                        }
-                        break;
-                    }
-                    case 7: {
-                        if(eventBeingProcessed.secondaryTriggerValue != SECONDARY_LOW){
-                            triggerStatus.hasSync = 0;
-                            triggerStatus.syncConfidence = 0;
-                        }
-                        else{
-                            triggerStatus.syncConfidence++;
-                        }
-                        break;
-                    }
-                    default: {
-                        while(1); // Error trap, we should never get here.
-                    	break;
-                    }
-                }
+        }
+        else{
+            // If the trigger has sync, check that this event matches the expected secondary trigger
+            // value and gap. If it does not, then we have lost sync.
+            flags = pattern->primaryEventFlags[triggerStatus.lastPrimaryEventNumber];
+            eventOk = ((flags & otherLevel) != 0) && (((flags & TRIG_GAP_BEFORE) != 0) == gap);
+
+            // A sync rule that matches while in sync must agree with where we think we are
+            if(syncRule != NULL){
+                eventOk = eventOk && (syncRule->primaryEventNumber == triggerStatus.lastPrimaryEventNumber)
+                                  && (syncRule->secondaryEventNumber == triggerStatus.lastSecondaryEventNumber);
             }
-        } 
 
-        else if((eventBeingProcessed.eventID == SECONDARY_RISE) || (eventBeingProcessed.eventID == SECONDARY_FALL)){
-            
-            // Increment event number (and set to zero on overflow)
-            if( triggerStatus.lastSecondaryEventNumber < 3){
-                triggerStatus.lastSecondaryEventNumber++;
-            }
-            else if (triggerStatus.lastSecondaryEventNumber == 3){
-                triggerStatus.lastSecondaryEventNumber = 0;
+            if(eventOk){
+                triggerStatus.syncConfidence++;
             }
             else{
-                while(1); // Error trap, should never get here.
+                triggerStatus.hasSync = 0;
+                triggerStatus.syncConfidence = 0;
             }
+        }
 
-            // Shift log, and add new event to log of past events (imSecondaryed without a for loop for speed)
-            triggerStatus.pastSecondaryEvents[3] = triggerStatus.pastSecondaryEvents[2];
-            triggerStatus.pastSecondaryEvents[2] = triggerStatus.pastSecondaryEvents[1];
-            triggerStatus.pastSecondaryEvents[1] = triggerStatus.pastSecondaryEvents[0];
-            triggerStatus.pastSecondaryEvents[0] = eventBeingProcessed.timeStamp;
+        if(triggerStatus.hasSync && (triggerStatus.lastPrimaryEventNumber == toothOfInterest)){
+            notificationBits |= TRIG_EVT_TOOTH;
+        }
 
-            // Check to see if the last added event makes sense with respect to what the secondary trigger is doing
+        // Let schedulers correct their events against this tooth, using the speed over the tooth that just ended
+        if((toothCallbackCount > 0) && triggerStatus.hasSync && (triggerStatus.syncConfidence > TRIGGER_MIN_SYNC_CONFIDENCE)){
+            toothUsPerDegree = TIME_TICKS_TO_US((float) TIME_DIFF(event->timeStamp, triggerDecoder_primaryEventTime(1))) / triggerDecoder_primaryAngleSpan(1);
+            for(x = 0; x < toothCallbackCount; x++){
+                toothCallbacks[x](triggerStatus.lastPrimaryEventNumber, event->timeStamp, toothUsPerDegree);
+            }
+        }
+    }
 
-            // If the trigger does not have sync, check if this is an event where we can establish sync
-            // On a secondary trigger event we can only establish sync on a falling edge. When secondary is falling
-            // and the primary trigger is low, then we determine that .lastPrimaryEventNumber = 3, and
-            // .lastSecondaryEventNumber = 1. When the secondary is falling and the primary is high, then we determing
-            // that .lastPrimaryEventNumber = 6 and .lastSecondaryEventNumber = 3.
-            if(triggerStatus.hasSync == 0){
-                if(eventBeingProcessed.eventID == SECONDARY_FALL){
-                    if(eventBeingProcessed.primaryTriggerValue == PRIMARY_LOW){
-                        triggerStatus.lastPrimaryEventNumber = 3;
-                        triggerStatus.lastSecondaryEventNumber = 1;
-                        triggerStatus.hasSync = 1;
-                        triggerStatus.syncConfidence = 1;
-                    }
-                    else if(eventBeingProcessed.primaryTriggerValue == PRIMARY_HIGH){
-                        triggerStatus.lastPrimaryEventNumber = 6;
-                        triggerStatus.lastSecondaryEventNumber = 3;
-                        triggerStatus.hasSync = 1;
-                        triggerStatus.syncConfidence = 1;
-                    }
-                    else{
-                        while(1); // Error trap, should never get here.
-                    }
-                }
+    else if((event->eventID == SECONDARY_RISE) || (event->eventID == SECONDARY_FALL)){
+        edge = (event->eventID == SECONDARY_RISE) ? TRIG_EDGE_RISE : TRIG_EDGE_FALL;
+        if((pattern->secondaryEdges & edge) == 0){
+            return 0;
+        }
+
+        // Increment event number (and set to zero on overflow)
+        triggerStatus.lastSecondaryEventNumber++;
+        if(triggerStatus.lastSecondaryEventNumber >= pattern->secondaryEventCount){
+            triggerStatus.lastSecondaryEventNumber = 0;
+        }
+
+        // Shift log, and add new event to log of past events (implemented without a for loop for speed)
+        triggerStatus.pastSecondaryEvents[3] = triggerStatus.pastSecondaryEvents[2];
+        triggerStatus.pastSecondaryEvents[2] = triggerStatus.pastSecondaryEvents[1];
+        triggerStatus.pastSecondaryEvents[1] = triggerStatus.pastSecondaryEvents[0];
+        triggerStatus.pastSecondaryEvents[0] = event->timeStamp;
+
+        otherLevel = (event->primaryTriggerValue == PRIMARY_HIGH) ? TRIG_EXPECT_HIGH : TRIG_EXPECT_LOW;
+        syncRule = triggerDecoder_findSyncRule(event->eventID, otherLevel, 0);
+
+        if(triggerStatus.hasSync == 0){
+            if(syncRule != NULL){
+                triggerStatus.lastPrimaryEventNumber = syncRule->primaryEventNumber;
+                triggerStatus.lastSecondaryEventNumber = syncRule->secondaryEventNumber;
+                triggerStatus.hasSync = 1;
+                triggerStatus.syncConfidence = 1;
             }
+        }
+        else{
+            flags = pattern->secondaryEventFlags[triggerStatus.lastSecondaryEventNumber];
+            eventOk = ((flags & otherLevel) != 0);
 
-            else if(triggerStatus.hasSync == 1){
-                switch(triggerStatus.lastSecondaryEventNumber){
-                    case 0: {
-                        if(eventBeingProcessed.primaryTriggerValue != PRIMARY_LOW){
-                            triggerStatus.hasSync = 0;
-                            triggerStatus.syncConfidence = 0;
-                        }
-                        else{
-                            triggerStatus.syncConfidence++;
-                        }
-                        break;
-                    }
-
-                    case 1: {
-                        if(eventBeingProcessed.primaryTriggerValue != PRIMARY_LOW){
-                            triggerStatus.hasSync = 0;
-                            triggerStatus.syncConfidence = 0;
-                        }
-                        else{
-                            triggerStatus.syncConfidence++;
-                        }
-                        break;
-                    }
-
-                    case 2: {
-                        if(eventBeingProcessed.primaryTriggerValue != PRIMARY_LOW){
-                            triggerStatus.hasSync = 0;
-                            triggerStatus.syncConfidence = 0;
-                        }
-                        else{
-                            triggerStatus.syncConfidence++;
-                        }
-                        break;
-                    }
-
-                    case 3: {
-                        if(eventBeingProcessed.primaryTriggerValue != PRIMARY_HIGH){
-                            triggerStatus.hasSync = 0;
-                            triggerStatus.syncConfidence = 0;
-                        } 
-                        else{
-                            triggerStatus.syncConfidence++;
-                        }
-                        break;
-                    }
-
-                    default: {
-                        while(1); // Error trap, should never get here.
-                        break;
-                    }
-                }
+            if(syncRule != NULL){
+                eventOk = eventOk && (syncRule->primaryEventNumber == triggerStatus.lastPrimaryEventNumber)
+                                  && (syncRule->secondaryEventNumber == triggerStatus.lastSecondaryEventNumber);
             }
 
+            if(eventOk){
+                triggerStatus.syncConfidence++;
+            }
             else{
-                while(1); // Error trap, should never get here.
+                triggerStatus.hasSync = 0;
+                triggerStatus.syncConfidence = 0;
             }
         }
+    }
 
-        else{
-            while(1); // we should never get here
-        }
+    else{
+        while(1); // we should never get here
+    }
 
-        // Return mutex for the triggerStatus structure.
-        xSemaphoreGive(triggerStatusMutexHandle);
-	}
+    // Let the getters see the new state
+    triggerDecoder_publishStatus();
+
+    if(triggerStatus.hasSync != hadSync){
+        notificationBits |= (triggerStatus.hasSync ? TRIG_EVT_SYNC_GAINED : TRIG_EVT_SYNC_LOST);
+    }
+
+    notificationBits |= triggerDecoder_checkRpm();
+
+    return notificationBits;
 }
 /*****************************************************************************/
 
 
 
 /******************************************************************************
-* float TriggerDecoder_GetRPM(void)
-* Returns the current rpm estimate
-* David Tolsma, 05/25/2020
+* void triggerDecoder_postEventFromISR(const struct triggerEvent_t * event)
+* Hands an edge from the trigger ISRs to the decoder. Patterns that decode in
+* the ISR are processed right here and only wake the decoder task when sync
+* changes or the tooth of interest is seen, all other patterns go into the
+* event ring for the decoder task. The task is only notified when the ring
+* was empty, as it keeps draining until the ring is empty again.
+* David Tolsma, 10/17/2026
 ******************************************************************************/
-float TriggerDecoder_GetRPM(void){
-    // We determine the current RPM by looking at the time it took to cover 
-    // the last 4 primary trigger events
-    float newestAngle;
-    float oldestAngle;
-    float deltaAngle;
-
-    int32_t newestAngleTime;
-    int32_t oldestAngleTime;
-    int32_t deltaTime;
-
-    float rpm;
-
-    // Grab mutex for the triggerStatus structure, then return it at the end of the function.
-    xSemaphoreTake(triggerStatusMutexHandle, portMAX_DELAY);
-
-    if(triggerStatus.syncConfidence > 12){
-        // Get most recent angle
-        newestAngle = triggerStatus.primaryEventAngles[triggerStatus.lastPrimaryEventNumber];
-        // Get oldest angle
-        if(triggerStatus.lastPrimaryEventNumber >= 3){
-            oldestAngle = triggerStatus.primaryEventAngles[triggerStatus.lastPrimaryEventNumber - 3];
-        }
-        else{
-            oldestAngle = triggerStatus.primaryEventAngles[5 + (triggerStatus.lastPrimaryEventNumber)];
+static void triggerDecoder_postEventFromISR(const struct triggerEvent_t * event){
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    uint32_t notificationBits;
+    uint32_t head;
+    struct triggerPackedEvent_t * slot;
+
+    if(triggerStatus.pattern->decodeInIsr){
+        notificationBits = triggerDecoder_processEvent(event);
+        TRIGGER_LOG_TOOTH(event, notificationBits);
+
+        if(notificationBits != 0){
+            LATENCY_TASK_READY(LATENCY_TRIGGER_TASK);
+            xTaskNotifyFromISR(TriggerDecoderTaskHandle,
+                               notificationBits,
+                               eSetBits,
+                               &xHigherPriorityTaskWoken);
         }
+    }
+    else{
+        head = triggerEventRingHead;
 
-        
-        // Determine delta degrees
-        // If the most recent primary trigger events do not span the 720* to 0* transition, then
-        // we can simply subtract the oldest angle from the newest angle.
-        // If the past events do span the 720* to 0* transition, then we know the angle between them
-        // is the angle between the oldest angle and 720* + the angle between 0* and the newest angle.
-        if(newestAngle > oldestAngle){
-            deltaAngle = newestAngle - oldestAngle;
+        if((head - triggerEventRingTail) >= TRIGGER_EVENT_RING_SIZE){
+            // The decoder task has fallen too far behind, the edge is lost
+            triggerEventOverflows++;
         }
         else{
-            deltaAngle = (720 - oldestAngle) + newestAngle;
+            slot = &triggerEventRing[head & TRIGGER_EVENT_RING_MASK];
+            slot->timeStamp = event->timeStamp;
+            slot->eventID = event->eventID;
+            slot->primaryHigh = (event->primaryTriggerValue == PRIMARY_HIGH);
+            slot->secondaryHigh = (event->secondaryTriggerValue == SECONDARY_HIGH);
+
+            // The event must be in the ring before the task can see the new head
+            __DMB();
+            triggerEventRingHead = head + 1;
+
+            if(head == triggerEventRingTail){
+                LATENCY_TASK_READY(LATENCY_TRIGGER_TASK);
+                xTaskNotifyFromISR(TriggerDecoderTaskHandle,
+                                   TRIGGER_NOTIFY_EVENTS,
+                                   eSetBits,
+                                   &xHigherPriorityTaskWoken);
+            }
         }
-        
-
-        // Get the time of the most recent primary event
-        newestAngleTime = triggerStatus.pastPrimaryEvents[0];
-        // Get time of the oldest primary event
-        oldestAngleTime = triggerStatus.pastPrimaryEvents[3];
-
-        // Determine delta time. This is overflow safe, as even if it spans the overflow of the uS timer
-        // beacuse the uS timer counts to 0xFFFF FFFF, subtraction in this way always results in the time
-        // between.
-        deltaTime = newestAngleTime - oldestAngleTime;
-
-
-        // Formula for converting to rpm is: 
-        // 
-        // Degree per microsecond:
-        // deltaAngle (degree) / deltaTime (uS);
-        //
-        // convert uS to seconds, then to minutes - degree per minute:
-        // [deltaAngle (degree)  * 1000000 * 60] / [ deltaTime (uS)]
-        // 
-        // convert degrees to revolutions - revolutions per minute:
-        // [deltaAngle (degree)  * 1000000 * 60] / [ deltaTime (uS) * 360]
-        //
-        rpm = (deltaAngle * 1000000 * 60) / (((float) deltaTime) * 360);
     }
-    else{
-        rpm = 0;
+
+    // If we have woken a higer priority task, we should yield to that task
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t triggerDecoder_drainEvents(void)
+* Decodes every edge waiting in the event ring, oldest first, and returns the
+* TRIG_EVT_* bits they raised. Only called from the decoder task.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint32_t triggerDecoder_drainEvents(void){
+    struct triggerEvent_t event;
+    const struct triggerPackedEvent_t * slot;
+    uint32_t tail = triggerEventRingTail;
+    uint32_t notificationBits = 0;
+    uint32_t eventBits;
+
+    // The head is read again each time round, so edges that arrive while we
+    // are draining are picked up without another notification.
+    while(tail != triggerEventRingHead){
+        __DMB();
+        slot = &triggerEventRing[tail & TRIGGER_EVENT_RING_MASK];
+        event.timeStamp = slot->timeStamp;
+        event.eventID = (triggerEventID_t) slot->eventID;
+        event.primaryTriggerValue = slot->primaryHigh ? PRIMARY_HIGH : PRIMARY_LOW;
+        event.secondaryTriggerValue = slot->secondaryHigh ? SECONDARY_HIGH : SECONDARY_LOW;
+
+        // Hand the slot back to the ISRs before decoding
+        __DMB();
+        tail++;
+        triggerEventRingTail = tail;
+
+        // TriggerDecoder_SetPattern also writes to the status structure, so the
+        // event is decoded with interrupts masked. This only takes a few table lookups.
+        taskENTER_CRITICAL();
+        eventBits = triggerDecoder_processEvent(&event);
+        TRIGGER_LOG_TOOTH(&event, eventBits);
+        taskEXIT_CRITICAL();
+
+        notificationBits |= eventBits;
     }
 
-    // We no longer need access to the trigger status structure.
-    // Return mutex for the triggerStatus structure.
-    xSemaphoreGive(triggerStatusMutexHandle);
-    
-    return rpm;
+    return notificationBits;
 }
 /*****************************************************************************/
 
 
 
+#ifdef TRIGGER_INPUT_CAPTURE
 /******************************************************************************
-* float TriggerDecoder_GetCurrentAngle(void)
-* Returns the current engine angle estimate
-* David Tolsma, 05/25/2020
+* void triggerDecoder_captureInit(void)
+* Routes the crank trigger to TIM5_CH4 and the cam trigger to TIM3_CH4. Both
+* edges are captured and DMA moves every capture into a ring, so a late ISR
+* does not lose or skew any of them, and one that comes after several edges
+* takes them all in one pass. Each capture still interrupts: the decoder and
+* the tooth callbacks retime the sparks and injections from each tooth as it
+* comes, which draining the rings at half and full transfer would hold up by
+* as many as 16 edges.
+* TIM3 and TIM5 are reset by TIM2, so captures share the time base returned
+* by Time_GetTicks.
+* David Tolsma, 10/17/2026
 ******************************************************************************/
-float TriggerDecoder_GetCurrentAngle(void){
-    
-    // We determine the current rotational velocity by looking at the time it
-    // took to cover  the last 4 primary trigger events
-    float newestAngle;
-    float oldestAngle;
-    float deltaAngle;
+static void triggerDecoder_captureInit(void){
+    // Enable the capture timers and the DMA
+    SET_BIT(RCC->APB1ENR1, RCC_APB1ENR1_TIM3EN);
+    SET_BIT(RCC->APB1ENR1, RCC_APB1ENR1_TIM5EN);
+    SET_BIT(RCC->AHB1ENR, RCC_AHB1ENR_DMA1EN);
+    SET_BIT(RCC->AHB1ENR, RCC_AHB1ENR_DMAMUX1EN);
+
+    // Hand the trigger pins to the timers
+    Gpio_SetAlternateFunction(CRANK_PORT, CRANK_PIN, CRANK_CAPTURE_AF);
+    Gpio_SetAlternateFunction(CAM_PORT, CAM_PIN, CAM_CAPTURE_AF);
+
+    // Count at the same rate as TIM2
+    WRITE_REG(TIM5->PSC, READ_REG(TIM2->PSC));
+    WRITE_REG(TIM3->PSC, READ_REG(TIM2->PSC));
+    WRITE_REG(TIM5->ARR, 0xFFFFFFFF);
+    WRITE_REG(TIM3->ARR, 0xFFFF);
+
+    // Channel 4 captures its own input (CC4S = 01), filtered over 8 samples (IC4F = 0011)
+    MODIFY_REG(TIM5->CCMR2, TIM_CCMR2_CC4S | TIM_CCMR2_IC4F, TIM_CCMR2_CC4S_0 | TIM_CCMR2_IC4F_0 | TIM_CCMR2_IC4F_1);
+    MODIFY_REG(TIM3->CCMR2, TIM_CCMR2_CC4S | TIM_CCMR2_IC4F, TIM_CCMR2_CC4S_0 | TIM_CCMR2_IC4F_0 | TIM_CCMR2_IC4F_1);
+
+    // Capture on both edges
+    SET_BIT(TIM5->CCER, TIM_CCER_CC4P | TIM_CCER_CC4NP | TIM_CCER_CC4E);
+    SET_BIT(TIM3->CCER, TIM_CCER_CC4P | TIM_CCER_CC4NP | TIM_CCER_CC4E);
+
+    // Slave reset mode on ITR1 (TIM2 TRGO), so an update of TIM2 restarts both timers with it
+    MODIFY_REG(TIM5->SMCR, TIM_SMCR_TS | TIM_SMCR_SMS, TIM_SMCR_TS_0 | TIM_SMCR_SMS_2);
+    MODIFY_REG(TIM3->SMCR, TIM_SMCR_TS | TIM_SMCR_SMS, TIM_SMCR_TS_0 | TIM_SMCR_SMS_2);
+
+    // DMA1 channel 1 copies each TIM5 CCR4 capture into the crank ring
+    WRITE_REG(DMAMUX1_Channel0->CCR, TRIGGER_DMAREQ_TIM5_CH4 << DMAMUX_CxCR_DMAREQ_ID_Pos);
+    WRITE_REG(DMA1_Channel1->CPAR, (uint32_t) &TIM5->CCR4);
+    WRITE_REG(DMA1_Channel1->CMAR, (uint32_t) crankCaptureRing);
+    WRITE_REG(DMA1_Channel1->CNDTR, TRIGGER_CAPTURE_RING_SIZE);
+    WRITE_REG(DMA1_Channel1->CCR, DMA_CCR_PL | DMA_CCR_MSIZE_1 | DMA_CCR_PSIZE_1 | DMA_CCR_MINC | DMA_CCR_CIRC);
+    SET_BIT(DMA1_Channel1->CCR, DMA_CCR_EN);
+
+    // DMA1 channel 2 copies each TIM3 CCR4 capture into the cam ring
+    WRITE_REG(DMAMUX1_Channel1->CCR, TRIGGER_DMAREQ_TIM3_CH4 << DMAMUX_CxCR_DMAREQ_ID_Pos);
+    WRITE_REG(DMA1_Channel2->CPAR, (uint32_t) &TIM3->CCR4);
+    WRITE_REG(DMA1_Channel2->CMAR, (uint32_t) camCaptureRing);
+    WRITE_REG(DMA1_Channel2->CNDTR, TRIGGER_CAPTURE_RING_SIZE);
+    WRITE_REG(DMA1_Channel2->CCR, DMA_CCR_PL | DMA_CCR_MSIZE_0 | DMA_CCR_PSIZE_0 | DMA_CCR_MINC | DMA_CCR_CIRC);
+    SET_BIT(DMA1_Channel2->CCR, DMA_CCR_EN);
+
+    // Request a DMA transfer and an interrupt on every capture. The interrupt is
+    // only for handing the edge on, its time is already in the ring.
+    SET_BIT(TIM5->DIER, TIM_DIER_CC4DE | TIM_DIER_CC4IE);
+    SET_BIT(TIM3->DIER, TIM_DIER_CC4DE | TIM_DIER_CC4IE);
+
+    // Start the timers, Main lines them up with TIM2 once every slave is set up
+    SET_BIT(TIM5->CR1, TIM_CR1_CEN);
+    SET_BIT(TIM3->CR1, TIM_CR1_CEN);
+
+    // Starting levels of the triggers, each capture toggles them from here
+    crankLevel = (Gpio_ReadInputPin(CRANK_PORT, CRANK_PIN) != 0);
+    camLevel = (Gpio_ReadInputPin(CAM_PORT, CAM_PIN) != 0);
 
-    int32_t newestAngleTime;
-    int32_t oldestAngleTime;
-    int32_t deltaTime;
-    int32_t status;
+    // Set NVIC Priotities to allow FreeRTOS calls in interupt
+    NVIC_SetPriority(TIM3_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY);
+    NVIC_SetPriority(TIM5_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY);
+}
+/*****************************************************************************/
 
-    float degreesPerUS;
-    int32_t currentTime;
-    float currentAngle;
 
-    // Grab mutex for the triggerStatus structure, then return it at the end of the function.
-    xSemaphoreTake(triggerStatusMutexHandle, portMAX_DELAY);
 
-    if(triggerStatus.syncConfidence > 12){
-        // Get most recent angle
-        newestAngle = triggerStatus.primaryEventAngles[triggerStatus.lastPrimaryEventNumber];
-        // Get oldest angle
-        if(triggerStatus.lastPrimaryEventNumber >= 3){
-            oldestAngle = triggerStatus.primaryEventAngles[triggerStatus.lastPrimaryEventNumber - 3];
+/******************************************************************************
+* void triggerDecoder_drainCaptures(void)
+* Hands every capture waiting in the DMA rings to the decoder, crank and cam
+* merged back into the order they happened in. Only called from the capture
+* ISRs, which share a priority and so never preempt each other.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void triggerDecoder_drainCaptures(void){
+    struct triggerEvent_t triggerEvent;
+    uint32_t crankWriteIndex;
+    uint32_t camWriteIndex;
+    uint32_t currentTime;
+    uint32_t crankTime;
+    uint32_t camTime;
+    uint32_t takeCrank;
+    uint32_t pinLevel;
+
+    // Find how far the DMA has written, the time must be read after this so it is
+    // newer than every capture we are about to process
+    crankWriteIndex = (TRIGGER_CAPTURE_RING_SIZE - READ_REG(DMA1_Channel1->CNDTR)) & TRIGGER_CAPTURE_RING_MASK;
+    camWriteIndex = (TRIGGER_CAPTURE_RING_SIZE - READ_REG(DMA1_Channel2->CNDTR)) & TRIGGER_CAPTURE_RING_MASK;
+    currentTime = Time_GetTicks();
+
+    while((crankCaptureReadIndex != crankWriteIndex) || (camCaptureReadIndex != camWriteIndex)){
+        crankTime = crankCaptureRing[crankCaptureReadIndex];
+
+        // TIM3 only holds the low 16 bits of the time, the rest is taken from the current
+        // time. This holds as long as the capture is less than 65536 ticks old.
+        camTime = currentTime - (uint16_t)((uint16_t) currentTime - camCaptureRing[camCaptureReadIndex]);
+
+        // Take the older of the two waiting captures (overflow safe compare)
+        if(camCaptureReadIndex == camWriteIndex){
+            takeCrank = 1;
+        }
+        else if(crankCaptureReadIndex == crankWriteIndex){
+            takeCrank = 0;
         }
         else{
-            oldestAngle = triggerStatus.primaryEventAngles[5 + (triggerStatus.lastPrimaryEventNumber)];
+            takeCrank = !TIME_AFTER(crankTime, camTime);
         }
 
-        // Get the time of the most recent primary event
-        newestAngleTime = triggerStatus.pastPrimaryEvents[0];
-        // Get time of the oldest primary event
-        oldestAngleTime = triggerStatus.pastPrimaryEvents[3];
-
-        // Determine delta time. This is overflow safe, as even if it spans the overflow of the uS timer
-        // beacuse the uS timer counts to 0xFFFF FFFF, subtraction in this way always results in the time
-        // between.
-        deltaTime = newestAngleTime - oldestAngleTime;
-
-        // Determine delta degrees
-        // If the most recent primary trigger events do not span the 720* to 0* transition, then
-        // we can simply subtract the oldest angle from the newest angle.
-        // If the past events do span the 720* to 0* transition, then we know the angle between them
-        // is the angle between the oldest angle and 720* + the angle between 0* and the newest angle.
-        if(newestAngle > oldestAngle){
-            deltaAngle = newestAngle - oldestAngle;
+        if(takeCrank){
+            crankLevel = !crankLevel;
+            triggerEvent.timeStamp = crankTime;
+            triggerEvent.eventID = crankLevel ? PRIMARY_RISE : PRIMARY_FALL;
+            crankCaptureReadIndex = (crankCaptureReadIndex + 1) & TRIGGER_CAPTURE_RING_MASK;
         }
         else{
-            deltaAngle = (720 - oldestAngle) + newestAngle;
+            camLevel = !camLevel;
+            triggerEvent.timeStamp = camTime;
+            triggerEvent.eventID = camLevel ? SECONDARY_RISE : SECONDARY_FALL;
+            camCaptureReadIndex = (camCaptureReadIndex + 1) & TRIGGER_CAPTURE_RING_MASK;
         }
 
-        // We need to determine the degrees travled per microsecond:
-        degreesPerUS = deltaAngle / ((float) deltaTime);
+        triggerEvent.primaryTriggerValue = crankLevel ? PRIMARY_HIGH : PRIMARY_LOW;
+        triggerEvent.secondaryTriggerValue = camLevel ? SECONDARY_HIGH : SECONDARY_LOW;
 
-        // Get the most up to date time
-        currentTime = Time_GetTimeuSeconds();
+        // Decode the edge here or post it to the decoder task
+        triggerDecoder_postEventFromISR(&triggerEvent);
+    }
 
-        // Determine current angle by:
-        // 1) subtracting the most recent event time from the current time to determine time since most recent event.
-        // 2) multiply that time by the degreesPerUS to determine how many degrees traveled since most recent event.
-        // 3) add that to the angle of the most recent event to determine current angle.
-        currentAngle = (((float)(currentTime - newestAngleTime)) * degreesPerUS) + newestAngle;
-        if(currentAngle >= 720){
-            currentAngle = currentAngle - 720;
-        }
+    // Every capture up to the write indexes has now been processed, so the tracked levels
+    // should match the pins. Line them back up in case a capture was overwritten in the
+    // ring. The pin is read first, and only trusted if no new capture arrived meanwhile.
+    pinLevel = (Gpio_ReadInputPin(CRANK_PORT, CRANK_PIN) != 0);
+    if(((TRIGGER_CAPTURE_RING_SIZE - READ_REG(DMA1_Channel1->CNDTR)) & TRIGGER_CAPTURE_RING_MASK) == crankWriteIndex){
+        crankLevel = pinLevel;
+    }
+    pinLevel = (Gpio_ReadInputPin(CAM_PORT, CAM_PIN) != 0);
+    if(((TRIGGER_CAPTURE_RING_SIZE - READ_REG(DMA1_Channel2->CNDTR)) & TRIGGER_CAPTURE_RING_MASK) == camWriteIndex){
+        camLevel = pinLevel;
+    }
+}
+/*****************************************************************************/
+#endif
+
+
+
+/******************************************************************************
+* void triggerDecoder_publishStatus(void)
+* Works out the speed estimates from the triggerStatus structure and publishes
+* them for the getters. This runs once per counted event, so the float math is
+* done here instead of in every getter. Only the decoder writes, and always
+* with interrupts masked or from the trigger ISRs, so a reader is never left
+* waiting on a half finished write.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void triggerDecoder_publishStatus(void){
+    float deltaTime;
+    float deltaAngle;
+    float reciprocal;
+
+    // Odd sequence, a write is in progress
+    triggerPublishedSequence++;
+    __DMB();
+
+    triggerPublished.hasSync = triggerStatus.hasSync;
+    triggerPublished.syncConfidence = triggerStatus.syncConfidence;
+    triggerPublished.newestEventTime = triggerDecoder_primaryEventTime(0);
+    triggerPublished.newestEventAngle = triggerStatus.pattern->primaryEventAngles[triggerStatus.lastPrimaryEventNumber];
+
+    if(triggerStatus.syncConfidence > TRIGGER_MIN_SYNC_CONFIDENCE){
+        // Time (uS) and angle covered by the last 4 primary events. The time is overflow safe, as the
+        // timer counts to 0xFFFF FFFF subtraction always results in the time between.
+        deltaTime = TIME_TICKS_TO_US((float) TIME_DIFF(triggerDecoder_primaryEventTime(0), triggerDecoder_primaryEventTime(3)));
+        deltaAngle = triggerDecoder_primaryAngleSpan(3);
+
+        // One divide gives both speed ratios:
+        // degree per uS = deltaAngle / deltaTime = deltaAngle^2 / (deltaAngle * deltaTime)
+        // uS per degree = deltaTime / deltaAngle = deltaTime^2 / (deltaAngle * deltaTime)
+        reciprocal = 1.0f / (deltaAngle * deltaTime);
+        triggerPublished.degreePerUs = deltaAngle * deltaAngle * reciprocal;
+        triggerPublished.usPerDegree = deltaTime * deltaTime * reciprocal;
+
+        // Formula for converting to rpm is:
+        // [deltaAngle (degree)  * 1000000 * 60] / [ deltaTime (uS) * 360]
+        triggerPublished.rpm = triggerPublished.degreePerUs * ((1000000.0f * 60.0f) / 360.0f);
+
+        // We want to ensure that the engine is turning at least 50 RPM in order to qualify as cranking:
+        // At 50 RPM it takes 600000uS to travel 180 degrees, so we ensure that the last 3 events took
+        // less time than that, scaled to the angle they covered.
+        triggerPublished.isCranking = (TIME_TICKS_TO_US((float) TIME_DIFF(triggerDecoder_primaryEventTime(0), triggerDecoder_primaryEventTime(2))) <
+                                       (triggerDecoder_primaryAngleSpan(2) * (600000.0f / 180.0f)));
+
+        // Speed and acceleration used to extrapolate the angle
+        triggerDecoder_updatePrediction();
     }
     else{
-        currentAngle = -1;
+        triggerPublished.degreePerUs = -1;
+        triggerPublished.usPerDegree = -1;
+        triggerPublished.rpm = 0;
+        triggerPublished.isCranking = 0;
+
+        triggerPublished.speed = 0;
+        triggerPublished.acceleration = 0;
+        triggerPublished.timeScale = 1;
+        triggerStatus.predictedPeriod = 0;
     }
 
-    // We no longer need access to the trigger status structure.
-    // Return mutex for the triggerStatus structure.
-    xSemaphoreGive(triggerStatusMutexHandle);
+    // Even sequence, the copy is complete
+    __DMB();
+    triggerPublishedSequence++;
+}
+/*****************************************************************************/
+
 
 
-    return currentAngle; 
+/******************************************************************************
+* void triggerDecoder_readStatus(struct triggerPublished_t * status)
+* Takes a consistent copy of the published status without blocking. If the
+* decoder published while we were copying, the copy is simply taken again.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void triggerDecoder_readStatus(struct triggerPublished_t * status){
+    uint32_t sequence;
+
+    do{
+        sequence = triggerPublishedSequence;
+        __DMB();
+        *status = triggerPublished;
+        __DMB();
+    }while((sequence & 1U) || (sequence != triggerPublishedSequence));
 }
+/*****************************************************************************/
 
+
+
+/******************************************************************************
+* const triggerSyncRule_t * triggerDecoder_findSyncRule(eventID, otherLevel, gap)
+* Returns the sync rule of the active pattern matching this edge, or NULL if
+* the edge can not establish sync. Patterns carry at most a handful of rules.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static const triggerSyncRule_t * triggerDecoder_findSyncRule(triggerEventID_t eventID, uint32_t otherLevel, uint32_t gap){
+    const triggerPattern_t * pattern = triggerStatus.pattern;
+    const triggerSyncRule_t * rule;
+    uint32_t x;
+
+    for(x = 0; x < pattern->syncRuleCount; x++){
+        rule = &pattern->syncRules[x];
+        if((rule->eventID == eventID) && (rule->otherLevel & otherLevel) && (rule->requiresGap == gap)){
+            return rule;
+        }
+    }
+
+    return NULL;
+}
 /*****************************************************************************/
 
 
 
 /******************************************************************************
-* float TriggerDecoder_GetUsPerDegree(void)
-* Returns the number of microseconds needed to traverse one degree
-* David Tolsma, 05/25/2020
+* uint32_t triggerDecoder_previousPrimaryEvent(uint32_t eventsBack)
+* Returns the primary event number seen eventsBack events ago.
+* David Tolsma, 10/17/2026
 ******************************************************************************/
-float TriggerDecoder_GetUsPerDegree(void){
-    
-    // We determine the current rotational velocity by looking at the time it
-    // took to cover  the last 4 primary trigger events
+static uint32_t triggerDecoder_previousPrimaryEvent(uint32_t eventsBack){
+    if(triggerStatus.lastPrimaryEventNumber >= eventsBack){
+        return triggerStatus.lastPrimaryEventNumber - eventsBack;
+    }
+    return triggerStatus.lastPrimaryEventNumber + triggerStatus.pattern->primaryEventCount - eventsBack;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* float triggerDecoder_primaryAngleSpan(uint32_t eventsBack)
+* Returns the crank angle covered between the primary event seen eventsBack
+* events ago and the most recent primary event.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static float triggerDecoder_primaryAngleSpan(uint32_t eventsBack){
     float newestAngle;
     float oldestAngle;
-    float deltaAngle;
 
-    int32_t newestAngleTime;
-    int32_t oldestAngleTime;
-    int32_t deltaTime;
+    newestAngle = triggerStatus.pattern->primaryEventAngles[triggerStatus.lastPrimaryEventNumber];
+    oldestAngle = triggerStatus.pattern->primaryEventAngles[triggerDecoder_previousPrimaryEvent(eventsBack)];
+
+    // If the most recent primary trigger events do not span the 720* to 0* transition, then
+    // we can simply subtract the oldest angle from the newest angle.
+    // If the past events do span the 720* to 0* transition, then we know the angle between them
+    // is the angle between the oldest angle and 720* + the angle between 0* and the newest angle.
+    if(newestAngle > oldestAngle){
+        return newestAngle - oldestAngle;
+    }
+    return (720 - oldestAngle) + newestAngle;
+}
+/*****************************************************************************/
 
-    float uSPerDegree;
 
-    // Grab mutex for the triggerStatus structure, then return it at the end of the function.
-    xSemaphoreTake(triggerStatusMutexHandle, portMAX_DELAY);
 
-    if(triggerStatus.syncConfidence > 12){
-        // Get most recent angle
-        newestAngle = triggerStatus.primaryEventAngles[triggerStatus.lastPrimaryEventNumber];
-        // Get oldest angle
-        if(triggerStatus.lastPrimaryEventNumber >= 3){
-            oldestAngle = triggerStatus.primaryEventAngles[triggerStatus.lastPrimaryEventNumber - 3];
-        }
-        else{
-            oldestAngle = triggerStatus.primaryEventAngles[5 + (triggerStatus.lastPrimaryEventNumber)];
+/******************************************************************************
+* uint32_t triggerDecoder_primaryEventTime(uint32_t eventsBack)
+* Returns the time of the primary event seen eventsBack events ago, up to
+* TRIGGER_PRIMARY_HISTORY_SIZE - 1 events back.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint32_t triggerDecoder_primaryEventTime(uint32_t eventsBack){
+    return triggerStatus.pastPrimaryEvents[(triggerStatus.primaryHistoryIndex - eventsBack) & TRIGGER_PRIMARY_HISTORY_MASK];
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t triggerDecoder_checkRpm(void)
+* Returns TRIG_EVT_RPM_ABOVE or TRIG_EVT_RPM_BELOW if the published rpm has
+* just left the threshold band on that side. Must be called with interrupts
+* masked or from the trigger ISRs.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint32_t triggerDecoder_checkRpm(void){
+    if(rpmThresholdHigh <= 0){
+        return 0;
+    }
+
+    if((!rpmAbove) && (triggerPublished.rpm > rpmThresholdHigh)){
+        rpmAbove = 1;
+        return TRIG_EVT_RPM_ABOVE;
+    }
+    if(rpmAbove && (triggerPublished.rpm < rpmThresholdLow)){
+        rpmAbove = 0;
+        return TRIG_EVT_RPM_BELOW;
+    }
+
+    return 0;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* uint32_t triggerDecoder_checkStall(void)
+* Drops sync if no primary event has been seen for TRIGGER_STALL_TIME_MS, as
+* a stopped engine sends no edges to lose sync on. The event history is
+* cleared so the first period after a restart is not gap tested against the
+* last one before the stall. This is done even when sync was already lost to
+* noise before the stall, or the long first period would look like the gap.
+* Returns the TRIG_EVT_* bits raised.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static uint32_t triggerDecoder_checkStall(void){
+    uint32_t notificationBits = 0;
+    uint32_t x;
+
+    taskENTER_CRITICAL();
+
+    if((triggerDecoder_primaryEventTime(0) != 0) &&
+       (TIME_DIFF(Time_GetTicks(), triggerDecoder_primaryEventTime(0)) > (int32_t) TIME_US_TO_TICKS(TRIGGER_STALL_TIME_MS * 1000U))){
+        for(x = 0; x < TRIGGER_PRIMARY_HISTORY_SIZE; x++){
+            triggerStatus.pastPrimaryEvents[x] = 0;
         }
 
-        // Get the time of the most recent primary event
-        newestAngleTime = triggerStatus.pastPrimaryEvents[0];
-        // Get time of the oldest primary event
-        oldestAngleTime = triggerStatus.pastPrimaryEvents[3];
-
-        // Determine delta time. This is overflow safe, as even if it spans the overflow of the uS timer
-        // beacuse the uS timer counts to 0xFFFF FFFF, subtraction in this way always results in the time
-        // between.
-        deltaTime = newestAngleTime - oldestAngleTime;
-
-        // Determine delta degrees
-        // If the most recent primary trigger events do not span the 720* to 0* transition, then
-        // we can simply subtract the oldest angle from the newest angle.
-        // If the past events do span the 720* to 0* transition, then we know the angle between them
-        // is the angle between the oldest angle and 720* + the angle between 0* and the newest angle.
-        if(newestAngle > oldestAngle){
-            deltaAngle = newestAngle - oldestAngle;
+        if(triggerStatus.hasSync){
+            triggerStatus.hasSync = 0;
+            triggerStatus.syncConfidence = 0;
+            notificationBits = TRIG_EVT_SYNC_LOST;
         }
-        else{
-            deltaAngle = (720 - oldestAngle) + newestAngle;
+        triggerDecoder_publishStatus();
+
+        notificationBits |= triggerDecoder_checkRpm();
+    }
+
+    taskEXIT_CRITICAL();
+
+    return notificationBits;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* void triggerDecoder_updatePrediction(void)
+* Works out the speed and acceleration used to extrapolate the angle from the
+* most recent primary event, and publishes them with the other estimates.
+*
+* Second order prediction takes the speed over each of the last two tooth
+* periods, which is the speed at the middle of each period. The change in speed
+* between the middles gives the acceleration, which is then used to carry the
+* speed forward to the most recent event. Compression pulses slow the engine
+* down at the same teeth every cycle, so the ratio of each actual tooth period
+* to its prediction is learned per tooth and used to scale time while that
+* tooth is running.
+* Must only be called from triggerDecoder_publishStatus with sync trusted.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void triggerDecoder_updatePrediction(void){
+    const triggerPattern_t * pattern = triggerStatus.pattern;
+    uint32_t nextPrimaryEventNumber;
+    float newestPeriod;
+    float olderPeriod;
+    float newestSpan;
+    float olderSpan;
+    float nextSpan;
+    float newestSpeed;
+    float olderSpeed;
+    float acceleration;
+    float speed;
+    float ratio;
+    float * correction;
+
+    if(triggerStatus.predictionMode == TRIGGER_PREDICT_LINEAR){
+        triggerPublished.speed = triggerPublished.degreePerUs;
+        triggerPublished.acceleration = 0;
+        triggerPublished.timeScale = 1;
+        return;
+    }
+
+    // Secondary events are published too, the prediction only moves on with a new primary event
+    if((triggerStatus.predictedPeriod > 0) && (triggerStatus.predictedFrom == triggerDecoder_primaryEventTime(0))){
+        return;
+    }
+
+    // The last two tooth periods and the angles they covered
+    newestPeriod = TIME_TICKS_TO_US((float) TIME_DIFF(triggerDecoder_primaryEventTime(0), triggerDecoder_primaryEventTime(1)));
+    olderPeriod = TIME_TICKS_TO_US((float) TIME_DIFF(triggerDecoder_primaryEventTime(1), triggerDecoder_primaryEventTime(2)));
+    newestSpan = triggerDecoder_primaryAngleSpan(1);
+    olderSpan = triggerDecoder_primaryAngleSpan(2) - newestSpan;
+
+    // Learn how far off the prediction for the period that just ended was
+    if(triggerStatus.predictedPeriod > 0){
+        ratio = newestPeriod / triggerStatus.predictedPeriod;
+        if((ratio > TRIGGER_CORRECTION_MIN_RATIO) && (ratio < TRIGGER_CORRECTION_MAX_RATIO)){
+            correction = &triggerStatus.toothCorrection[triggerStatus.lastPrimaryEventNumber];
+            *correction += (ratio - *correction) * TRIGGER_CORRECTION_GAIN;
         }
+    }
 
-        // We need to determine the nuber of microseonds per degree.
-        uSPerDegree = ((float) deltaTime) / deltaAngle;
+    // Speed at the middle of each period, and the acceleration between the two middles
+    newestSpeed = newestSpan / newestPeriod;
+    olderSpeed = olderSpan / olderPeriod;
+    acceleration = (newestSpeed - olderSpeed) * 2.0f / (newestPeriod + olderPeriod);
+
+    // Carry the speed forward half a period to the most recent event
+    speed = newestSpeed + (acceleration * newestPeriod * 0.5f);
+    if(speed <= 0){
+        // Slowing down too hard to extrapolate, fall back to the average speed
+        speed = triggerPublished.degreePerUs;
+        acceleration = 0;
     }
-    else{
-        uSPerDegree = -1;
+
+    // Predict the period now running, before correction:
+    // nextSpan = speed * t + acceleration * t^2 / 2, solved with one refinement of t = nextSpan / speed
+    nextPrimaryEventNumber = triggerStatus.lastPrimaryEventNumber + 1;
+    if(nextPrimaryEventNumber >= pattern->primaryEventCount){
+        nextPrimaryEventNumber = 0;
+    }
+    nextSpan = pattern->primaryEventAngles[nextPrimaryEventNumber] - pattern->primaryEventAngles[triggerStatus.lastPrimaryEventNumber];
+    if(nextSpan <= 0){
+        nextSpan = nextSpan + 720;
     }
-    // We no longer need access to the trigger status structure.
-    // Return mutex for the triggerStatus structure.
-    xSemaphoreGive(triggerStatusMutexHandle);
+    triggerStatus.predictedPeriod = nextSpan / (speed + (acceleration * 0.5f * (nextSpan / speed)));
+    if(triggerStatus.predictedPeriod < 0){
+        triggerStatus.predictedPeriod = 0;
+    }
+    triggerStatus.predictedFrom = triggerDecoder_primaryEventTime(0);
 
-    return uSPerDegree;
+    triggerPublished.speed = speed;
+    triggerPublished.acceleration = acceleration;
+    triggerPublished.timeScale = 1.0f / triggerStatus.toothCorrection[nextPrimaryEventNumber];
 }
+/*****************************************************************************/
+
 
+
+/******************************************************************************
+* void triggerDecoder_resetCorrections(void)
+* Forgets all learned per tooth corrections. Must be called with interrupts
+* masked.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void triggerDecoder_resetCorrections(void){
+    uint32_t x;
+
+    for(x = 0; x < TRIGGER_MAX_PRIMARY_EVENTS; x++){
+        triggerStatus.toothCorrection[x] = 1;
+    }
+    triggerStatus.predictedPeriod = 0;
+}
 /*****************************************************************************/
 
 
 
 /******************************************************************************
-* float TriggerDecoder_GetDegreePerUs(void)
-* Returns the number of degrees traveled per microsecond
-* David Tolsma, 05/25/2020
+* void TriggerDecoder_GetSnapshot(triggerSnapshot_t * snapshot)
+* Fills in the angle, speed and sync state of the engine. Everything is worked
+* out from one copy of the published status, so the values all agree with each
+* other and with snapshot->timeStamp. Never blocks.
+* David Tolsma, 10/17/2026
 ******************************************************************************/
-float TriggerDecoder_GetDegreePerUs(void){
-    
-    // We determine the current rotational velocity by looking at the time it
-    // took to cover  the last 4 primary trigger events
-    float newestAngle;
-    float oldestAngle;
-    float deltaAngle;
+void TriggerDecoder_GetSnapshot(triggerSnapshot_t * snapshot){
+    struct triggerPublished_t status;
+    float elapsedTime;
+    float currentAngle;
 
-    int32_t newestAngleTime;
-    int32_t oldestAngleTime;
-    int32_t deltaTime;
+    triggerDecoder_readStatus(&status);
 
-    float degreePerUs;
+    // Read the time after the copy, so it is never older than the newest event
+    snapshot->timeStamp = Time_GetTicks();
+    snapshot->hasSync = status.hasSync;
+    snapshot->syncConfidence = status.syncConfidence;
+    snapshot->rpm = status.rpm;
+    snapshot->usPerDegree = status.usPerDegree;
+    snapshot->degreePerUs = status.degreePerUs;
+    snapshot->isCranking = status.isCranking;
 
-    // Grab mutex for the triggerStatus structure, then return it at the end of the function.
-    xSemaphoreTake(triggerStatusMutexHandle, portMAX_DELAY);
+    if(status.syncConfidence > TRIGGER_MIN_SYNC_CONFIDENCE){
+        // Determine current angle by:
+        // 1) subtracting the most recent event time from the current time to determine time since most recent event,
+        //    scaled by the correction learned for the tooth now running.
+        // 2) integrate the speed and acceleration over that time to determine how many degrees traveled since most recent event.
+        // 3) add that to the angle of the most recent event to determine current angle.
+        elapsedTime = TIME_TICKS_TO_US((float) TIME_DIFF(snapshot->timeStamp, status.newestEventTime)) * status.timeScale;
 
-    if(triggerStatus.syncConfidence > 12){
-        // Get most recent angle
-        newestAngle = triggerStatus.primaryEventAngles[triggerStatus.lastPrimaryEventNumber];
-        // Get oldest angle
-        if(triggerStatus.lastPrimaryEventNumber >= 3){
-            oldestAngle = triggerStatus.primaryEventAngles[triggerStatus.lastPrimaryEventNumber - 3];
-        }
-        else{
-            oldestAngle = triggerStatus.primaryEventAngles[5 + (triggerStatus.lastPrimaryEventNumber)];
+        // Once the engine would have slowed to a stop, hold the angle there rather than going backwards
+        if((status.acceleration < 0) && ((status.speed + (status.acceleration * elapsedTime)) < 0)){
+            elapsedTime = -status.speed / status.acceleration;
         }
 
-        // Get the time of the most recent primary event
-        newestAngleTime = triggerStatus.pastPrimaryEvents[0];
-        // Get time of the oldest primary event
-        oldestAngleTime = triggerStatus.pastPrimaryEvents[3];
-
-        // Determine delta time. This is overflow safe, as even if it spans the overflow of the uS timer
-        // beacuse the uS timer counts to 0xFFFF FFFF, subtraction in this way always results in the time
-        // between.
-        deltaTime = newestAngleTime - oldestAngleTime;
-
-        // Determine delta degrees
-        // If the most recent primary trigger events do not span the 720* to 0* transition, then
-        // we can simply subtract the oldest angle from the newest angle.
-        // If the past events do span the 720* to 0* transition, then we know the angle between them
-        // is the angle between the oldest angle and 720* + the angle between 0* and the newest angle.
-        if(newestAngle > oldestAngle){
-            deltaAngle = newestAngle - oldestAngle;
-        }
-        else{
-            deltaAngle = (720 - oldestAngle) + newestAngle;
+        currentAngle = (elapsedTime * (status.speed + (0.5f * status.acceleration * elapsedTime))) + status.newestEventAngle;
+        if(currentAngle >= 720){
+            // A stalled engine keeps sync until the stall is seen, and its angle can run on for many cycles
+            currentAngle = currentAngle - (720.0f * (float)(uint32_t)(currentAngle * (1.0f / 720.0f)));
         }
-
-        // We need to determine the nuber of microseonds per degree.
-        degreePerUs = deltaAngle / ((float) deltaTime);
+        snapshot->currentAngle = currentAngle;
     }
     else{
-        degreePerUs = -1;
+        snapshot->currentAngle = -1;
     }
+}
+/*****************************************************************************/
 
-    // We no longer need access to the trigger status structure.
-    // Return mutex for the triggerStatus structure.
-    xSemaphoreGive(triggerStatusMutexHandle);
 
 
-    return degreePerUs;
+/******************************************************************************
+* float TriggerDecoder_GetRPM(void)
+* Returns the current rpm estimate
+* David Tolsma, 05/25/2020
+******************************************************************************/
+float TriggerDecoder_GetRPM(void){
+    // Worked out by the decoder on the last event, a single word is always read whole
+    return triggerPublished.rpm;
 }
+/*****************************************************************************/
+
+
 
+/******************************************************************************
+* float TriggerDecoder_GetCurrentAngle(void)
+* Returns the current engine angle estimate
+* David Tolsma, 05/25/2020
+******************************************************************************/
+float TriggerDecoder_GetCurrentAngle(void){
+    triggerSnapshot_t snapshot;
+
+    TriggerDecoder_GetSnapshot(&snapshot);
+
+    return snapshot.currentAngle;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* float TriggerDecoder_GetUsPerDegree(void)
+* Returns the number of microseconds needed to traverse one degree
+* David Tolsma, 05/25/2020
+******************************************************************************/
+float TriggerDecoder_GetUsPerDegree(void){
+    // Worked out by the decoder on the last event, a single word is always read whole
+    return triggerPublished.usPerDegree;
+}
+/*****************************************************************************/
+
+
+
+/******************************************************************************
+* float TriggerDecoder_GetDegreePerUs(void)
+* Returns the number of degrees traveled per microsecond
+* David Tolsma, 05/25/2020
+******************************************************************************/
+float TriggerDecoder_GetDegreePerUs(void){
+    // Worked out by the decoder on the last event, a single word is always read whole
+    return triggerPublished.degreePerUs;
+}
 /*****************************************************************************/
 
 
@@ -742,43 +1395,144 @@ int32_t TriggerDecoder_GetSyncConfidece(void){
 
 
 /******************************************************************************
-* uint32_t TriggerDecoder_IsCranking(void)
-* Determines if tthe engine is cranking or stopped.
-* David Tolsma, 05/25/2020
+* uint32_t TriggerDecoder_GetEventOverflows(void)
+* Returns the number of edges dropped because the decoder task fell behind
+* David Tolsma, 10/17/2026
 ******************************************************************************/
-int32_t TriggerDecoder_IsCranking(void){
-    int32_t timeBetweenEvents;
-    int32_t isCranking;
+uint32_t TriggerDecoder_GetEventOverflows(void){
+    return triggerEventOverflows;
+}
+/*****************************************************************************/
 
-    // Check to see if the decoder has sync
-    if(triggerStatus.syncConfidence > 12){
-        xSemaphoreTake(triggerStatusMutexHandle, portMAX_DELAY);
-        
-        // there is always 180 degrees between any 3 events
-        timeBetweenEvents = triggerStatus.pastPrimaryEvents[0] - triggerStatus.pastPrimaryEvents[2];
 
-        xSemaphoreGive(triggerStatusMutexHandle);
-        // We want to ensure that the engine is turning at least 50 RPM in order to qualify as cranking:
-        // We determine the microseconds it takes to travel 180 degrees at 50 RPM and ensure that the last
-        // 180 degrees took less time than that to happen. 
-        if (timeBetweenEvents < (600000)){
-            isCranking = 1;
-        }
-        else{
-            isCranking = 0;
+#ifdef TRIGGER_TOOTH_LOG
+/******************************************************************************
+* void TriggerDecoder_ToothLogArm(void)
+* Empties the tooth log and starts it logging again
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void TriggerDecoder_ToothLogArm(void){
+    taskENTER_CRITICAL();
+    toothLogHead = 0;
+    toothLogOverflows = triggerEventOverflows;
+    toothLogRemaining = TRIGGER_TOOTH_LOG_RUNNING;
+    taskEXIT_CRITICAL();
+}
+/*****************************************************************************/
+
+
+/******************************************************************************
+* uint32_t TriggerDecoder_ToothLogIsFrozen(void)
+* Returns 1 once the tooth log has stopped after a sync loss (or a read)
+* David Tolsma, 10/17/2026
+******************************************************************************/
+uint32_t TriggerDecoder_ToothLogIsFrozen(void){
+    return (toothLogRemaining == 0);
+}
+/*****************************************************************************/
+
+
+/******************************************************************************
+* uint32_t TriggerDecoder_GetToothLog(triggerToothLogEntry_t * entries, uint32_t maxEntries)
+* Stops the tooth log if it is still running, then copies up to maxEntries
+* of the newest edges, oldest first. Returns how many were copied. Edges are
+* only logged with the trigger interrupts masked, so once the log is stopped
+* it can be copied without masking them.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+uint32_t TriggerDecoder_GetToothLog(triggerToothLogEntry_t * entries, uint32_t maxEntries){
+    uint32_t count;
+    uint32_t index;
+    uint32_t x;
+
+    toothLogRemaining = 0;
+
+    count = (toothLogHead < TRIGGER_TOOTH_LOG_SIZE) ? toothLogHead : TRIGGER_TOOTH_LOG_SIZE;
+    if(count > maxEntries){
+        count = maxEntries;
+    }
+
+    index = toothLogHead - count;
+    for(x = 0; x < count; x++){
+        entries[x] = toothLog[(index + x) & TRIGGER_TOOTH_LOG_MASK];
+    }
+
+    return count;
+}
+/*****************************************************************************/
+
+
+/******************************************************************************
+* void triggerDecoder_logTooth(const struct triggerEvent_t * event, uint32_t notificationBits)
+* Adds an edge to the tooth log with the state the decoder left after it,
+* and counts down the edges left to log once notificationBits shows sync was
+* lost. Runs on every edge, so it is kept to a handful of loads and stores
+* with no loops. Must be called with interrupts masked, or from the trigger
+* ISRs.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+static void triggerDecoder_logTooth(const struct triggerEvent_t * event, uint32_t notificationBits){
+    triggerToothLogEntry_t * entry;
+    uint32_t edge;
+    uint32_t overflows;
+
+    if(toothLogRemaining == 0){
+        return;
+    }
+
+    edge = (uint32_t) event->eventID;
+    if(event->primaryTriggerValue == PRIMARY_HIGH){
+        edge |= TRIG_LOG_PRIMARY_HIGH;
+    }
+    if(event->secondaryTriggerValue == SECONDARY_HIGH){
+        edge |= TRIG_LOG_SECONDARY_HIGH;
+    }
+    if(triggerStatus.hasSync){
+        edge |= TRIG_LOG_SYNC;
+    }
+
+    // Edges the ring had no room for never reach here, flag the edge after them
+    overflows = triggerEventOverflows;
+    if(overflows != toothLogOverflows){
+        edge |= TRIG_LOG_OVERFLOW;
+        toothLogOverflows = overflows;
+    }
+
+    entry = &toothLog[toothLogHead & TRIGGER_TOOTH_LOG_MASK];
+    entry->timeStamp = event->timeStamp;
+    entry->edge = (uint8_t) edge;
+    entry->primaryEventNumber = (uint8_t) triggerStatus.lastPrimaryEventNumber;
+    entry->syncConfidence = (triggerStatus.syncConfidence < 0xFFFFU) ? (uint16_t) triggerStatus.syncConfidence : 0xFFFFU;
+    toothLogHead++;
+
+    if(toothLogRemaining == TRIGGER_TOOTH_LOG_RUNNING){
+        if(notificationBits & TRIG_EVT_SYNC_LOST){
+            toothLogRemaining = TRIGGER_TOOTH_LOG_AFTER_LOSS;
         }
     }
-	else{
-        isCranking = 0;
+    else{
+        toothLogRemaining--;
     }
+}
+/*****************************************************************************/
+#endif
+
 
-    return isCranking;
+/******************************************************************************
+* uint32_t TriggerDecoder_IsCranking(void)
+* Determines if tthe engine is cranking or stopped.
+* David Tolsma, 05/25/2020
+******************************************************************************/
+int32_t TriggerDecoder_IsCranking(void){
+    // Worked out by the decoder on the last event, a single word is always read whole
+    return triggerPublished.isCranking;
 }
 /*****************************************************************************/
 
 
 
 
+#ifndef TRIGGER_INPUT_CAPTURE
 /******************************************************************************
 * void EXTI1_IRQHandler(void)
 * ISR handler that looks for a change on,GPIO Port B, Pin 1. When it handles
@@ -790,12 +1544,14 @@ int32_t TriggerDecoder_IsCranking(void){
 * David Tolsma, 05/25/2020
 ******************************************************************************/
 void EXTI1_IRQHandler(void){
-
-    BaseType_t xHigherPriorityTaskWoken;
     struct triggerEvent_t triggerEvent;
+#ifdef LATENCY_MEASURE
+    latencyEntry_t latencyEntry;
+#endif
 
     // Get timestamp as soon as possible for best accuracy
-    triggerEvent.timeStamp = Time_GetTimeuSeconds();
+    triggerEvent.timeStamp = Time_GetTicks();
+    LATENCY_ISR_ENTER(latencyEntry);
 
     // We are in EXTI1_IRQHandler beacuse of a CAM sensor event, however we do not
     // know if it is a rising or falling edge. We check here for that info.
@@ -818,15 +1574,11 @@ void EXTI1_IRQHandler(void){
 
     // Clear interupt source
     SET_BIT(EXTI->PR1, EXTI_PR1_PIF1);
-    
-    // We have not yet woken a higher priority task
-    xHigherPriorityTaskWoken = pdFALSE;
 
-    // Post the trigerEvent struct to the queue
-    xQueueSendFromISR( triggerEventQHandle, (void *) &triggerEvent, &xHigherPriorityTaskWoken );
+    // Decode the edge here or post it to the decoder task
+    triggerDecoder_postEventFromISR(&triggerEvent);
 
-    // If we have woken a higer priority task, we should yield to that task
-    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    LATENCY_ISR_EXIT(latencyEntry, LATENCY_CAM_ISR);
 }
 /*****************************************************************************/
 
@@ -843,11 +1595,14 @@ void EXTI1_IRQHandler(void){
 * David Tolsma, 05/25/2020
 ******************************************************************************/
 void EXTI3_IRQHandler(void){
-    BaseType_t xHigherPriorityTaskWoken;
     struct triggerEvent_t triggerEvent;
+#ifdef LATENCY_MEASURE
+    latencyEntry_t latencyEntry;
+#endif
 
     // Get timestamp as soon as possible for best accuracy
-    triggerEvent.timeStamp = Time_GetTimeuSeconds();
+    triggerEvent.timeStamp = Time_GetTicks();
+    LATENCY_ISR_ENTER(latencyEntry);
 
     // We are in EXTI3_IRQHandler beacuse of a CRANK sensor event, however we do not
     // know if it is a rising or falling edge. We check here for that info.
@@ -870,14 +1625,53 @@ void EXTI3_IRQHandler(void){
 
     // Clear interupt source
     SET_BIT(EXTI->PR1, EXTI_PR1_PIF3);
-    
-    // We have not yet woken a higher priority task
-    xHigherPriorityTaskWoken = pdFALSE;
 
-    // Post the trigerEvent struct to the queue
-    xQueueSendFromISR( triggerEventQHandle, (void *) &triggerEvent, &xHigherPriorityTaskWoken );
+    // Decode the edge here or post it to the decoder task
+    triggerDecoder_postEventFromISR(&triggerEvent);
 
-    // If we have woken a higer priority task, we should yield to that task
-    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    LATENCY_ISR_EXIT(latencyEntry, LATENCY_CRANK_ISR);
+}
+/*****************************************************************************/
+
+#else
+/******************************************************************************
+* void TIM5_IRQHandler(void)
+* void TIM3_IRQHandler(void)
+* ISR handlers for the crank (TIM5_CH4) and cam (TIM3_CH4) captures. The
+* timestamps were latched by the timers and moved to the rings by DMA, so all
+* that is left is to hand them to the decoder.
+* David Tolsma, 10/17/2026
+******************************************************************************/
+void TIM5_IRQHandler(void){
+#ifdef LATENCY_MEASURE
+    latencyEntry_t latencyEntry;
+#endif
+
+    LATENCY_ISR_ENTER(latencyEntry);
+    LATENCY_ISR_TIMER_EVENT(latencyEntry, TIM5, TIM_SR_CC4IF);
+
+    // Clear interupt source
+    CLEAR_BIT(TIM5->SR, TIM_SR_CC4IF | TIM_SR_CC4OF);
+
+    triggerDecoder_drainCaptures();
+
+    LATENCY_ISR_EXIT(latencyEntry, LATENCY_CRANK_ISR);
+}
+
+void TIM3_IRQHandler(void){
+#ifdef LATENCY_MEASURE
+    latencyEntry_t latencyEntry;
+#endif
+
+    LATENCY_ISR_ENTER(latencyEntry);
+    LATENCY_ISR_TIMER_EVENT(latencyEntry, TIM3, TIM_SR_CC4IF);
+
+    // Clear interupt source
+    CLEAR_BIT(TIM3->SR, TIM_SR_CC4IF | TIM_SR_CC4OF);
+
+    triggerDecoder_drainCaptures();
+
+    LATENCY_ISR_EXIT(latencyEntry, LATENCY_CAM_ISR);
 }
 /*****************************************************************************/
+#endif
@@ -0,0 +1,234 @@
+/******************************************************************************
+* File:                    TriggerPattern.c
+* Author:                  David Tolsma
+* Date Modified:           10/17/2026
+* Breif Description:       Trigger wheel pattern descriptors for the decoder
+*******************************************************************************
+* Includes
+******************************************************************************/
+#include "TriggerPattern.h"
+
+/******************************************************************************
+* Defines
+******************************************************************************/
+// Short hands to keep the per event flag tables readable
+#define EXP_H   TRIG_EXPECT_HIGH
+#define EXP_L   TRIG_EXPECT_LOW
+#define EXP_X   TRIG_EXPECT_ANY
+#define GAP_H   (TRIG_EXPECT_HIGH | TRIG_GAP_BEFORE)
+#define GAP_L   (TRIG_EXPECT_LOW | TRIG_GAP_BEFORE)
+
+/******************************************************************************
+* Private Variables (static)
+******************************************************************************/
+
+/******************************************************************************
+* Stock pattern
+* 4 tooth crank and 2 tooth cam, both edges of both triggers are used. Primary
+* events 0, 2, 4, 6 are rising edges, 1, 3, 5, 7 are falling edges. Secondary
+* events 0 and 2 are rising edges, 1 and 3 are falling edges.
+******************************************************************************/
+static const float stockPrimaryAngles[8] = {105, 175, 285, 355, 465, 535, 645, 715};
+
+// Nominal angles, the cam edges sit somewhere between the crank events
+// bounding them.
+static const float stockSecondaryAngles[4] = {230, 410, 590, 680};
+
+static const uint8_t stockPrimaryFlags[8] = {
+    EXP_L, EXP_L, EXP_H, EXP_H, EXP_L, EXP_L, EXP_H, EXP_L
+};
+
+static const uint8_t stockSecondaryFlags[4] = {
+    EXP_L, EXP_L, EXP_L, EXP_H
+};
+
+// On a primary falling edge with the secondary high we just saw primary event
+// #3. On a secondary falling edge the primary level tells us if it was
+// secondary event #1 (primary low) or #3 (primary high).
+static const triggerSyncRule_t stockSyncRules[3] = {
+    {PRIMARY_FALL,   EXP_H, 0, 3, 0},
+    {SECONDARY_FALL, EXP_L, 0, 3, 1},
+    {SECONDARY_FALL, EXP_H, 0, 6, 3}
+};
+
+const triggerPattern_t triggerPatternStock = {
+    .name = "stock 4/2",
+    .primaryEventCount = 8,
+    .secondaryEventCount = 4,
+    .primaryEdges = TRIG_EDGE_BOTH,
+    .secondaryEdges = TRIG_EDGE_BOTH,
+    .primaryEventAngles = stockPrimaryAngles,
+    .secondaryEventAngles = stockSecondaryAngles,
+    .primaryEventFlags = stockPrimaryFlags,
+    .secondaryEventFlags = stockSecondaryFlags,
+    .syncRules = stockSyncRules,
+    .syncRuleCount = 3,
+    .gapRatio = 0,
+    .decodeInIsr = 0
+};
+/*****************************************************************************/
+
+
+/******************************************************************************
+* 36-1 pattern
+* 35 teeth at 10* spacing, rising edges only. Tooth 0 is the first tooth after
+* the gap. A half moon cam is high for the first crank revolution, falling at
+* 355* and rising at 715*, which tells the two revolutions apart at the gap.
+******************************************************************************/
+static const float wheel36_1PrimaryAngles[70] = {
+    0, 10, 20, 30, 40, 50, 60, 70, 80, 90,
+    100, 110, 120, 130, 140, 150, 160, 170, 180, 190,
+    200, 210, 220, 230, 240, 250, 260, 270, 280, 290,
+    300, 310, 320, 330, 340, 360, 370, 380, 390, 400,
+    410, 420, 430, 440, 450, 460, 470, 480, 490, 500,
+    510, 520, 530, 540, 550, 560, 570, 580, 590, 600,
+    610, 620, 630, 640, 650, 660, 670, 680, 690, 700
+};
+
+static const float wheel36_1SecondaryAngles[2] = {355, 715};
+
+static const uint8_t wheel36_1PrimaryFlags[70] = {
+    GAP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H,
+    EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H,
+    EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H,
+    EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, GAP_L, EXP_L, EXP_L, EXP_L, EXP_L,
+    EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L,
+    EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L,
+    EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L
+};
+
+static const uint8_t wheel36_1SecondaryFlags[2] = {EXP_X, EXP_X};
+
+static const triggerSyncRule_t wheel36_1SyncRules[2] = {
+    {PRIMARY_RISE, EXP_H, 1, 0, 1},
+    {PRIMARY_RISE, EXP_L, 1, 35, 0}
+};
+
+const triggerPattern_t triggerPattern36_1 = {
+    .name = "36-1",
+    .primaryEventCount = 70,
+    .secondaryEventCount = 2,
+    .primaryEdges = TRIG_EDGE_RISE,
+    .secondaryEdges = TRIG_EDGE_BOTH,
+    .primaryEventAngles = wheel36_1PrimaryAngles,
+    .secondaryEventAngles = wheel36_1SecondaryAngles,
+    .primaryEventFlags = wheel36_1PrimaryFlags,
+    .secondaryEventFlags = wheel36_1SecondaryFlags,
+    .syncRules = wheel36_1SyncRules,
+    .syncRuleCount = 2,
+    .gapRatio = 1.5f,
+    .decodeInIsr = 1
+};
+/*****************************************************************************/
+
+
+/******************************************************************************
+* 60-2 pattern
+* 58 teeth at 6* spacing, rising edges only. Tooth 0 is the first tooth after
+* the gap. A half moon cam is high for the first crank revolution, falling at
+* 351* and rising at 711*.
+******************************************************************************/
+static const float wheel60_2PrimaryAngles[116] = {
+    0, 6, 12, 18, 24, 30, 36, 42, 48, 54,
+    60, 66, 72, 78, 84, 90, 96, 102, 108, 114,
+    120, 126, 132, 138, 144, 150, 156, 162, 168, 174,
+    180, 186, 192, 198, 204, 210, 216, 222, 228, 234,
+    240, 246, 252, 258, 264, 270, 276, 282, 288, 294,
+    300, 306, 312, 318, 324, 330, 336, 342, 360, 366,
+    372, 378, 384, 390, 396, 402, 408, 414, 420, 426,
+    432, 438, 444, 450, 456, 462, 468, 474, 480, 486,
+    492, 498, 504, 510, 516, 522, 528, 534, 540, 546,
+    552, 558, 564, 570, 576, 582, 588, 594, 600, 606,
+    612, 618, 624, 630, 636, 642, 648, 654, 660, 666,
+    672, 678, 684, 690, 696, 702
+};
+
+static const float wheel60_2SecondaryAngles[2] = {351, 711};
+
+static const uint8_t wheel60_2PrimaryFlags[116] = {
+    GAP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H,
+    EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H,
+    EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H,
+    EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H,
+    EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H,
+    EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, EXP_H, GAP_L, EXP_L,
+    EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L,
+    EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L,
+    EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L,
+    EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L,
+    EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L,
+    EXP_L, EXP_L, EXP_L, EXP_L, EXP_L, EXP_L
+};
+
+static const uint8_t wheel60_2SecondaryFlags[2] = {EXP_X, EXP_X};
+
+static const triggerSyncRule_t wheel60_2SyncRules[2] = {
+    {PRIMARY_RISE, EXP_H, 1, 0, 1},
+    {PRIMARY_RISE, EXP_L, 1, 58, 0}
+};
+
+const triggerPattern_t triggerPattern60_2 = {
+    .name = "60-2",
+    .primaryEventCount = 116,
+    .secondaryEventCount = 2,
+    .primaryEdges = TRIG_EDGE_RISE,
+    .secondaryEdges = TRIG_EDGE_BOTH,
+    .primaryEventAngles = wheel60_2PrimaryAngles,
+    .secondaryEventAngles = wheel60_2SecondaryAngles,
+    .primaryEventFlags = wheel60_2PrimaryFlags,
+    .secondaryEventFlags = wheel60_2SecondaryFlags,
+    .syncRules = wheel60_2SyncRules,
+    .syncRuleCount = 2,
+    .gapRatio = 2.0f,
+    .decodeInIsr = 1
+};
+/*****************************************************************************/
+
+
+/******************************************************************************
+* 24+1 pattern
+* 24 evenly spaced crank teeth at 15*, rising edges only, and a single cam
+* tooth whose rising edge sits at 710*, between crank teeth 47 and 0.
+******************************************************************************/
+static const float wheel24_1PrimaryAngles[48] = {
+    0, 15, 30, 45, 60, 75, 90, 105, 120, 135,
+    150, 165, 180, 195, 210, 225, 240, 255, 270, 285,
+    300, 315, 330, 345, 360, 375, 390, 405, 420, 435,
+    450, 465, 480, 495, 510, 525, 540, 555, 570, 585,
+    600, 615, 630, 645, 660, 675, 690, 705
+};
+
+static const float wheel24_1SecondaryAngles[1] = {710};
+
+static const uint8_t wheel24_1PrimaryFlags[48] = {
+    EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X,
+    EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X,
+    EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X,
+    EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X,
+    EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X, EXP_X
+};
+
+static const uint8_t wheel24_1SecondaryFlags[1] = {EXP_X};
+
+// The cam tooth always lands after crank tooth 47. While in sync this rule
+// also checks that no crank teeth were gained or lost since the last cam tooth.
+static const triggerSyncRule_t wheel24_1SyncRules[1] = {
+    {SECONDARY_RISE, EXP_X, 0, 47, 0}
+};
+
+const triggerPattern_t triggerPattern24_1 = {
+    .name = "24+1",
+    .primaryEventCount = 48,
+    .secondaryEventCount = 1,
+    .primaryEdges = TRIG_EDGE_RISE,
+    .secondaryEdges = TRIG_EDGE_RISE,
+    .primaryEventAngles = wheel24_1PrimaryAngles,
+    .secondaryEventAngles = wheel24_1SecondaryAngles,
+    .primaryEventFlags = wheel24_1PrimaryFlags,
+    .secondaryEventFlags = wheel24_1SecondaryFlags,
+    .syncRules = wheel24_1SyncRules,
+    .syncRuleCount = 1,
+    .gapRatio = 0,
+    .decodeInIsr = 1
+};
+/*****************************************************************************/
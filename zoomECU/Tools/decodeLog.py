@@ -0,0 +1,253 @@
+#!/usr/bin/env python3
+###############################################################################
+# File:                    decodeLog.py
+# Author:                  David Tolsma
+# Date Modified:           10/17/2026
+# Breif Description:       Reads the logs written by Src/Datalog.c off the raw
+#                          SD card (or an image of it) and writes one out as
+#                          CSV in engineering units.
+#
+#   sudo dd if=/dev/sdX of=card.img bs=1M count=64
+#   python3 Tools/decodeLog.py --list card.img
+#   python3 Tools/decodeLog.py card.img > log.csv
+#   python3 Tools/decodeLog.py --session 3 card.img > log.csv
+#
+# The index block points at the newest log, and each log's header at the one
+# before, so every log on the card is found from the index. The newest log is
+# decoded unless --session is given. A log runs from its header block until
+# the frame sequence breaks, which is where frames left by an older, longer
+# log start. A summary of the log (length, frames dropped by the ECU, sync
+# losses) is printed to stderr.
+#
+# To start a card over, zero its index block:
+#   sudo dd if=/dev/zero of=/dev/sdX bs=512 seek=1 count=1
+#
+# --check PROGRAM runs the host build's datalogger (zoomEcuHost -D) twice
+# onto a fresh image and checks the second log was put after the first.
+###############################################################################
+import argparse
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+
+# Must match Inc/Datalog.h and Inc/SdCard.h
+BLOCK_SIZE = 512
+DATALOG_INDEX_BLOCK = 1
+DATALOG_START_BLOCK = 2048
+DATALOG_MAGIC = b"ZOOMLOG\0"
+DATALOG_INDEX_MAGIC = b"ZOOMIDX\0"
+DATALOG_VERSION = 2
+DATALOG_NO_ANGLE = 0xFFFF
+HEADER = struct.Struct("<8sHHHHHHII")
+INDEX = struct.Struct("<8sHHIII")
+FRAME = struct.Struct("<IHHHhHhhhhhhhBBH")
+
+COLUMNS = ["time_us", "sequence", "rpm", "angle", "advance", "dwell_us",
+           "map_kpa", "tps_pct", "lambda", "iat_c", "cts_c", "bat_v", "afm_v",
+           "sync", "sync_confidence", "dropped"]
+
+# Card image for --check, 4MiB, and the run of each log on it
+CHECK_BLOCKS = 8192
+CHECK_RUN = ["60-2", "3000", "100"]
+
+
+def read_block(card, block):
+    card.seek(block * BLOCK_SIZE)
+    return card.read(BLOCK_SIZE)
+
+
+def read_index(card):
+    """Returns the number of logs, the header block of the newest and the next
+    free block."""
+    magic, version, _, sessions, last, next_block = INDEX.unpack_from(read_block(card, DATALOG_INDEX_BLOCK))
+    if magic != DATALOG_INDEX_MAGIC:
+        sys.exit("No logs found (bad index magic %r)" % magic)
+    if version != DATALOG_VERSION:
+        sys.exit("Card index version %d, this reads version %d" % (version, DATALOG_VERSION))
+    return sessions, last, next_block
+
+
+def read_header(card, block):
+    (magic, version, frame_size, per_block, period, ticks_per_us, first,
+     session, previous) = HEADER.unpack_from(read_block(card, block))
+    if magic != DATALOG_MAGIC:
+        sys.exit("No log at block %d (bad magic %r)" % (block, magic))
+    if version != DATALOG_VERSION or frame_size != FRAME.size:
+        sys.exit("Log version %d with %d byte frames, this reads version %d with %d byte frames" %
+                 (version, frame_size, DATALOG_VERSION, FRAME.size))
+    return {"block": block, "per_block": per_block, "period": period, "ticks_per_us": ticks_per_us,
+            "first": first, "session": session, "previous": previous}
+
+
+def logs(card):
+    """Returns the header of every log on the card, oldest first."""
+    found = []
+    _, block, _ = read_index(card)
+    while block != 0:
+        header = read_header(card, block)
+        found.insert(0, header)
+        # Each log is further up the card than the one before it
+        if header["previous"] >= block:
+            print("Log %d points back up the card to block %d, logs before it are not read" %
+                  (header["session"], header["previous"]), file=sys.stderr)
+            break
+        block = header["previous"]
+    return found
+
+
+def frames(card, header):
+    """Yields each frame of a log, oldest first, until the sequence breaks."""
+    sequence = header["first"]
+    block = header["block"] + 1
+    while True:
+        data = read_block(card, block)
+        if len(data) < BLOCK_SIZE:
+            return
+        for x in range(header["per_block"]):
+            frame = FRAME.unpack_from(data, x * FRAME.size)
+            if frame[1] != sequence:
+                return
+            yield frame
+            sequence = (sequence + 1) & 0xFFFF
+        block += 1
+
+
+def decode(card, header, out):
+    """Writes a log out as CSV, or only counts it if out is None. Returns the
+    number of frames, the length in uS, the frames dropped and sync losses."""
+    if out is not None:
+        out.write(",".join(COLUMNS) + "\n")
+
+    count = 0
+    sync_losses = 0
+    last_sync = 0
+    time = 0
+    last_ticks = None
+    dropped = 0
+    for (ticks, sequence, rpm, angle, advance, dwell, map_, tps, o2, iat, cts, bat, afm,
+         sync, confidence, dropped) in frames(card, header):
+        # Time_GetTicks wraps, carry it on from the last frame
+        if last_ticks is None:
+            last_ticks = ticks
+        time += ((ticks - last_ticks) & 0xFFFFFFFF) / header["ticks_per_us"]
+        last_ticks = ticks
+
+        if last_sync and not sync:
+            sync_losses += 1
+        last_sync = sync
+
+        if out is not None:
+            out.write("%.0f,%d,%d,%s,%.1f,%d,%.1f,%.1f,%.3f,%.1f,%.1f,%.3f,%.3f,%d,%d,%d\n" % (
+                time, sequence, rpm,
+                "" if angle == DATALOG_NO_ANGLE else "%.1f" % (angle * 0.1),
+                advance * 0.1, dwell, map_ * 0.1, tps * 0.1, o2 * 0.001,
+                iat * 0.1, cts * 0.1, bat * 0.001, afm * 0.001,
+                sync, confidence, dropped))
+        count += 1
+
+    return count, time, dropped, sync_losses
+
+
+def list_logs(card):
+    for header in logs(card):
+        count, time, dropped, _ = decode(card, header, None)
+        print("log %d at block %d: %d frames, %.1f S, %d dropped" %
+              (header["session"], header["block"], count, time * 1e-6, dropped))
+
+
+def check(program):
+    """Puts a partition table in block 0 of a blank image, logs onto it twice
+    with the host build, and checks block 0 was left alone, the index points
+    at both logs, the second log starts past the end of the first and the
+    first is still whole. Returns the number of failures."""
+    failures = 0
+    mbr = bytes((x * 7) & 0xFF for x in range(BLOCK_SIZE - 2)) + b"\x55\xAA"
+
+    with tempfile.TemporaryDirectory() as directory:
+        path = os.path.join(directory, "card.img")
+        with open(path, "wb") as card:
+            card.write(mbr + bytes((CHECK_BLOCKS - 1) * BLOCK_SIZE))
+
+        counts = []
+        for run in range(2):
+            subprocess.run([program, "-D", path] + CHECK_RUN, check=True, stdout=subprocess.DEVNULL)
+            with open(path, "rb") as card:
+                counts.append([decode(card, header, None)[0] for header in logs(card)])
+
+        with open(path, "rb") as card:
+            if read_block(card, 0) != mbr:
+                print("FAIL block 0 was written")
+                failures += 1
+
+            found = logs(card)
+            sessions, _, next_block = read_index(card)
+            print("%d logs, next free block %d" % (sessions, next_block))
+            for header, count in zip(found, counts[-1]):
+                end = header["block"] + 1 + (count + header["per_block"] - 1) // header["per_block"]
+                print("log %d at block %d to %d, %d frames" % (header["session"], header["block"], end, count))
+
+            if sessions != 2 or len(found) != 2 or [h["session"] for h in found] != [1, 2]:
+                print("FAIL expected logs 1 and 2, found %s" % [h["session"] for h in found])
+                return failures + 1
+            if found[0]["block"] != DATALOG_START_BLOCK:
+                print("FAIL the first log is at block %d, not %d" % (found[0]["block"], DATALOG_START_BLOCK))
+                failures += 1
+            end = found[0]["block"] + 1 + (counts[-1][0] + found[0]["per_block"] - 1) // found[0]["per_block"]
+            if found[1]["block"] < end:
+                print("FAIL the second log at block %d starts inside the first, which ends at %d" % (found[1]["block"], end))
+                failures += 1
+            if counts[-1][0] != counts[0][0] or counts[0][0] == 0:
+                print("FAIL the first log had %d frames, %d after the second" % (counts[0][0], counts[-1][0]))
+                failures += 1
+            if counts[-1][1] == 0:
+                print("FAIL the second log has no frames")
+                failures += 1
+            if next_block <= found[1]["block"]:
+                print("FAIL the index points the next log at block %d, inside the second" % next_block)
+                failures += 1
+
+    print("ok" if failures == 0 else "%d failures" % failures)
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decodes the logs on a zoomECU SD card")
+    parser.add_argument("card", nargs="?", help="SD card device or image")
+    parser.add_argument("--output", "-o", help="CSV file, stdout if not given")
+    parser.add_argument("--session", "-s", type=int, help="Log to decode, the newest if not given")
+    parser.add_argument("--list", "-l", action="store_true", help="List the logs on the card")
+    parser.add_argument("--check", metavar="PROGRAM",
+                        help="Log twice onto an image with the host build and check the logs, instead of decoding")
+    args = parser.parse_args()
+
+    if args.check:
+        sys.exit(1 if check(args.check) else 0)
+    if args.card is None:
+        parser.error("the card is needed")
+
+    with open(args.card, "rb") as card:
+        if args.list:
+            list_logs(card)
+            return
+
+        found = logs(card)
+        if not found:
+            sys.exit("No logs on the card")
+        if args.session is None:
+            header = found[-1]
+        else:
+            header = next((h for h in found if h["session"] == args.session), None)
+            if header is None:
+                sys.exit("No log %d, the card has logs %s" % (args.session, [h["session"] for h in found]))
+
+        out = open(args.output, "w") if args.output else sys.stdout
+        count, time, dropped, sync_losses = decode(card, header, out)
+
+    print("log %d, %d frames, %.1f S at %d mS, %d dropped, %d sync losses" %
+          (header["session"], count, time * 1e-6, header["period"], dropped, sync_losses), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,314 @@
+#!/usr/bin/env python3
+###############################################################################
+# File:                    generateCalibration.py
+# Author:                  David Tolsma
+# Date Modified:           10/17/2026
+# Breif Description:       Generates Src/CalibrationTables.c, the raw ADC to
+#                          engineering unit tables used by Calibration.c.
+#
+# Each table has CALIBRATION_TABLE_SIZE points spread evenly over the 16 bit
+# raw range, so the firmware finds its two points with a shift instead of a
+# search. Sensors are described below by a circuit model (thermistor or
+# linear), or by a CSV of "volts,value" points measured on the real sensor:
+#
+#   python3 Tools/generateCalibration.py                   (built in models)
+#   python3 Tools/generateCalibration.py --csv CTS=cts.csv (override one)
+#   python3 Tools/generateCalibration.py --check build-host/zoomEcuHost
+#
+# Every table is checked against its float model at all 65536 raw values and
+# the worst error is printed, rerun after changing a sensor and commit the
+# regenerated file. --check does the same to the firmware's own conversions,
+# run on the host build, and fails if one is off. ctest runs it.
+###############################################################################
+import argparse
+import csv
+import math
+import os
+import subprocess
+import sys
+
+# Must match Inc/Calibration.h
+CALIBRATION_SHIFT = 9
+CALIBRATION_TABLE_SIZE = (65536 >> CALIBRATION_SHIFT) + 1
+RAW_FULL_SCALE = 65535
+VREF = 3.3
+
+# --check holds the end points of each conversion to rounding, and every other
+# reading to this fraction of the sensor's span between its limits
+CHECK_ROUNDING = 1.0
+CHECK_TOLERANCE = 0.0025
+
+# Spans of a table already this close to the curve are left as sampled
+FIT_ERROR = 1.0
+
+# Thermistor inputs: NTC to ground with a pull up to VREF. The curve is a
+# Steinhart-Hart fit through three (degrees C, ohms) points.
+THERMISTOR_PULLUP = 2490.0
+GM_THERMISTOR = [(-40.0, 100700.0), (30.0, 2238.0), (99.0, 177.0)]
+TEMPERATURE_LIMITS = (-40.0, 150.0)
+
+# Linear inputs: two (volts at the pin, value) points. Every sensor is clamped
+# to its limits after the table lookup, so a table can cross a limit between
+# two of its points without the clamp being smeared over the gap.
+# Values are stored in the units listed in Inc/Calibration.h.
+SENSORS = [
+    # name, model,       points,                             limits,            units
+    ("MAP", "linear",     [(0.0, 100), (3.3, 2600)],           (0, 3000),        "0.1 kPa, MPX4250AP through a 5V to 3.3V divider"),
+    ("AFM", "linear",     [(0.0, 0), (3.3, 3300)],             (0, 3300),        "mV at the pin"),
+    ("TPS", "linear",     [(0.5, 0), (3.0, 1000)],             (0, 1000),        "0.1 % open"),
+    ("O2",  "linear",     [(0.0, 680), (3.3, 1360)],           (680, 1360),      "lambda x 1000, 0-5V wideband through a divider"),
+    ("IAT", "thermistor", GM_THERMISTOR,                       None,             "0.1 degrees C"),
+    ("CTS", "thermistor", GM_THERMISTOR,                       None,             "0.1 degrees C"),
+    ("BAT", "linear",     [(0.0, 0), (3.3, 19800)],            (0, 19800),       "mV, 6:1 divider"),
+]
+
+
+def steinhart_hart(points):
+    """Solves A, B, C of 1/T = A + B ln(R) + C ln(R)^3 through three points."""
+    (t1, r1), (t2, r2), (t3, r3) = points
+    l1, l2, l3 = math.log(r1), math.log(r2), math.log(r3)
+    y1, y2, y3 = 1 / (t1 + 273.15), 1 / (t2 + 273.15), 1 / (t3 + 273.15)
+    g2 = (y2 - y1) / (l2 - l1)
+    g3 = (y3 - y1) / (l3 - l1)
+    c = (g3 - g2) / (l3 - l2) / (l1 + l2 + l3)
+    b = g2 - c * (l1 * l1 + l1 * l2 + l2 * l2)
+    a = y1 - (b + l1 * l1 * c) * l1
+    return a, b, c
+
+
+def thermistor_model(points):
+    """Degrees C x 10 against volts. Not clamped to TEMPERATURE_LIMITS, so the
+    table follows the curve through the limit and the clamp is exact, only a
+    shorted or open sensor reads the limit."""
+    a, b, c = steinhart_hart(points)
+    low, high = TEMPERATURE_LIMITS
+
+    def model(volts):
+        # A shorted sensor reads 0V (hot), an open one reads VREF (cold)
+        if volts <= 0.0:
+            return high * 10
+        if volts >= VREF:
+            return low * 10
+        resistance = THERMISTOR_PULLUP * volts / (VREF - volts)
+        ln_r = math.log(resistance)
+        return (1 / (a + b * ln_r + c * ln_r ** 3) - 273.15) * 10
+    return model
+
+
+def piecewise_model(points):
+    """Straight lines through the points, extended past the end points."""
+    points = sorted(points)
+
+    def model(volts):
+        if volts <= points[0][0]:
+            x0, y0 = points[0]
+            x1, y1 = points[1]
+        elif volts >= points[-1][0]:
+            x0, y0 = points[-2]
+            x1, y1 = points[-1]
+        else:
+            for (x0, y0), (x1, y1) in zip(points, points[1:]):
+                if x0 <= volts <= x1:
+                    break
+        return y0 + (y1 - y0) * (volts - x0) / (x1 - x0)
+    return model
+
+
+def clamped(model, limits):
+    """The transfer function of a sensor, its model held to its limits. The
+    firmware clamps the same way after the table lookup."""
+    def transfer(volts):
+        return min(max(model(volts), limits[0]), limits[1])
+    return transfer
+
+
+def read_csv(path):
+    with open(path, newline="") as f:
+        return [(float(row[0]), float(row[1])) for row in csv.reader(f) if row and not row[0].startswith("#")]
+
+
+def raw_to_volts(raw):
+    return raw * VREF / RAW_FULL_SCALE
+
+
+def build_table(model):
+    table = []
+    for x in range(CALIBRATION_TABLE_SIZE):
+        raw = min(x << CALIBRATION_SHIFT, RAW_FULL_SCALE)
+        # Past the limits only the side of the limit matters, the clamp does the rest
+        value = min(max(int(round(model(raw_to_volts(raw)))), -32768), 32767)
+        table.append(value)
+    return table
+
+
+def fit_table(table, limits, transfer):
+    """Nudges the inner points of a table, a count at a time, wherever that
+    lowers the worst error of the two spans either side. Sampling the curve
+    puts every span of a bent curve off to one side, on the steep end of a
+    thermistor by over a degree, nudging splits it either side. The end
+    points are left on the curve."""
+    expected = [transfer(raw_to_volts(raw)) for raw in range(RAW_FULL_SCALE + 1)]
+
+    def span_error(x):
+        first = (x - 1) << CALIBRATION_SHIFT
+        last = min((x + 1) << CALIBRATION_SHIFT, RAW_FULL_SCALE + 1)
+        return max(abs(lookup(table, limits, raw) - expected[raw]) for raw in range(first, last))
+
+    changed = True
+    while changed:
+        changed = False
+        for x in range(1, CALIBRATION_TABLE_SIZE - 1):
+            best = span_error(x)
+            if best <= FIT_ERROR:
+                continue
+            start = table[x]
+            pick = start
+            for step in (-2, -1, 1, 2):
+                table[x] = start + step
+                error = span_error(x)
+                if error < best:
+                    best = error
+                    pick = table[x]
+            table[x] = pick
+            changed = changed or (pick != start)
+    return table
+
+
+def lookup(table, limits, raw):
+    """Same integer math as Calibration_Convert."""
+    index = raw >> CALIBRATION_SHIFT
+    fraction = raw & ((1 << CALIBRATION_SHIFT) - 1)
+    value = table[index] + (((table[index + 1] - table[index]) * fraction + (1 << (CALIBRATION_SHIFT - 1))) >> CALIBRATION_SHIFT)
+    return min(max(value, limits[0]), limits[1])
+
+
+def worst_error(values, transfer):
+    """Returns the worst error of the converted values, one per raw reading,
+    and the value it happens at. Thermistors are worst near their hot limit,
+    where the curve is steepest."""
+    worst = (0.0, 0.0)
+    for raw in range(RAW_FULL_SCALE + 1):
+        expected = transfer(raw_to_volts(raw))
+        worst = max(worst, (abs(values[raw] - expected), expected))
+    return worst
+
+
+def clamp_points(transfer, limits):
+    """Raw readings the transfer function reaches each limit at, and the
+    reading either side, where a table crossing the limit is worst."""
+    points = set()
+    previous = None
+    for raw in range(RAW_FULL_SCALE + 1):
+        at_limit = transfer(raw_to_volts(raw)) in limits
+        if previous is not None and at_limit != previous:
+            points.update(r for r in (raw - 1, raw, raw + 1) if 0 <= r <= RAW_FULL_SCALE)
+        previous = at_limit
+    return sorted(points)
+
+
+def load_sensors(overrides):
+    """Returns (name, units, source, limits, model) of every sensor, in
+    sensor_t order. Limits are integers in the sensor's units."""
+    sensors = []
+    for name, kind, points, limits, units in SENSORS:
+        if kind == "thermistor":
+            limits = (TEMPERATURE_LIMITS[0] * 10, TEMPERATURE_LIMITS[1] * 10)
+        limits = (int(limits[0]), int(limits[1]))
+
+        if name in overrides:
+            model = piecewise_model(read_csv(overrides[name]))
+            source = "CSV " + os.path.basename(overrides[name])
+        elif kind == "thermistor":
+            model = thermistor_model(points)
+            source = "Steinhart-Hart NTC, %.0f ohm pull up" % THERMISTOR_PULLUP
+        else:
+            model = piecewise_model(points)
+            source = "linear"
+        sensors.append((name, units, source, limits, model))
+    return sensors
+
+
+def check(program, sensors):
+    """Runs the host build's conversion dump (zoomEcuHost -C), one line per raw
+    reading with the value of every sensor, and holds it to the transfer
+    functions. The end points and the readings either side of each clamp must
+    be within a count of the clamped model, every other reading within
+    CHECK_TOLERANCE of the sensor's span. Returns the number of failures."""
+    output = subprocess.run([program, "-C"], check=True, stdout=subprocess.PIPE, universal_newlines=True).stdout
+    rows = [[int(v) for v in line.split()] for line in output.splitlines()]
+    if len(rows) != RAW_FULL_SCALE + 1:
+        print("FAIL expected %d rows, got %d" % (RAW_FULL_SCALE + 1, len(rows)))
+        return 1
+
+    failures = 0
+    for column, (name, units, source, limits, model) in enumerate(sensors):
+        transfer = clamped(model, limits)
+        values = [row[column + 1] for row in rows]
+
+        for raw in [0, RAW_FULL_SCALE] + clamp_points(transfer, limits):
+            expected = transfer(raw_to_volts(raw))
+            if abs(values[raw] - expected) > CHECK_ROUNDING:
+                print("FAIL %-4s raw %5d reads %d, expected %.1f" % (name, raw, values[raw], expected))
+                failures += 1
+
+        error, at = worst_error(values, transfer)
+        status = "ok"
+        if error > CHECK_TOLERANCE * (limits[1] - limits[0]):
+            status = "FAIL"
+            failures += 1
+        print("%-4s %-4s worst error %.2f at %.0f, limit %.2f (%s)" % (status, name, error, at, CHECK_TOLERANCE * (limits[1] - limits[0]), units))
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generates Src/CalibrationTables.c")
+    parser.add_argument("--csv", action="append", default=[], metavar="SENSOR=FILE",
+                        help="volts,value points to use instead of the built in model")
+    parser.add_argument("--output", default=os.path.join(os.path.dirname(__file__), "..", "Src", "CalibrationTables.c"))
+    parser.add_argument("--check", metavar="PROGRAM",
+                        help="check the conversions of a host build (zoomEcuHost) instead of generating")
+    args = parser.parse_args()
+
+    overrides = dict(item.split("=", 1) for item in args.csv)
+    sensors = load_sensors(overrides)
+
+    if args.check:
+        sys.exit(1 if check(args.check, sensors) else 0)
+
+    lines = [
+        "/******************************************************************************",
+        "* File:                    CalibrationTables.c",
+        "* Author:                  David Tolsma",
+        "* Date Modified:           10/17/2026",
+        "* Breif Description:       Raw ADC to engineering unit tables. Generated by",
+        "*                          Tools/generateCalibration.py, do not edit.",
+        "*******************************************************************************",
+        "* Includes",
+        "******************************************************************************/",
+        '#include "Calibration.h"',
+        "",
+        "/******************************************************************************",
+        "* Public Variables",
+        "******************************************************************************/",
+    ]
+
+    for name, units, source, limits, model in sensors:
+        table = fit_table(build_table(model), limits, clamped(model, limits))
+        values = [lookup(table, limits, raw) for raw in range(RAW_FULL_SCALE + 1)]
+        error, at = worst_error(values, clamped(model, limits))
+        print("%-4s worst error %.2f at %.0f (%s)" % (name, error, at, units))
+
+        lines.append("// %s: %s, %s. Worst interpolation error %.2f at %.0f." % (name, units, source, error, at))
+        lines.append("const int16_t calibrationTable%s[CALIBRATION_TABLE_SIZE] = {" % name)
+        for x in range(0, len(table), 12):
+            lines.append("    " + ", ".join("%d" % v for v in table[x:x + 12]) + ",")
+        lines.append("};")
+        lines.append("const calibrationLimits_t calibrationLimits%s = {%d, %d};" % (name, limits[0], limits[1]))
+        lines.append("")
+
+    with open(args.output, "w") as f:
+        f.write("\n".join(lines))
+
+
+if __name__ == "__main__":
+    main()